@@ -0,0 +1,464 @@
+/* Parser escrito a mano: descenso recursivo sin recursión y precedencia de operadores */
+
+/* Inclusiones de bibliotecas estándar */
+#include <stdio.h>
+#include <stdlib.h>
+#include "analizador.h"
+
+/* Tamaño inicial de las pilas de expresiones */
+#define PILA_INICIAL 64
+
+/* Error sintáctico de calc-lexico.l */
+void yyerror(CompilerContext *ctx, Nodo **raiz, const char *s);
+
+/* Qué puede aparecer como operando en una posición de la expresión */
+typedef enum {
+    CUALQUIERA,                     /* E o EB */
+    SOLO_E                          /* Sólo E: operandos de + - * / == > < */
+} Contexto;
+
+/* Operando ya construido y si es booleano (EB) o aritmético (E) */
+typedef struct {
+    Nodo *nodo;
+    int es_bool;
+} Operando;
+
+/* Operador pendiente, o un '(' abierto con el contexto en que se abrió */
+typedef struct {
+    int token;                      /* PARA para un paréntesis */
+    Contexto contexto;
+    int linea, columna;             /* Dónde está, para ubicar su nodo */
+} Operador;
+
+/* Estado del parser */
+typedef struct {
+    CompilerContext *ctx;
+    const Tokens *t;
+    size_t i;                       /* Token actual */
+    Operando *operandos;
+    size_t n_operandos, cap_operandos;
+    Operador *operadores;
+    size_t n_operadores, cap_operadores;
+} Analizador;
+
+/**
+ * Devuelve el token actual sin consumirlo.
+ * @param a Parser.
+ * @return Token de Bison (0 al final).
+ */
+static int actual(const Analizador *a) {
+    int tipo = a->t->tipo[a->i];
+    return tipo ? tipo + TOKEN_BASE : 0;
+}
+
+/**
+ * Consume el token actual (el de fin nunca se consume).
+ * @param a Parser.
+ */
+static void avanzar(Analizador *a) {
+    if (a->i + 1 < a->t->n) a->i++;
+}
+
+/**
+ * Consume el token actual si es el esperado.
+ * @param a Parser.
+ * @param token Token esperado.
+ * @return 1 si estaba, 0 si no.
+ */
+static int aceptar(Analizador *a, int token) {
+    if (actual(a) != token) return 0;
+    avanzar(a);
+    return 1;
+}
+
+/**
+ * Informa un error sintáctico en el token actual, con el mismo mensaje y la
+ * misma línea que Bison.
+ * @param a Parser.
+ * @return -1, para devolverlo directamente.
+ */
+static int error_sintactico(Analizador *a) {
+    a->ctx->tokens = a->t;
+    a->ctx->token_actual = a->i + 1;
+    yyerror(a->ctx, NULL, "syntax error");
+    a->ctx->tokens = NULL;
+    return -1;
+}
+
+/**
+ * Posición del token actual en el fuente. Se pide a medida que se avanza,
+ * para que contexto_ubicar no tenga que volver atrás.
+ * @param a Parser.
+ * @param linea Devuelve la línea.
+ * @param columna Devuelve la columna.
+ */
+static void posicion(Analizador *a, int *linea, int *columna) {
+    contexto_ubicar(a->ctx, a->t->desplazamiento[a->i], linea, columna);
+}
+
+/**
+ * Ubica un nodo recién construido en el token actual.
+ * @param a Parser.
+ * @param nodo Nodo (NULL si falló su construcción).
+ * @return El mismo nodo.
+ */
+static Nodo *ubicar(Analizador *a, Nodo *nodo) {
+    int linea, columna;
+    posicion(a, &linea, &columna);
+    return nodo_ubicar(nodo, linea, columna);
+}
+
+/**
+ * Texto del ID actual: una porción del fuente.
+ * @param a Parser.
+ * @param largo Devuelve el largo del identificador.
+ * @return Inicio del identificador en ctx->fuente.
+ */
+static const char *lexema(const Analizador *a, size_t *largo) {
+    *largo = (uint32_t)a->t->valor[a->i];
+    return a->ctx->fuente + a->t->desplazamiento[a->i];
+}
+
+/**
+ * Precedencia de un operador binario (0 si el token no es un operador).
+ * Es la de los %left de calc-sintaxis.y, con las comparaciones entre && y +.
+ * @param token Token.
+ * @return Precedencia.
+ */
+static int precedencia(int token) {
+    switch (token) {
+        case OP_OR:    return 1;
+        case OP_AND:   return 2;
+        case OP_IGUAL:
+        case OP_MAYOR:
+        case OP_MENOR: return 3;
+        case OP_SUMA:
+        case OP_RESTA: return 4;
+        case OP_MULT:
+        case OP_DIV:   return 5;
+        default:       return 0;
+    }
+}
+
+/**
+ * Operación del AST que corresponde a un token operador.
+ * @param token Token.
+ * @return Operación.
+ */
+static TipoOP operacion(int token) {
+    switch (token) {
+        case OP_SUMA:  return TOP_SUMA;
+        case OP_RESTA: return TOP_RESTA;
+        case OP_MULT:  return TOP_MULT;
+        case OP_DIV:   return TOP_DIV;
+        case OP_IGUAL: return TOP_IGUAL;
+        case OP_MAYOR: return TOP_MAYOR;
+        case OP_MENOR: return TOP_MENOR;
+        case OP_AND:   return TOP_AND;
+        default:       return TOP_OR;
+    }
+}
+
+/**
+ * Apila un operando.
+ * @param a Parser.
+ * @param nodo Nodo (NULL si falló su construcción).
+ * @param es_bool 1 si es EB.
+ * @return 0, o -1 si no se pudo (con ctx->error; el nodo queda liberado).
+ */
+static int apilar_operando(Analizador *a, Nodo *nodo, int es_bool) {
+    if (!nodo) return -1;
+    if (a->n_operandos == a->cap_operandos) {
+        size_t cap = a->cap_operandos ? a->cap_operandos * 2 : PILA_INICIAL;
+        Operando *operandos = realloc(a->operandos, cap * sizeof(Operando));
+        if (!operandos) {
+            nodo_libre(a->ctx, nodo);
+            contexto_error(a->ctx, ERROR_MEMORIA, 0, 0, "sin memoria para la pila del parser");
+            return -1;
+        }
+        a->operandos = operandos;
+        a->cap_operandos = cap;
+    }
+    a->operandos[a->n_operandos].nodo = nodo;
+    a->operandos[a->n_operandos].es_bool = es_bool;
+    a->n_operandos++;
+    return 0;
+}
+
+/**
+ * Apila un operador o un paréntesis.
+ * @param a Parser.
+ * @param token Operador, o PARA.
+ * @param contexto Contexto del paréntesis.
+ * @return 0, o -1 si no hubo memoria (con ctx->error).
+ */
+static int apilar_operador(Analizador *a, int token, Contexto contexto) {
+    if (a->n_operadores == a->cap_operadores) {
+        size_t cap = a->cap_operadores ? a->cap_operadores * 2 : PILA_INICIAL;
+        Operador *operadores = realloc(a->operadores, cap * sizeof(Operador));
+        if (!operadores) {
+            contexto_error(a->ctx, ERROR_MEMORIA, 0, 0, "sin memoria para la pila del parser");
+            return -1;
+        }
+        a->operadores = operadores;
+        a->cap_operadores = cap;
+    }
+    a->operadores[a->n_operadores].token = token;
+    a->operadores[a->n_operadores].contexto = contexto;
+    posicion(a, &a->operadores[a->n_operadores].linea, &a->operadores[a->n_operadores].columna);
+    a->n_operadores++;
+    return 0;
+}
+
+/**
+ * Contexto del próximo operando: sólo E si lo va a tomar un operador
+ * aritmético o de comparación, o si está dentro de un paréntesis abierto
+ * donde sólo cabe una E.
+ * @param a Parser.
+ * @return Contexto.
+ */
+static Contexto contexto_actual(const Analizador *a) {
+    if (a->n_operadores == 0) return CUALQUIERA;
+    const Operador *op = &a->operadores[a->n_operadores - 1];
+    if (op->token == PARA) return op->contexto;
+    return precedencia(op->token) >= 3 ? SOLO_E : CUALQUIERA;
+}
+
+/**
+ * Reduce el operador del tope con sus dos operandos.
+ * @param a Parser.
+ * @return 0, o -1 si el operando derecho de && o || no es booleano o si no
+ *         se pudo crear el nodo.
+ */
+static int reducir(Analizador *a) {
+    const Operador *op = &a->operadores[--a->n_operadores];
+    int token = op->token;
+    Operando der = a->operandos[--a->n_operandos];
+    Operando *izq = &a->operandos[a->n_operandos - 1];
+    if ((token == OP_AND || token == OP_OR) && !der.es_bool) {
+        a->operandos[a->n_operandos++] = der;           /* Para liberarlo */
+        return error_sintactico(a);
+    }
+    izq->nodo = nodo_ubicar(nodo_opBin(a->ctx, operacion(token), izq->nodo, der.nodo),
+                            op->linea, op->columna);
+    izq->es_bool = precedencia(token) <= 3;
+    if (izq->nodo) return 0;
+    a->n_operandos--;                                   /* nodo_opBin liberó los dos */
+    return -1;
+}
+
+/**
+ * Reduce mientras el tope sea un operador de precedencia mayor o igual.
+ * @param a Parser.
+ * @param minima Precedencia mínima a reducir (0 = todos hasta un paréntesis).
+ * @return 0, o -1 si hubo un error.
+ */
+static int reducir_hasta(Analizador *a, int minima) {
+    while (a->n_operadores > 0) {
+        int token = a->operadores[a->n_operadores - 1].token;
+        if (token == PARA || precedencia(token) < minima) break;
+        if (reducir(a) != 0) return -1;
+    }
+    return 0;
+}
+
+/**
+ * Analiza una expresión (E o EB) con precedencia de operadores sobre pilas
+ * explícitas. Acepta lo mismo que las reglas E y EB de calc-sintaxis.y:
+ * los operandos de + - * / == > < son E, los de && y || son EB, y true,
+ * false, las comparaciones y los paréntesis que las contienen son EB.
+ * @param a Parser (el token actual es el primero de la expresión).
+ * @param expr Devuelve la expresión.
+ * @return 0, o -1 si hubo un error (ya informado y sin pérdidas de memoria).
+ */
+static int expresion(Analizador *a, Nodo **expr) {
+    int esperando_operando = 1;
+    a->n_operandos = a->n_operadores = 0;
+
+    for (;;) {
+        int token = actual(a);
+        if (esperando_operando) {
+            Contexto contexto = contexto_actual(a);
+            if (token == PARA) {
+                if (apilar_operador(a, PARA, contexto) != 0) goto error_informado;
+                avanzar(a);
+                continue;
+            }
+            int r;
+            if (token == ID) {
+                size_t largo;
+                const char *id = lexema(a, &largo);
+                r = apilar_operando(a, ubicar(a, nodo_ID(a->ctx, id, largo)), 0);
+            } else if (token == NUMERO) r = apilar_operando(a, ubicar(a, nodo_int(a->ctx, a->t->valor[a->i])), 0);
+            else if ((token == TRUE || token == FALSE) && contexto == CUALQUIERA)
+                r = apilar_operando(a, ubicar(a, nodo_bool(a->ctx, token == TRUE)), 1);
+            else goto error;
+            if (r != 0) goto error_informado;
+            avanzar(a);
+            esperando_operando = 0;
+            continue;
+        }
+
+        int prec = precedencia(token);
+        if (prec > 0) {
+            if (reducir_hasta(a, prec) != 0) goto error_informado;
+            int izq_bool = a->operandos[a->n_operandos - 1].es_bool;
+            if (prec <= 2 ? !izq_bool : izq_bool) goto error;
+            if (prec == 3 && contexto_actual(a) == SOLO_E) goto error;
+            if (apilar_operador(a, token, CUALQUIERA) != 0) goto error_informado;
+            avanzar(a);
+            esperando_operando = 1;
+            continue;
+        }
+
+        if (reducir_hasta(a, 0) != 0) goto error_informado;
+        if (token == PARC && a->n_operadores > 0) {
+            a->n_operadores--;                          /* El '(' */
+            avanzar(a);
+            continue;
+        }
+        if (a->n_operadores > 0) goto error;            /* Paréntesis sin cerrar */
+        *expr = a->operandos[0].nodo;
+        return 0;
+    }
+
+error:
+    error_sintactico(a);
+error_informado:
+    for (size_t k = 0; k < a->n_operandos; ++k) nodo_libre(a->ctx, a->operandos[k].nodo);
+    return -1;
+}
+
+/**
+ * Analiza una declaración: TIPO VAR (',' VAR)* ';'. Igual que la regla VARS,
+ * una sola variable queda sola y varias forman una secuencia anidada a la
+ * derecha.
+ * @param a Parser (el token actual es int o bool).
+ * @param decl Devuelve la declaración.
+ * @return 0, o -1 si hubo un error.
+ */
+static int declaracion(Analizador *a, Nodo **decl) {
+    Nodo *lista = NULL;
+    Nodo **cola = &lista;
+    avanzar(a);                                         /* int o bool */
+    for (;;) {
+        if (actual(a) != ID) goto error;
+        size_t largo;
+        int linea, columna;
+        const char *id = lexema(a, &largo);
+        posicion(a, &linea, &columna);
+        avanzar(a);
+        Nodo *expr = NULL;
+        if (aceptar(a, OP_ASIGN) && expresion(a, &expr) != 0) goto error_informado;
+        Nodo *var = nodo_ubicar(nodo_decl(a->ctx, id, largo, expr), linea, columna);
+        if (!var) goto error_informado;
+
+        if (aceptar(a, COMA)) {
+            if (!(*cola = nodo_seq(a->ctx, var, NULL))) goto error_informado;
+            cola = &(*cola)->opBinaria.der;
+            continue;
+        }
+        *cola = var;
+        if (!aceptar(a, PYC)) goto error;
+        *decl = lista;
+        return 0;
+    }
+
+error:
+    error_sintactico(a);
+error_informado:
+    nodo_libre(a->ctx, lista);
+    return -1;
+}
+
+/**
+ * Analiza una sentencia: ID '=' expr ';' o return [expr] ';'.
+ * @param a Parser (el token actual es ID o return).
+ * @param sent Devuelve la sentencia.
+ * @return 0, o -1 si hubo un error.
+ */
+static int sentencia(Analizador *a, Nodo **sent) {
+    Nodo *expr = NULL;
+    int linea, columna;
+    posicion(a, &linea, &columna);
+    if (aceptar(a, RETURN)) {
+        if (actual(a) != PYC && expresion(a, &expr) != 0) return -1;
+        if (!(*sent = nodo_return(a->ctx, expr))) return -1;
+    } else {
+        size_t largo;
+        const char *id = lexema(a, &largo);
+        avanzar(a);
+        if (!aceptar(a, OP_ASIGN)) return error_sintactico(a);
+        if (expresion(a, &expr) != 0) return -1;
+        if (!(*sent = nodo_assign(a->ctx, id, largo, expr))) return -1;
+    }
+    nodo_ubicar(*sent, linea, columna);
+    if (aceptar(a, PYC)) return 0;
+    nodo_libre(a->ctx, *sent);
+    return error_sintactico(a);
+}
+
+/**
+ * Analiza el programa: TIPOM main '(' ')' '{' CODIGO '}'. CODIGO es una lista
+ * de declaraciones y sentencias encadenadas con NODO_SEQ, terminada en NULL;
+ * si el contexto tiene un sumidero, cada una se le entrega en cambio.
+ * @param a Parser.
+ * @param raiz Devuelve el cuerpo del programa.
+ * @return 0, o -1 si hubo un error.
+ */
+static int programa(Analizador *a, Nodo **raiz) {
+    Nodo *codigo = NULL;
+    Nodo **cola = &codigo;
+
+    if (!aceptar(a, INT) && !aceptar(a, BOOL) && !aceptar(a, VOID)) return error_sintactico(a);
+    if (!aceptar(a, MAIN) || !aceptar(a, PARA) || !aceptar(a, PARC) || !aceptar(a, LLAA))
+        return error_sintactico(a);
+
+    for (;;) {
+        int token = actual(a);
+        Nodo *nodo;
+        int r;
+        if (token == INT || token == BOOL) r = declaracion(a, &nodo);
+        else if (token == ID || token == RETURN) r = sentencia(a, &nodo);
+        else break;
+        if (r != 0) {
+            nodo_libre(a->ctx, codigo);
+            return -1;
+        }
+        if (a->ctx->sumidero) {
+            a->ctx->sumidero(a->ctx, nodo, a->ctx->arg_sumidero);
+            if (contexto_fallo(a->ctx)) return -1;      /* Falló al ejecutarla */
+            continue;
+        }
+        if (!(*cola = nodo_seq(a->ctx, nodo, NULL))) {
+            nodo_libre(a->ctx, codigo);
+            return -1;
+        }
+        cola = &(*cola)->opBinaria.der;
+    }
+
+    if (!aceptar(a, LLAC) || actual(a) != 0) {
+        nodo_libre(a->ctx, codigo);
+        return error_sintactico(a);
+    }
+    *raiz = codigo;
+    return 0;
+}
+
+/**
+ * Analiza un arreglo de tokens con el parser escrito a mano. El fuente del
+ * que salió tiene que seguir en ctx->fuente.
+ * @param ctx Contexto de compilación.
+ * @param tokens Arreglo terminado en el token de fin.
+ * @param raiz Devuelve la raíz del AST (NULL si el programa está vacío).
+ * @return 0 si el análisis fue correcto, 1 si hubo un error (sintáctico, o
+ *         de memoria al construir el AST).
+ */
+int analizador_parsear(CompilerContext *ctx, const Tokens *tokens, Nodo **raiz) {
+    Analizador a = { ctx, tokens, 0, NULL, 0, 0, NULL, 0, 0 };
+    *raiz = NULL;
+    int r = programa(&a, raiz);
+    free(a.operandos);
+    free(a.operadores);
+    return r == 0 ? 0 : 1;
+}
@@ -0,0 +1,23 @@
+#ifndef ANALIZADOR_H
+#define ANALIZADOR_H
+
+#include "contexto.h"
+#include "tokens.h"
+
+/* ------------------ Parser escrito a mano ------------------ */
+
+/*
+ * Alternativa al parser de Bison sobre el mismo arreglo de tokens: construye
+ * exactamente el mismo AST y detecta los errores sintácticos en el mismo
+ * token. Las listas de sentencias y de variables se arman con un bucle y las
+ * expresiones con precedencia de operadores sobre pilas explícitas, así que
+ * no hay límite de profundidad (Bison corta en YYMAXDEPTH = 10000 con
+ * expresiones o listas de variables muy anidadas).
+ */
+
+/* ------------------ Prototipos de funciones ------------------ */
+
+/* Mismo contrato que contexto_parsear_tokens */
+int analizador_parsear(CompilerContext *ctx, const Tokens *tokens, Nodo **raiz);
+
+#endif /* ANALIZADOR_H */
@@ -9,80 +9,152 @@
 #include <string.h>
 #include <limits.h>
 #include <errno.h>
-#include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <spawn.h>
 #include "ast.h"
+#include "contexto.h"
+#include "recorrido.h"
+#include "serializacion.h"
+#include "perfil.h"
+
+extern char **environ;
 
 /* ------------------ Constructores y destructor de nodos ------------------ */
 
-/* Contador global para asignar IDs únicos a los nodos en la exportación DOT */
-static int contador_nodos = 0;
+/**
+ * Reserva memoria contabilizándola en las estadísticas.
+ * @param ctx Contexto de compilación.
+ * @param tam Cantidad de bytes.
+ * @return Puntero a la memoria reservada, o NULL (con ctx->error) si no hubo.
+ */
+static void *ast_malloc(CompilerContext *ctx, size_t tam) {
+    void *p = malloc(tam);
+    if (!p) {
+        contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria (%zu bytes)", tam);
+        return NULL;
+    }
+    ctx->stats.bytes += tam;
+    ctx->stats.reservas++;
+    return p;
+}
+
+/**
+ * Duplica una cadena contabilizándola en las estadísticas.
+ * @param ctx Contexto de compilación.
+ * @param s Cadena a copiar.
+ * @return Copia en memoria dinámica, o NULL si no hubo memoria.
+ */
+static char *ast_strdup(CompilerContext *ctx, const char *s) {
+    size_t tam = strlen(s) + 1;
+    char *copia = ast_malloc(ctx, tam);
+    return copia ? memcpy(copia, s, tam) : NULL;
+}
+
+/**
+ * Copia los primeros 'largo' bytes de s como cadena terminada en NUL. Los
+ * identificadores llegan del lexer como porciones del fuente, sin terminar.
+ * @param ctx Contexto de compilación.
+ * @param s Inicio del texto.
+ * @param largo Cantidad de bytes.
+ * @return Copia en memoria dinámica, o NULL si no hubo memoria.
+ */
+static char *ast_strndup(CompilerContext *ctx, const char *s, size_t largo) {
+    char *copia = ast_malloc(ctx, largo + 1);
+    if (!copia) return NULL;
+    memcpy(copia, s, largo);
+    copia[largo] = '\0';
+    return copia;
+}
+
+/**
+ * Reserva un nodo del tipo dado.
+ * @param ctx Contexto de compilación.
+ * @param tipo Tipo del nodo.
+ * @return Puntero al nodo creado, o NULL si no hubo memoria.
+ */
+static Nodo *nuevo_nodo(CompilerContext *ctx, TipoNodo tipo) {
+    Nodo *n = ast_malloc(ctx, sizeof(Nodo));
+    if (!n) return NULL;
+    n->tipo = tipo;
+    n->linea = n->columna = 0;
+    ctx->stats.nodos[tipo]++;
+    return n;
+}
+
+/**
+ * Salida de un constructor que no pudo armar su nodo: libera los hijos que
+ * recibió, para que ningún subárbol quede sin dueño, y registra el motivo si
+ * nadie registró antes la causa (un hijo que ya había fallado).
+ * @param ctx Contexto de compilación.
+ * @param motivo Qué argumento era inválido (NULL si faltó memoria).
+ * @param a Hijo recibido (o NULL).
+ * @param b Otro hijo recibido (o NULL).
+ * @return NULL, para devolverlo directamente.
+ */
+static Nodo *nodo_fallido(CompilerContext *ctx, const char *motivo, Nodo *a, Nodo *b) {
+    if (motivo) contexto_error(ctx, ERROR_INTERNO, 0, 0, "%s", motivo);
+    nodo_libre(ctx, a);
+    nodo_libre(ctx, b);
+    return NULL;
+}
 
 /**
  * Crea un nodo para un identificador (ID).
- * @param nombre El nombre del identificador.
- * @return Puntero al nodo creado.
+ * @param ctx Contexto de compilación.
+ * @param nombre El nombre del identificador (no hace falta que termine en NUL).
+ * @param largo Largo del nombre.
+ * @return Puntero al nodo creado, o NULL (con ctx->error).
  */
-Nodo *nodo_ID(char *nombre) {
-    if (!nombre) {
-        fprintf(stderr, "Error: nodo_ID recibió nombre NULL\n");
-        exit(EXIT_FAILURE);
-    }
-    Nodo *n = malloc(sizeof(Nodo));
-    if (!n) {
-        perror("malloc");
-        exit(EXIT_FAILURE);
+Nodo *nodo_ID(CompilerContext *ctx, const char *nombre, size_t largo) {
+    if (!nombre) return nodo_fallido(ctx, "nodo_ID recibió nombre NULL", NULL, NULL);
+    Nodo *n = nuevo_nodo(ctx, NODO_ID);
+    if (!n) return NULL;
+    n->nombre = ast_strndup(ctx, nombre, largo);
+    if (!n->nombre) {
+        free(n);
+        return NULL;
     }
-    n->tipo = NODO_ID;
-    n->nombre = strdup(nombre);
     return n;
 }
 
 /**
  * Crea un nodo para un valor entero.
+ * @param ctx Contexto de compilación.
  * @param val_int El valor entero.
- * @return Puntero al nodo creado.
+ * @return Puntero al nodo creado, o NULL (con ctx->error).
  */
-Nodo *nodo_int(int val_int) {
-    Nodo *n = malloc(sizeof(Nodo));
-    if (!n) {
-        perror("malloc");
-        exit(EXIT_FAILURE);
-    }
-    n->tipo = NODO_INT;
+Nodo *nodo_int(CompilerContext *ctx, int val_int) {
+    Nodo *n = nuevo_nodo(ctx, NODO_INT);
+    if (!n) return NULL;
     n->val_int = val_int;
     return n;
 }
 
 /**
  * Crea un nodo para un valor booleano.
+ * @param ctx Contexto de compilación.
  * @param val_bool El valor booleano (0 o 1).
- * @return Puntero al nodo creado.
+ * @return Puntero al nodo creado, o NULL (con ctx->error).
  */
-Nodo *nodo_bool(int val_bool) {
-    Nodo *n = malloc(sizeof(Nodo));
-    if (!n) {
-        perror("malloc");
-        exit(EXIT_FAILURE);
-    }
-    n->tipo = NODO_BOOL;
+Nodo *nodo_bool(CompilerContext *ctx, int val_bool) {
+    Nodo *n = nuevo_nodo(ctx, NODO_BOOL);
+    if (!n) return NULL;
     n->val_bool = val_bool;
     return n;
 }
 
 /**
  * Crea un nodo para una operación binaria.
+ * @param ctx Contexto de compilación.
  * @param op El tipo de operación.
  * @param izq Nodo izquierdo.
  * @param der Nodo derecho.
- * @return Puntero al nodo creado.
+ * @return Puntero al nodo creado, o NULL (con ctx->error y los hijos liberados).
  */
-Nodo *nodo_opBin(TipoOP op, Nodo *izq, Nodo *der) {
-    Nodo *n = malloc(sizeof(Nodo));
-    if (!n) {
-        perror("malloc");
-        exit(EXIT_FAILURE);
-    }
-    n->tipo = NODO_OP;
+Nodo *nodo_opBin(CompilerContext *ctx, TipoOP op, Nodo *izq, Nodo *der) {
+    Nodo *n = nuevo_nodo(ctx, NODO_OP);
+    if (!n) return nodo_fallido(ctx, NULL, izq, der);
     n->opBinaria.op = op;
     n->opBinaria.izq = izq;
     n->opBinaria.der = der;
@@ -91,106 +163,104 @@ Nodo *nodo_opBin(TipoOP op, Nodo *izq, Nodo *der) {
 
 /**
  * Crea un nodo para una asignación.
+ * @param ctx Contexto de compilación.
  * @param id El identificador a asignar.
+ * @param largo Largo del identificador.
  * @param expr La expresión a asignar.
- * @return Puntero al nodo creado.
+ * @return Puntero al nodo creado, o NULL (con ctx->error y expr liberada).
  */
-Nodo *nodo_assign(char *id, Nodo *expr) {
-    if (!id) {
-        fprintf(stderr, "Error: nodo_assign recibió id NULL\n");
-        exit(EXIT_FAILURE);
-    }
-    if (!expr) {
-        fprintf(stderr, "Error: nodo_assign recibió expr NULL\n");
-        exit(EXIT_FAILURE);
-    }
-    Nodo *n = malloc(sizeof(Nodo));
-    if (!n) {
-        perror("malloc");
-        exit(EXIT_FAILURE);
+Nodo *nodo_assign(CompilerContext *ctx, const char *id, size_t largo, Nodo *expr) {
+    if (!id) return nodo_fallido(ctx, "nodo_assign recibió id NULL", expr, NULL);
+    if (!expr) return nodo_fallido(ctx, "nodo_assign recibió expr NULL", NULL, NULL);
+    Nodo *n = nuevo_nodo(ctx, NODO_ASSIGN);
+    if (n) n->assign.id = ast_strndup(ctx, id, largo);
+    if (!n || !n->assign.id) {
+        free(n);
+        return nodo_fallido(ctx, NULL, expr, NULL);
     }
-    n->tipo = NODO_ASSIGN;
-    n->assign.id = strdup(id);
     n->assign.expr = expr;
     return n;
 }
 
 /**
  * Crea un nodo para una sentencia return.
+ * @param ctx Contexto de compilación.
  * @param expr La expresión a retornar (puede ser NULL).
- * @return Puntero al nodo creado.
+ * @return Puntero al nodo creado, o NULL (con ctx->error y expr liberada).
  */
-Nodo *nodo_return(Nodo *expr) {
-    Nodo *n = malloc(sizeof(Nodo));
-    if (!n) {
-        perror("malloc");
-        exit(EXIT_FAILURE);
-    }
-    n->tipo = NODO_RETURN;
+Nodo *nodo_return(CompilerContext *ctx, Nodo *expr) {
+    Nodo *n = nuevo_nodo(ctx, NODO_RETURN);
+    if (!n) return nodo_fallido(ctx, NULL, expr, NULL);
     n->ret_expr = expr;
     return n;
 }
 
 /**
  * Crea un nodo para una secuencia de nodos.
+ * @param ctx Contexto de compilación.
  * @param primero El primer nodo de la secuencia.
  * @param resto El resto de la secuencia.
- * @return Puntero al nodo creado.
+ * @return Puntero al nodo creado, o NULL (con ctx->error y los hijos liberados).
  */
-Nodo *nodo_seq(Nodo *primero, Nodo *resto) {
-    Nodo *n = malloc(sizeof(Nodo));
-    if (!n) {
-        perror("malloc");
-        exit(EXIT_FAILURE);
-    }
-    n->tipo = NODO_SEQ;
+Nodo *nodo_seq(CompilerContext *ctx, Nodo *primero, Nodo *resto) {
+    Nodo *n = nuevo_nodo(ctx, NODO_SEQ);
+    if (!n) return nodo_fallido(ctx, NULL, primero, resto);
     n->opBinaria.izq = primero;
     n->opBinaria.der = resto;
+    if (primero) nodo_ubicar(n, primero->linea, primero->columna);
     return n;
 }
 
 /**
  * Crea un nodo para una declaración de variable.
+ * @param ctx Contexto de compilación.
  * @param id El identificador de la variable.
+ * @param largo Largo del identificador.
  * @param expr La expresión inicial (puede ser NULL).
- * @return Puntero al nodo creado.
+ * @return Puntero al nodo creado, o NULL (con ctx->error y expr liberada).
  */
-Nodo *nodo_decl(char *id, Nodo *expr) {
-    if (!id) {
-        fprintf(stderr, "Error: nodo_decl recibió id NULL\n");
-        exit(EXIT_FAILURE);
-    }
-    Nodo *n = malloc(sizeof(Nodo));
-    if (!n) {
-        perror("malloc");
-        exit(EXIT_FAILURE);
+Nodo *nodo_decl(CompilerContext *ctx, const char *id, size_t largo, Nodo *expr) {
+    if (!id) return nodo_fallido(ctx, "nodo_decl recibió id NULL", expr, NULL);
+    Nodo *n = nuevo_nodo(ctx, NODO_DECL);
+    if (n) n->assign.id = ast_strndup(ctx, id, largo);
+    if (!n || !n->assign.id) {
+        free(n);
+        return nodo_fallido(ctx, NULL, expr, NULL);
     }
-    n->tipo = NODO_DECL;
-    n->assign.id = strdup(id);
     n->assign.expr = expr;
     return n;
 }
 
 /**
- * Libera la memoria de un nodo y sus subnodos recursivamente.
- * @param n El nodo a liberar.
+ * Anota en un nodo dónde empieza en el fuente lo que representa. Los parsers
+ * la llaman después de construirlo; una secuencia toma la de su primer
+ * elemento al crearse.
+ * @param n Nodo (puede ser NULL, si falló su construcción).
+ * @param linea Línea, desde 1.
+ * @param columna Columna en bytes, desde 1.
+ * @return El mismo nodo.
  */
-void nodo_libre(Nodo *n) {
-    if (!n) return;
+Nodo *nodo_ubicar(Nodo *n, int linea, int columna) {
+    if (n) {
+        n->linea = linea;
+        n->columna = columna;
+    }
+    return n;
+}
 
+/**
+ * Visita de nodo_libre: libera un nodo cuyos hijos ya se liberaron.
+ * @param n Nodo a liberar.
+ * @param profundidad No se usa.
+ * @param arg No se usa.
+ */
+static void liberar_visita(Nodo *n, int profundidad, void *arg) {
+    (void)profundidad;
+    (void)arg;
     switch (n->tipo) {
-        case NODO_SEQ:
-        case NODO_OP:
-            nodo_libre(n->opBinaria.izq);
-            nodo_libre(n->opBinaria.der);
-            break;
         case NODO_ASSIGN:
         case NODO_DECL:
             free(n->assign.id);
-            nodo_libre(n->assign.expr);
-            break;
-        case NODO_RETURN:
-            nodo_libre(n->ret_expr);
             break;
         case NODO_ID:
             free(n->nombre);
@@ -201,179 +271,589 @@ void nodo_libre(Nodo *n) {
     free(n);
 }
 
-/* ------------------ Exportar DOT para Graphviz ------------------ */
+/**
+ * Libera la memoria de un nodo y sus subnodos (en postorden, sin recursión).
+ * @param ctx Contexto de compilación.
+ * @param n El nodo a liberar.
+ */
+void nodo_libre(CompilerContext *ctx, Nodo *n) {
+    (void)ctx;
+    recorrido_profundo(n, NULL, liberar_visita, NULL);
+}
+
+/* ------------------ Escritura con buffer ------------------ */
+
+/* Tamaño inicial del buffer y umbral a partir del cual se vuelca */
+#define ESCRITOR_INICIAL (64 * 1024)
+#define ESCRITOR_VOLCADO (1024 * 1024)
+
+/* Salida de las pasadas que escriben mucho texto (seudo-assembly, grafo del
+   AST): el texto se arma en memoria y se escribe con write() en bloques grandes */
+typedef struct {
+    FILE *f;
+    int fd;                 /* Descriptor de f, o -1 si no tiene */
+    char *buf;
+    size_t n;
+    size_t cap;
+    int sin_memoria;        /* El buffer no pudo crecer: lo que sigue se descarta */
+    int error;              /* errno del volcado que falló (0 = ninguno): lo que sigue se descarta */
+} Escritor;
+
+/**
+ * Prepara un escritor sobre un archivo abierto.
+ * @param w Escritor.
+ * @param f Archivo de salida.
+ */
+static void escritor_abrir(Escritor *w, FILE *f) {
+    w->f = f;
+    w->fd = fileno(f);
+    w->n = 0;
+    w->cap = ESCRITOR_INICIAL;
+    w->buf = malloc(w->cap);
+    w->sin_memoria = w->buf == NULL;
+    w->error = 0;
+}
+
+/**
+ * Escribe lo acumulado en el archivo de salida. Lo que haya en el buffer de
+ * stdio de f se escribe antes, para no desordenar la salida. Si f no tiene
+ * descriptor (open_memstream en --batch) se usa fwrite. Después de un error
+ * de escritura no se intenta más: escritor_cerrar lo informa.
+ * @param w Escritor.
+ */
+static void escritor_volcar(Escritor *w) {
+    if (w->n == 0 || w->error) {
+        w->n = 0;
+        return;
+    }
+    if (w->fd < 0) {
+        if (fwrite(w->buf, 1, w->n, w->f) < w->n) w->error = errno ? errno : EIO;
+        w->n = 0;
+        return;
+    }
+    if (fflush(w->f) != 0) w->error = errno;
+    size_t hecho = 0;
+    while (!w->error && hecho < w->n) {
+        ssize_t escritos = write(w->fd, w->buf + hecho, w->n - hecho);
+        if (escritos < 0) {
+            if (errno != EINTR) w->error = errno;
+            continue;
+        }
+        hecho += (size_t)escritos;
+    }
+    w->n = 0;
+}
+
+/**
+ * Asegura lugar en el buffer para lo que se va a escribir.
+ * @param w Escritor.
+ * @param largo Bytes que se van a escribir.
+ * @return Dónde escribirlos, o NULL si no hubo memoria (no se escribe nada).
+ */
+static char *escritor_reservar(Escritor *w, size_t largo) {
+    if (w->sin_memoria) return NULL;
+    if (w->n + largo > w->cap) {
+        size_t cap = w->cap;
+        while (w->n + largo > cap) cap *= 2;
+        char *buf = realloc(w->buf, cap);
+        if (!buf) {
+            w->sin_memoria = 1;
+            return NULL;
+        }
+        w->buf = buf;
+        w->cap = cap;
+    }
+    return w->buf + w->n;
+}
+
+/**
+ * Da por escrito el texto hasta p y vuelca el buffer si pasó el umbral.
+ * @param w Escritor.
+ * @param p Posición siguiente al último carácter escrito.
+ */
+static void escritor_avanzar(Escritor *w, char *p) {
+    w->n = (size_t)(p - w->buf);
+    if (w->n >= ESCRITOR_VOLCADO) escritor_volcar(w);
+}
+
+/**
+ * Vuelca lo pendiente y libera el buffer (el archivo queda abierto). Si la
+ * salida quedó incompleta lo registra en el contexto.
+ * @param w Escritor.
+ * @param ctx Contexto de compilación.
+ * @param destino Qué se escribía, para el mensaje ("el seudo-assembly").
+ * @return 0, o -1 si faltó memoria o falló la escritura.
+ */
+static int escritor_cerrar(Escritor *w, CompilerContext *ctx, const char *destino) {
+    escritor_volcar(w);
+    free(w->buf);
+    w->buf = NULL;
+    if (w->sin_memoria) {
+        contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para escribir %s", destino);
+        return -1;
+    }
+    if (w->error) {
+        contexto_error(ctx, ERROR_ESCRITURA, 0, 0, "no se pudo escribir %s: %s", destino, strerror(w->error));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Copia una cadena sin su NUL.
+ * @param p Dónde escribir.
+ * @param s Cadena.
+ * @return Posición siguiente al último carácter.
+ */
+static char *copiar_texto(char *p, const char *s) {
+    while (*s) *p++ = *s++;
+    return p;
+}
+
+/**
+ * Escribe una cadena fija con el escritor.
+ * @param w Escritor.
+ * @param s Cadena.
+ */
+static void escritor_texto(Escritor *w, const char *s) {
+    char *p = escritor_reservar(w, strlen(s));
+    if (p) escritor_avanzar(w, copiar_texto(p, s));
+}
+
+/**
+ * Escribe un número sin signo en decimal, sin printf.
+ * @param p Dónde escribir (al menos 20 bytes).
+ * @param v Valor.
+ * @return Posición siguiente al último dígito.
+ */
+static char *formatear_cuenta(char *p, unsigned long v) {
+    char digitos[20];
+    int k = 0;
+    do {
+        digitos[k++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (k) *p++ = digitos[--k];
+    return p;
+}
 
 /**
- * Escribe recursivamente el nodo en formato DOT.
- * @param f Archivo donde escribir.
- * @param n Nodo a escribir.
+ * Escribe un entero en decimal, sin printf.
+ * @param p Dónde escribir (al menos 11 bytes).
+ * @param v Valor.
+ * @return Posición siguiente al último dígito.
+ */
+static char *formatear_entero(char *p, int v) {
+    unsigned int u = v < 0 ? 0u - (unsigned int)v : (unsigned int)v;
+    if (v < 0) *p++ = '-';
+    return formatear_cuenta(p, u);
+}
+
+/* ------------------ Exportar el AST como grafo ------------------ */
+
+/*
+ * exportar_dot escribe un nodo y una arista por cada nodo del AST, así que
+ * con árboles de millones de nodos hay que acotar lo que se escribe: pasado
+ * el presupuesto de nodos o la profundidad máxima, cada subárbol que queda se
+ * escribe como un único nodo resumen con la cantidad de nodos que tiene y
+ * cuántos hay de cada tipo. Una vez agotado el presupuesto cada subárbol
+ * pendiente cuesta un nodo, así que el total lo supera a lo sumo en la
+ * profundidad del árbol.
  */
-static void escribir_dot_rec(FILE *f, Nodo *n) {
-    if (!n) return;
 
-    int mi_id = contador_nodos++;
+/* Etiqueta más larga sin contar el identificador, y línea más larga sin la etiqueta */
+#define GRAFO_ETIQUETA 16
+#define GRAFO_LINEA 96
+
+/* Pasada de exportar_dot */
+typedef struct {
+    CompilerContext *ctx;   /* Lleva el contador de IDs */
+    Escritor w;
+    const OpcionesGrafo *og;
+    long escritos;          /* Nodos escritos, contando los resúmenes */
+} ExportacionGrafo;
+
+/* Nodos de un subárbol resumido */
+typedef struct {
+    unsigned long total;
+    unsigned long por_tipo[NODO_OP_RAPIDO + 1];
+} Resumen;
+
+/**
+ * Devuelve el texto de una operación binaria.
+ * @param op Tipo de operación.
+ * @return El operador tal como se escribe en el fuente.
+ */
+const char *texto_op(TipoOP op) {
+    switch (op) {
+        case TOP_SUMA:  return "+";
+        case TOP_RESTA: return "-";
+        case TOP_MULT:  return "*";
+        case TOP_DIV:   return "/";
+        case TOP_IGUAL: return "==";
+        case TOP_OR:    return "or";
+        case TOP_AND:   return "and";
+        case TOP_MAYOR: return ">";
+        case TOP_MENOR: return "<";
+        default:        return "?";
+    }
+}
 
+/**
+ * Largo del identificador que lleva la etiqueta de un nodo.
+ * @param n Nodo.
+ * @return Bytes del identificador (0 si no tiene).
+ */
+static size_t largo_nombre(const Nodo *n) {
     switch (n->tipo) {
-        case NODO_SEQ:
-            fprintf(f, "    nodo%d [label=\"SEQ\", style=filled, fillcolor=lightgray];\n", mi_id);
-            if (n->opBinaria.izq) {
-                fprintf(f, "    nodo%d -> nodo%d;\n", mi_id, contador_nodos);
-                escribir_dot_rec(f, n->opBinaria.izq);
-            }
-            if (n->opBinaria.der) {
-                fprintf(f, "    nodo%d -> nodo%d [style=dashed];\n", mi_id, contador_nodos);
-                escribir_dot_rec(f, n->opBinaria.der);
-            }
-            break;
+        case NODO_ID:     return strlen(n->nombre);
         case NODO_DECL:
-            fprintf(f, "    nodo%d [label=\"DECL %s\"];\n", mi_id, n->assign.id);
-            if (n->assign.expr) {
-                fprintf(f, "    nodo%d -> nodo%d;\n", mi_id, contador_nodos);
-                escribir_dot_rec(f, n->assign.expr);
-            }
-            break;
+        case NODO_ASSIGN: return strlen(n->assign.id);
+        default:          return 0;
+    }
+}
+
+/**
+ * Escribe la etiqueta de un nodo ("DECL x", "+", "42"...).
+ * @param p Dónde escribir (GRAFO_ETIQUETA más largo_nombre bytes).
+ * @param n Nodo de un tipo que exportar_dot conoce.
+ * @return Posición siguiente al último carácter.
+ */
+static char *escribir_etiqueta(char *p, const Nodo *n) {
+    switch (n->tipo) {
+        case NODO_SEQ:      return copiar_texto(p, "SEQ");
+        case NODO_DECL:     return copiar_texto(copiar_texto(p, "DECL "), n->assign.id);
+        case NODO_ASSIGN:   return copiar_texto(copiar_texto(p, "ASSIGN "), n->assign.id);
         case NODO_OP:
-            fprintf(f, "    nodo%d [label=\"%s\"];\n", mi_id,
-                    n->opBinaria.op == TOP_SUMA ? "+" :
-                    n->opBinaria.op == TOP_RESTA ? "-" :
-                    n->opBinaria.op == TOP_MULT ? "*" :
-                    n->opBinaria.op == TOP_DIV ? "/" :
-                    n->opBinaria.op == TOP_IGUAL ? "==" :
-                    n->opBinaria.op == TOP_OR ? "or" :
-                    n->opBinaria.op == TOP_AND ? "and" :
-                    n->opBinaria.op == TOP_MAYOR ? ">" :
-                    n->opBinaria.op == TOP_MENOR ? "<" : "?");
-            if (n->opBinaria.izq) {
-                fprintf(f, "    nodo%d -> nodo%d;\n", mi_id, contador_nodos);
-                escribir_dot_rec(f, n->opBinaria.izq);
-            }
-            if (n->opBinaria.der) {
-                fprintf(f, "    nodo%d -> nodo%d;\n", mi_id, contador_nodos);
-                escribir_dot_rec(f, n->opBinaria.der);
-            }
+        case NODO_OP_RAPIDO: return copiar_texto(p, texto_op(n->opBinaria.op));
+        case NODO_ID:       return copiar_texto(p, n->nombre);
+        case NODO_INT:      return formatear_entero(p, n->val_int);
+        case NODO_RETURN:   return copiar_texto(p, "RETURN");
+        default:            return p;
+    }
+}
+
+/**
+ * Escribe un nodo del AST.
+ * @param g Exportación en curso.
+ * @param n Nodo.
+ * @param id ID del nodo.
+ * @param padre ID del padre (-1 para la raíz).
+ */
+static void escribir_nodo(ExportacionGrafo *g, const Nodo *n, int id, int padre) {
+    char *p = escritor_reservar(&g->w, GRAFO_LINEA + GRAFO_ETIQUETA + largo_nombre(n));
+    if (!p) return;
+    switch (g->og->formato) {
+        case GRAFO_DOT:
+            p = formatear_entero(copiar_texto(p, "    nodo"), id);
+            p = escribir_etiqueta(copiar_texto(p, " [label=\""), n);
+            *p++ = '"';
+            if (n->tipo == NODO_SEQ) p = copiar_texto(p, ", style=filled, fillcolor=lightgray");
+            else if (n->tipo == NODO_RETURN) p = copiar_texto(p, ", style=filled, fillcolor=lightpink");
+            p = copiar_texto(p, "];\n");
             break;
-        case NODO_ID:
-            fprintf(f, "    nodo%d [label=\"%s\"];\n", mi_id, n->nombre);
+        case GRAFO_JSON:
+            p = formatear_entero(copiar_texto(p, "{\"id\":"), id);
+            p = copiar_texto(p, ",\"padre\":");
+            p = padre < 0 ? copiar_texto(p, "null") : formatear_entero(p, padre);
+            p = copiar_texto(copiar_texto(p, ",\"tipo\":\""), stats_nombre_nodo(n->tipo));
+            p = escribir_etiqueta(copiar_texto(p, "\",\"etiqueta\":\""), n);
+            p = copiar_texto(p, "\"}\n");
             break;
-        case NODO_INT:
-            fprintf(f, "    nodo%d [label=\"%d\"];\n", mi_id, n->val_int);
+        case GRAFO_ARISTAS:
             break;
-        case NODO_RETURN:
-            fprintf(f, "    nodo%d [label=\"RETURN\", style=filled, fillcolor=lightpink];\n", mi_id);
-            if (n->ret_expr) {
-                fprintf(f, "    nodo%d -> nodo%d;\n", mi_id, contador_nodos);
-                escribir_dot_rec(f, n->ret_expr);
+    }
+    escritor_avanzar(&g->w, p);
+    g->escritos++;
+}
+
+/**
+ * Visita de resumir_subarbol: cuenta un nodo.
+ * @param n Nodo.
+ * @param profundidad No se usa.
+ * @param arg El Resumen.
+ */
+static void contar_visita(Nodo *n, int profundidad, void *arg) {
+    Resumen *res = arg;
+    (void)profundidad;
+    res->total++;
+    if (n->tipo <= NODO_OP_RAPIDO) res->por_tipo[n->tipo]++;
+}
+
+/**
+ * Escribe un subárbol entero como un único nodo con la cantidad de nodos que
+ * tiene y cuántos hay de cada tipo.
+ * @param g Exportación en curso.
+ * @param n Raíz del subárbol.
+ * @param id ID del nodo resumen.
+ * @param padre ID del padre (-1 para la raíz).
+ */
+static void escribir_resumen(ExportacionGrafo *g, Nodo *n, int id, int padre) {
+    Resumen res;
+    memset(&res, 0, sizeof(res));
+    recorrido_profundo(n, contar_visita, NULL, &res);
+
+    char *p = escritor_reservar(&g->w, GRAFO_LINEA + (NODO_OP_RAPIDO + 1) * 40);
+    if (!p) return;
+    switch (g->og->formato) {
+        case GRAFO_DOT:
+            p = formatear_entero(copiar_texto(p, "    nodo"), id);
+            p = formatear_cuenta(copiar_texto(p, " [label=\""), res.total);
+            p = copiar_texto(p, " nodos");
+            for (int t = 0; t <= NODO_OP_RAPIDO; ++t) {
+                if (!res.por_tipo[t]) continue;
+                p = copiar_texto(copiar_texto(p, "\\n"), stats_nombre_nodo(t));
+                *p++ = ' ';
+                p = formatear_cuenta(p, res.por_tipo[t]);
             }
+            p = copiar_texto(p, "\", shape=note, style=\"filled,dashed\", fillcolor=lightyellow];\n");
             break;
-        case NODO_ASSIGN:
-            fprintf(f, "    nodo%d [label=\"ASSIGN %s\"];\n", mi_id, n->assign.id);
-            if (n->assign.expr) {
-                fprintf(f, "    nodo%d -> nodo%d;\n", mi_id, contador_nodos);
-                escribir_dot_rec(f, n->assign.expr);
+        case GRAFO_JSON:
+            p = formatear_entero(copiar_texto(p, "{\"id\":"), id);
+            p = copiar_texto(p, ",\"padre\":");
+            p = padre < 0 ? copiar_texto(p, "null") : formatear_entero(p, padre);
+            p = formatear_cuenta(copiar_texto(p, ",\"tipo\":\"RESUMEN\",\"nodos\":"), res.total);
+            p = copiar_texto(p, ",\"por_tipo\":{");
+            for (int t = 0, primero = 1; t <= NODO_OP_RAPIDO; ++t) {
+                if (!res.por_tipo[t]) continue;
+                if (!primero) *p++ = ',';
+                primero = 0;
+                p = copiar_texto(copiar_texto(p, "\""), stats_nombre_nodo(t));
+                p = formatear_cuenta(copiar_texto(p, "\":"), res.por_tipo[t]);
             }
+            p = copiar_texto(p, "}}\n");
             break;
-        default:
-            fprintf(stderr, "Warning: tipo de nodo desconocido %d en escribir_dot_rec\n", n->tipo);
+        case GRAFO_ARISTAS:
+            break;
+    }
+    escritor_avanzar(&g->w, p);
+    g->escritos++;
+}
+
+/**
+ * Escribe la arista de un nodo a su hijo (el JSON no las lleva: cada nodo
+ * dice quién es su padre).
+ * @param g Exportación en curso.
+ * @param padre ID del padre.
+ * @param hijo ID del hijo.
+ * @param punteada 1 para el resto de una secuencia.
+ */
+static void escribir_arista(ExportacionGrafo *g, int padre, int hijo, int punteada) {
+    char *p = escritor_reservar(&g->w, GRAFO_LINEA);
+    if (!p) return;
+    switch (g->og->formato) {
+        case GRAFO_DOT:
+            p = formatear_entero(copiar_texto(p, "    nodo"), padre);
+            p = formatear_entero(copiar_texto(p, " -> nodo"), hijo);
+            if (punteada) p = copiar_texto(p, " [style=dashed]");
+            p = copiar_texto(p, ";\n");
+            break;
+        case GRAFO_ARISTAS:
+            p = formatear_entero(p, padre);
+            *p++ = '\t';
+            p = formatear_entero(p, hijo);
+            *p++ = '\n';
+            break;
+        case GRAFO_JSON:
             break;
     }
+    escritor_avanzar(&g->w, p);
 }
 
 /**
- * Exporta el AST a un archivo DOT y genera una imagen PNG usando Graphviz.
+ * Paso de la exportación: al entrar escribe el nodo con su ID (que queda en
+ * m->dato; hasta entonces m->dato es el ID del padre) o, si ya no entra en
+ * los límites, el resumen de su subárbol. Antes de bajar a cada hijo escribe
+ * la arista hacia él.
+ * @param r Recorrido.
+ * @param m Marco del nodo.
+ * @param arg La ExportacionGrafo.
+ * @return Qué sigue.
+ */
+static int paso_dot(Recorrido *r, Marco *m, void *arg) {
+    ExportacionGrafo *g = arg;
+    CompilerContext *ctx = g->ctx;
+    Nodo *n = m->nodo;
+
+    if (g->w.sin_memoria) return RECORRIDO_ABORTAR;
+    if (m->paso == 0) {
+        int padre = m->dato;
+        m->dato = ctx->contador_nodos++;
+        if (recorrido_hijo(n, 0) || recorrido_hijo(n, 1)) {
+            int profundidad = r->n - 1;
+            if ((g->og->max_profundidad && profundidad + 1 >= g->og->max_profundidad) ||
+                (g->og->max_nodos && g->escritos >= g->og->max_nodos)) {
+                escribir_resumen(g, n, m->dato, padre);
+                return RECORRIDO_FIN;
+            }
+        }
+        switch (n->tipo) {
+            case NODO_SEQ:
+            case NODO_DECL:
+            case NODO_OP:
+            case NODO_OP_RAPIDO:
+            case NODO_ID:
+            case NODO_INT:
+            case NODO_RETURN:
+            case NODO_ASSIGN:
+                escribir_nodo(g, n, m->dato, padre);
+                break;
+            default:
+                fprintf(stderr, "Warning: tipo de nodo desconocido %d en exportar_dot\n", n->tipo);
+                return RECORRIDO_FIN;
+        }
+    }
+
+    while (m->paso < 2) {
+        int i = m->paso++;
+        Nodo *hijo = recorrido_hijo(n, i);
+        if (!hijo) continue;
+        /* El resto de la secuencia va punteado */
+        escribir_arista(g, m->dato, ctx->contador_nodos, n->tipo == NODO_SEQ && i == 1);
+        return recorrido_bajar(r, hijo, m->dato);
+    }
+    return RECORRIDO_FIN;
+}
+
+/**
+ * Lanza Graphviz para convertir el .dot en PNG, sin shell y sin esperarlo:
+ * el hijo corre en su propio grupo de procesos (un Ctrl-C a calc no lo
+ * interrumpe) con la E/S estándar en /dev/null. Cuando calc termina, init
+ * lo adopta.
+ * @param dot_file Archivo DOT ya escrito.
+ * @param png_file Imagen a generar.
+ */
+static void renderizar_png(const char *dot_file, const char *png_file) {
+    char *const argv[] = { "dot", "-Tpng", (char *)dot_file, "-o", (char *)png_file, NULL };
+    posix_spawn_file_actions_t acciones;
+    posix_spawnattr_t atributos;
+    pid_t pid;
+
+    posix_spawn_file_actions_init(&acciones);
+    posix_spawn_file_actions_addopen(&acciones, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&acciones, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&acciones, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawnattr_init(&atributos);
+    posix_spawnattr_setflags(&atributos, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&atributos, 0);
+
+    int error = posix_spawnp(&pid, "dot", &acciones, &atributos, argv, environ);
+    if (error) fprintf(stderr, "Aviso: no se pudo ejecutar dot: %s\n", strerror(error));
+
+    posix_spawnattr_destroy(&atributos);
+    posix_spawn_file_actions_destroy(&acciones);
+}
+
+/**
+ * Exporta el AST como grafo: en DOT para Graphviz (y, si se pide, genera la
+ * imagen PNG en segundo plano), en JSON (un objeto por nodo y por línea) o
+ * como lista de aristas ("padre<TAB>hijo" por línea). Los dos últimos se
+ * pueden leer a medida que se escriben.
+ * @param ctx Contexto de compilación.
  * @param nodo Raíz del AST.
  * @param filename Nombre base del archivo (sin extensión).
+ * @param og Formato y límites de la exportación.
  */
-void exportar_dot(Nodo *nodo, const char *filename) {
-    char dot_file[PATH_MAX];
+void exportar_dot(CompilerContext *ctx, Nodo *nodo, const char *filename, const OpcionesGrafo *og) {
+    static const char *const extensiones[] = { ".dot", ".jsonl", ".tsv" };
+    char archivo[PATH_MAX];
     char png_file[PATH_MAX];
-    char command[PATH_MAX * 2 + 80];
 
-    snprintf(dot_file, sizeof(dot_file), "%s.dot", filename);
+    snprintf(archivo, sizeof(archivo), "%s%s", filename, extensiones[og->formato]);
     snprintf(png_file, sizeof(png_file), "%s.png", filename);
 
-    FILE *f = fopen(dot_file, "w");
+    char destino[PATH_MAX + 2];
+    snprintf(destino, sizeof(destino), "'%s'", archivo);
+    FILE *f = fopen(archivo, "w");
     if (!f) {
-        perror("Error al crear archivo DOT");
+        contexto_error(ctx, ERROR_ESCRITURA, 0, 0, "no se pudo crear %s: %s", destino, strerror(errno));
         return;
     }
 
-    fprintf(f, "digraph AST {\n");
-    fprintf(f, "    node [shape=box, fontname=\"Arial\"];\n");
+    ExportacionGrafo g = { ctx, { 0 }, og, 0 };
+    escritor_abrir(&g.w, f);
+    if (og->formato == GRAFO_DOT)
+        escritor_texto(&g.w, "digraph AST {\n    node [shape=box, fontname=\"Arial\"];\n");
 
-    contador_nodos = 0;
-    escribir_dot_rec(f, nodo);
+    ctx->contador_nodos = 0;
+    int sin_memoria = 0;
+    if (nodo) {
+        Recorrido r;
+        recorrido_ejecutar(&r, nodo, -1, paso_dot, &g);
+        sin_memoria = r.sin_memoria;
+    }
 
-    fprintf(f, "}\n");
-    fclose(f);
+    if (og->formato == GRAFO_DOT) escritor_texto(&g.w, "}\n");
+    int error = escritor_cerrar(&g.w, ctx, destino);
+    if (sin_memoria) contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para exportar %s", destino);
+    if (fclose(f) != 0 && !error) {
+        contexto_error(ctx, ERROR_ESCRITURA, 0, 0, "no se pudo escribir %s: %s", destino, strerror(errno));
+        error = -1;
+    }
 
-    snprintf(command, sizeof(command), "dot -Tpng %s -o %s 2>/dev/null", dot_file, png_file);
-    system(command);
+    if (!error && !sin_memoria && og->formato == GRAFO_DOT && og->png) renderizar_png(archivo, png_file);
 }
 
 /* ------------------ Tabla de símbolos simple ------------------ */
 
-/* Tamaño máximo de la tabla de símbolos */
-#define MAX_SIMBOLOS 1024
-
-/**
- * Estructura para un símbolo en la tabla.
- */
-typedef struct {
-    char *id;           /* Nombre del símbolo */
-    int valor;          /* Valor (entero o booleano 0/1) */
-    int es_bool;        /* 0 = int, 1 = bool */
-    int inicializado;   /* 0 = no inicializado, 1 = inicializado */
-} Simbolo;
-
-/* Tabla de símbolos estática */
-static Simbolo tabla[MAX_SIMBOLOS];
-static int tabla_size = 0;
+/* La tabla (Simbolo, MAX_SIMBOLOS) vive en el CompilerContext, ver contexto.h */
 
 /**
  * Busca un símbolo en la tabla por su ID.
+ * @param ctx Contexto de compilación.
  * @param id El identificador a buscar.
  * @return Puntero al símbolo si existe, NULL en caso contrario.
  */
-static Simbolo* buscar_simbolo(const char *id) {
-    for (int i = 0; i < tabla_size; ++i) {
-        if (strcmp(tabla[i].id, id) == 0) return &tabla[i];
+static Simbolo* buscar_simbolo(CompilerContext *ctx, const char *id) {
+    ctx->stats.busquedas++;
+    for (int i = 0; i < ctx->tabla_size; ++i) {
+        ctx->stats.comparaciones++;
+        if (strcmp(ctx->tabla[i].id, id) == 0) return &ctx->tabla[i];
     }
     return NULL;
 }
 
 /**
  * Declara un nuevo símbolo en la tabla.
+ * @param ctx Contexto de compilación.
  * @param id Identificador.
  * @param valor Valor inicial.
  * @param es_bool Tipo (0=int, 1=bool).
  * @param inicializado Estado de inicialización.
+ * @param linea Línea de la declaración, para los errores.
+ * @param columna Columna de la declaración.
  */
-static void declarar_simbolo(const char *id, int valor, int es_bool, int inicializado) {
-    if (buscar_simbolo(id)) {
-        fprintf(stderr, "Error: variable '%s' ya declarada\n", id);
-        exit(EXIT_FAILURE);
+static void declarar_simbolo(CompilerContext *ctx, const char *id, int valor, int es_bool, int inicializado,
+                             int linea, int columna) {
+    if (buscar_simbolo(ctx, id)) {
+        contexto_error(ctx, ERROR_REDECLARADA, linea, columna, "variable '%s' ya declarada", id);
+        return;
     }
-    if (tabla_size >= MAX_SIMBOLOS) {
-        fprintf(stderr, "Error: tabla de símbolos llena\n");
-        exit(EXIT_FAILURE);
+    if (ctx->tabla_size >= MAX_SIMBOLOS) {
+        contexto_error(ctx, ERROR_TABLA_LLENA, linea, columna, "tabla de símbolos llena");
+        return;
     }
-    tabla[tabla_size].id = strdup(id);
-    tabla[tabla_size].valor = valor;
-    tabla[tabla_size].es_bool = es_bool;
-    tabla[tabla_size].inicializado = inicializado;
-    tabla_size++;
+    ctx->tabla[ctx->tabla_size].id = ast_strdup(ctx, id);
+    if (!ctx->tabla[ctx->tabla_size].id) return;
+    ctx->tabla[ctx->tabla_size].valor = valor;
+    ctx->tabla[ctx->tabla_size].es_bool = es_bool;
+    ctx->tabla[ctx->tabla_size].inicializado = inicializado;
+    ctx->tabla_size++;
 }
 
 /**
  * Asigna un valor a un símbolo existente.
+ * @param ctx Contexto de compilación.
  * @param id Identificador.
  * @param valor Nuevo valor.
+ * @param linea Línea de la asignación, para los errores.
+ * @param columna Columna de la asignación.
  */
-static void asignar_simbolo(const char *id, int valor) {
-    Simbolo *s = buscar_simbolo(id);
+static void asignar_simbolo(CompilerContext *ctx, const char *id, int valor, int linea, int columna) {
+    Simbolo *s = buscar_simbolo(ctx, id);
     if (!s) {
-        fprintf(stderr, "Error: asignación a variable no declarada '%s'\n", id);
-        exit(EXIT_FAILURE);
+        contexto_error(ctx, ERROR_NO_DECLARADA, linea, columna, "asignación a variable no declarada '%s'", id);
+        return;
     }
     s->valor = valor;
     s->inicializado = 1;
@@ -381,134 +861,470 @@ static void asignar_simbolo(const char *id, int valor) {
 
 /**
  * Libera la memoria de la tabla de símbolos.
+ * @param ctx Contexto de compilación.
  */
-static void liberar_tabla_simbolos(void) {
-    for (int i = 0; i < tabla_size; ++i) {
-        free(tabla[i].id);
+static void liberar_tabla_simbolos(CompilerContext *ctx) {
+    for (int i = 0; i < ctx->tabla_size; ++i) {
+        free(ctx->tabla[i].id);
     }
-    tabla_size = 0;
+    ctx->tabla_size = 0;
 }
 
 /* ------------------ Evaluador / intérprete ------------------ */
 
 /**
- * Evalúa un nodo del AST y retorna su valor.
- * @param n Nodo a evaluar.
- * @return Valor resultante de la evaluación.
+ * Aplica una operación binaria ya evaluados ambos operandos.
+ * @param ctx Contexto de compilación (para informar errores).
+ * @param op Operación.
+ * @param izq Valor izquierdo.
+ * @param der Valor derecho.
+ * @param linea Línea de la operación, para los errores.
+ * @param columna Columna de la operación.
+ * @return Resultado.
  */
-int eval_nodo(Nodo *n) {
-    if (!n) return 0;
+static inline int aplicar_op(CompilerContext *ctx, TipoOP op, int izq, int der, int linea, int columna) {
+    switch (op) {
+        case TOP_SUMA:  return izq + der;
+        case TOP_RESTA: return izq - der;
+        case TOP_MULT:  return izq * der;
+        case TOP_DIV:
+            if (der == 0) return contexto_error(ctx, ERROR_DIVISION_CERO, linea, columna, "división por cero");
+            /* INT_MIN / -1 no entra en un int (y x86 lo atrapa con SIGFPE):
+               dividir por -1 es negar en complemento a dos, que da INT_MIN */
+            if (der == -1) return (int)(0u - (unsigned)izq);
+            return izq / der;
+        case TOP_IGUAL: return izq == der;
+        case TOP_OR:    return (izq != 0) || (der != 0);
+        case TOP_AND:   return (izq != 0) && (der != 0);
+        case TOP_MAYOR: return izq > der;
+        case TOP_MENOR: return izq < der;
+        default:
+            return contexto_error(ctx, ERROR_NODO_DESCONOCIDO, linea, columna,
+                                  "operación binaria desconocida %d", op);
+    }
+}
+
+/**
+ * Paso del evaluador: deja el valor de cada nodo en r->valor. Las secuencias
+ * siguen con su resto en el mismo marco y cortan después de un return.
+ * @param r Recorrido.
+ * @param m Marco del nodo.
+ * @param arg Contexto de compilación.
+ * @return Qué sigue.
+ */
+static int paso_eval(Recorrido *r, Marco *m, void *arg) {
+    CompilerContext *ctx = arg;
+    Nodo *n = m->nodo;
+    if (!n) {
+        r->valor = 0;
+        return RECORRIDO_FIN;
+    }
 
     switch (n->tipo) {
         case NODO_INT:
-            return n->val_int;
+            r->valor = n->val_int;
+            return RECORRIDO_FIN;
         case NODO_BOOL:
-            return n->val_bool ? 1 : 0;
+            r->valor = n->val_bool ? 1 : 0;
+            return RECORRIDO_FIN;
         case NODO_ID: {
-            Simbolo *s = buscar_simbolo(n->nombre);
+            Simbolo *s = buscar_simbolo(ctx, n->nombre);
             if (!s) {
-                fprintf(stderr, "Error: variable '%s' no declarada\n", n->nombre);
-                exit(EXIT_FAILURE);
+                contexto_error(ctx, ERROR_NO_DECLARADA, n->linea, n->columna, "variable '%s' no declarada",
+                               n->nombre);
+                return RECORRIDO_ABORTAR;
             }
             if (!s->inicializado) {
-                fprintf(stderr, "Error: variable '%s' usada sin inicializar\n", n->nombre);
-                exit(EXIT_FAILURE);
+                contexto_error(ctx, ERROR_SIN_INICIALIZAR, n->linea, n->columna,
+                               "variable '%s' usada sin inicializar", n->nombre);
+                return RECORRIDO_ABORTAR;
             }
-            return s->valor;
+            r->valor = s->valor;
+            return RECORRIDO_FIN;
         }
-        case NODO_DECL: {
-            int inicializado = 0;
-            int valor = 0;
-            if (n->assign.expr) {
-                valor = eval_nodo(n->assign.expr);
-                inicializado = 1;
+        case NODO_DECL:
+            if (m->paso == 0 && n->assign.expr) {
+                m->paso = 1;
+                return recorrido_bajar(r, n->assign.expr, 0);
             }
-            declarar_simbolo(n->assign.id, valor, 0, inicializado);
-            return 0;
-        }
-        case NODO_ASSIGN: {
-            int valor = eval_nodo(n->assign.expr);
-            asignar_simbolo(n->assign.id, valor);
-            return valor;
-        }
-        case NODO_OP: {
-            int izq = eval_nodo(n->opBinaria.izq);
-            int der = eval_nodo(n->opBinaria.der);
-            switch (n->opBinaria.op) {
-                case TOP_SUMA:  return izq + der;
-                case TOP_RESTA: return izq - der;
-                case TOP_MULT:  return izq * der;
-                case TOP_DIV:
-                    if (der == 0) {
-                        fprintf(stderr, "Error: división por cero\n");
-                        exit(EXIT_FAILURE);
-                    }
-                    return izq / der;
-                case TOP_IGUAL: return izq == der;
-                case TOP_OR:    return (izq != 0) || (der != 0);
-                case TOP_AND:   return (izq != 0) && (der != 0);
-                case TOP_MAYOR: return izq > der;
-                case TOP_MENOR: return izq < der;
-                default:
-                    fprintf(stderr, "Error: operación binaria desconocida %d\n", n->opBinaria.op);
-                    exit(EXIT_FAILURE);
+            /* paso 1: r->valor es el de la expresión inicial */
+            declarar_simbolo(ctx, n->assign.id, m->paso ? r->valor : 0, 0, m->paso, n->linea, n->columna);
+            r->valor = 0;
+            return contexto_fallo(ctx) ? RECORRIDO_ABORTAR : RECORRIDO_FIN;
+        case NODO_ASSIGN:
+            if (m->paso == 0) {
+                m->paso = 1;
+                return recorrido_bajar(r, n->assign.expr, 0);
             }
-        }
-        case NODO_SEQ: {
-            int resultado = 0;
-            if (n->opBinaria.izq) {
-                resultado = eval_nodo(n->opBinaria.izq);
-                if (n->opBinaria.izq->tipo == NODO_RETURN) return resultado;
+            asignar_simbolo(ctx, n->assign.id, r->valor, n->linea, n->columna);
+            return contexto_fallo(ctx) ? RECORRIDO_ABORTAR : RECORRIDO_FIN;
+        case NODO_OP:
+        case NODO_OP_RAPIDO:
+            switch (m->paso) {
+                case 0:
+                    m->paso = 1;
+                    return recorrido_bajar(r, n->opBinaria.izq, 0);
+                case 1:
+                    m->valor = r->valor;
+                    m->paso = 2;
+                    return recorrido_bajar(r, n->opBinaria.der, 0);
             }
-            if (n->opBinaria.der) {
-                resultado = eval_nodo(n->opBinaria.der);
-                if (n->opBinaria.der->tipo == NODO_RETURN) return resultado;
+            r->valor = aplicar_op(ctx, n->opBinaria.op, m->valor, r->valor, n->linea, n->columna);
+            return contexto_fallo(ctx) ? RECORRIDO_ABORTAR : RECORRIDO_FIN;
+        case NODO_SEQ:
+            if (m->paso == 0) {
+                m->paso = 1;
+                if (n->opBinaria.izq) return recorrido_bajar(r, n->opBinaria.izq, 0);
+                r->valor = 0;
             }
-            return resultado;
+            /* El valor de la secuencia es el de su última sentencia */
+            if (n->opBinaria.izq && n->opBinaria.izq->tipo == NODO_RETURN) return RECORRIDO_FIN;
+            if (n->opBinaria.der) return recorrido_seguir(r, n->opBinaria.der, 0);
+            return RECORRIDO_FIN;
+        case NODO_RETURN:
+            return recorrido_seguir(r, n->ret_expr, 0);
+        default:
+            contexto_error(ctx, ERROR_NODO_DESCONOCIDO, n->linea, n->columna,
+                           "eval_nodo no soporta tipo de nodo %d", n->tipo);
+            return RECORRIDO_ABORTAR;
+    }
+}
+
+/**
+ * Paso del evaluador con --profile: ejecuta paso_eval y le carga al nodo los
+ * ciclos de la llamada. El dato de cada marco lleva el registro de su nodo
+ * más uno (al apilarlo, el del padre): así el nodo se busca en el perfil una
+ * sola vez, al entrar. El hijo de una secuencia cuelga del padre de ella.
+ * @param r Recorrido.
+ * @param m Marco del nodo.
+ * @param arg Contexto de compilación (ctx->perfil no es NULL).
+ * @return Qué sigue.
+ */
+static int paso_perfil(Recorrido *r, Marco *m, void *arg) {
+    CompilerContext *ctx = arg;
+    Perfil *p = ctx->perfil;
+    if (m->paso == 0 && m->nodo) {
+        int registro = perfil_entrar(p, m->nodo, m->dato - 1);
+        if (registro < 0) {
+            contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para el perfil");
+            return RECORRIDO_ABORTAR;
         }
-        case NODO_RETURN: {
-            if (!n->ret_expr) return 0;
-            return eval_nodo(n->ret_expr);
+        m->dato = registro + 1;
+    }
+    int registro = m->dato - 1;         /* Un nodo NULL se le carga al padre */
+
+    uint64_t t0 = perfil_ciclos();
+    int sigue = paso_eval(r, m, arg);
+    uint64_t ciclos = perfil_ciclos() - t0;
+
+    if (registro < 0) return sigue;
+    p->registros[registro].propio += ciclos;
+    if (sigue == RECORRIDO_BAJAR || sigue == RECORRIDO_SEGUIR) {
+        int padre = m->nodo && m->nodo->tipo == NODO_SEQ ? p->registros[registro].padre : registro;
+        r->dato_hijo = padre + 1;
+    }
+    return sigue;
+}
+
+/**
+ * Evalúa un nodo del AST y retorna su valor. Si ctx->perfil no es NULL,
+ * además mide cada nodo (ver perfil.h).
+ * @param ctx Contexto de compilación.
+ * @param n Nodo a evaluar.
+ * @return Valor resultante de la evaluación (0 si hubo un error: queda en
+ *         ctx->error).
+ */
+int eval_nodo(CompilerContext *ctx, Nodo *n) {
+    if (!n) return 0;
+    Recorrido r;
+    /* Dos llamadas para que cada una integre su función de paso */
+    int valor = ctx->perfil ? recorrido_ejecutar(&r, n, 0, paso_perfil, ctx)
+                            : recorrido_ejecutar(&r, n, 0, paso_eval, ctx);
+    if (r.sin_memoria) contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para evaluar");
+    return contexto_fallo(ctx) ? 0 : valor;
+}
+
+/**
+ * Evalúa un AST plano directamente sobre los datos mapeados, con el mismo
+ * resultado, efectos y errores que eval_nodo sobre el AST reconstruido. Como
+ * los nodos están en postorden, basta recorrerlos en orden con una pila de
+ * valores: cada nodo toma los de sus hijos y deja el suyo. Un return que abre
+ * una secuencia salta a ella, sin evaluar el resto.
+ * @param ctx Contexto de compilación.
+ * @param p AST plano abierto con plano_abrir.
+ * @return Valor del programa.
+ */
+int eval_plano(CompilerContext *ctx, const AstPlano *p) {
+    int32_t n = (int32_t)p->cabecera->n_nodos;
+    if (n == 0) return 0;
+    int *pila = malloc(n * sizeof(int));
+    if (!pila) return contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para evaluar");
+    int tope = 0;
+
+    for (int32_t i = 0; i < n && !contexto_fallo(ctx); ++i) {
+        const NodoPlano *np = &p->nodos[i];
+        int izq, der;
+        switch (np->tipo) {
+            case NODO_INT:
+                pila[tope++] = np->a;
+                break;
+            case NODO_BOOL:
+                pila[tope++] = np->a ? 1 : 0;
+                break;
+            case NODO_ID: {
+                const char *nombre = plano_cadena(p, np->a);
+                Simbolo *s = buscar_simbolo(ctx, nombre);
+                if (!s)
+                    contexto_error(ctx, ERROR_NO_DECLARADA, np->linea, np->columna,
+                                   "variable '%s' no declarada", nombre);
+                else if (!s->inicializado)
+                    contexto_error(ctx, ERROR_SIN_INICIALIZAR, np->linea, np->columna,
+                                   "variable '%s' usada sin inicializar", nombre);
+                pila[tope++] = s ? s->valor : 0;
+                break;
+            }
+            case NODO_DECL:
+                if (np->b != PLANO_NINGUNO)
+                    declarar_simbolo(ctx, plano_cadena(p, np->a), pila[--tope], 0, 1, np->linea, np->columna);
+                else declarar_simbolo(ctx, plano_cadena(p, np->a), 0, 0, 0, np->linea, np->columna);
+                pila[tope++] = 0;
+                break;
+            case NODO_ASSIGN:
+                asignar_simbolo(ctx, plano_cadena(p, np->a), pila[tope - 1], np->linea, np->columna);
+                break;
+            case NODO_OP:
+                der = np->b != PLANO_NINGUNO ? pila[--tope] : 0;
+                izq = np->a != PLANO_NINGUNO ? pila[--tope] : 0;
+                pila[tope++] = aplicar_op(ctx, (TipoOP)np->op, izq, der, np->linea, np->columna);
+                break;
+            case NODO_SEQ:
+                /* El valor de la secuencia es el de su última sentencia */
+                if (np->a != PLANO_NINGUNO && p->nodos[np->a].tipo == NODO_RETURN) break;
+                der = np->b != PLANO_NINGUNO ? pila[--tope] : 0;
+                izq = np->a != PLANO_NINGUNO ? pila[--tope] : 0;
+                pila[tope++] = np->b != PLANO_NINGUNO ? der : izq;
+                break;
+            case NODO_RETURN:
+                if (np->a == PLANO_NINGUNO) pila[tope++] = 0;
+                if (np->b != PLANO_NINGUNO) i = np->b - 1;
+                break;
+        }
+    }
+
+    int resultado = contexto_fallo(ctx) ? 0 : pila[tope - 1];
+    free(pila);
+    return resultado;
+}
+
+/* ------------------ Evaluador con nodos autoespecializados ------------------ */
+
+/*
+ * La primera vez que eval_especializado ejecuta un NODO_OP lo reescribe en el
+ * lugar como NODO_OP_RAPIDO: guarda en una sola "variante" la operación y la
+ * forma de cada operando (slot de la tabla, constante o subexpresión) y ya
+ * resuelve las variables a índices de la tabla. Las ejecuciones siguientes del
+ * mismo árbol saltan directamente al caso de esa variante.
+ *
+ * Los slots son válidos porque el lenguaje no tiene saltos: partiendo de la
+ * tabla vacía, cada ejecución del mismo árbol declara las variables en el mismo
+ * orden. La guardia sólo verifica que la tabla tenga al menos esos símbolos; si
+ * no, el nodo vuelve a NODO_OP y se especializa de nuevo. No mira qué símbolos
+ * son: un árbol especializado sólo puede volver a ejecutarse sobre una tabla
+ * vacía o reconstruida por ese mismo programa. Sobre la tabla de otro programa
+ * leería los slots de otras variables sin ningún error.
+ */
+
+/* Formas de un operando especializado */
+enum { RAP_SLOT, RAP_CONST, RAP_EXPR };
+
+/* Número de variante para una operación y las formas de sus operandos */
+#define RAP_VARIANTE(op, fa, fb) (((op) * 3 + (fa)) * 3 + (fb))
+
+/* variante y guardia son de 16 bits, para que Nodo no crezca */
+_Static_assert(RAP_VARIANTE(TOP_MENOR, RAP_EXPR, RAP_EXPR) <= UINT16_MAX, "variante de 16 bits");
+_Static_assert(MAX_SIMBOLOS <= UINT16_MAX, "guardia de 16 bits");
+
+/**
+ * Clasifica un operando y, si es una variable, hace los controles genéricos
+ * una única vez y la resuelve a su slot.
+ * @param ctx Contexto de compilación.
+ * @param n Nodo del operando.
+ * @param valor Slot o constante, según la forma.
+ * @return Forma del operando.
+ */
+static int forma_operando(CompilerContext *ctx, Nodo *n, int *valor) {
+    *valor = 0;
+    if (!n) return RAP_CONST;
+    switch (n->tipo) {
+        case NODO_INT:
+            *valor = n->val_int;
+            return RAP_CONST;
+        case NODO_BOOL:
+            *valor = n->val_bool ? 1 : 0;
+            return RAP_CONST;
+        case NODO_ID: {
+            /* Si la variable no es válida queda como subexpresión, para que
+               eval_nodo informe el error en el mismo orden de siempre */
+            Simbolo *s = buscar_simbolo(ctx, n->nombre);
+            if (!s || !s->inicializado) return RAP_EXPR;
+            *valor = (int)(s - ctx->tabla);
+            return RAP_SLOT;
         }
         default:
-            fprintf(stderr, "Error: eval_nodo no soporta tipo de nodo %d\n", n->tipo);
-            exit(EXIT_FAILURE);
+            return RAP_EXPR;
     }
 }
 
+/**
+ * Reescribe un NODO_OP como NODO_OP_RAPIDO.
+ * @param ctx Contexto de compilación.
+ * @param n Nodo a especializar.
+ */
+static void especializar_op(CompilerContext *ctx, Nodo *n) {
+    TipoOP op = n->opBinaria.op;
+    if (op == TOP_ASSIGN || op > TOP_MENOR) return;   /* eval_nodo informa el error */
+
+    int a, b;
+    int fa = forma_operando(ctx, n->opBinaria.izq, &a);
+    int fb = forma_operando(ctx, n->opBinaria.der, &b);
+    int guardia = 0;
+    if (fa == RAP_SLOT && a + 1 > guardia) guardia = a + 1;
+    if (fb == RAP_SLOT && b + 1 > guardia) guardia = b + 1;
+
+    n->tipo = NODO_OP_RAPIDO;
+    n->opRapida.variante = (uint16_t)RAP_VARIANTE(op, fa, fb);
+    n->opRapida.a = a;
+    n->opRapida.b = b;
+    n->opRapida.guardia = (uint16_t)guardia;
+}
+
+/* Lectura de un operando según su forma: las subexpresiones ya se evaluaron,
+   la izquierda quedó en m->valor y la derecha en r->valor */
+#define RAP_OPERANDO_RAP_SLOT(v, sub)  (ctx->tabla[v].valor)
+#define RAP_OPERANDO_RAP_CONST(v, sub) (v)
+#define RAP_OPERANDO_RAP_EXPR(v, sub)  (sub)
+
+/* Un caso del switch por cada combinación de operación y formas */
+#define RAP_CASO(op, fa, fb)                                            \
+    case RAP_VARIANTE(op, fa, fb):                                     \
+        r->valor = aplicar_op(ctx, op,                                 \
+                              RAP_OPERANDO_##fa(n->opRapida.a, m->valor), \
+                              RAP_OPERANDO_##fb(n->opRapida.b, r->valor), \
+                              n->linea, n->columna);                     \
+        break;
+#define RAP_CASOS(op)                                                   \
+    RAP_CASO(op, RAP_SLOT, RAP_SLOT)  RAP_CASO(op, RAP_SLOT, RAP_CONST)  \
+    RAP_CASO(op, RAP_SLOT, RAP_EXPR)  RAP_CASO(op, RAP_CONST, RAP_SLOT)  \
+    RAP_CASO(op, RAP_CONST, RAP_CONST) RAP_CASO(op, RAP_CONST, RAP_EXPR) \
+    RAP_CASO(op, RAP_EXPR, RAP_SLOT)  RAP_CASO(op, RAP_EXPR, RAP_CONST)  \
+    RAP_CASO(op, RAP_EXPR, RAP_EXPR)
+
+/**
+ * Paso de eval_especializado: especializa y ejecuta los NODO_OP y deja el
+ * resto de los nodos a paso_eval, así que las sentencias, las secuencias y los
+ * errores son los de eval_nodo. Un NODO_OP_RAPIDO sólo baja a los operandos
+ * que son subexpresiones; los slots y las constantes se leen en el lugar.
+ * @param r Recorrido en curso.
+ * @param m Marco del nodo.
+ * @param arg Contexto de compilación.
+ * @return Qué hacer después (RECORRIDO_*).
+ */
+static int paso_especializado(Recorrido *r, Marco *m, void *arg) {
+    CompilerContext *ctx = arg;
+    Nodo *n = m->nodo;
+    if (!n || (n->tipo != NODO_OP && n->tipo != NODO_OP_RAPIDO)) return paso_eval(r, m, arg);
+
+    if (m->paso == 0) {
+        if (n->tipo == NODO_OP_RAPIDO && n->opRapida.guardia > ctx->tabla_size) n->tipo = NODO_OP;
+        if (n->tipo == NODO_OP) especializar_op(ctx, n);
+    }
+    if (n->tipo == NODO_OP) return paso_eval(r, m, arg);
+
+    int variante = n->opRapida.variante;
+    if (m->paso == 0 && variante / 3 % 3 == RAP_EXPR) {
+        m->paso = 1;
+        return recorrido_bajar(r, n->opRapida.izq, 0);
+    }
+    if (m->paso == 1) m->valor = r->valor;
+    if (m->paso < 2 && variante % 3 == RAP_EXPR) {
+        m->paso = 2;
+        return recorrido_bajar(r, n->opRapida.der, 0);
+    }
+
+    switch (variante) {
+        RAP_CASOS(TOP_SUMA)
+        RAP_CASOS(TOP_RESTA)
+        RAP_CASOS(TOP_MULT)
+        RAP_CASOS(TOP_DIV)
+        RAP_CASOS(TOP_IGUAL)
+        RAP_CASOS(TOP_OR)
+        RAP_CASOS(TOP_AND)
+        RAP_CASOS(TOP_MAYOR)
+        RAP_CASOS(TOP_MENOR)
+        default:
+            contexto_error(ctx, ERROR_NODO_DESCONOCIDO, n->linea, n->columna,
+                           "variante especializada desconocida %d", variante);
+            return RECORRIDO_ABORTAR;
+    }
+    return contexto_fallo(ctx) ? RECORRIDO_ABORTAR : RECORRIDO_FIN;
+}
+
+/**
+ * Evalúa un nodo como eval_nodo, pero especializando en el lugar cada NODO_OP
+ * la primera vez que se ejecuta. Pensado para ejecutar muchas veces el mismo
+ * árbol, vaciando la tabla de símbolos entre ejecuciones; ver la condición
+ * sobre la tabla al principio de esta sección.
+ * @param ctx Contexto de compilación.
+ * @param n Nodo a evaluar.
+ * @return Valor resultante de la evaluación.
+ */
+int eval_especializado(CompilerContext *ctx, Nodo *n) {
+    if (!n) return 0;
+    Recorrido r;
+    int valor = recorrido_ejecutar(&r, n, 0, paso_especializado, ctx);
+    if (r.sin_memoria) contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para evaluar");
+    return contexto_fallo(ctx) ? 0 : valor;
+}
+
 /**
  * Imprime un divisor con título para separar secciones en la salida.
+ * @param ctx Contexto de compilación (define la salida).
  * @param title Título del divisor.
  */
-static void print_divider(const char *title) {
-    printf("┌──────────────────────────────────────────────────┐\n");
-    printf("│ %-48s │\n", title);
-    printf("└──────────────────────────────────────────────────┘\n");
+static void print_divider(CompilerContext *ctx, const char *title) {
+    fprintf(ctx->salida, "┌──────────────────────────────────────────────────┐\n");
+    fprintf(ctx->salida, "│ %-48s │\n", title);
+    fprintf(ctx->salida, "└──────────────────────────────────────────────────┘\n");
 }
 
+/* Pasada de imprimir_nodo */
+typedef struct {
+    CompilerContext *ctx;
+    int indent;             /* Indentación de la raíz */
+} Impresion;
+
 /**
- * Imprime el AST con indentación recursiva.
+ * Visita de imprimir_nodo: imprime un nodo indentado según su profundidad.
  * @param nodo Nodo a imprimir.
- * @param indent Nivel de indentación.
+ * @param profundidad Profundidad respecto de la raíz.
+ * @param arg La Impresion.
  */
-void imprimir_nodo(Nodo *nodo, int indent) {
-    if (!nodo) return;
+static void imprimir_visita(Nodo *nodo, int profundidad, void *arg) {
+    Impresion *imp = arg;
+    FILE *salida = imp->ctx->salida;
 
-    for (int i = 0; i < indent; i++) printf("    ");
+    fprintf(salida, "%*s", 4 * (imp->indent + profundidad), "");
 
     switch (nodo->tipo) {
         case NODO_SEQ:
-            printf("%-10s\n", "SEQ");
-            imprimir_nodo(nodo->opBinaria.izq, indent + 1);
-            imprimir_nodo(nodo->opBinaria.der, indent + 1);
+            fprintf(salida, "%-10s\n", "SEQ");
             break;
         case NODO_DECL:
-            printf("%-10s%s\n", "DECL", nodo->assign.id);
-            if (nodo->assign.expr)
-                imprimir_nodo(nodo->assign.expr, indent + 1);
+            fprintf(salida, "%-10s%s\n", "DECL", nodo->assign.id);
             break;
         case NODO_OP:
-            printf("%-10s\n",
+        case NODO_OP_RAPIDO:
+            fprintf(salida, "%-10s\n",
                    nodo->opBinaria.op == TOP_SUMA ? "SUMA" :
                    nodo->opBinaria.op == TOP_RESTA ? "RESTA" :
                    nodo->opBinaria.op == TOP_MULT ? "MULT" :
@@ -518,254 +1334,464 @@ void imprimir_nodo(Nodo *nodo, int indent) {
                    nodo->opBinaria.op == TOP_AND ? "AND" :
                    nodo->opBinaria.op == TOP_MAYOR ? "MAYOR" :
                    nodo->opBinaria.op == TOP_MENOR ? "MENOR" : "OP_UNKNOWN");
-            imprimir_nodo(nodo->opBinaria.izq, indent + 1);
-            imprimir_nodo(nodo->opBinaria.der, indent + 1);
             break;
         case NODO_ID:
-            printf("%-10s%s\n", "ID", nodo->nombre);
+            fprintf(salida, "%-10s%s\n", "ID", nodo->nombre);
             break;
         case NODO_INT:
-            printf("%-10s%d\n", "INT", nodo->val_int);
+            fprintf(salida, "%-10s%d\n", "INT", nodo->val_int);
             break;
         case NODO_BOOL:
-            printf("%-10s%s\n", "BOOL", nodo->val_bool ? "true" : "false");
+            fprintf(salida, "%-10s%s\n", "BOOL", nodo->val_bool ? "true" : "false");
             break;
         case NODO_ASSIGN:
-            printf("%-10s%s\n", "ASSIGN", nodo->assign.id);
-            imprimir_nodo(nodo->assign.expr, indent + 1);
+            fprintf(salida, "%-10s%s\n", "ASSIGN", nodo->assign.id);
             break;
         case NODO_RETURN:
-            printf("%-10s\n", "RETURN");
-            if (nodo->ret_expr)
-                imprimir_nodo(nodo->ret_expr, indent + 1);
+            fprintf(salida, "%-10s\n", "RETURN");
             break;
         default:
-            printf("%-10s%d\n", "UNKNOWN", nodo->tipo);
+            fprintf(salida, "%-10s%d\n", "UNKNOWN", nodo->tipo);
             break;
     }
 }
 
+/**
+ * Imprime el AST en preorden, un nivel de indentación por nivel del árbol.
+ * @param ctx Contexto de compilación (define la salida).
+ * @param nodo Nodo a imprimir.
+ * @param indent Nivel de indentación.
+ */
+void imprimir_nodo(CompilerContext *ctx, Nodo *nodo, int indent) {
+    Impresion imp = { ctx, indent };
+    recorrido_profundo(nodo, imprimir_visita, NULL, &imp);
+}
+
 /* ------------------ Intérprete / wrapper de ejecución ------------------ */
 
+/**
+ * Imprime el contenido actual de la tabla de símbolos.
+ * @param ctx Contexto de compilación.
+ */
+void imprimir_tabla_simbolos(CompilerContext *ctx) {
+    fprintf(ctx->salida, "Tabla de Símbolos:\n");
+    fprintf(ctx->salida, "----------------------------------------\n");
+    if (ctx->tabla_size > 0) {
+        int max_len = 8; // Ancho mínimo para "Variable"
+        for (int i = 0; i < ctx->tabla_size; ++i) {
+            int len = (int)strlen(ctx->tabla[i].id);
+            if (len > max_len) max_len = len;
+        }
+        fprintf(ctx->salida, "%-*s %-10s %-15s\n", max_len, "Variable", "Valor", "Estado");
+        fprintf(ctx->salida, "----------------------------------------\n");
+        for (int i = 0; i < ctx->tabla_size; ++i) {
+            fprintf(ctx->salida, "%-*s %-10d %-15s\n",
+                   max_len, ctx->tabla[i].id, ctx->tabla[i].valor,
+                   ctx->tabla[i].inicializado ? "Inicializado" : "No inicializado");
+        }
+    } else {
+        fprintf(ctx->salida, "(Tabla vacía)\n");
+    }
+    fprintf(ctx->salida, "\n");
+}
+
 /**
  * Interpreta un programa completo, imprimiendo detalles.
+ * @param ctx Contexto de compilación.
  * @param programa Raíz del AST del programa.
  * @return Resultado de la ejecución.
  */
-int interpretar_programa(Nodo *programa) {
-    liberar_tabla_simbolos();
+int interpretar_programa(CompilerContext *ctx, Nodo *programa) {
+    double t0 = stats_reloj();
+    liberar_tabla_simbolos(ctx);
 
-    printf("\n");
-    print_divider("EJECUCION DEL PROGRAMA");
+    fprintf(ctx->salida, "\n");
+    print_divider(ctx, "EJECUCION DEL PROGRAMA");
 
-    printf("Árbol Sintáctico Abstracto (AST):\n");
-    printf("----------------------------------------\n");
+    fprintf(ctx->salida, "Árbol Sintáctico Abstracto (AST):\n");
+    fprintf(ctx->salida, "----------------------------------------\n");
     if (programa)
-        imprimir_nodo(programa, 0);
+        imprimir_nodo(ctx, programa, 0);
     else
-        printf("(AST vacío)\n");
-    printf("\n");
+        fprintf(ctx->salida, "(AST vacío)\n");
+    fprintf(ctx->salida, "\n");
 
     int resultado = 0;
     if (programa)
-        resultado = eval_nodo(programa);
+        resultado = eval_nodo(ctx, programa);
 
-    printf("Tabla de Símbolos:\n");
-    printf("----------------------------------------\n");
-    if (tabla_size > 0) {
-        int max_len = 8; // Ancho mínimo para "Variable"
-        for (int i = 0; i < tabla_size; ++i) {
-            int len = (int)strlen(tabla[i].id);
-            if (len > max_len) max_len = len;
-        }
-        printf("%-*s %-10s %-15s\n", max_len, "Variable", "Valor", "Estado");
-        printf("----------------------------------------\n");
-        for (int i = 0; i < tabla_size; ++i) {
-            printf("%-*s %-10d %-15s\n",
-                   max_len, tabla[i].id, tabla[i].valor,
-                   tabla[i].inicializado ? "Inicializado" : "No inicializado");
-        }
-    } else {
-        printf("(Tabla vacía)\n");
-    }
-    printf("\n");
+    imprimir_tabla_simbolos(ctx);
 
-    print_divider("FIN DE LA EJECUCION");
+    print_divider(ctx, "FIN DE LA EJECUCION");
 
+    ctx->stats.tiempo[FASE_INTERPRETAR] += stats_reloj() - t0;
     return resultado;
 }
 
 /**
- * Libera recursos globales del AST.
+ * Libera los recursos del contexto asociados al AST (tabla de símbolos).
+ * @param ctx Contexto de compilación.
  */
-void ast_liberar_recursos(void) {
-    liberar_tabla_simbolos();
+void ast_liberar_recursos(CompilerContext *ctx) {
+    liberar_tabla_simbolos(ctx);
 }
 
 /* ------------------ Generador de seudo-assembly ------------------ */
 
-/* Contador para etiquetas únicas */
-static int gen_label_counter = 0;
-
 /**
  * Genera una nueva etiqueta única.
+ * @param ctx Contexto de compilación.
  * @return Número de etiqueta.
  */
-static int nueva_etiqueta(void) { return gen_label_counter++; }
+static int nueva_etiqueta(CompilerContext *ctx) { return ctx->gen_label_counter++; }
+
+/* Mnemónicos del seudo-assembly; el emisor los cuenta por índice */
+typedef enum {
+    MN_BEGIN, MN_HALT, MN_DECL, MN_LOAD, MN_STORE, MN_PUSH, MN_RET,
+    MN_JZ, MN_JNZ, MN_JMP, MN_LABEL,
+    MN_ADD, MN_SUB, MN_MUL, MN_DIV, MN_CMPEQ, MN_CMPGT, MN_CMPLT, MN_DESCONOCIDO,
+    NUM_MNEMONICOS
+} Mnemonico;
+
+/* Texto de cada mnemónico, en el orden de Mnemonico */
+static const char *const nombres_mnemonico[NUM_MNEMONICOS] = {
+    "BEGIN", "HALT", "DECL", "LOAD", "STORE", "PUSH", "RET",
+    "JZ", "JNZ", "JMP", "LABEL",
+    "ADD", "SUB", "MUL", "DIV", "CMPEQ", "CMPGT", "CMPLT", "??"
+};
+
+/* Línea más larga sin contar el operando de texto: mnemónico, " L", un int y '\n' */
+#define EMISOR_LINEA 32
+
+/* Salida del generador: cuenta las instrucciones y escribe con un Escritor */
+struct Emisor {
+    CompilerContext *ctx;
+    Escritor w;
+    unsigned long cuenta[NUM_MNEMONICOS];   /* Instrucciones por mnemónico */
+    Mnemonico orden[NUM_MNEMONICOS];        /* Mnemónicos por primera aparición */
+    int n_orden;
+};
 
 /**
- * Emite una línea de código assembly al archivo.
- * @param f Archivo de salida.
- * @param fmt Formato de la línea.
- * @param ... Argumentos variables.
+ * Asegura lugar en el buffer para una línea.
+ * @param e Emisor.
+ * @param largo Bytes que se van a escribir.
+ * @return Dónde escribirlos, o NULL si no hubo memoria (la línea se descarta).
+ */
+static char *emisor_reservar(Emisor *e, size_t largo) {
+    return escritor_reservar(&e->w, largo);
+}
+
+/**
+ * Escribe el mnemónico al comienzo de una línea y lo cuenta.
+ * @param e Emisor.
+ * @param p Dónde escribir.
+ * @param mn Mnemónico.
+ * @return Posición siguiente.
+ */
+static char *emisor_mnemonico(Emisor *e, char *p, Mnemonico mn) {
+    if (e->cuenta[mn]++ == 0) e->orden[e->n_orden++] = mn;
+    return copiar_texto(p, nombres_mnemonico[mn]);
+}
+
+/**
+ * Termina una línea y vuelca el buffer si pasó el umbral.
+ * @param e Emisor.
+ * @param p Posición siguiente al último carácter de la línea.
+ */
+static void emisor_cerrar(Emisor *e, char *p) {
+    *p++ = '\n';
+    escritor_avanzar(&e->w, p);
+}
+
+/**
+ * Emite una instrucción sin operando.
+ * @param e Emisor.
+ * @param mn Mnemónico.
+ */
+static void emitir(Emisor *e, Mnemonico mn) {
+    char *p = emisor_reservar(e, EMISOR_LINEA);
+    if (p) emisor_cerrar(e, emisor_mnemonico(e, p, mn));
+}
+
+/**
+ * Emite una instrucción con un operando entero ("PUSH 3").
+ * @param e Emisor.
+ * @param mn Mnemónico.
+ * @param v Operando.
+ */
+static void emitir_entero(Emisor *e, Mnemonico mn, int v) {
+    char *p = emisor_reservar(e, EMISOR_LINEA);
+    if (!p) return;
+    p = emisor_mnemonico(e, p, mn);
+    *p++ = ' ';
+    emisor_cerrar(e, formatear_entero(p, v));
+}
+
+/**
+ * Emite una instrucción con una etiqueta como operando ("JZ L3").
+ * @param e Emisor.
+ * @param mn Mnemónico.
+ * @param etiqueta Número de etiqueta.
  */
-static void emit(FILE *f, const char *fmt, ...) {
-    va_list ap;
-    va_start(ap, fmt);
-    vfprintf(f, fmt, ap);
-    fprintf(f, "\n");
-    va_end(ap);
+static void emitir_etiqueta(Emisor *e, Mnemonico mn, int etiqueta) {
+    char *p = emisor_reservar(e, EMISOR_LINEA);
+    if (!p) return;
+    p = emisor_mnemonico(e, p, mn);
+    *p++ = ' ';
+    *p++ = 'L';
+    emisor_cerrar(e, formatear_entero(p, etiqueta));
+}
+
+/**
+ * Emite una instrucción con un identificador como operando ("LOAD x").
+ * @param e Emisor.
+ * @param mn Mnemónico.
+ * @param id Identificador.
+ */
+static void emitir_nombre(Emisor *e, Mnemonico mn, const char *id) {
+    size_t largo = strlen(id);
+    char *p = emisor_reservar(e, EMISOR_LINEA + largo);
+    if (!p) return;
+    p = emisor_mnemonico(e, p, mn);
+    *p++ = ' ';
+    memcpy(p, id, largo);
+    emisor_cerrar(e, p + largo);
 }
 
 /**
  * Obtiene el mnemónico para una operación binaria.
  * @param op Tipo de operación.
- * @return Cadena con el mnemónico.
+ * @return Mnemónico.
  */
-static const char *op_mnemonic(TipoOP op) {
+static Mnemonico op_mnemonico(TipoOP op) {
     switch (op) {
-        case TOP_SUMA:  return "ADD";
-        case TOP_RESTA: return "SUB";
-        case TOP_MULT:  return "MUL";
-        case TOP_DIV:   return "DIV";
-        case TOP_IGUAL: return "CMPEQ";
-        case TOP_MAYOR: return "CMPGT";
-        case TOP_MENOR: return "CMPLT";
-        default:        return "??";
+        case TOP_SUMA:  return MN_ADD;
+        case TOP_RESTA: return MN_SUB;
+        case TOP_MULT:  return MN_MUL;
+        case TOP_DIV:   return MN_DIV;
+        case TOP_IGUAL: return MN_CMPEQ;
+        case TOP_MAYOR: return MN_CMPGT;
+        case TOP_MENOR: return MN_CMPLT;
+        default:        return MN_DESCONOCIDO;
     }
 }
 
-/* Declaraciones forward */
-static void gen_stmt(FILE *f, Nodo *n);
-static void gen_expr(FILE *f, Nodo *n);
+/* Pasada del generador; el dato de cada marco dice si el nodo se genera
+   como sentencia o como expresión (que deja su valor en la pila) */
+enum { GEN_STMT, GEN_EXPR };
 
 /**
- * Genera código para una expresión (deja valor en la pila).
- * @param f Archivo de salida.
- * @param n Nodo de la expresión.
+ * Paso del generador para un nodo en posición de expresión.
+ * @param r Recorrido.
+ * @param m Marco del nodo.
+ * @param e Emisor.
+ * @return Qué sigue.
  */
-static void gen_expr(FILE *f, Nodo *n) {
-    if (!n) { emit(f, "PUSH 0"); return; }
+static int paso_expr(Recorrido *r, Marco *m, Emisor *e) {
+    Nodo *n = m->nodo;
+    if (!n) {
+        emitir_entero(e, MN_PUSH, 0);
+        return RECORRIDO_FIN;
+    }
 
     switch (n->tipo) {
         case NODO_INT:
-            emit(f, "PUSH %d", n->val_int);
-            break;
+            emitir_entero(e, MN_PUSH, n->val_int);
+            return RECORRIDO_FIN;
         case NODO_BOOL:
-            emit(f, "PUSH %d", n->val_bool ? 1 : 0);
-            break;
+            emitir_entero(e, MN_PUSH, n->val_bool ? 1 : 0);
+            return RECORRIDO_FIN;
         case NODO_ID:
-            emit(f, "LOAD %s", n->nombre);
-            break;
-        case NODO_OP: {
-            if (n->opBinaria.op == TOP_AND) {
-                int L_false = nueva_etiqueta();
-                int L_end = nueva_etiqueta();
-                gen_expr(f, n->opBinaria.izq);
-                emit(f, "JZ L%d", L_false);
-                gen_expr(f, n->opBinaria.der);
-                emit(f, "JZ L%d", L_false);
-                emit(f, "PUSH 1");
-                emit(f, "JMP L%d", L_end);
-                emit(f, "LABEL L%d", L_false);
-                emit(f, "PUSH 0");
-                emit(f, "LABEL L%d", L_end);
-            } else if (n->opBinaria.op == TOP_OR) {
-                int L_true = nueva_etiqueta();
-                int L_end = nueva_etiqueta();
-                gen_expr(f, n->opBinaria.izq);
-                emit(f, "JNZ L%d", L_true);
-                gen_expr(f, n->opBinaria.der);
-                emit(f, "JNZ L%d", L_true);
-                emit(f, "PUSH 0");
-                emit(f, "JMP L%d", L_end);
-                emit(f, "LABEL L%d", L_true);
-                emit(f, "PUSH 1");
-                emit(f, "LABEL L%d", L_end);
-            } else {
-                gen_expr(f, n->opBinaria.izq);
-                gen_expr(f, n->opBinaria.der);
-                emit(f, "%s", op_mnemonic(n->opBinaria.op));
+            emitir_nombre(e, MN_LOAD, n->nombre);
+            return RECORRIDO_FIN;
+        case NODO_OP:
+        case NODO_OP_RAPIDO:
+            if (n->opBinaria.op == TOP_AND || n->opBinaria.op == TOP_OR) {
+                /* Cortocircuito: m->valor es la etiqueta del salto y m->valor + 1 la del final */
+                int es_and = n->opBinaria.op == TOP_AND;
+                Mnemonico salto = es_and ? MN_JZ : MN_JNZ;
+                switch (m->paso) {
+                    case 0:
+                        m->valor = nueva_etiqueta(e->ctx);
+                        nueva_etiqueta(e->ctx);
+                        m->paso = 1;
+                        return recorrido_bajar(r, n->opBinaria.izq, GEN_EXPR);
+                    case 1:
+                        emitir_etiqueta(e, salto, m->valor);
+                        m->paso = 2;
+                        return recorrido_bajar(r, n->opBinaria.der, GEN_EXPR);
+                }
+                emitir_etiqueta(e, salto, m->valor);
+                emitir_entero(e, MN_PUSH, es_and);
+                emitir_etiqueta(e, MN_JMP, m->valor + 1);
+                emitir_etiqueta(e, MN_LABEL, m->valor);
+                emitir_entero(e, MN_PUSH, !es_and);
+                emitir_etiqueta(e, MN_LABEL, m->valor + 1);
+                return RECORRIDO_FIN;
             }
-            break;
-        }
+            switch (m->paso) {
+                case 0:
+                    m->paso = 1;
+                    return recorrido_bajar(r, n->opBinaria.izq, GEN_EXPR);
+                case 1:
+                    m->paso = 2;
+                    return recorrido_bajar(r, n->opBinaria.der, GEN_EXPR);
+            }
+            emitir(e, op_mnemonico(n->opBinaria.op));
+            return RECORRIDO_FIN;
         default:
-            gen_stmt(f, n);
-            emit(f, "PUSH 0");
-            break;
+            /* Una sentencia usada como expresión vale 0 */
+            if (m->paso == 0) {
+                m->paso = 1;
+                return recorrido_bajar(r, n, GEN_STMT);
+            }
+            emitir_entero(e, MN_PUSH, 0);
+            return RECORRIDO_FIN;
     }
 }
 
 /**
- * Genera código para una sentencia.
- * @param f Archivo de salida.
- * @param n Nodo de la sentencia.
+ * Paso del generador para un nodo en posición de sentencia.
+ * @param r Recorrido.
+ * @param m Marco del nodo.
+ * @param e Emisor.
+ * @return Qué sigue.
  */
-static void gen_stmt(FILE *f, Nodo *n) {
-    if (!n) return;
+static int paso_stmt(Recorrido *r, Marco *m, Emisor *e) {
+    Nodo *n = m->nodo;
+    if (!n) return RECORRIDO_FIN;
 
     switch (n->tipo) {
         case NODO_SEQ:
-            gen_stmt(f, n->opBinaria.izq);
-            gen_stmt(f, n->opBinaria.der);
-            break;
+            if (m->paso == 0) {
+                m->paso = 1;
+                return recorrido_bajar(r, n->opBinaria.izq, GEN_STMT);
+            }
+            return recorrido_seguir(r, n->opBinaria.der, GEN_STMT);
         case NODO_DECL:
-            emit(f, "DECL %s", n->assign.id);
-            if (n->assign.expr) {
-                gen_expr(f, n->assign.expr);
-                emit(f, "STORE %s", n->assign.id);
+            if (m->paso == 0) {
+                emitir_nombre(e, MN_DECL, n->assign.id);
+                if (!n->assign.expr) return RECORRIDO_FIN;
+                m->paso = 1;
+                return recorrido_bajar(r, n->assign.expr, GEN_EXPR);
             }
-            break;
+            emitir_nombre(e, MN_STORE, n->assign.id);
+            return RECORRIDO_FIN;
         case NODO_ASSIGN:
-            gen_expr(f, n->assign.expr);
-            emit(f, "STORE %s", n->assign.id);
-            break;
+            if (m->paso == 0) {
+                m->paso = 1;
+                return recorrido_bajar(r, n->assign.expr, GEN_EXPR);
+            }
+            emitir_nombre(e, MN_STORE, n->assign.id);
+            return RECORRIDO_FIN;
         case NODO_RETURN:
-            if (n->ret_expr) {
-                gen_expr(f, n->ret_expr);
-            } else {
-                emit(f, "PUSH 0");
+            if (m->paso == 0) {
+                m->paso = 1;
+                if (n->ret_expr) return recorrido_bajar(r, n->ret_expr, GEN_EXPR);
+                emitir_entero(e, MN_PUSH, 0);
             }
-            emit(f, "RET");
-            break;
+            emitir(e, MN_RET);
+            return RECORRIDO_FIN;
         case NODO_OP:
+        case NODO_OP_RAPIDO:
         case NODO_INT:
         case NODO_BOOL:
         case NODO_ID:
-            gen_expr(f, n);
-            break;
+            return recorrido_seguir(r, n, GEN_EXPR);
         default:
-            fprintf(stderr, "Codegen: nodo no soportado en stmt %d\n", n->tipo);
-            break;
+            contexto_error(e->ctx, ERROR_NODO_DESCONOCIDO, n->linea, n->columna,
+                           "generar_asm no soporta tipo de nodo %d", n->tipo);
+            return RECORRIDO_ABORTAR;
     }
 }
 
+/**
+ * Paso del generador: despacha según el nodo sea sentencia o expresión.
+ * @param r Recorrido.
+ * @param m Marco del nodo.
+ * @param arg El Emisor.
+ * @return Qué sigue.
+ */
+static int paso_gen(Recorrido *r, Marco *m, void *arg) {
+    Emisor *e = arg;
+    if (e->w.sin_memoria) return RECORRIDO_ABORTAR;
+    return m->dato == GEN_EXPR ? paso_expr(r, m, arg) : paso_stmt(r, m, arg);
+}
+
+/**
+ * Genera el código de un nodo como sentencia.
+ * @param e Emisor.
+ * @param n Nodo a generar.
+ */
+static void gen_stmt(Emisor *e, Nodo *n) {
+    Recorrido r;
+    recorrido_ejecutar(&r, n, GEN_STMT, paso_gen, e);
+    if (r.sin_memoria) e->w.sin_memoria = 1;
+}
+
+/**
+ * Crea el emisor y emite el encabezado del seudo-assembly.
+ * @param ctx Contexto de compilación.
+ * @param f Archivo de salida.
+ * @return Emisor para generar_asm_sentencia y generar_asm_fin, o NULL si no
+ *         hubo memoria (con ctx->error; las dos aceptan NULL y no hacen nada).
+ */
+Emisor *generar_asm_inicio(CompilerContext *ctx, FILE *f) {
+    Emisor *e = calloc(1, sizeof(Emisor));
+    if (!e) {
+        contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para generar el seudo-assembly");
+        return NULL;
+    }
+    e->ctx = ctx;
+    escritor_abrir(&e->w, f);
+
+    escritor_texto(&e->w, "; ---------- PSEUDO-ASM GENERADO ----------\n");
+    emitir(e, MN_BEGIN);
+    return e;
+}
+
+/**
+ * Emite el código de una declaración o sentencia de nivel superior. Llamada
+ * con cada una en orden produce lo mismo que generar_asm con todo el programa.
+ * @param e Emisor.
+ * @param sentencia Sentencia a generar.
+ */
+void generar_asm_sentencia(Emisor *e, Nodo *sentencia) {
+    if (e) gen_stmt(e, sentencia);
+}
+
+/**
+ * Emite el cierre del seudo-assembly, escribe lo pendiente, pasa los
+ * contadores de instrucciones a las estadísticas y libera el emisor.
+ * @param e Emisor.
+ */
+void generar_asm_fin(Emisor *e) {
+    if (!e) return;
+    emitir(e, MN_HALT);
+    escritor_cerrar(&e->w, e->ctx, "el seudo-assembly");
+    for (int i = 0; i < e->n_orden; ++i) {
+        Mnemonico mn = e->orden[i];
+        stats_contar_instrucciones(&e->ctx->stats, nombres_mnemonico[mn], e->cuenta[mn]);
+    }
+    free(e);
+}
+
 /**
  * Genera código seudo-assembly para el programa.
+ * @param ctx Contexto de compilación.
  * @param programa Raíz del AST.
- * @param filename Nombre del archivo de salida (NULL para stdout).
+ * @param filename Nombre del archivo de salida (NULL para ctx->salida).
  */
-void generar_asm(Nodo *programa, const char *filename) {
-    FILE *f = filename ? fopen(filename, "w") : stdout;
+void generar_asm(CompilerContext *ctx, Nodo *programa, const char *filename) {
+    FILE *f = filename ? fopen(filename, "w") : ctx->salida;
     if (!f) {
-        perror("fopen generar_asm");
+        contexto_error(ctx, ERROR_ESCRITURA, 0, 0, "no se pudo crear '%s': %s", filename, strerror(errno));
         return;
     }
-    emit(f, "; ---------- PSEUDO-ASM GENERADO ----------");
-    emit(f, "BEGIN");
-
-    if (programa) gen_stmt(f, programa);
-
-    emit(f, "HALT");
-    if (filename) fclose(f);
-}
\ No newline at end of file
+    Emisor *e = generar_asm_inicio(ctx, f);
+    if (programa) generar_asm_sentencia(e, programa);
+    generar_asm_fin(e);
+    if (filename && fclose(f) != 0)
+        contexto_error(ctx, ERROR_ESCRITURA, 0, 0, "no se pudo escribir '%s': %s", filename, strerror(errno));
+}
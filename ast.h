@@ -2,6 +2,7 @@
 #define AST_H
 
 #include <stdio.h>
+#include <stdint.h>
 
 /* ------------------ Definiciones de tipos ------------------ */
 
@@ -16,7 +17,8 @@ typedef enum {
     NODO_INT,
     NODO_BOOL,
     NODO_ID,
-    NODO_SEQ
+    NODO_SEQ,
+    NODO_OP_RAPIDO  /* NODO_OP ya especializado por eval_especializado */
 } TipoNodo;
 
 /* Tipos de operaciones binarias */
@@ -36,6 +38,8 @@ typedef enum {
 /* Estructura del nodo del AST */
 typedef struct Nodo {
     TipoNodo tipo;
+    int linea;              /* Posición en el fuente: línea y columna desde 1 */
+    int columna;            /* (0 = desconocida, p. ej. un nodo armado a mano) */
     union {
         int val_int;
         int val_bool;
@@ -45,6 +49,15 @@ typedef struct Nodo {
             struct Nodo *der;
             TipoOP op;
         } opBinaria;
+        /* Forma especializada: comparte los primeros campos con opBinaria */
+        struct {
+            struct Nodo *izq;
+            struct Nodo *der;
+            TipoOP op;
+            uint16_t variante;  /* Operación y forma de los operandos */
+            uint16_t guardia;   /* Tamaño mínimo de la tabla para usar los slots */
+            int a, b;           /* Slot de la tabla o constante de cada operando */
+        } opRapida;
         struct {
             char *id;
             struct Nodo *expr;
@@ -53,31 +66,64 @@ typedef struct Nodo {
     };
 } Nodo;
 
+/* Formato de exportar_dot */
+typedef enum {
+    GRAFO_DOT,              /* Graphviz (.dot) */
+    GRAFO_JSON,             /* Un objeto JSON por nodo y por línea (.jsonl) */
+    GRAFO_ARISTAS           /* "padre<TAB>hijo" por línea (.tsv) */
+} FormatoGrafo;
+
+/* Formato y límites de exportar_dot; pasados los límites cada subárbol se
+   escribe como un nodo resumen */
+typedef struct {
+    FormatoGrafo formato;
+    long max_nodos;         /* Nodos a escribir (0 = sin límite) */
+    int max_profundidad;    /* Niveles a escribir (0 = sin límite) */
+    int png;                /* Lanzar también dot -Tpng (sólo GRAFO_DOT) */
+} OpcionesGrafo;
+
+/* Estado de una compilación (tabla de símbolos, contadores, salida, lexer).
+   Se define en contexto.h; cada compilación usa el suyo. */
+typedef struct CompilerContext CompilerContext;
+
 /* ------------------ Prototipos de funciones ------------------ */
 
 /* Constructores de nodos */
-Nodo *nodo_ID(char *nombre);
-Nodo *nodo_int(int val_int);
-Nodo *nodo_bool(int val_bool);
-Nodo *nodo_opBin(TipoOP op, Nodo *izq, Nodo *der);
-Nodo *nodo_assign(char *id, Nodo *expr);
-Nodo *nodo_return(Nodo *expr);
-Nodo *nodo_seq(Nodo *primero, Nodo *resto);
-Nodo *nodo_decl(char *id, Nodo *expr);
+Nodo *nodo_ID(CompilerContext *ctx, const char *nombre, size_t largo);
+Nodo *nodo_int(CompilerContext *ctx, int val_int);
+Nodo *nodo_bool(CompilerContext *ctx, int val_bool);
+Nodo *nodo_opBin(CompilerContext *ctx, TipoOP op, Nodo *izq, Nodo *der);
+Nodo *nodo_assign(CompilerContext *ctx, const char *id, size_t largo, Nodo *expr);
+Nodo *nodo_return(CompilerContext *ctx, Nodo *expr);
+Nodo *nodo_seq(CompilerContext *ctx, Nodo *primero, Nodo *resto);
+Nodo *nodo_decl(CompilerContext *ctx, const char *id, size_t largo, Nodo *expr);
+Nodo *nodo_ubicar(Nodo *n, int linea, int columna);   /* Anota la posición; devuelve n */
 
 /* Funciones de manejo del AST */
-void imprimir_nodo(Nodo *nodo, int indent); /* Imprimir AST básico */
-void print_ast(Nodo *nodo, int indent);     /* Imprimir AST con formato mejorado */
-void nodo_libre(Nodo *nodo);                /* Liberar memoria del AST */
-void exportar_dot(Nodo *nodo, const char *filename); /* Exportar a Graphviz */
+void imprimir_nodo(CompilerContext *ctx, Nodo *nodo, int indent); /* Imprimir AST básico */
+void nodo_libre(CompilerContext *ctx, Nodo *nodo);                /* Liberar memoria del AST */
+void exportar_dot(CompilerContext *ctx, Nodo *nodo, const char *filename,
+                  const OpcionesGrafo *og);       /* Exportar a Graphviz, JSON o aristas */
+const char *texto_op(TipoOP op);                  /* El operador como se escribe */
 
 
 /* Funciones del intérprete */
-int eval_nodo(Nodo *n);                /* Evalúa un nodo del AST y devuelve su valor */
-int interpretar_programa(Nodo *programa);
-void ast_liberar_recursos(void);
+int eval_nodo(CompilerContext *ctx, Nodo *n);          /* Evalúa un nodo del AST y devuelve su valor */
+/* Igual, reescribiendo los NODO_OP en NODO_OP_RAPIDO. Los slots resueltos sólo
+   valen sobre una tabla vacía o reconstruida por el mismo programa */
+int eval_especializado(CompilerContext *ctx, Nodo *n);
+int interpretar_programa(CompilerContext *ctx, Nodo *programa);
+void imprimir_tabla_simbolos(CompilerContext *ctx);    /* Imprime la tabla tras evaluar */
+void ast_liberar_recursos(CompilerContext *ctx);
 
 /* --- Codegen a seudo-assembly --- */
-void generar_asm(Nodo *programa, const char *filename);
+void generar_asm(CompilerContext *ctx, Nodo *programa, const char *filename);
+
+/* Lo mismo por partes, para generar sentencia por sentencia (--stream). El
+   emisor acumula el texto en memoria y lo escribe en f en bloques grandes. */
+typedef struct Emisor Emisor;
+Emisor *generar_asm_inicio(CompilerContext *ctx, FILE *f);
+void generar_asm_sentencia(Emisor *e, Nodo *sentencia);
+void generar_asm_fin(Emisor *e);        /* Vuelca lo pendiente y libera e */
 
 #endif /* AST_H */
@@ -0,0 +1,323 @@
+/*
+ * Benchmark de punta a punta de las fases del compilador.
+ *
+ * Uso: ./bench-fases [-r repeticiones] [-L flex|simd] [-P bison|mano]
+ *                    [-n sentencias[,sentencias...]] [-v variables]
+ *                    [-p profundidad] [-a ancho] [-l %lógicas]
+ *                    [-d %declaraciones] [-s semilla] [archivo...]
+ *
+ * Mide el análisis léxico, el sintáctico, eval_nodo y generar_asm sobre cada
+ * archivo y sobre un programa sintético (generador.h) por cada cantidad de
+ * sentencias de -n; sin archivos ni -n usa 1000,10000,100000. De cada fase
+ * toma la repetición más rápida. Cada programa se mide en un proceso hijo,
+ * así el pico de memoria (ru_maxrss) es el suyo y no el de los anteriores.
+ *
+ * La salida es una línea JSON por programa y fase, por ejemplo:
+ *   {"programa":"sintetico-1000","fase":"parse","repeticiones":5,
+ *    "bytes":51234,"tokens":20480,"sentencias":1001,"nodos":19876,
+ *    "segundos":0.000812,"sentencias_s":1232758,"nodos_s":24477832,
+ *    "rss_pico_acumulado_kb":3120}
+ * rss_pico_acumulado_kb es el pico del proceso hijo desde que empezó hasta el
+ * final de esa fase: ru_maxrss no se reinicia entre fases, así que no es la
+ * memoria de la fase sola y nunca baja de una fase a la siguiente.
+ */
+
+/* Definiciones necesarias para compatibilidad POSIX */
+#define _POSIX_C_SOURCE 200809L
+
+/* Inclusiones de bibliotecas estándar */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "contexto.h"
+#include "recorrido.h"
+#include "tokens.h"
+#include "analizador.h"
+#include "generador.h"
+
+/* Fases medidas, en el orden en que se ejecutan */
+enum { MEDIDA_LEXICO, MEDIDA_SINTAXIS, MEDIDA_EVAL, MEDIDA_ASM, NUM_MEDIDAS };
+static const char *const nombres_medida[NUM_MEDIDAS] = { "lex", "parse", "eval", "asm" };
+
+/* Cantidades de sentencias por defecto sin archivos ni -n */
+#define SENTENCIAS_POR_DEFECTO "1000,10000,100000"
+
+/* Opciones del benchmark */
+typedef struct {
+    int repeticiones;
+    TipoLexer lexer;
+    TipoParser parser;
+    OpcionesGenerador og;
+} OpcionesBench;
+
+/* Tiempo y memoria de una fase */
+typedef struct {
+    double segundos;            /* Repetición más rápida */
+    long rss_pico_kb;           /* Pico acumulado del proceso al terminar la fase */
+} Medida;
+
+/**
+ * Pico de memoria residente del proceso.
+ * @return Kilobytes (ru_maxrss).
+ */
+static long rss_maximo(void) {
+    struct rusage ru;
+    return getrusage(RUSAGE_SELF, &ru) == 0 ? ru.ru_maxrss : 0;
+}
+
+/**
+ * Cuenta un nodo (visita de recorrido_profundo).
+ */
+static void contar_nodo(Nodo *n, int profundidad, void *arg) {
+    (void)n;
+    (void)profundidad;
+    ++*(long *)arg;
+}
+
+/**
+ * Escribe una cadena JSON con sus comillas.
+ * @param s Texto.
+ */
+static void escribir_json(const char *s) {
+    putchar('"');
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') printf("\\%c", *s);
+        else if ((unsigned char)*s < 0x20) printf("\\u%04x", *s);
+        else putchar(*s);
+    }
+    putchar('"');
+}
+
+/**
+ * Tokeniza el fuente con el lexer del contexto.
+ * @param ctx Contexto.
+ * @param texto Fuente seguido de dos NUL.
+ * @param largo Largo del fuente.
+ * @param tokens Arreglo a llenar (iniciado).
+ * @return Segundos que tardó.
+ */
+static double lexear(CompilerContext *ctx, char *texto, size_t largo, Tokens *tokens) {
+    contexto_prestar_fuente(ctx, texto, largo);
+    if (contexto_preparar_lexico(ctx) != 0) return 0;
+    double t0 = stats_reloj();
+    tokens_lexear(ctx, tokens);
+    double t = stats_reloj() - t0;
+    contexto_terminar_lexico(ctx);
+    return t;
+}
+
+/**
+ * Mide las cuatro fases sobre un programa e imprime una línea por fase.
+ * @param ob Opciones.
+ * @param nombre Nombre del programa en la salida.
+ * @param texto Fuente seguido de dos NUL.
+ * @param largo Largo del fuente.
+ * @return 0, o 1 si el programa tiene un error.
+ */
+static int medir(const OpcionesBench *ob, const char *nombre, char *texto, size_t largo) {
+    FILE *nulo = fopen("/dev/null", "w");
+    if (!nulo) {
+        perror("/dev/null");
+        return 1;
+    }
+    CompilerContext *ctx = contexto_crear(nulo);
+    ctx->lexer = ob->lexer;
+    ctx->parser = ob->parser;
+    Medida m[NUM_MEDIDAS];
+
+    /* Léxico: se conserva el arreglo de la última repetición para el parser */
+    Tokens tokens;
+    tokens_iniciar(&tokens);
+    for (int r = 0; r < ob->repeticiones; ++r) {
+        tokens_liberar(&tokens);
+        tokens_iniciar(&tokens);
+        double t = lexear(ctx, texto, largo, &tokens);
+        if (r == 0 || t < m[MEDIDA_LEXICO].segundos) m[MEDIDA_LEXICO].segundos = t;
+    }
+    m[MEDIDA_LEXICO].rss_pico_kb = rss_maximo();
+    long sentencias = 0;
+    for (size_t i = 0; i < tokens.n; ++i) sentencias += tokens.tipo[i] + TOKEN_BASE == PYC;
+
+    /* Sintáctico, desde el mismo arreglo de tokens */
+    Nodo *raiz = NULL;
+    contexto_prestar_fuente(ctx, texto, largo);
+    for (int r = 0; r < ob->repeticiones && !contexto_fallo(ctx); ++r) {
+        nodo_libre(ctx, raiz);
+        double t0 = stats_reloj();
+        if (ctx->parser == PARSER_MANO) analizador_parsear(ctx, &tokens, &raiz);
+        else contexto_parsear_tokens(ctx, &tokens, &raiz);
+        double t = stats_reloj() - t0;
+        if (r == 0 || t < m[MEDIDA_SINTAXIS].segundos) m[MEDIDA_SINTAXIS].segundos = t;
+    }
+    m[MEDIDA_SINTAXIS].rss_pico_kb = rss_maximo();
+    long nodos = 0;
+    recorrido_profundo(raiz, contar_nodo, NULL, &nodos);
+
+    /* Evaluación: la tabla de símbolos se vacía entre repeticiones */
+    for (int r = 0; r < ob->repeticiones && !contexto_fallo(ctx); ++r) {
+        double t0 = stats_reloj();
+        eval_nodo(ctx, raiz);
+        double t = stats_reloj() - t0;
+        if (r == 0 || t < m[MEDIDA_EVAL].segundos) m[MEDIDA_EVAL].segundos = t;
+        if (r + 1 < ob->repeticiones) ast_liberar_recursos(ctx);
+    }
+    m[MEDIDA_EVAL].rss_pico_kb = rss_maximo();
+
+    /* Seudo-assembly a /dev/null */
+    for (int r = 0; r < ob->repeticiones && !contexto_fallo(ctx); ++r) {
+        double t0 = stats_reloj();
+        generar_asm(ctx, raiz, NULL);
+        double t = stats_reloj() - t0;
+        if (r == 0 || t < m[MEDIDA_ASM].segundos) m[MEDIDA_ASM].segundos = t;
+    }
+    m[MEDIDA_ASM].rss_pico_kb = rss_maximo();
+
+    int error = contexto_fallo(ctx);
+    for (int i = 0; i < NUM_MEDIDAS && !error; ++i) {
+        double s = m[i].segundos > 0 ? m[i].segundos : 1e-9;
+        printf("{\"programa\":");
+        escribir_json(nombre);
+        printf(",\"fase\":\"%s\",\"repeticiones\":%d,\"bytes\":%zu,\"tokens\":%zu,"
+               "\"sentencias\":%ld,\"nodos\":%ld,\"segundos\":%.9f,"
+               "\"sentencias_s\":%.0f,\"nodos_s\":%.0f,\"rss_pico_acumulado_kb\":%ld}\n",
+               nombres_medida[i], ob->repeticiones, largo, tokens.n, sentencias, nodos,
+               m[i].segundos, sentencias / s, nodos / s, m[i].rss_pico_kb);
+    }
+
+    nodo_libre(ctx, raiz);
+    tokens_liberar(&tokens);
+    contexto_liberar_fuente(ctx);
+    contexto_destruir(ctx);
+    fclose(nulo);
+    return error;
+}
+
+/**
+ * Carga un archivo y lo mide.
+ * @param ob Opciones.
+ * @param ruta Archivo.
+ * @return 0, o 1 si no se pudo leer o tiene un error.
+ */
+static int medir_archivo(const OpcionesBench *ob, const char *ruta) {
+    FILE *f = fopen(ruta, "r");
+    if (!f) {
+        perror(ruta);
+        return 1;
+    }
+    CompilerContext *carga = contexto_crear(NULL);
+    int error = contexto_cargar_fuente(carga, f);
+    fclose(f);
+    if (!error) error = medir(ob, ruta, carga->fuente, carga->largo_fuente);
+    contexto_destruir(carga);
+    return error;
+}
+
+/**
+ * Genera un programa sintético de n sentencias y lo mide.
+ * @param ob Opciones (las del generador, salvo la cantidad de sentencias).
+ * @param n Sentencias.
+ * @return 0, o 1 si hubo un error.
+ */
+static int medir_sintetico(const OpcionesBench *ob, long n) {
+    OpcionesGenerador og = ob->og;
+    og.sentencias = n;
+    char *texto;
+    size_t tam;
+    FILE *f = open_memstream(&texto, &tam);
+    if (!f) {
+        perror("open_memstream");
+        return 1;
+    }
+    int error = generador_escribir(f, &og);
+    fputc('\0', f);
+    fputc('\0', f);
+    fclose(f);
+    if (error) {
+        fprintf(stderr, "Error: no se pudo generar el programa de %ld sentencias\n", n);
+        free(texto);
+        return 1;
+    }
+    char nombre[64];
+    snprintf(nombre, sizeof(nombre), "sintetico-%ld", n);
+    error = medir(ob, nombre, texto, tam - 2);
+    free(texto);
+    return error;
+}
+
+/**
+ * Ejecuta una medición en un proceso hijo y espera a que termine.
+ * @param ob Opciones.
+ * @param ruta Archivo a medir, o NULL para un programa sintético.
+ * @param n Sentencias del programa sintético.
+ * @return 0, o 1 si el hijo falló.
+ */
+static int en_hijo(const OpcionesBench *ob, const char *ruta, long n) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return 1;
+    }
+    if (pid == 0) {
+        int error = ruta ? medir_archivo(ob, ruta) : medir_sintetico(ob, n);
+        fflush(stdout);
+        _exit(error ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+    int estado;
+    if (waitpid(pid, &estado, 0) < 0) {
+        perror("waitpid");
+        return 1;
+    }
+    if (WIFEXITED(estado) && WEXITSTATUS(estado) == 0) return 0;
+    fprintf(stderr, "Error: falló la medición de %s\n", ruta ? ruta : "un programa sintético");
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    OpcionesBench ob = { 5, LEXER_POR_DEFECTO, PARSER_BISON, { 0 } };
+    generador_opciones(&ob.og);
+    const char *lista = NULL;
+    int c, uso = 0;
+    while ((c = getopt(argc, argv, "r:L:P:n:v:p:a:l:d:s:")) != -1) {
+        switch (c) {
+            case 'r': ob.repeticiones = atoi(optarg); break;
+            case 'L': ob.lexer = strcmp(optarg, "simd") == 0 ? LEXER_SIMD : LEXER_FLEX; break;
+            case 'P': ob.parser = strcmp(optarg, "mano") == 0 ? PARSER_MANO : PARSER_BISON; break;
+            case 'n': lista = optarg; break;
+            case 'v': ob.og.variables = atoi(optarg); break;
+            case 'p': ob.og.profundidad = atoi(optarg); break;
+            case 'a': ob.og.ancho = atoi(optarg); break;
+            case 'l': ob.og.porc_logicas = atoi(optarg); break;
+            case 'd': ob.og.porc_declaraciones = atoi(optarg); break;
+            case 's': ob.og.semilla = strtoul(optarg, NULL, 10); break;
+            default:  uso = 1; break;
+        }
+    }
+    const char *motivo = generador_validar(&ob.og);
+    if (uso || ob.repeticiones <= 0 || motivo) {
+        if (motivo) fprintf(stderr, "Error: %s\n", motivo);
+        fprintf(stderr, "Uso: %s [-r repeticiones] [-L flex|simd] [-P bison|mano]\n"
+                        "       [-n sentencias[,sentencias...]] [-v variables] [-p profundidad]\n"
+                        "       [-a ancho] [-l %%lógicas] [-d %%declaraciones] [-s semilla] [archivo...]\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (!lista && optind >= argc) lista = SENTENCIAS_POR_DEFECTO;
+
+    int errores = 0;
+    for (int i = optind; i < argc; ++i) errores += en_hijo(&ob, argv[i], 0);
+    for (const char *p = lista; p && *p; ) {
+        char *fin;
+        long n = strtol(p, &fin, 10);
+        if (fin == p || n < 0) {
+            fprintf(stderr, "Error: lista de sentencias inválida '%s'\n", lista);
+            return EXIT_FAILURE;
+        }
+        errores += en_hijo(&ob, NULL, n);
+        p = *fin == ',' ? fin + 1 : fin;
+    }
+    return errores ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,160 @@
+/*
+ * Benchmark de los lexers: el generado por flex y el escrito a mano con SIMD.
+ *
+ * Uso: ./bench-lexico [-r repeticiones] archivo...
+ *
+ * Para cada archivo verifica que los dos lexers produzcan exactamente la
+ * misma secuencia de tokens (tipo, valor y línea) y mide cuántos tokens por
+ * segundo produce cada uno. Termina con error si alguna secuencia difiere.
+ */
+
+/* Definiciones necesarias para compatibilidad POSIX */
+#define _POSIX_C_SOURCE 200809L
+
+/* Inclusiones de bibliotecas estándar */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "contexto.h"
+#include "lexico.h"
+
+/* Interfaz del lexer reentrante (calc-lexico.l) */
+int yylex(YYSTYPE *yylval_param, void *yyscanner);
+
+/* Token con su valor y la línea en la que terminó */
+typedef struct {
+    int tipo;
+    size_t desplazamiento;      /* ID: porción del fuente */
+    size_t largo;
+    int num;                    /* NUMERO */
+    int linea;
+} Token;
+
+/**
+ * Devuelve el siguiente token del lexer en uso del contexto.
+ * @param ctx Contexto con el lexer ya iniciado.
+ * @param t Token a completar.
+ * @return Tipo de token (0 al final).
+ */
+static int siguiente(CompilerContext *ctx, Token *t) {
+    YYSTYPE lval;
+    memset(t, 0, sizeof(*t));
+    t->tipo = ctx->lexer == LEXER_SIMD ? lexico_simd(&lval, ctx) : yylex(&lval, ctx->scanner);
+    if (t->tipo == ID) {
+        t->desplazamiento = lval.lex.texto - ctx->fuente;
+        t->largo = lval.lex.largo;
+    } else if (t->tipo == NUMERO) {
+        t->num = lval.num;
+    }
+    t->linea = contexto_linea(ctx);
+    return t->tipo;
+}
+
+/**
+ * Compara las secuencias de tokens de los dos lexers sobre un archivo.
+ * @param ruta Archivo.
+ * @param tokens Devuelve la cantidad de tokens.
+ * @return 0 si son idénticas, 1 si no.
+ */
+static int comparar(const char *ruta, long *tokens) {
+    FILE *f = fopen(ruta, "r");
+    if (!f) {
+        perror(ruta);
+        exit(EXIT_FAILURE);
+    }
+    CompilerContext *flex = contexto_crear(stdout);
+    CompilerContext *simd = contexto_crear(stdout);
+    flex->lexer = LEXER_FLEX;
+    simd->lexer = LEXER_SIMD;
+    contexto_iniciar_lexico(flex, f);
+    rewind(f);
+    contexto_iniciar_lexico(simd, f);
+    fclose(f);
+
+    int distinto = 0;
+    Token a, b;
+    *tokens = 0;
+    do {
+        siguiente(flex, &a);
+        siguiente(simd, &b);
+        int igual = a.tipo == b.tipo && a.linea == b.linea && a.num == b.num &&
+                    a.largo == b.largo &&
+                    memcmp(flex->fuente + a.desplazamiento, simd->fuente + b.desplazamiento, a.largo) == 0;
+        if (!igual) {
+            fprintf(stderr, "%s: token %ld distinto (flex %d línea %d, simd %d línea %d)\n",
+                    ruta, *tokens, a.tipo, a.linea, b.tipo, b.linea);
+            distinto = 1;
+            break;
+        }
+        (*tokens)++;
+    } while (a.tipo != 0);
+
+    contexto_terminar_lexico(flex);
+    contexto_terminar_lexico(simd);
+    contexto_destruir(flex);
+    contexto_destruir(simd);
+    return distinto;
+}
+
+/**
+ * Mide un lexer recorriendo el archivo completo varias veces.
+ * @param ruta Archivo.
+ * @param lexer Lexer a medir.
+ * @param repeticiones Pasadas sobre el archivo.
+ * @return Segundos de la pasada más rápida.
+ */
+static double medir(const char *ruta, TipoLexer lexer, int repeticiones) {
+    double mejor = 0;
+    for (int r = 0; r < repeticiones; ++r) {
+        FILE *f = fopen(ruta, "r");
+        if (!f) {
+            perror(ruta);
+            exit(EXIT_FAILURE);
+        }
+        CompilerContext *ctx = contexto_crear(stdout);
+        ctx->lexer = lexer;
+        contexto_iniciar_lexico(ctx, f);
+        fclose(f);
+
+        YYSTYPE lval;
+        double t0 = stats_reloj();
+        if (lexer == LEXER_SIMD) while (lexico_simd(&lval, ctx) != 0) {}
+        else while (yylex(&lval, ctx->scanner) != 0) {}
+        double t = stats_reloj() - t0;
+        if (r == 0 || t < mejor) mejor = t;
+
+        contexto_terminar_lexico(ctx);
+        contexto_destruir(ctx);
+    }
+    return mejor;
+}
+
+int main(int argc, char *argv[]) {
+    int repeticiones = 20;
+    int c;
+    while ((c = getopt(argc, argv, "r:")) != -1) {
+        if (c == 'r' && atoi(optarg) > 0) repeticiones = atoi(optarg);
+        else optind = argc + 1;
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "Uso: %s [-r repeticiones] archivo...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int errores = 0;
+    printf("Lexer a mano: %s\n", LEXICO_SIMD_NOMBRE);
+    printf("%-32s %10s %14s %14s %8s\n", "archivo", "tokens", "flex tok/s", "simd tok/s", "mejora");
+    for (int i = optind; i < argc; ++i) {
+        long tokens;
+        if (comparar(argv[i], &tokens) != 0) {
+            errores++;
+            continue;
+        }
+        double t_flex = medir(argv[i], LEXER_FLEX, repeticiones);
+        double t_simd = medir(argv[i], LEXER_SIMD, repeticiones);
+        printf("%-32s %10ld %14.0f %14.0f %7.2fx\n", argv[i], tokens,
+               tokens / t_flex, tokens / t_simd, t_flex / t_simd);
+    }
+    return errores ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,164 @@
+/*
+ * Benchmark de los motores de ejecución: eval_nodo, eval_especializado y
+ * el motor de cierres.
+ *
+ * Uso: ./bench-motores [sentencias] [repeticiones]
+ *
+ * Arma un programa sintético de línea recta con los constructores del AST
+ * (declaraciones, asignaciones aritméticas y lógicas, un return final), lo
+ * ejecuta repetidas veces con cada motor, verifica que den el mismo
+ * resultado e informa el tiempo promedio por ejecución.
+ */
+
+/* Definiciones necesarias para compatibilidad POSIX */
+#define _POSIX_C_SOURCE 200809L
+
+/* Inclusiones de bibliotecas estándar */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ast.h"
+#include "contexto.h"
+#include "cierres.h"
+
+/* Cantidad de variables del programa sintético */
+#define N_VARS 64
+
+/* Generador pseudoaleatorio fijo para que el programa sea reproducible */
+#define SEMILLA 12345UL
+static unsigned long semilla = SEMILLA;
+
+/* Contexto donde se construye y evalúa el programa sintético */
+static CompilerContext *ctx;
+static int azar(int n) {
+    semilla = semilla * 1103515245UL + 12345UL;
+    return (int)((semilla >> 16) % (unsigned long)n);
+}
+
+/**
+ * Devuelve el tiempo monótono actual en segundos.
+ */
+static double ahora(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Crea un nodo ID para la variable i.
+ */
+static Nodo *var(int i) {
+    char nombre[16];
+    snprintf(nombre, sizeof(nombre), "v%d", i);
+    return nodo_ID(ctx, nombre, strlen(nombre));
+}
+
+/**
+ * Crea una expresión acotada sobre variables elegidas al azar.
+ */
+static Nodo *expresion(void) {
+    int a = azar(N_VARS), b = azar(N_VARS), c = azar(N_VARS), k = 1 + azar(9);
+    switch (azar(5)) {
+        case 0:  /* (a + k) - b */
+            return nodo_opBin(ctx, TOP_RESTA, nodo_opBin(ctx, TOP_SUMA, var(a), nodo_int(ctx, k)), var(b));
+        case 1:  /* a * 3 / 4 */
+            return nodo_opBin(ctx, TOP_DIV, nodo_opBin(ctx, TOP_MULT, var(a), nodo_int(ctx, 3)), nodo_int(ctx, 4));
+        case 2:  /* a < b && c > k */
+            return nodo_opBin(ctx, TOP_AND, nodo_opBin(ctx, TOP_MENOR, var(a), var(b)),
+                              nodo_opBin(ctx, TOP_MAYOR, var(c), nodo_int(ctx, k)));
+        case 3:  /* a == b || c < k */
+            return nodo_opBin(ctx, TOP_OR, nodo_opBin(ctx, TOP_IGUAL, var(a), var(b)),
+                              nodo_opBin(ctx, TOP_MENOR, var(c), nodo_int(ctx, k)));
+        default: /* (a - b) / 5 + k */
+            return nodo_opBin(ctx, TOP_SUMA, nodo_opBin(ctx, TOP_DIV,
+                              nodo_opBin(ctx, TOP_RESTA, var(a), var(b)), nodo_int(ctx, 5)), nodo_int(ctx, k));
+    }
+}
+
+/**
+ * Arma el programa: N_VARS declaraciones, n asignaciones y un return.
+ * Siempre genera el mismo árbol para el mismo n.
+ */
+static Nodo *programa_sintetico(int n) {
+    semilla = SEMILLA;
+    Nodo *resto = nodo_seq(ctx, nodo_return(ctx, nodo_opBin(ctx, TOP_SUMA, var(0), var(1))), NULL);
+    for (int i = n - 1; i >= 0; --i) {
+        char nombre[16];
+        snprintf(nombre, sizeof(nombre), "v%d", azar(N_VARS));
+        resto = nodo_seq(ctx, nodo_assign(ctx, nombre, strlen(nombre), expresion()), resto);
+    }
+    for (int i = N_VARS - 1; i >= 0; --i) {
+        char nombre[16];
+        snprintf(nombre, sizeof(nombre), "v%d", i);
+        resto = nodo_seq(ctx, nodo_decl(ctx, nombre, strlen(nombre), nodo_int(ctx, i)), resto);
+    }
+    return resto;
+}
+
+int main(int argc, char *argv[]) {
+    int sentencias = argc > 1 ? atoi(argv[1]) : 1000;
+    int repeticiones = argc > 2 ? atoi(argv[2]) : 2000;
+    if (sentencias <= 0 || repeticiones <= 0) {
+        fprintf(stderr, "Uso: %s [sentencias] [repeticiones]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    ctx = contexto_crear(stdout);
+    Nodo *prog = programa_sintetico(sentencias);
+
+    /* eval_nodo: la tabla de símbolos se vacía entre ejecuciones */
+    int r_arbol = 0;
+    double t0 = ahora();
+    for (int r = 0; r < repeticiones; ++r) {
+        r_arbol = eval_nodo(ctx, prog);
+        ast_liberar_recursos(ctx);
+    }
+    double t_arbol = ahora() - t0;
+
+    /* Nodos autoespecializados: la primera ejecución reescribe el árbol */
+    Nodo *prog_rapido = programa_sintetico(sentencias);
+    int r_especializado = 0;
+    t0 = ahora();
+    for (int r = 0; r < repeticiones; ++r) {
+        r_especializado = eval_especializado(ctx, prog_rapido);
+        ast_liberar_recursos(ctx);
+    }
+    double t_especializado = ahora() - t0;
+
+    /* Cierres: se compila una vez y se ejecuta sobre un marco reutilizado */
+    t0 = ahora();
+    ProgramaCierres pc;
+    cierres_compilar(prog, &pc);
+    double t_compilar = ahora() - t0;
+
+    int *marco = calloc(pc.n_vars + 1, sizeof(int));
+    if (!marco) {
+        perror("calloc");
+        return EXIT_FAILURE;
+    }
+    int r_cierres = 0;
+    t0 = ahora();
+    for (int r = 0; r < repeticiones; ++r) r_cierres = cierres_ejecutar(&pc, marco);
+    double t_cierres = ahora() - t0;
+
+    printf("Sentencias: %d, variables: %d, cierres: %d, repeticiones: %d\n",
+           sentencias, N_VARS, pc.n, repeticiones);
+    printf("eval_nodo:     %7.2f us/ejecución (resultado %d)\n",
+           t_arbol * 1e6 / repeticiones, r_arbol);
+    printf("especializado: %7.2f us/ejecución (resultado %d, %.2fx)\n",
+           t_especializado * 1e6 / repeticiones, r_especializado, t_arbol / t_especializado);
+    printf("cierres:       %7.2f us/ejecución (resultado %d, %.2fx, compilación %.2f us)\n",
+           t_cierres * 1e6 / repeticiones, r_cierres, t_arbol / t_cierres, t_compilar * 1e6);
+
+    free(marco);
+    cierres_liberar(&pc);
+    nodo_libre(ctx, prog);
+    nodo_libre(ctx, prog_rapido);
+    contexto_destruir(ctx);
+    if (r_arbol != r_cierres || r_arbol != r_especializado) {
+        fprintf(stderr, "Error: los motores no coinciden\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,198 @@
+/*
+ * Benchmark de los parsers: el generado por Bison y el escrito a mano.
+ *
+ * Uso: ./bench-parser [-r repeticiones] [-n sentencias] [archivo...]
+ *
+ * Tokeniza cada archivo una vez y lo parsea repetidas veces con cada parser
+ * desde el mismo arreglo de tokens, verifica que los dos AST sean idénticos
+ * e informa tokens por segundo. Con -n agrega un programa sintético de esa
+ * cantidad de sentencias, para medir con programas largos.
+ */
+
+/* Definiciones necesarias para compatibilidad POSIX */
+#define _POSIX_C_SOURCE 200809L
+
+/* Inclusiones de bibliotecas estándar */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "contexto.h"
+#include "tokens.h"
+#include "analizador.h"
+
+/**
+ * Compara dos AST nodo por nodo. Las secuencias se recorren con un bucle
+ * porque las listas de sentencias pueden ser muy largas.
+ * @param a Primer árbol.
+ * @param b Segundo árbol.
+ * @return 1 si son iguales.
+ */
+static int ast_iguales(const Nodo *a, const Nodo *b) {
+    while (a && b) {
+        if (a->tipo != b->tipo) return 0;
+        switch (a->tipo) {
+            case NODO_SEQ:
+                if (!ast_iguales(a->opBinaria.izq, b->opBinaria.izq)) return 0;
+                a = a->opBinaria.der;
+                b = b->opBinaria.der;
+                continue;
+            case NODO_OP:
+                return a->opBinaria.op == b->opBinaria.op &&
+                       ast_iguales(a->opBinaria.izq, b->opBinaria.izq) &&
+                       ast_iguales(a->opBinaria.der, b->opBinaria.der);
+            case NODO_ASSIGN:
+            case NODO_DECL:
+                return strcmp(a->assign.id, b->assign.id) == 0 &&
+                       ast_iguales(a->assign.expr, b->assign.expr);
+            case NODO_RETURN:
+                return ast_iguales(a->ret_expr, b->ret_expr);
+            case NODO_ID:
+                return strcmp(a->nombre, b->nombre) == 0;
+            case NODO_INT:
+                return a->val_int == b->val_int;
+            case NODO_BOOL:
+                return a->val_bool == b->val_bool;
+            default:
+                return 0;
+        }
+    }
+    return a == b;
+}
+
+/**
+ * Arma un programa sintético: declaraciones y asignaciones con expresiones
+ * aritméticas y lógicas, algunas entre paréntesis anidados.
+ * @param sentencias Cantidad de asignaciones.
+ * @param largo Devuelve el largo del texto.
+ * @return Texto terminado en dos NUL.
+ */
+static char *programa_sintetico(int sentencias, size_t *largo) {
+    char *texto;
+    size_t tam;
+    FILE *f = open_memstream(&texto, &tam);
+    if (!f) {
+        perror("open_memstream");
+        exit(EXIT_FAILURE);
+    }
+    fprintf(f, "int main () {\n    int a = 1, b = 2, c = 3;\n    bool p = true;\n");
+    for (int i = 0; i < sentencias; ++i) {
+        switch (i % 4) {
+            case 0:  fprintf(f, "    a = (a + %d) * (b - c) / 3;\n", i % 97); break;
+            case 1:  fprintf(f, "    b = ((((a + b)))) - %d * c;\n", i % 13); break;
+            case 2:  fprintf(f, "    p = a < b && (c == %d || b > a);\n", i % 7); break;
+            default: fprintf(f, "    c = a * b + c * %d - a / 2;\n", i % 5); break;
+        }
+    }
+    fprintf(f, "    return a + b + c;\n}\n");
+    fputc('\0', f);
+    fputc('\0', f);
+    fclose(f);
+    *largo = tam - 2;
+    return texto;
+}
+
+/**
+ * Tokeniza un texto y lo parsea con cada parser, compara y mide.
+ * @param nombre Nombre a mostrar.
+ * @param texto Fuente terminado en dos NUL (pasa a ser del contexto).
+ * @param largo Largo del fuente.
+ * @param repeticiones Parseos por parser.
+ * @return 0 si los AST coinciden (o si Bison no pudo y el otro sí).
+ */
+static int medir(const char *nombre, char *texto, size_t largo, int repeticiones) {
+    CompilerContext *ctx = contexto_crear(stdout);
+    ctx->lexer = LEXER_SIMD;
+    ctx->fuente = texto;
+    ctx->largo_fuente = largo;
+    contexto_preparar_lexico(ctx);
+    Tokens tokens;
+    tokens_iniciar(&tokens);
+    if (tokens_lexear(ctx, &tokens) != 0) {
+        tokens_liberar(&tokens);
+        contexto_terminar_lexico(ctx);
+        contexto_destruir(ctx);
+        return 1;
+    }
+
+    double mejor[2] = { 0, 0 };
+    Nodo *arbol[2] = { NULL, NULL };
+    int error[2];
+    for (int p = 0; p < 2; ++p) {
+        for (int r = 0; r < repeticiones; ++r) {
+            Nodo *raiz;
+            double t0 = stats_reloj();
+            error[p] = p == 0 ? contexto_parsear_tokens(ctx, &tokens, &raiz)
+                              : analizador_parsear(ctx, &tokens, &raiz);
+            double t = stats_reloj() - t0;
+            if (r == 0 || t < mejor[p]) mejor[p] = t;
+            if (r == 0) arbol[p] = raiz;
+            else nodo_libre(ctx, raiz);
+            if (error[p]) break;
+        }
+    }
+
+    int distinto = 0;
+    if (error[0] && !error[1]) {
+        printf("%-32s %10zu %14s %14.0f %8s\n", nombre, tokens.n, "(error)",
+               tokens.n / mejor[1], "-");
+    } else if (error[0] != error[1] || !ast_iguales(arbol[0], arbol[1])) {
+        fprintf(stderr, "%s: los AST de Bison y del parser a mano difieren\n", nombre);
+        distinto = 1;
+    } else {
+        printf("%-32s %10zu %14.0f %14.0f %7.2fx\n", nombre, tokens.n,
+               tokens.n / mejor[0], tokens.n / mejor[1], mejor[0] / mejor[1]);
+    }
+
+    nodo_libre(ctx, arbol[0]);
+    nodo_libre(ctx, arbol[1]);
+    tokens_liberar(&tokens);
+    contexto_terminar_lexico(ctx);
+    contexto_destruir(ctx);
+    return distinto;
+}
+
+int main(int argc, char *argv[]) {
+    int repeticiones = 20, sentencias = 0;
+    int c;
+    while ((c = getopt(argc, argv, "r:n:")) != -1) {
+        switch (c) {
+            case 'r': repeticiones = atoi(optarg); break;
+            case 'n': sentencias = atoi(optarg); break;
+            default:  repeticiones = 0; break;
+        }
+    }
+    if (repeticiones <= 0 || (optind >= argc && sentencias <= 0)) {
+        fprintf(stderr, "Uso: %s [-r repeticiones] [-n sentencias] [archivo...]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int errores = 0;
+    printf("%-32s %10s %14s %14s %8s\n", "entrada", "tokens", "bison tok/s", "mano tok/s", "mejora");
+    for (int i = optind; i < argc; ++i) {
+        FILE *f = fopen(argv[i], "r");
+        if (!f) {
+            perror(argv[i]);
+            return EXIT_FAILURE;
+        }
+        CompilerContext *carga = contexto_crear(stdout);
+        contexto_cargar_fuente(carga, f);
+        fclose(f);
+        char *texto = malloc(carga->largo_fuente + 2);
+        if (!texto) {
+            perror("malloc");
+            return EXIT_FAILURE;
+        }
+        memcpy(texto, carga->fuente, carga->largo_fuente + 2);
+        errores += medir(argv[i], texto, carga->largo_fuente, repeticiones);
+        contexto_destruir(carga);
+    }
+    if (sentencias > 0) {
+        char nombre[64];
+        size_t largo;
+        snprintf(nombre, sizeof(nombre), "sintético (%d sentencias)", sentencias);
+        char *texto = programa_sintetico(sentencias, &largo);
+        errores += medir(nombre, texto, largo, repeticiones);
+    }
+    return errores ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,323 @@
+/* Caché de compilaciones en disco: entradas por clave, publicación atómica y LRU */
+
+/* Definiciones necesarias para compatibilidad POSIX */
+#define _DEFAULT_SOURCE
+
+/* Inclusiones de bibliotecas estándar */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "cache.h"
+#include "serializacion.h"
+
+/* Una entrada del directorio, para cache_podar */
+typedef struct {
+    char *ruta;
+    uint64_t bytes;
+    struct timespec uso;        /* Fecha de modificación: último acierto o escritura */
+} EntradaDir;
+
+/**
+ * Calcula la clave de un resultado: el hash del fuente seguido de la versión
+ * del compilador y de las opciones que cambian lo que se guarda.
+ * @param hash_fuente plano_hash del fuente.
+ * @param opciones Texto con las fases pedidas.
+ * @return Clave.
+ */
+uint64_t cache_clave(uint64_t hash_fuente, const char *opciones) {
+    static const char version[] = CALC_VERSION;
+    uint64_t h = plano_hash_seguir(hash_fuente, version, sizeof(version));
+    return plano_hash_seguir(h, opciones, strlen(opciones) + 1);
+}
+
+/**
+ * Arma la ruta de una entrada dentro del directorio de caché.
+ * @param ruta Dónde dejar la ruta.
+ * @param tam Tamaño de ruta.
+ * @param dir Directorio de caché.
+ * @param clave Clave de la entrada.
+ * @param extension ".res" o ".ast".
+ */
+void cache_ruta(char *ruta, size_t tam, const char *dir, uint64_t clave, const char *extension) {
+    snprintf(ruta, tam, "%s/%016llx%s", dir, (unsigned long long)clave, extension);
+}
+
+/**
+ * Escribe un bloque completo en un descriptor.
+ * @param fd Descriptor.
+ * @param datos Bytes.
+ * @param largo Cantidad de bytes.
+ * @return 0 si se escribió todo, -1 si no.
+ */
+static int escribir_todo(int fd, const void *datos, size_t largo) {
+    const char *p = datos;
+    while (largo > 0) {
+        ssize_t w = write(fd, p, largo);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += w;
+        largo -= (size_t)w;
+    }
+    return 0;
+}
+
+/**
+ * Escribe un archivo por partes en un temporal del mismo directorio y lo
+ * renombra a su nombre final: quien abra la ruta ve el archivo anterior o el
+ * nuevo completo, nunca uno a medio escribir.
+ * @param ruta Nombre final.
+ * @param partes Bloques a escribir, en orden.
+ * @param largos Largo de cada bloque.
+ * @param n Cantidad de bloques.
+ * @return 0 si se publicó, -1 si no.
+ */
+int cache_publicar(const char *ruta, const void *const partes[], const size_t largos[], int n) {
+    char temporal[PATH_MAX];
+    if (snprintf(temporal, sizeof(temporal), "%s.XXXXXX", ruta) >= (int)sizeof(temporal)) return -1;
+    int fd = mkstemp(temporal);
+    if (fd < 0) return -1;
+
+    int ok = 1;
+    for (int i = 0; i < n && ok; ++i) ok = escribir_todo(fd, partes[i], largos[i]) == 0;
+    ok = ok && fchmod(fd, 0644) == 0;
+    ok = close(fd) == 0 && ok;
+    if (ok && rename(temporal, ruta) == 0) return 0;
+    unlink(temporal);
+    return -1;
+}
+
+/**
+ * Marca una entrada como recién usada, para que cache_podar la borre última.
+ * @param ruta Archivo de la entrada.
+ */
+void cache_tocar(const char *ruta) {
+    utimensat(AT_FDCWD, ruta, NULL, 0);
+}
+
+/**
+ * Busca el resultado de una compilación. El archivo queda mapeado y los
+ * textos de r apuntan adentro hasta cache_cerrar.
+ * @param dir Directorio de caché.
+ * @param clave cache_clave de la compilación.
+ * @param largo_fuente Bytes del fuente (defensa contra colisiones del hash).
+ * @param r Dónde dejar el resultado.
+ * @return 0 si estaba, -1 si no (o si la entrada no sirve).
+ */
+int cache_buscar(const char *dir, uint64_t clave, uint64_t largo_fuente, ResultadoCache *r) {
+    char ruta[PATH_MAX];
+    memset(r, 0, sizeof(*r));
+    cache_ruta(ruta, sizeof(ruta), dir, clave, ".res");
+
+    int fd = open(ruta, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || (size_t)sb.st_size < sizeof(CabeceraResultado)) {
+        close(fd);
+        return -1;
+    }
+    void *base = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return -1;
+
+    const CabeceraResultado *cab = base;
+    r->base = base;
+    r->largo = (size_t)sb.st_size;
+    if (memcmp(cab->magia, CACHE_MAGIA, sizeof(CACHE_MAGIA)) != 0 || cab->formato != CACHE_FORMATO ||
+        cab->clave != clave || cab->largo_fuente != largo_fuente ||
+        cab->largo_asm > r->largo || cab->largo_simbolos > r->largo ||
+        sizeof(CabeceraResultado) + cab->largo_asm + cab->largo_simbolos != r->largo) {
+        cache_cerrar(r);
+        return -1;
+    }
+    r->resultado = cab->resultado;
+    r->asm_texto = (const char *)(cab + 1);
+    r->largo_asm = (size_t)cab->largo_asm;
+    r->simbolos = r->asm_texto + r->largo_asm;
+    r->largo_simbolos = (size_t)cab->largo_simbolos;
+    cache_tocar(ruta);
+    return 0;
+}
+
+/**
+ * Desmapea un resultado encontrado con cache_buscar.
+ * @param r Resultado.
+ */
+void cache_cerrar(ResultadoCache *r) {
+    if (r->base) munmap(r->base, r->largo);
+    memset(r, 0, sizeof(*r));
+}
+
+/**
+ * Guarda el resultado de una compilación.
+ * @param dir Directorio de caché.
+ * @param clave cache_clave de la compilación.
+ * @param largo_fuente Bytes del fuente.
+ * @param r Resultado (textos en memoria del llamador).
+ * @return 0 si se guardó, -1 si no.
+ */
+int cache_guardar(const char *dir, uint64_t clave, uint64_t largo_fuente, const ResultadoCache *r) {
+    char ruta[PATH_MAX];
+    CabeceraResultado cab;
+    memset(&cab, 0, sizeof(cab));
+    memcpy(cab.magia, CACHE_MAGIA, sizeof(CACHE_MAGIA));
+    cab.formato = CACHE_FORMATO;
+    cab.resultado = r->resultado;
+    cab.clave = clave;
+    cab.largo_fuente = largo_fuente;
+    cab.largo_asm = r->largo_asm;
+    cab.largo_simbolos = r->largo_simbolos;
+
+    const void *const partes[] = { &cab, r->asm_texto, r->simbolos };
+    const size_t largos[] = { sizeof(cab), r->largo_asm, r->largo_simbolos };
+    cache_ruta(ruta, sizeof(ruta), dir, clave, ".res");
+    return cache_publicar(ruta, partes, largos, 3);
+}
+
+/**
+ * Compara dos entradas por último uso, la más vieja primero.
+ * @param a Primera EntradaDir.
+ * @param b Segunda EntradaDir.
+ * @return Negativo, cero o positivo.
+ */
+static int comparar_uso(const void *a, const void *b) {
+    const struct timespec *x = &((const EntradaDir *)a)->uso;
+    const struct timespec *y = &((const EntradaDir *)b)->uso;
+    if (x->tv_sec != y->tv_sec) return x->tv_sec < y->tv_sec ? -1 : 1;
+    return (x->tv_nsec > y->tv_nsec) - (x->tv_nsec < y->tv_nsec);
+}
+
+/**
+ * Mide el directorio y, si pasa del tamaño máximo, borra las entradas usadas
+ * hace más tiempo hasta dejarlo en CACHE_PODA_OBJETIVO. Sólo cuenta los .res
+ * y .ast; otro proceso puede estar podando a la vez, así que una entrada que
+ * ya no está no es un error.
+ * @param dir Directorio de caché.
+ * @param max_bytes Tamaño máximo.
+ * @param ocupado Devuelve los bytes que quedan (puede ser NULL; no se toca
+ *        si no hubo memoria).
+ * @return Cantidad de entradas borradas, o -1 si no hubo memoria para
+ *         recorrer el directorio (entonces no se borra nada).
+ */
+int cache_podar(const char *dir, uint64_t max_bytes, uint64_t *ocupado) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        if (ocupado) *ocupado = 0;
+        return 0;
+    }
+
+    size_t n = 0, cap = 64;
+    uint64_t total = 0;
+    EntradaDir *entradas = malloc(cap * sizeof(EntradaDir));
+    if (!entradas) {
+        closedir(d);
+        return -1;
+    }
+
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        size_t largo = strlen(e->d_name);
+        if (largo <= 4 || (strcmp(e->d_name + largo - 4, ".res") != 0 &&
+                           strcmp(e->d_name + largo - 4, ".ast") != 0)) continue;
+
+        char *ruta = malloc(strlen(dir) + largo + 2);
+        if (!ruta) break;
+        sprintf(ruta, "%s/%s", dir, e->d_name);
+        struct stat sb;
+        if (stat(ruta, &sb) != 0 || !S_ISREG(sb.st_mode)) {
+            free(ruta);
+            continue;
+        }
+        if (n == cap) {
+            EntradaDir *mas = realloc(entradas, cap * 2 * sizeof(EntradaDir));
+            if (!mas) {
+                free(ruta);
+                break;
+            }
+            entradas = mas;
+            cap *= 2;
+        }
+        entradas[n].ruta = ruta;
+        entradas[n].bytes = (uint64_t)sb.st_size;
+        entradas[n].uso = sb.st_mtim;
+        total += entradas[n].bytes;
+        n++;
+    }
+    /* Si se cortó por falta de memoria la lista está incompleta y podría
+       borrar entradas recientes en vez de las viejas */
+    int sin_memoria = e != NULL;
+    closedir(d);
+
+    int borradas = 0;
+    if (sin_memoria) {
+        borradas = -1;
+    } else if (total > max_bytes) {
+        uint64_t objetivo = CACHE_PODA_OBJETIVO(max_bytes);
+        qsort(entradas, n, sizeof(EntradaDir), comparar_uso);
+        for (size_t i = 0; i < n && total > objetivo; ++i) {
+            if (unlink(entradas[i].ruta) == 0) borradas++;
+            total -= entradas[i].bytes;
+        }
+    }
+    for (size_t i = 0; i < n; ++i) free(entradas[i].ruta);
+    free(entradas);
+    if (ocupado && !sin_memoria) *ocupado = total;
+    return borradas;
+}
+
+/**
+ * Prepara la estimación del tamaño de un directorio de caché. No lo recorre
+ * todavía: se mide la primera vez que se guarda algo.
+ * @param o Estimación.
+ * @param dir Directorio de caché.
+ * @param max_bytes Tamaño máximo.
+ */
+void cache_ocupacion_iniciar(OcupacionCache *o, const char *dir, uint64_t max_bytes) {
+    pthread_mutex_init(&o->mutex, NULL);
+    o->dir = dir;
+    o->max_bytes = max_bytes;
+    o->bytes = 0;
+    o->medido = 0;
+}
+
+/**
+ * Libera una estimación.
+ * @param o Estimación.
+ */
+void cache_ocupacion_destruir(OcupacionCache *o) {
+    pthread_mutex_destroy(&o->mutex);
+}
+
+/**
+ * Suma a la estimación una entrada recién guardada y, si con ella pasa del
+ * máximo, poda el directorio. El directorio sólo se recorre la primera vez y
+ * en cada poda, que lo deja con lugar para varios guardados más. Lo que
+ * guarden otros procesos no entra en la estimación hasta la próxima medida.
+ * @param o Estimación.
+ * @param ruta Entrada guardada.
+ * @return Cantidad de entradas borradas, o -1 si no hubo memoria para podar
+ *         (la próxima entrada que se guarde lo vuelve a intentar).
+ */
+int cache_anotar(OcupacionCache *o, const char *ruta) {
+    struct stat sb;
+    uint64_t bytes = stat(ruta, &sb) == 0 ? (uint64_t)sb.st_size : 0;
+    int borradas = 0;
+    pthread_mutex_lock(&o->mutex);
+    if (!o->medido) {
+        borradas = cache_podar(o->dir, o->max_bytes, &o->bytes);
+        o->medido = borradas >= 0;
+    } else {
+        o->bytes += bytes;
+        if (o->bytes > o->max_bytes) borradas = cache_podar(o->dir, o->max_bytes, &o->bytes);
+    }
+    pthread_mutex_unlock(&o->mutex);
+    return borradas;
+}
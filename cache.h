@@ -0,0 +1,99 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/* ------------------ Caché de compilaciones en disco (--cache) ------------------ */
+
+/*
+ * Cada entrada es un archivo del directorio de caché cuyo nombre es la clave:
+ *
+ *   <clave>.res   resultado de una compilación: el seudo-assembly, la tabla de
+ *                 símbolos impresa y el valor del programa. La clave es el
+ *                 hash del fuente, de CALC_VERSION y de las fases pedidas.
+ *   <clave>.ast   AST plano del fuente (serializacion.h), para las fases que
+ *                 necesitan el árbol. La clave es el hash del fuente.
+ *
+ * Las entradas se publican con un rename atómico. Cada acierto actualiza la
+ * fecha de modificación de la entrada. El tamaño del directorio se mide una
+ * vez y después se estima sumando lo que se guarda (OcupacionCache); cuando
+ * la estimación pasa del máximo se borran las entradas de fecha más vieja
+ * hasta quedar en CACHE_PODA_OBJETIVO (LRU), y se vuelve a medir.
+ */
+
+/* Versión del compilador que entra en la clave de los resultados. Por defecto
+   cada compilación de calc tiene la suya, así que un calc recompilado nunca
+   usa resultados de otro; para compartir la caché entre compilaciones del
+   mismo código, definir -DCALC_VERSION="..." */
+#ifndef CALC_VERSION
+#define CALC_VERSION "calc " __DATE__ " " __TIME__
+#endif
+
+/* Identificación del formato de los .res */
+#define CACHE_MAGIA "CALCRES"
+#define CACHE_FORMATO 1
+
+/* Tamaño máximo del directorio de caché por defecto (--cache-max, en MB) */
+#define CACHE_MAX_POR_DEFECTO 256
+
+/* Al podar se deja el directorio en 7/8 del máximo: si quedara justo en el
+   máximo, cada guardado siguiente volvería a recorrerlo */
+#define CACHE_PODA_OBJETIVO(max) ((max) - (max) / 8)
+
+/* Encabezado de un .res; le siguen largo_asm bytes de seudo-assembly y
+   largo_simbolos de la tabla impresa */
+typedef struct {
+    char magia[8];              /* CACHE_MAGIA con su NUL */
+    uint32_t formato;
+    int32_t resultado;          /* Valor del programa */
+    uint64_t clave;
+    uint64_t largo_fuente;
+    uint64_t largo_asm;
+    uint64_t largo_simbolos;
+} CabeceraResultado;
+
+/* Un resultado: al guardarlo apunta a memoria del llamador; al buscarlo, al
+   archivo mapeado */
+typedef struct {
+    int32_t resultado;
+    const char *asm_texto;
+    size_t largo_asm;
+    const char *simbolos;
+    size_t largo_simbolos;
+    void *base;                 /* Mapeo (sólo después de cache_buscar) */
+    size_t largo;
+} ResultadoCache;
+
+/* Tamaño estimado de un directorio de caché; lo comparten los hilos de --batch */
+typedef struct {
+    pthread_mutex_t mutex;
+    const char *dir;
+    uint64_t max_bytes;
+    uint64_t bytes;             /* Lo medido más lo guardado desde entonces */
+    int medido;                 /* 0 = todavía no se recorrió el directorio */
+} OcupacionCache;
+
+/* ------------------ Prototipos de funciones ------------------ */
+
+uint64_t cache_clave(uint64_t hash_fuente, const char *opciones); /* Clave de un .res */
+void cache_ruta(char *ruta, size_t tam, const char *dir, uint64_t clave, const char *extension);
+
+/* 0 si hay un resultado para la clave (queda mapeado hasta cache_cerrar) */
+int cache_buscar(const char *dir, uint64_t clave, uint64_t largo_fuente, ResultadoCache *r);
+void cache_cerrar(ResultadoCache *r);
+int cache_guardar(const char *dir, uint64_t clave, uint64_t largo_fuente, const ResultadoCache *r);
+
+/* Escribe las partes en un temporal y lo renombra a ruta; 0 si se pudo */
+int cache_publicar(const char *ruta, const void *const partes[], const size_t largos[], int n);
+void cache_tocar(const char *ruta);                     /* Marca la entrada como usada */
+/* Si el directorio pasa de max_bytes lo poda; devuelve las entradas borradas
+   (-1 si no hubo memoria) y en *ocupado (puede ser NULL) los bytes que quedan */
+int cache_podar(const char *dir, uint64_t max_bytes, uint64_t *ocupado);
+
+void cache_ocupacion_iniciar(OcupacionCache *o, const char *dir, uint64_t max_bytes);
+void cache_ocupacion_destruir(OcupacionCache *o);
+int cache_anotar(OcupacionCache *o, const char *ruta);  /* Entradas borradas, o -1 */
+
+#endif /* CACHE_H */
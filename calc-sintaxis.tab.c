@@ -55,10 +55,10 @@
 #define YYSKELETON_NAME "yacc.c"
 
 /* Pure parsers.  */
-#define YYPURE 0
+#define YYPURE 2
 
 /* Push parsers.  */
-#define YYPUSH 0
+#define YYPUSH 1
 
 /* Pull parsers.  */
 #define YYPULL 1
@@ -67,13 +67,13 @@
 
 
 /* First part of user prologue.  */
-#line 7 "calc-sintaxis.y"
+#line 28 "calc-sintaxis.y"
 
 #include <stdio.h>
 #include <stdlib.h>
-
-extern int yylex(void);
-extern void yyerror(const char *s);
+#include <string.h>
+#include "ast.h"
+#include "contexto.h"
 
 #line 79 "calc-sintaxis.tab.c"
 
@@ -149,6 +149,81 @@ typedef enum yysymbol_kind_t yysymbol_kind_t;
 
 
 
+/* Unqualified %code blocks.  */
+#line 58 "calc-sintaxis.y"
+
+#include "tokens.h"
+#include "analizador.h"
+#include "lexico.h"
+
+/* Tamaño inicial del buffer del análisis incremental */
+#define INCREMENTAL_INICIAL 65536
+
+/* Interfaz del lexer reentrante (calc-lexico.l, con bison-bridge) */
+int yylex_init_extra(CompilerContext *extra, yyscan_t *scanner);
+int yylex_destroy(yyscan_t yyscanner);
+struct yy_buffer_state *yy_scan_buffer(char *base, size_t size, yyscan_t yyscanner);
+void yyset_lineno(int linea, yyscan_t yyscanner);
+int yyget_lineno(yyscan_t yyscanner);
+void yyerror(CompilerContext *ctx, Nodo **raiz, const char *s);
+
+/* Con %locations Bison le pasa también la ubicación del error; yyerror ya
+   la calcula (contexto_linea y contexto_columna), así que no se usa */
+#define yyerror(lloc, ctx, raiz, s) ((void)(lloc), yyerror(ctx, raiz, s))
+
+/**
+ * Completa la ubicación de un token a partir de su desplazamiento en el fuente.
+ * @param ctx Contexto de compilación.
+ * @param desplazamiento Inicio del token en ctx->fuente.
+ * @param lloc Ubicación a completar.
+ */
+static void ubicar_token(CompilerContext *ctx, size_t desplazamiento, YYLTYPE *lloc) {
+    contexto_ubicar(ctx, desplazamiento, &lloc->first_line, &lloc->first_column);
+    lloc->last_line = lloc->first_line;
+    lloc->last_column = lloc->first_column;
+}
+
+static int yylex_tokens(YYSTYPE *lval, YYLTYPE *lloc, CompilerContext *ctx) {
+    const Tokens *t = ctx->tokens;
+    if (contexto_fallo(ctx)) return 0;     /* Cortar: lo apilado se destruye */
+    size_t i = ctx->token_actual < t->n ? ctx->token_actual++ : t->n - 1;
+    ubicar_token(ctx, t->desplazamiento[i], lloc);
+    return tokens_leer(t, ctx->fuente, i, lval);
+}
+#define yylex yylex_tokens
+
+/* Anota en un nodo recién construido la posición de un símbolo de la regla */
+#define UBICAR(nodo, l) nodo_ubicar((nodo), (l).first_line, (l).first_column)
+
+/* Texto y largo de un identificador, para los constructores del AST */
+#define LEXEMA(l) (l).texto, (l).largo
+
+/* Libera la copia de un identificador, si tiene (el constructor ya copió el nombre) */
+#define SOLTAR(l) do { if ((l).propio) free((char *)(l).texto); } while (0)
+
+/**
+ * Agrega una declaración o sentencia de nivel superior al final de CODIGO, o
+ * se la entrega al sumidero del contexto si hay uno (--stream).
+ * @param ctx Contexto de compilación.
+ * @param lista Lista armada hasta ahora.
+ * @param sentencia Sentencia recién reducida.
+ * @return La lista con la sentencia agregada.
+ */
+static ListaNodos agregar_sentencia(CompilerContext *ctx, ListaNodos lista, Nodo *sentencia) {
+    if (!sentencia) return lista;                       /* Falló su construcción */
+    if (ctx->sumidero) {
+        ctx->sumidero(ctx, sentencia, ctx->arg_sumidero);
+        return lista;
+    }
+    Nodo *seq = nodo_seq(ctx, sentencia, NULL);
+    if (!seq) return lista;                             /* nodo_seq ya liberó la sentencia */
+    if (lista.ultimo) lista.ultimo->opBinaria.der = seq;
+    else lista.primero = seq;
+    lista.ultimo = seq;
+    return lista;
+}
+
+#line 227 "calc-sintaxis.tab.c"
 
 #ifdef short
 # undef short
@@ -345,30 +420,6 @@ typedef int yy_state_fast_t;
 
 /* The parser invokes alloca or malloc; define the necessary symbols.  */
 
-# ifdef YYSTACK_USE_ALLOCA
-#  if YYSTACK_USE_ALLOCA
-#   ifdef __GNUC__
-#    define YYSTACK_ALLOC __builtin_alloca
-#   elif defined __BUILTIN_VA_ARG_INCR
-#    include <alloca.h> /* INFRINGES ON USER NAME SPACE */
-#   elif defined _AIX
-#    define YYSTACK_ALLOC __alloca
-#   elif defined _MSC_VER
-#    include <malloc.h> /* INFRINGES ON USER NAME SPACE */
-#    define alloca _alloca
-#   else
-#    define YYSTACK_ALLOC alloca
-#    if ! defined _ALLOCA_H && ! defined EXIT_SUCCESS
-#     include <stdlib.h> /* INFRINGES ON USER NAME SPACE */
-      /* Use EXIT_SUCCESS as a witness for stdlib.h.  */
-#     ifndef EXIT_SUCCESS
-#      define EXIT_SUCCESS 0
-#     endif
-#    endif
-#   endif
-#  endif
-# endif
-
 # ifdef YYSTACK_ALLOC
    /* Pacify GCC's 'empty if-body' warning.  */
 #  define YYSTACK_FREE(Ptr) do { /* empty */; } while (0)
@@ -410,13 +461,15 @@ void free (void *); /* INFRINGES ON USER NAME SPACE */
 
 #if (! defined yyoverflow \
      && (! defined __cplusplus \
-         || (defined YYSTYPE_IS_TRIVIAL && YYSTYPE_IS_TRIVIAL)))
+         || (defined YYLTYPE_IS_TRIVIAL && YYLTYPE_IS_TRIVIAL \
+             && defined YYSTYPE_IS_TRIVIAL && YYSTYPE_IS_TRIVIAL)))
 
 /* A type that is properly aligned for any stack member.  */
 union yyalloc
 {
   yy_state_t yyss_alloc;
   YYSTYPE yyvs_alloc;
+  YYLTYPE yyls_alloc;
 };
 
 /* The size of the maximum gap between one aligned stack and the next.  */
@@ -425,8 +478,9 @@ union yyalloc
 /* The size of an array large to enough to hold all stacks, each with
    N elements.  */
 # define YYSTACK_BYTES(N) \
-     ((N) * (YYSIZEOF (yy_state_t) + YYSIZEOF (YYSTYPE)) \
-      + YYSTACK_GAP_MAXIMUM)
+     ((N) * (YYSIZEOF (yy_state_t) + YYSIZEOF (YYSTYPE) \
+             + YYSIZEOF (YYLTYPE)) \
+      + 2 * YYSTACK_GAP_MAXIMUM)
 
 # define YYCOPY_NEEDED 1
 
@@ -471,7 +525,7 @@ union yyalloc
 /* YYFINAL -- State number of the termination state.  */
 #define YYFINAL  6
 /* YYLAST -- Last index in YYTABLE.  */
-#define YYLAST   105
+#define YYLAST   103
 
 /* YYNTOKENS -- Number of terminals.  */
 #define YYNTOKENS  30
@@ -480,7 +534,7 @@ union yyalloc
 /* YYNRULES -- Number of rules.  */
 #define YYNRULES  36
 /* YYNSTATES -- Number of states.  */
-#define YYNSTATES  71
+#define YYNSTATES  69
 
 /* YYMAXUTOK -- Last valid token kind.  */
 #define YYMAXUTOK   284
@@ -532,10 +586,10 @@ static const yytype_int8 yytranslate[] =
 /* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
 static const yytype_uint8 yyrline[] =
 {
-       0,    41,    41,    74,    75,    76,    80,    81,    84,    90,
-      94,    95,    99,   100,   101,   105,   106,   110,   111,   112,
-     113,   114,   118,   119,   120,   121,   122,   123,   124,   128,
-     129,   130,   131,   132,   133,   134,   135
+       0,   156,   156,   163,   164,   165,   171,   172,   173,   177,
+     181,   182,   186,   187,   188,   192,   193,   197,   198,   199,
+     200,   201,   206,   207,   208,   209,   210,   211,   212,   216,
+     217,   218,   219,   220,   221,   222,   223
 };
 #endif
 
@@ -566,7 +620,7 @@ yysymbol_name (yysymbol_kind_t yysymbol)
 }
 #endif
 
-#define YYPACT_NINF (-16)
+#define YYPACT_NINF (-17)
 
 #define yypact_value_is_default(Yyn) \
   ((Yyn) == YYPACT_NINF)
@@ -580,14 +634,13 @@ yysymbol_name (yysymbol_kind_t yysymbol)
    STATE-NUM.  */
 static const yytype_int8 yypact[] =
 {
-      17,   -16,   -16,   -16,     1,     7,   -16,     0,    26,    40,
-      86,    12,   -16,   -16,    -1,    50,    86,    45,    86,    67,
-     -16,   -16,   -16,   -16,    67,   -16,    35,    77,   -16,   -16,
-      55,    72,    66,   -16,    46,    79,    -7,    27,   -16,    34,
-      34,    34,    34,    34,    34,    34,   -16,    67,    67,    67,
-     -16,    45,   -16,   -16,   -16,   -16,    34,    33,    33,    73,
-      73,   -16,   -16,    73,    60,   -16,    74,    60,    53,   -16,
-      23
+      93,   -17,   -17,   -17,     1,     7,   -17,     0,    25,    41,
+     -17,    39,    33,   -17,   -17,    -1,   -17,   -17,    64,   -17,
+      75,   -17,   -17,   -17,   -17,    75,   -17,    43,    70,    44,
+      50,    74,    54,    72,    -7,    35,   -17,    31,    31,    31,
+      31,    31,    31,    31,   -17,    75,    75,    75,   -17,    64,
+     -17,   -17,   -17,   -17,    31,    10,    10,    65,    65,   -17,
+     -17,    65,    30,   -17,    79,    30,    77,   -17,    20
 };
 
 /* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
@@ -596,27 +649,26 @@ static const yytype_int8 yypact[] =
 static const yytype_int8 yydefact[] =
 {
        0,     3,     4,     5,     0,     0,     1,     0,     0,     0,
-       6,     0,    15,    16,     0,     0,     6,     0,     6,     0,
-      27,    28,    35,    36,     0,    19,     0,     0,     2,     7,
-      12,     0,    10,     8,     0,     0,     0,     0,    20,     0,
-       0,     0,     0,     0,     0,     0,    21,     0,     0,     0,
-       9,     0,    17,    18,    26,    34,     0,    23,    22,    32,
-      33,    25,    24,    31,     0,    30,    29,    13,    14,    11,
-       0
+       6,     0,     0,    15,    16,     0,     2,     7,     0,     8,
+       0,    27,    28,    35,    36,     0,    19,     0,     0,    12,
+       0,    10,     0,     0,     0,     0,    20,     0,     0,     0,
+       0,     0,     0,     0,    21,     0,     0,     0,     9,     0,
+      17,    18,    26,    34,     0,    23,    22,    32,    33,    25,
+      24,    31,     0,    30,    29,    13,    14,    11,     0
 };
 
 /* YYPGOTO[NTERM-NUM].  */
 static const yytype_int8 yypgoto[] =
 {
-     -16,   -16,   -16,    29,   -16,    54,   -16,   -16,   -16,   -14,
-     -15
+     -17,   -17,   -17,   -17,   -17,    40,   -17,   -17,   -17,   -15,
+     -16
 };
 
 /* YYDEFGOTO[NTERM-NUM].  */
 static const yytype_int8 yydefgoto[] =
 {
-       0,     4,     5,    15,    16,    31,    32,    17,    18,    64,
-      27
+       0,     4,     5,    11,    17,    30,    31,    18,    19,    62,
+      28
 };
 
 /* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
@@ -624,32 +676,32 @@ static const yytype_int8 yydefgoto[] =
    number is the opposite.  If YYTABLE_NINF, syntax error.  */
 static const yytype_int8 yytable[] =
 {
-      26,     6,    20,    21,    35,    34,    54,    22,    23,    37,
-      36,    24,     8,    39,    40,    41,    42,    25,     7,    43,
-      44,    45,     1,     2,     3,    57,    58,    59,    60,    61,
-      62,    63,    65,    66,    68,    67,    54,    20,    21,     9,
-      55,    19,    70,    39,    40,    29,    56,    33,    30,    43,
-      44,    47,    48,    38,    10,    39,    40,    41,    42,    43,
-      44,    43,    44,    45,    52,    28,    39,    40,    41,    42,
-      20,    21,    43,    44,    45,    22,    23,    47,    48,    24,
-      39,    40,    41,    42,    49,    51,    43,    44,    45,    11,
-      50,    12,    13,    39,    40,    46,    14,    53,    47,    43,
-      44,    47,    48,    47,    48,    69
+      27,     6,    21,    22,    33,    32,    52,    23,    24,    35,
+      34,    25,     8,    37,    38,    39,    40,    26,     7,    41,
+      42,    43,    55,    56,    57,    58,    59,    60,    61,    63,
+      64,    66,    65,    52,    21,    22,    41,    42,     9,    68,
+      37,    38,    12,    54,    13,    14,    41,    42,    53,    15,
+      37,    38,    39,    40,    16,    10,    41,    42,    43,    45,
+      46,    36,    20,    37,    38,    39,    40,    29,    48,    41,
+      42,    43,    50,    47,    37,    38,    39,    40,    21,    22,
+      41,    42,    43,    23,    24,    37,    38,    25,    44,    67,
+      51,    41,    42,    49,    45,    46,    45,    46,     1,     2,
+       3,    45,    46,    45
 };
 
 static const yytype_int8 yycheck[] =
 {
-      14,     0,     3,     4,    19,    19,    13,     8,     9,    24,
-      24,    12,    12,    20,    21,    22,    23,    18,    11,    26,
-      27,    28,     5,     6,     7,    39,    40,    41,    42,    43,
-      44,    45,    47,    48,    49,    49,    13,     3,     4,    13,
-      13,    29,    56,    20,    21,    16,    12,    18,     3,    26,
-      27,    24,    25,    18,    14,    20,    21,    22,    23,    26,
-      27,    26,    27,    28,    18,    15,    20,    21,    22,    23,
-       3,     4,    26,    27,    28,     8,     9,    24,    25,    12,
-      20,    21,    22,    23,    29,    19,    26,    27,    28,     3,
-      18,     5,     6,    20,    21,    18,    10,    18,    24,    26,
-      27,    24,    25,    24,    25,    51
+      15,     0,     3,     4,    20,    20,    13,     8,     9,    25,
+      25,    12,    12,    20,    21,    22,    23,    18,    11,    26,
+      27,    28,    37,    38,    39,    40,    41,    42,    43,    45,
+      46,    47,    47,    13,     3,     4,    26,    27,    13,    54,
+      20,    21,     3,    12,     5,     6,    26,    27,    13,    10,
+      20,    21,    22,    23,    15,    14,    26,    27,    28,    24,
+      25,    18,    29,    20,    21,    22,    23,     3,    18,    26,
+      27,    28,    18,    29,    20,    21,    22,    23,     3,     4,
+      26,    27,    28,     8,     9,    20,    21,    12,    18,    49,
+      18,    26,    27,    19,    24,    25,    24,    25,     5,     6,
+       7,    24,    25,    24
 };
 
 /* YYSTOS[STATE-NUM] -- The symbol kind of the accessing symbol of
@@ -657,13 +709,12 @@ static const yytype_int8 yycheck[] =
 static const yytype_int8 yystos[] =
 {
        0,     5,     6,     7,    31,    32,     0,    11,    12,    13,
-      14,     3,     5,     6,    10,    33,    34,    37,    38,    29,
-       3,     4,     8,     9,    12,    18,    39,    40,    15,    33,
-       3,    35,    36,    33,    39,    40,    39,    40,    18,    20,
-      21,    22,    23,    26,    27,    28,    18,    24,    25,    29,
-      18,    19,    18,    18,    13,    13,    12,    39,    39,    39,
-      39,    39,    39,    39,    39,    40,    40,    39,    40,    35,
-      39
+      14,    33,     3,     5,     6,    10,    15,    34,    37,    38,
+      29,     3,     4,     8,     9,    12,    18,    39,    40,     3,
+      35,    36,    39,    40,    39,    40,    18,    20,    21,    22,
+      23,    26,    27,    28,    18,    24,    25,    29,    18,    19,
+      18,    18,    13,    13,    12,    39,    39,    39,    39,    39,
+      39,    39,    39,    40,    40,    39,    40,    35,    39
 };
 
 /* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
@@ -710,7 +761,7 @@ enum { YYENOMEM = -2 };
       }                                                           \
     else                                                          \
       {                                                           \
-        yyerror (YY_("syntax error: cannot back up")); \
+        yyerror (&yylloc, ctx, raiz, YY_("syntax error: cannot back up")); \
         YYERROR;                                                  \
       }                                                           \
   while (0)
@@ -719,6 +770,32 @@ enum { YYENOMEM = -2 };
    Use YYerror or YYUNDEF. */
 #define YYERRCODE YYUNDEF
 
+/* YYLLOC_DEFAULT -- Set CURRENT to span from RHS[1] to RHS[N].
+   If N is 0, then set CURRENT to the empty location which ends
+   the previous symbol: RHS[0] (always defined).  */
+
+#ifndef YYLLOC_DEFAULT
+# define YYLLOC_DEFAULT(Current, Rhs, N)                                \
+    do                                                                  \
+      if (N)                                                            \
+        {                                                               \
+          (Current).first_line   = YYRHSLOC (Rhs, 1).first_line;        \
+          (Current).first_column = YYRHSLOC (Rhs, 1).first_column;      \
+          (Current).last_line    = YYRHSLOC (Rhs, N).last_line;         \
+          (Current).last_column  = YYRHSLOC (Rhs, N).last_column;       \
+        }                                                               \
+      else                                                              \
+        {                                                               \
+          (Current).first_line   = (Current).last_line   =              \
+            YYRHSLOC (Rhs, 0).last_line;                                \
+          (Current).first_column = (Current).last_column =              \
+            YYRHSLOC (Rhs, 0).last_column;                              \
+        }                                                               \
+    while (0)
+#endif
+
+#define YYRHSLOC(Rhs, K) ((Rhs)[K])
+
 
 /* Enable debugging if requested.  */
 #if YYDEBUG
@@ -735,6 +812,63 @@ do {                                            \
 } while (0)
 
 
+/* YYLOCATION_PRINT -- Print the location on the stream.
+   This macro was not mandated originally: define only if we know
+   we won't break user code: when these are the locations we know.  */
+
+# ifndef YYLOCATION_PRINT
+
+#  if defined YY_LOCATION_PRINT
+
+   /* Temporary convenience wrapper in case some people defined the
+      undocumented and private YY_LOCATION_PRINT macros.  */
+#   define YYLOCATION_PRINT(File, Loc)  YY_LOCATION_PRINT(File, *(Loc))
+
+#  elif defined YYLTYPE_IS_TRIVIAL && YYLTYPE_IS_TRIVIAL
+
+/* Print *YYLOCP on YYO.  Private, do not rely on its existence. */
+
+YY_ATTRIBUTE_UNUSED
+static int
+yy_location_print_ (FILE *yyo, YYLTYPE const * const yylocp)
+{
+  int res = 0;
+  int end_col = 0 != yylocp->last_column ? yylocp->last_column - 1 : 0;
+  if (0 <= yylocp->first_line)
+    {
+      res += YYFPRINTF (yyo, "%d", yylocp->first_line);
+      if (0 <= yylocp->first_column)
+        res += YYFPRINTF (yyo, ".%d", yylocp->first_column);
+    }
+  if (0 <= yylocp->last_line)
+    {
+      if (yylocp->first_line < yylocp->last_line)
+        {
+          res += YYFPRINTF (yyo, "-%d", yylocp->last_line);
+          if (0 <= end_col)
+            res += YYFPRINTF (yyo, ".%d", end_col);
+        }
+      else if (0 <= end_col && yylocp->first_column < end_col)
+        res += YYFPRINTF (yyo, "-%d", end_col);
+    }
+  return res;
+}
+
+#   define YYLOCATION_PRINT  yy_location_print_
+
+    /* Temporary convenience wrapper in case some people defined the
+       undocumented and private YY_LOCATION_PRINT macros.  */
+#   define YY_LOCATION_PRINT(File, Loc)  YYLOCATION_PRINT(File, &(Loc))
+
+#  else
+
+#   define YYLOCATION_PRINT(File, Loc) ((void) 0)
+    /* Temporary convenience wrapper in case some people defined the
+       undocumented and private YY_LOCATION_PRINT macros.  */
+#   define YY_LOCATION_PRINT  YYLOCATION_PRINT
+
+#  endif
+# endif /* !defined YYLOCATION_PRINT */
 
 
 # define YY_SYMBOL_PRINT(Title, Kind, Value, Location)                    \
@@ -743,7 +877,7 @@ do {                                                                      \
     {                                                                     \
       YYFPRINTF (stderr, "%s ", Title);                                   \
       yy_symbol_print (stderr,                                            \
-                  Kind, Value); \
+                  Kind, Value, Location, ctx, raiz); \
       YYFPRINTF (stderr, "\n");                                           \
     }                                                                     \
 } while (0)
@@ -755,10 +889,13 @@ do {                                                                      \
 
 static void
 yy_symbol_value_print (FILE *yyo,
-                       yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep)
+                       yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, YYLTYPE const * const yylocationp, CompilerContext *ctx, Nodo **raiz)
 {
   FILE *yyoutput = yyo;
   YY_USE (yyoutput);
+  YY_USE (yylocationp);
+  YY_USE (ctx);
+  YY_USE (raiz);
   if (!yyvaluep)
     return;
   YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
@@ -773,12 +910,14 @@ yy_symbol_value_print (FILE *yyo,
 
 static void
 yy_symbol_print (FILE *yyo,
-                 yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep)
+                 yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, YYLTYPE const * const yylocationp, CompilerContext *ctx, Nodo **raiz)
 {
   YYFPRINTF (yyo, "%s %s (",
              yykind < YYNTOKENS ? "token" : "nterm", yysymbol_name (yykind));
 
-  yy_symbol_value_print (yyo, yykind, yyvaluep);
+  YYLOCATION_PRINT (yyo, yylocationp);
+  YYFPRINTF (yyo, ": ");
+  yy_symbol_value_print (yyo, yykind, yyvaluep, yylocationp, ctx, raiz);
   YYFPRINTF (yyo, ")");
 }
 
@@ -811,8 +950,8 @@ do {                                                            \
 `------------------------------------------------*/
 
 static void
-yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp,
-                 int yyrule)
+yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp, YYLTYPE *yylsp,
+                 int yyrule, CompilerContext *ctx, Nodo **raiz)
 {
   int yylno = yyrline[yyrule];
   int yynrhs = yyr2[yyrule];
@@ -825,7 +964,8 @@ yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp,
       YYFPRINTF (stderr, "   $%d = ", yyi + 1);
       yy_symbol_print (stderr,
                        YY_ACCESSING_SYMBOL (+yyssp[yyi + 1 - yynrhs]),
-                       &yyvsp[(yyi + 1) - (yynrhs)]);
+                       &yyvsp[(yyi + 1) - (yynrhs)],
+                       &(yylsp[(yyi + 1) - (yynrhs)]), ctx, raiz);
       YYFPRINTF (stderr, "\n");
     }
 }
@@ -833,7 +973,7 @@ yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp,
 # define YY_REDUCE_PRINT(Rule)          \
 do {                                    \
   if (yydebug)                          \
-    yy_reduce_print (yyssp, yyvsp, Rule); \
+    yy_reduce_print (yyssp, yyvsp, yylsp, Rule, ctx, raiz); \
 } while (0)
 
 /* Nonzero means print parse trace.  It is left uninitialized so that
@@ -862,6 +1002,40 @@ int yydebug;
 #ifndef YYMAXDEPTH
 # define YYMAXDEPTH 10000
 #endif
+/* Parser data structure.  */
+struct yypstate
+  {
+    /* Number of syntax errors so far.  */
+    int yynerrs;
+
+    yy_state_fast_t yystate;
+    /* Number of tokens to shift before error messages enabled.  */
+    int yyerrstatus;
+
+    /* Refer to the stacks through separate pointers, to allow yyoverflow
+       to reallocate them elsewhere.  */
+
+    /* Their size.  */
+    YYPTRDIFF_T yystacksize;
+
+    /* The state stack: array, bottom, top.  */
+    yy_state_t yyssa[YYINITDEPTH];
+    yy_state_t *yyss;
+    yy_state_t *yyssp;
+
+    /* The semantic value stack: array, bottom, top.  */
+    YYSTYPE yyvsa[YYINITDEPTH];
+    YYSTYPE *yyvs;
+    YYSTYPE *yyvsp;
+
+    /* The location stack: array, bottom, top.  */
+    YYLTYPE yylsa[YYINITDEPTH];
+    YYLTYPE *yyls;
+    YYLTYPE *yylsp;
+    /* Whether this instance has not started parsing yet.
+     * If 2, it corresponds to a finished parsing.  */
+    int yynew;
+  };
 
 
 
@@ -874,56 +1048,212 @@ int yydebug;
 
 static void
 yydestruct (const char *yymsg,
-            yysymbol_kind_t yykind, YYSTYPE *yyvaluep)
+            yysymbol_kind_t yykind, YYSTYPE *yyvaluep, YYLTYPE *yylocationp, CompilerContext *ctx, Nodo **raiz)
 {
   YY_USE (yyvaluep);
+  YY_USE (yylocationp);
+  YY_USE (ctx);
+  YY_USE (raiz);
   if (!yymsg)
     yymsg = "Deleting";
   YY_SYMBOL_PRINT (yymsg, yykind, yyvaluep, yylocationp);
 
   YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
-  YY_USE (yykind);
+  switch (yykind)
+    {
+    case YYSYMBOL_ID: /* ID  */
+#line 145 "calc-sintaxis.y"
+            { SOLTAR(((*yyvaluep).lex)); }
+#line 1068 "calc-sintaxis.tab.c"
+        break;
+
+    case YYSYMBOL_prog: /* prog  */
+#line 143 "calc-sintaxis.y"
+            { nodo_libre(ctx, ((*yyvaluep).nodo)); }
+#line 1074 "calc-sintaxis.tab.c"
+        break;
+
+    case YYSYMBOL_CODIGO: /* CODIGO  */
+#line 144 "calc-sintaxis.y"
+            { nodo_libre(ctx, ((*yyvaluep).lista).primero); }
+#line 1080 "calc-sintaxis.tab.c"
+        break;
+
+    case YYSYMBOL_DECLARACION: /* DECLARACION  */
+#line 143 "calc-sintaxis.y"
+            { nodo_libre(ctx, ((*yyvaluep).nodo)); }
+#line 1086 "calc-sintaxis.tab.c"
+        break;
+
+    case YYSYMBOL_VARS: /* VARS  */
+#line 143 "calc-sintaxis.y"
+            { nodo_libre(ctx, ((*yyvaluep).nodo)); }
+#line 1092 "calc-sintaxis.tab.c"
+        break;
+
+    case YYSYMBOL_VAR: /* VAR  */
+#line 143 "calc-sintaxis.y"
+            { nodo_libre(ctx, ((*yyvaluep).nodo)); }
+#line 1098 "calc-sintaxis.tab.c"
+        break;
+
+    case YYSYMBOL_SENTENCIA: /* SENTENCIA  */
+#line 143 "calc-sintaxis.y"
+            { nodo_libre(ctx, ((*yyvaluep).nodo)); }
+#line 1104 "calc-sintaxis.tab.c"
+        break;
+
+    case YYSYMBOL_E: /* E  */
+#line 143 "calc-sintaxis.y"
+            { nodo_libre(ctx, ((*yyvaluep).nodo)); }
+#line 1110 "calc-sintaxis.tab.c"
+        break;
+
+    case YYSYMBOL_EB: /* EB  */
+#line 143 "calc-sintaxis.y"
+            { nodo_libre(ctx, ((*yyvaluep).nodo)); }
+#line 1116 "calc-sintaxis.tab.c"
+        break;
+
+      default:
+        break;
+    }
   YY_IGNORE_MAYBE_UNINITIALIZED_END
 }
 
 
-/* Lookahead token kind.  */
-int yychar;
 
-/* The semantic value of the lookahead symbol.  */
-YYSTYPE yylval;
-/* Number of syntax errors so far.  */
-int yynerrs;
 
 
+int
+yyparse (CompilerContext *ctx, Nodo **raiz)
+{
+  yypstate *yyps = yypstate_new ();
+  if (!yyps)
+    {
+      static YYLTYPE yyloc_default
+# if defined YYLTYPE_IS_TRIVIAL && YYLTYPE_IS_TRIVIAL
+  = { 1, 1, 1, 1 }
+# endif
+;
+      YYLTYPE yylloc = yyloc_default;
+      yyerror (&yylloc, ctx, raiz, YY_("memory exhausted"));
+      return 2;
+    }
+  int yystatus = yypull_parse (yyps, ctx, raiz);
+  yypstate_delete (yyps);
+  return yystatus;
+}
 
+int
+yypull_parse (yypstate *yyps, CompilerContext *ctx, Nodo **raiz)
+{
+  YY_ASSERT (yyps);
+  static YYLTYPE yyloc_default
+# if defined YYLTYPE_IS_TRIVIAL && YYLTYPE_IS_TRIVIAL
+  = { 1, 1, 1, 1 }
+# endif
+;
+  YYLTYPE yylloc = yyloc_default;
+  int yystatus;
+  do {
+    YYSTYPE yylval;
+    int yychar = yylex (&yylval, &yylloc, ctx);
+    yystatus = yypush_parse (yyps, yychar, &yylval, &yylloc, ctx, raiz);
+  } while (yystatus == YYPUSH_MORE);
+  return yystatus;
+}
 
-/*----------.
-| yyparse.  |
-`----------*/
+#define yynerrs yyps->yynerrs
+#define yystate yyps->yystate
+#define yyerrstatus yyps->yyerrstatus
+#define yyssa yyps->yyssa
+#define yyss yyps->yyss
+#define yyssp yyps->yyssp
+#define yyvsa yyps->yyvsa
+#define yyvs yyps->yyvs
+#define yyvsp yyps->yyvsp
+#define yylsa yyps->yylsa
+#define yyls yyps->yyls
+#define yylsp yyps->yylsp
+#define yystacksize yyps->yystacksize
+
+/* Initialize the parser data structure.  */
+static void
+yypstate_clear (yypstate *yyps)
+{
+  yynerrs = 0;
+  yystate = 0;
+  yyerrstatus = 0;
+
+  yyssp = yyss;
+  yyvsp = yyvs;
+  yylsp = yyls;
+
+  /* Initialize the state stack, in case yypcontext_expected_tokens is
+     called before the first call to yyparse. */
+  *yyssp = 0;
+  yyps->yynew = 1;
+}
 
-int
-yyparse (void)
+/* Initialize the parser data structure.  */
+yypstate *
+yypstate_new (void)
 {
-    yy_state_fast_t yystate = 0;
-    /* Number of tokens to shift before error messages enabled.  */
-    int yyerrstatus = 0;
+  yypstate *yyps;
+  yyps = YY_CAST (yypstate *, YYMALLOC (sizeof *yyps));
+  if (!yyps)
+    return YY_NULLPTR;
+  yystacksize = YYINITDEPTH;
+  yyss = yyssa;
+  yyvs = yyvsa;
+  yyls = yylsa;
+  yypstate_clear (yyps);
+  return yyps;
+}
 
-    /* Refer to the stacks through separate pointers, to allow yyoverflow
-       to reallocate them elsewhere.  */
+void
+yypstate_delete (yypstate *yyps)
+{
+  if (yyps)
+    {
+#ifndef yyoverflow
+      /* If the stack was reallocated but the parse did not complete, then the
+         stack still needs to be freed.  */
+      if (yyss != yyssa)
+        YYSTACK_FREE (yyss);
+#endif
+      YYFREE (yyps);
+    }
+}
 
-    /* Their size.  */
-    YYPTRDIFF_T yystacksize = YYINITDEPTH;
 
-    /* The state stack: array, bottom, top.  */
-    yy_state_t yyssa[YYINITDEPTH];
-    yy_state_t *yyss = yyssa;
-    yy_state_t *yyssp = yyss;
 
-    /* The semantic value stack: array, bottom, top.  */
-    YYSTYPE yyvsa[YYINITDEPTH];
-    YYSTYPE *yyvs = yyvsa;
-    YYSTYPE *yyvsp = yyvs;
+/*---------------.
+| yypush_parse.  |
+`---------------*/
+
+int
+yypush_parse (yypstate *yyps,
+              int yypushed_char, YYSTYPE const *yypushed_val, YYLTYPE *yypushed_loc, CompilerContext *ctx, Nodo **raiz)
+{
+/* Lookahead token kind.  */
+int yychar;
+
+
+/* The semantic value of the lookahead symbol.  */
+/* Default value used for initialization, for pacifying older GCCs
+   or non-GCC compilers.  */
+YY_INITIAL_VALUE (static YYSTYPE yyval_default;)
+YYSTYPE yylval YY_INITIAL_VALUE (= yyval_default);
+
+/* Location data for the lookahead symbol.  */
+static YYLTYPE yyloc_default
+# if defined YYLTYPE_IS_TRIVIAL && YYLTYPE_IS_TRIVIAL
+  = { 1, 1, 1, 1 }
+# endif
+;
+YYLTYPE yylloc = yyloc_default;
 
   int yyn;
   /* The return value of yyparse.  */
@@ -933,19 +1263,38 @@ yyparse (void)
   /* The variables used to return semantic value and location from the
      action routines.  */
   YYSTYPE yyval;
+  YYLTYPE yyloc;
+
+  /* The locations where the error started and ended.  */
+  YYLTYPE yyerror_range[3];
 
 
 
-#define YYPOPSTACK(N)   (yyvsp -= (N), yyssp -= (N))
+#define YYPOPSTACK(N)   (yyvsp -= (N), yyssp -= (N), yylsp -= (N))
 
   /* The number of symbols on the RHS of the reduced rule.
      Keep to zero when no symbol should be popped.  */
   int yylen = 0;
 
+  switch (yyps->yynew)
+    {
+    case 0:
+      yyn = yypact[yystate];
+      goto yyread_pushed_token;
+
+    case 2:
+      yypstate_clear (yyps);
+      break;
+
+    default:
+      break;
+    }
+
   YYDPRINTF ((stderr, "Starting parse\n"));
 
   yychar = YYEMPTY; /* Cause a token to be read.  */
 
+  yylsp[0] = *yypushed_loc;
   goto yysetstate;
 
 
@@ -984,6 +1333,7 @@ yysetstate:
            memory.  */
         yy_state_t *yyss1 = yyss;
         YYSTYPE *yyvs1 = yyvs;
+        YYLTYPE *yyls1 = yyls;
 
         /* Each stack pointer address is followed by the size of the
            data in use in that stack, in bytes.  This used to be a
@@ -992,9 +1342,11 @@ yysetstate:
         yyoverflow (YY_("memory exhausted"),
                     &yyss1, yysize * YYSIZEOF (*yyssp),
                     &yyvs1, yysize * YYSIZEOF (*yyvsp),
+                    &yyls1, yysize * YYSIZEOF (*yylsp),
                     &yystacksize);
         yyss = yyss1;
         yyvs = yyvs1;
+        yyls = yyls1;
       }
 # else /* defined YYSTACK_RELOCATE */
       /* Extend the stack our own way.  */
@@ -1013,6 +1365,7 @@ yysetstate:
           YYNOMEM;
         YYSTACK_RELOCATE (yyss_alloc, yyss);
         YYSTACK_RELOCATE (yyvs_alloc, yyvs);
+        YYSTACK_RELOCATE (yyls_alloc, yyls);
 #  undef YYSTACK_RELOCATE
         if (yyss1 != yyssa)
           YYSTACK_FREE (yyss1);
@@ -1021,6 +1374,7 @@ yysetstate:
 
       yyssp = yyss + yysize - 1;
       yyvsp = yyvs + yysize - 1;
+      yylsp = yyls + yysize - 1;
 
       YY_IGNORE_USELESS_CAST_BEGIN
       YYDPRINTF ((stderr, "Stack size increased to %ld\n",
@@ -1056,8 +1410,20 @@ yybackup:
   /* YYCHAR is either empty, or end-of-input, or a valid lookahead.  */
   if (yychar == YYEMPTY)
     {
+      if (!yyps->yynew)
+        {
+          YYDPRINTF ((stderr, "Return for a new token:\n"));
+          yyresult = YYPUSH_MORE;
+          goto yypushreturn;
+        }
+      yyps->yynew = 0;
+yyread_pushed_token:
       YYDPRINTF ((stderr, "Reading a token\n"));
-      yychar = yylex ();
+      yychar = yypushed_char;
+      if (yypushed_val)
+        yylval = *yypushed_val;
+      if (yypushed_loc)
+        yylloc = *yypushed_loc;
     }
 
   if (yychar <= YYEOF)
@@ -1074,6 +1440,7 @@ yybackup:
          loop in error recovery. */
       yychar = YYUNDEF;
       yytoken = YYSYMBOL_YYerror;
+      yyerror_range[1] = yylloc;
       goto yyerrlab1;
     }
   else
@@ -1107,6 +1474,7 @@ yybackup:
   YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
   *++yyvsp = yylval;
   YY_IGNORE_MAYBE_UNINITIALIZED_END
+  *++yylsp = yylloc;
 
   /* Discard the shifted token.  */
   yychar = YYEMPTY;
@@ -1140,225 +1508,197 @@ yyreduce:
      GCC warning that YYVAL may be used uninitialized.  */
   yyval = yyvsp[1-yylen];
 
-
+  /* Default location. */
+  YYLLOC_DEFAULT (yyloc, (yylsp - yylen), yylen);
+  yyerror_range[1] = yyloc;
   YY_REDUCE_PRINT (yyn);
   switch (yyn)
     {
   case 2: /* prog: TIPOM MAIN PARA PARC LLAA CODIGO LLAC  */
-#line 41 "calc-sintaxis.y"
+#line 156 "calc-sintaxis.y"
                                           {
-        /* Exporta el AST a DOT y genera PNG */
-        exportar_dot((yyvsp[-1].nodo), "ast_tree");
-
-        /* Genera seudo-assembly */
-        printf("\n----------------------------------------\n");
-        generar_asm((yyvsp[-1].nodo), "programa.sasm");
-        printf("Seudo-assembly escrito en 'programa.sasm'\n");
-        printf("----------------------------------------\n");
-
-        /* Evalúa directamente el nodo raíz */
-        int resultado_directo = eval_nodo((yyvsp[-1].nodo));
-        printf("Resultado (eval_nodo): %d\n", resultado_directo);
-
-        /* Interpreta el programa completo */
-        int resultado_completo = interpretar_programa((yyvsp[-1].nodo));
-
-        /* Libera memoria del AST */
-        nodo_libre((yyvsp[-1].nodo));
-
-        /* Libera tabla de símbolos */
-        ast_liberar_recursos();
-
-        /* Imprime resultado final */
-        printf("┌───────────────────────────────┐\n");
-        printf("│ Resultado del Programa        │\n");
-        printf("└───────────────────────────────┘\n");
-        printf("     %d\n", resultado_completo);
-        printf("     ✔ No hay errores\n\n");
+        *raiz = (yyvsp[-1].lista).primero;
+        (yyval.nodo) = NULL;                  /* El AST es de *raiz, no del destructor */
     }
-#line 1180 "calc-sintaxis.tab.c"
+#line 1524 "calc-sintaxis.tab.c"
     break;
 
   case 6: /* CODIGO: %empty  */
-#line 80 "calc-sintaxis.y"
-                        { (yyval.nodo) = NULL; }
-#line 1186 "calc-sintaxis.tab.c"
+#line 171 "calc-sintaxis.y"
+                        { (yyval.lista).primero = (yyval.lista).ultimo = NULL; }
+#line 1530 "calc-sintaxis.tab.c"
     break;
 
-  case 7: /* CODIGO: DECLARACION CODIGO  */
-#line 81 "calc-sintaxis.y"
-                        {
-        (yyval.nodo) = nodo_seq((yyvsp[-1].nodo), (yyvsp[0].nodo));
-    }
-#line 1194 "calc-sintaxis.tab.c"
+  case 7: /* CODIGO: CODIGO DECLARACION  */
+#line 172 "calc-sintaxis.y"
+                        { (yyval.lista) = agregar_sentencia(ctx, (yyvsp[-1].lista), (yyvsp[0].nodo)); }
+#line 1536 "calc-sintaxis.tab.c"
     break;
 
-  case 8: /* CODIGO: SENTENCIA CODIGO  */
-#line 84 "calc-sintaxis.y"
-                        {
-        (yyval.nodo) = nodo_seq((yyvsp[-1].nodo), (yyvsp[0].nodo));
-    }
-#line 1202 "calc-sintaxis.tab.c"
+  case 8: /* CODIGO: CODIGO SENTENCIA  */
+#line 173 "calc-sintaxis.y"
+                        { (yyval.lista) = agregar_sentencia(ctx, (yyvsp[-1].lista), (yyvsp[0].nodo)); }
+#line 1542 "calc-sintaxis.tab.c"
     break;
 
   case 9: /* DECLARACION: TIPO VARS PYC  */
-#line 90 "calc-sintaxis.y"
+#line 177 "calc-sintaxis.y"
                   { (yyval.nodo) = (yyvsp[-1].nodo); }
-#line 1208 "calc-sintaxis.tab.c"
+#line 1548 "calc-sintaxis.tab.c"
     break;
 
   case 10: /* VARS: VAR  */
-#line 94 "calc-sintaxis.y"
+#line 181 "calc-sintaxis.y"
                     { (yyval.nodo) = (yyvsp[0].nodo); }
-#line 1214 "calc-sintaxis.tab.c"
+#line 1554 "calc-sintaxis.tab.c"
     break;
 
   case 11: /* VARS: VAR COMA VARS  */
-#line 95 "calc-sintaxis.y"
-                    { (yyval.nodo) = nodo_seq((yyvsp[-2].nodo), (yyvsp[0].nodo)); }
-#line 1220 "calc-sintaxis.tab.c"
+#line 182 "calc-sintaxis.y"
+                    { (yyval.nodo) = nodo_seq(ctx, (yyvsp[-2].nodo), (yyvsp[0].nodo)); }
+#line 1560 "calc-sintaxis.tab.c"
     break;
 
   case 12: /* VAR: ID  */
-#line 99 "calc-sintaxis.y"
-                          { (yyval.nodo) = nodo_decl((yyvsp[0].str), NULL); free((yyvsp[0].str)); }
-#line 1226 "calc-sintaxis.tab.c"
+#line 186 "calc-sintaxis.y"
+                          { (yyval.nodo) = UBICAR(nodo_decl(ctx, LEXEMA((yyvsp[0].lex)), NULL), (yylsp[0])); SOLTAR((yyvsp[0].lex)); }
+#line 1566 "calc-sintaxis.tab.c"
     break;
 
   case 13: /* VAR: ID OP_ASIGN E  */
-#line 100 "calc-sintaxis.y"
-                         { (yyval.nodo) = nodo_decl((yyvsp[-2].str), (yyvsp[0].nodo)); free((yyvsp[-2].str)); }
-#line 1232 "calc-sintaxis.tab.c"
+#line 187 "calc-sintaxis.y"
+                         { (yyval.nodo) = UBICAR(nodo_decl(ctx, LEXEMA((yyvsp[-2].lex)), (yyvsp[0].nodo)), (yylsp[-2])); SOLTAR((yyvsp[-2].lex)); }
+#line 1572 "calc-sintaxis.tab.c"
     break;
 
   case 14: /* VAR: ID OP_ASIGN EB  */
-#line 101 "calc-sintaxis.y"
-                         { (yyval.nodo) = nodo_decl((yyvsp[-2].str), (yyvsp[0].nodo)); free((yyvsp[-2].str)); }
-#line 1238 "calc-sintaxis.tab.c"
+#line 188 "calc-sintaxis.y"
+                         { (yyval.nodo) = UBICAR(nodo_decl(ctx, LEXEMA((yyvsp[-2].lex)), (yyvsp[0].nodo)), (yylsp[-2])); SOLTAR((yyvsp[-2].lex)); }
+#line 1578 "calc-sintaxis.tab.c"
     break;
 
   case 17: /* SENTENCIA: ID OP_ASIGN E PYC  */
-#line 110 "calc-sintaxis.y"
-                          { (yyval.nodo) = nodo_assign((yyvsp[-3].str), (yyvsp[-1].nodo)); free((yyvsp[-3].str)); }
-#line 1244 "calc-sintaxis.tab.c"
+#line 197 "calc-sintaxis.y"
+                          { (yyval.nodo) = UBICAR(nodo_assign(ctx, LEXEMA((yyvsp[-3].lex)), (yyvsp[-1].nodo)), (yylsp[-3])); SOLTAR((yyvsp[-3].lex)); }
+#line 1584 "calc-sintaxis.tab.c"
     break;
 
   case 18: /* SENTENCIA: ID OP_ASIGN EB PYC  */
-#line 111 "calc-sintaxis.y"
-                          { (yyval.nodo) = nodo_assign((yyvsp[-3].str), (yyvsp[-1].nodo)); free((yyvsp[-3].str)); }
-#line 1250 "calc-sintaxis.tab.c"
+#line 198 "calc-sintaxis.y"
+                          { (yyval.nodo) = UBICAR(nodo_assign(ctx, LEXEMA((yyvsp[-3].lex)), (yyvsp[-1].nodo)), (yylsp[-3])); SOLTAR((yyvsp[-3].lex)); }
+#line 1590 "calc-sintaxis.tab.c"
     break;
 
   case 19: /* SENTENCIA: RETURN PYC  */
-#line 112 "calc-sintaxis.y"
-                          { (yyval.nodo) = nodo_return(NULL); }
-#line 1256 "calc-sintaxis.tab.c"
+#line 199 "calc-sintaxis.y"
+                          { (yyval.nodo) = UBICAR(nodo_return(ctx, NULL), (yylsp[-1])); }
+#line 1596 "calc-sintaxis.tab.c"
     break;
 
   case 20: /* SENTENCIA: RETURN E PYC  */
-#line 113 "calc-sintaxis.y"
-                          { (yyval.nodo) = nodo_return((yyvsp[-1].nodo)); }
-#line 1262 "calc-sintaxis.tab.c"
+#line 200 "calc-sintaxis.y"
+                          { (yyval.nodo) = UBICAR(nodo_return(ctx, (yyvsp[-1].nodo)), (yylsp[-2])); }
+#line 1602 "calc-sintaxis.tab.c"
     break;
 
   case 21: /* SENTENCIA: RETURN EB PYC  */
-#line 114 "calc-sintaxis.y"
-                          { (yyval.nodo) = nodo_return((yyvsp[-1].nodo)); }
-#line 1268 "calc-sintaxis.tab.c"
+#line 201 "calc-sintaxis.y"
+                          { (yyval.nodo) = UBICAR(nodo_return(ctx, (yyvsp[-1].nodo)), (yylsp[-2])); }
+#line 1608 "calc-sintaxis.tab.c"
     break;
 
   case 22: /* E: E OP_SUMA E  */
-#line 118 "calc-sintaxis.y"
-                    { (yyval.nodo) = nodo_opBin(TOP_SUMA, (yyvsp[-2].nodo), (yyvsp[0].nodo)); }
-#line 1274 "calc-sintaxis.tab.c"
+#line 206 "calc-sintaxis.y"
+                    { (yyval.nodo) = UBICAR(nodo_opBin(ctx, TOP_SUMA, (yyvsp[-2].nodo), (yyvsp[0].nodo)), (yylsp[-1])); }
+#line 1614 "calc-sintaxis.tab.c"
     break;
 
   case 23: /* E: E OP_RESTA E  */
-#line 119 "calc-sintaxis.y"
-                    { (yyval.nodo) = nodo_opBin(TOP_RESTA, (yyvsp[-2].nodo), (yyvsp[0].nodo)); }
-#line 1280 "calc-sintaxis.tab.c"
+#line 207 "calc-sintaxis.y"
+                    { (yyval.nodo) = UBICAR(nodo_opBin(ctx, TOP_RESTA, (yyvsp[-2].nodo), (yyvsp[0].nodo)), (yylsp[-1])); }
+#line 1620 "calc-sintaxis.tab.c"
     break;
 
   case 24: /* E: E OP_MULT E  */
-#line 120 "calc-sintaxis.y"
-                    { (yyval.nodo) = nodo_opBin(TOP_MULT, (yyvsp[-2].nodo), (yyvsp[0].nodo)); }
-#line 1286 "calc-sintaxis.tab.c"
+#line 208 "calc-sintaxis.y"
+                    { (yyval.nodo) = UBICAR(nodo_opBin(ctx, TOP_MULT, (yyvsp[-2].nodo), (yyvsp[0].nodo)), (yylsp[-1])); }
+#line 1626 "calc-sintaxis.tab.c"
     break;
 
   case 25: /* E: E OP_DIV E  */
-#line 121 "calc-sintaxis.y"
-                    { (yyval.nodo) = nodo_opBin(TOP_DIV, (yyvsp[-2].nodo), (yyvsp[0].nodo)); }
-#line 1292 "calc-sintaxis.tab.c"
+#line 209 "calc-sintaxis.y"
+                    { (yyval.nodo) = UBICAR(nodo_opBin(ctx, TOP_DIV, (yyvsp[-2].nodo), (yyvsp[0].nodo)), (yylsp[-1])); }
+#line 1632 "calc-sintaxis.tab.c"
     break;
 
   case 26: /* E: PARA E PARC  */
-#line 122 "calc-sintaxis.y"
+#line 210 "calc-sintaxis.y"
                     { (yyval.nodo) = (yyvsp[-1].nodo); }
-#line 1298 "calc-sintaxis.tab.c"
+#line 1638 "calc-sintaxis.tab.c"
     break;
 
   case 27: /* E: ID  */
-#line 123 "calc-sintaxis.y"
-                    { (yyval.nodo) = nodo_ID((yyvsp[0].str)); free((yyvsp[0].str)); }
-#line 1304 "calc-sintaxis.tab.c"
+#line 211 "calc-sintaxis.y"
+                    { (yyval.nodo) = UBICAR(nodo_ID(ctx, LEXEMA((yyvsp[0].lex))), (yylsp[0])); SOLTAR((yyvsp[0].lex)); }
+#line 1644 "calc-sintaxis.tab.c"
     break;
 
   case 28: /* E: NUMERO  */
-#line 124 "calc-sintaxis.y"
-                    { (yyval.nodo) = nodo_int((yyvsp[0].num)); }
-#line 1310 "calc-sintaxis.tab.c"
+#line 212 "calc-sintaxis.y"
+                    { (yyval.nodo) = UBICAR(nodo_int(ctx, (yyvsp[0].num)), (yylsp[0])); }
+#line 1650 "calc-sintaxis.tab.c"
     break;
 
   case 29: /* EB: EB OP_OR EB  */
-#line 128 "calc-sintaxis.y"
-                    { (yyval.nodo) = nodo_opBin(TOP_OR, (yyvsp[-2].nodo), (yyvsp[0].nodo)); }
-#line 1316 "calc-sintaxis.tab.c"
+#line 216 "calc-sintaxis.y"
+                    { (yyval.nodo) = UBICAR(nodo_opBin(ctx, TOP_OR, (yyvsp[-2].nodo), (yyvsp[0].nodo)), (yylsp[-1])); }
+#line 1656 "calc-sintaxis.tab.c"
     break;
 
   case 30: /* EB: EB OP_AND EB  */
-#line 129 "calc-sintaxis.y"
-                    { (yyval.nodo) = nodo_opBin(TOP_AND, (yyvsp[-2].nodo), (yyvsp[0].nodo)); }
-#line 1322 "calc-sintaxis.tab.c"
+#line 217 "calc-sintaxis.y"
+                    { (yyval.nodo) = UBICAR(nodo_opBin(ctx, TOP_AND, (yyvsp[-2].nodo), (yyvsp[0].nodo)), (yylsp[-1])); }
+#line 1662 "calc-sintaxis.tab.c"
     break;
 
   case 31: /* EB: E OP_IGUAL E  */
-#line 130 "calc-sintaxis.y"
-                    { (yyval.nodo) = nodo_opBin(TOP_IGUAL, (yyvsp[-2].nodo), (yyvsp[0].nodo)); }
-#line 1328 "calc-sintaxis.tab.c"
+#line 218 "calc-sintaxis.y"
+                    { (yyval.nodo) = UBICAR(nodo_opBin(ctx, TOP_IGUAL, (yyvsp[-2].nodo), (yyvsp[0].nodo)), (yylsp[-1])); }
+#line 1668 "calc-sintaxis.tab.c"
     break;
 
   case 32: /* EB: E OP_MAYOR E  */
-#line 131 "calc-sintaxis.y"
-                    { (yyval.nodo) = nodo_opBin(TOP_MAYOR, (yyvsp[-2].nodo), (yyvsp[0].nodo)); }
-#line 1334 "calc-sintaxis.tab.c"
+#line 219 "calc-sintaxis.y"
+                    { (yyval.nodo) = UBICAR(nodo_opBin(ctx, TOP_MAYOR, (yyvsp[-2].nodo), (yyvsp[0].nodo)), (yylsp[-1])); }
+#line 1674 "calc-sintaxis.tab.c"
     break;
 
   case 33: /* EB: E OP_MENOR E  */
-#line 132 "calc-sintaxis.y"
-                    { (yyval.nodo) = nodo_opBin(TOP_MENOR, (yyvsp[-2].nodo), (yyvsp[0].nodo)); }
-#line 1340 "calc-sintaxis.tab.c"
+#line 220 "calc-sintaxis.y"
+                    { (yyval.nodo) = UBICAR(nodo_opBin(ctx, TOP_MENOR, (yyvsp[-2].nodo), (yyvsp[0].nodo)), (yylsp[-1])); }
+#line 1680 "calc-sintaxis.tab.c"
     break;
 
   case 34: /* EB: PARA EB PARC  */
-#line 133 "calc-sintaxis.y"
+#line 221 "calc-sintaxis.y"
                     { (yyval.nodo) = (yyvsp[-1].nodo); }
-#line 1346 "calc-sintaxis.tab.c"
+#line 1686 "calc-sintaxis.tab.c"
     break;
 
   case 35: /* EB: TRUE  */
-#line 134 "calc-sintaxis.y"
-                    { (yyval.nodo) = nodo_bool(1); }
-#line 1352 "calc-sintaxis.tab.c"
+#line 222 "calc-sintaxis.y"
+                    { (yyval.nodo) = UBICAR(nodo_bool(ctx, 1), (yylsp[0])); }
+#line 1692 "calc-sintaxis.tab.c"
     break;
 
   case 36: /* EB: FALSE  */
-#line 135 "calc-sintaxis.y"
-                    { (yyval.nodo) = nodo_bool(0); }
-#line 1358 "calc-sintaxis.tab.c"
+#line 223 "calc-sintaxis.y"
+                    { (yyval.nodo) = UBICAR(nodo_bool(ctx, 0), (yylsp[0])); }
+#line 1698 "calc-sintaxis.tab.c"
     break;
 
 
-#line 1362 "calc-sintaxis.tab.c"
+#line 1702 "calc-sintaxis.tab.c"
 
       default: break;
     }
@@ -1379,6 +1719,7 @@ yyreduce:
   yylen = 0;
 
   *++yyvsp = yyval;
+  *++yylsp = yyloc;
 
   /* Now 'shift' the result of the reduction.  Determine what state
      that goes to, based on the state we popped back to and the rule
@@ -1405,9 +1746,10 @@ yyerrlab:
   if (!yyerrstatus)
     {
       ++yynerrs;
-      yyerror (YY_("syntax error"));
+      yyerror (&yylloc, ctx, raiz, YY_("syntax error"));
     }
 
+  yyerror_range[1] = yylloc;
   if (yyerrstatus == 3)
     {
       /* If just tried and failed to reuse lookahead token after an
@@ -1422,7 +1764,7 @@ yyerrlab:
       else
         {
           yydestruct ("Error: discarding",
-                      yytoken, &yylval);
+                      yytoken, &yylval, &yylloc, ctx, raiz);
           yychar = YYEMPTY;
         }
     }
@@ -1476,9 +1818,9 @@ yyerrlab1:
       if (yyssp == yyss)
         YYABORT;
 
-
+      yyerror_range[1] = *yylsp;
       yydestruct ("Error: popping",
-                  YY_ACCESSING_SYMBOL (yystate), yyvsp);
+                  YY_ACCESSING_SYMBOL (yystate), yyvsp, yylsp, ctx, raiz);
       YYPOPSTACK (1);
       yystate = *yyssp;
       YY_STACK_PRINT (yyss, yyssp);
@@ -1488,6 +1830,9 @@ yyerrlab1:
   *++yyvsp = yylval;
   YY_IGNORE_MAYBE_UNINITIALIZED_END
 
+  yyerror_range[2] = yylloc;
+  ++yylsp;
+  YYLLOC_DEFAULT (*yylsp, yyerror_range, 2);
 
   /* Shift the error token.  */
   YY_SYMBOL_PRINT ("Shifting", YY_ACCESSING_SYMBOL (yyn), yyvsp, yylsp);
@@ -1516,7 +1861,7 @@ yyabortlab:
 | yyexhaustedlab -- YYNOMEM (memory exhaustion) comes here.  |
 `-----------------------------------------------------------*/
 yyexhaustedlab:
-  yyerror (YY_("memory exhausted"));
+  yyerror (&yylloc, ctx, raiz, YY_("memory exhausted"));
   yyresult = 2;
   goto yyreturnlab;
 
@@ -1531,7 +1876,7 @@ yyreturnlab:
          user semantic actions for why this is necessary.  */
       yytoken = YYTRANSLATE (yychar);
       yydestruct ("Cleanup: discarding lookahead",
-                  yytoken, &yylval);
+                  yytoken, &yylval, &yylloc, ctx, raiz);
     }
   /* Do not reclaim the symbols of the rule whose action triggered
      this YYABORT or YYACCEPT.  */
@@ -1540,27 +1885,399 @@ yyreturnlab:
   while (yyssp != yyss)
     {
       yydestruct ("Cleanup: popping",
-                  YY_ACCESSING_SYMBOL (+*yyssp), yyvsp);
+                  YY_ACCESSING_SYMBOL (+*yyssp), yyvsp, yylsp, ctx, raiz);
       YYPOPSTACK (1);
     }
-#ifndef yyoverflow
-  if (yyss != yyssa)
-    YYSTACK_FREE (yyss);
-#endif
+  yyps->yynew = 2;
+  goto yypushreturn;
+
+
+/*-------------------------.
+| yypushreturn -- return.  |
+`-------------------------*/
+yypushreturn:
 
   return yyresult;
 }
+#undef yynerrs
+#undef yystate
+#undef yyerrstatus
+#undef yyssa
+#undef yyss
+#undef yyssp
+#undef yyvsa
+#undef yyvs
+#undef yyvsp
+#undef yylsa
+#undef yyls
+#undef yylsp
+#undef yystacksize
+#line 226 "calc-sintaxis.y"
+
+
+/**
+ * Deja listo el lexer elegido al principio de ctx->fuente: el de flex lo
+ * recorre en el lugar con yy_scan_buffer (necesita los dos NUL finales) y el
+ * escrito a mano avanza ctx->cursor hasta ctx->largo_fuente.
+ * @param ctx Contexto con el fuente ya cargado.
+ * @return 0, o -1 si flex no pudo reservar su estado (con ctx->error).
+ */
+int contexto_preparar_lexico(CompilerContext *ctx) {
+    ctx->cursor = 0;
+    ctx->linea = 1;
+    ctx->linea_ubicado = 0;
+    if (ctx->lexer != LEXER_FLEX) return 0;
+
+    yyscan_t scanner;
+    if (yylex_init_extra(ctx, &scanner) != 0) {
+        contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para el lexer");
+        return -1;
+    }
+    if (!yy_scan_buffer(ctx->fuente, ctx->largo_fuente + 2, scanner)) {
+        yylex_destroy(scanner);
+        contexto_error(ctx, ERROR_MEMORIA, 0, 0, "yy_scan_buffer rechazó la entrada");
+        return -1;
+    }
+    yyset_lineno(1, scanner);         /* yy_scan_buffer no inicializa la línea */
+    ctx->scanner = scanner;
+    return 0;
+}
 
-#line 138 "calc-sintaxis.y"
+/**
+ * Carga la entrada en ctx->fuente, si no se cargó antes, y prepara el lexer
+ * elegido (ctx->lexer).
+ * @param ctx Contexto de compilación.
+ * @param entrada Archivo con el código fuente.
+ * @return 0, o -1 si no hubo memoria (con ctx->error).
+ */
+int contexto_iniciar_lexico(CompilerContext *ctx, FILE *entrada) {
+    if (!ctx->fuente && contexto_cargar_fuente(ctx, entrada) != 0) return -1;
+    return contexto_preparar_lexico(ctx);
+}
 
+/**
+ * Libera el lexer de flex y el texto fuente.
+ * @param ctx Contexto de compilación.
+ */
+void contexto_terminar_lexico(CompilerContext *ctx) {
+    if (ctx->scanner) yylex_destroy(ctx->scanner);
+    ctx->scanner = NULL;
+    contexto_liberar_fuente(ctx);     /* El AST tiene sus propias copias de los nombres */
+}
 
-int main(int argc, char *argv[]) {
-    extern FILE *yyin;
-    ++argv, --argc;
+/**
+ * Devuelve la línea por la que va el análisis (para yyerror). Si el parser
+ * lee de un arreglo de tokens, es la línea del último token leído, contando
+ * los saltos del fuente hasta su desplazamiento; si no, la del lexer en uso.
+ * @param ctx Contexto de compilación.
+ * @return Número de línea, empezando en 1.
+ */
+int contexto_linea(const CompilerContext *ctx) {
+    if (ctx->tokens) {
+        size_t i = ctx->token_actual ? ctx->token_actual - 1 : 0;
+        const char *p = ctx->fuente;
+        const char *fin = p + ctx->tokens->desplazamiento[i];
+        int linea = 1;
+        while ((p = memchr(p, '\n', fin - p)) != NULL) {
+            linea++;
+            p++;
+        }
+        return linea;
+    }
+    return ctx->lexer == LEXER_SIMD ? ctx->linea : yyget_lineno(ctx->scanner);
+}
 
-    if (argc > 0) yyin = fopen(argv[0], "r");
-    else yyin = stdin;
+/**
+ * Devuelve la columna del token por el que va el análisis, contando desde 1.
+ * Con el lexer de flex (sin arreglo de tokens) no se conoce.
+ * @param ctx Contexto de compilación.
+ * @return Columna, o 0 si no se sabe.
+ */
+int contexto_columna(const CompilerContext *ctx) {
+    size_t inicio;
+    if (ctx->tokens) {
+        size_t i = ctx->token_actual ? ctx->token_actual - 1 : 0;
+        inicio = ctx->tokens->desplazamiento[i];
+    } else if (ctx->lexer == LEXER_SIMD) {
+        /* El análisis incremental ya ubicó el token y puede haber descartado
+           el principio de su línea */
+        if (ctx->linea_ubicado && ctx->ubicado == ctx->inicio_token) return ctx->columna_ubicado;
+        inicio = ctx->inicio_token;
+    } else {
+        return 0;
+    }
+    size_t p = inicio;
+    while (p > 0 && ctx->fuente[p - 1] != '\n') p--;
+    return (int)(inicio - p) + 1;
+}
 
-    yyparse();
+/**
+ * Devuelve la línea y la columna de una posición del fuente. Avanza desde la
+ * última posición pedida contando saltos de línea; sólo si se pide una
+ * anterior vuelve a contar desde el principio. Como no vuelve a mirar el texto
+ * anterior a la última posición, el análisis incremental puede descartarlo.
+ * @param ctx Contexto con el fuente cargado.
+ * @param desplazamiento Posición en ctx->fuente.
+ * @param linea Devuelve la línea, desde 1.
+ * @param columna Devuelve la columna en bytes, desde 1.
+ */
+void contexto_ubicar(CompilerContext *ctx, size_t desplazamiento, int *linea, int *columna) {
+    size_t p = ctx->ubicado;
+    int l = ctx->linea_ubicado, c = ctx->columna_ubicado;
+    if (l == 0 || desplazamiento < p) {
+        p = 0;
+        l = c = 1;
+    }
+    const char *q = ctx->fuente + p;
+    const char *fin = ctx->fuente + desplazamiento;
+    const char *salto;
+    while (q < fin && (salto = memchr(q, '\n', fin - q)) != NULL) {
+        l++;
+        c = 1;
+        q = salto + 1;
+    }
+    c += (int)(fin - q);
+    ctx->ubicado = desplazamiento;
+    ctx->linea_ubicado = l;
+    ctx->columna_ubicado = c;
+    *linea = l;
+    *columna = c;
+}
+
+/**
+ * Analiza un arreglo de tokens ya armado. El fuente del que salió tiene que
+ * seguir en ctx->fuente, porque los ID son porciones de ese texto.
+ * @param ctx Contexto de compilación.
+ * @param tokens Arreglo terminado en el token de fin.
+ * @param raiz Devuelve la raíz del AST (NULL si el programa está vacío).
+ * @return 0 si el análisis fue correcto, distinto de 0 si hubo errores.
+ */
+int contexto_parsear_tokens(CompilerContext *ctx, const Tokens *tokens, Nodo **raiz) {
+    ctx->tokens = tokens;
+    ctx->token_actual = 0;
+    *raiz = NULL;
+    int error = yyparse(ctx, raiz);
+    ctx->tokens = NULL;
+    if (contexto_fallo(ctx)) {
+        nodo_libre(ctx, *raiz);         /* Se aceptó, pero falló la construcción de algo */
+        *raiz = NULL;
+        error = 1;
+    }
+    return error;
+}
+
+/**
+ * Analiza un programa completo con un lexer propio del contexto. La entrada
+ * se carga entera (mapeada si es un archivo), se tokeniza completa a un
+ * arreglo y el parser elegido (ctx->parser) lee de ese arreglo.
+ * @param ctx Contexto de compilación.
+ * @param entrada Archivo con el código fuente.
+ * @param raiz Devuelve la raíz del AST (NULL si el programa está vacío).
+ * @return 0 si el análisis fue correcto, distinto de 0 si hubo errores.
+ */
+int contexto_parsear(CompilerContext *ctx, FILE *entrada, Nodo **raiz) {
+    Tokens tokens;
+    tokens_iniciar(&tokens);
+    *raiz = NULL;
+    if (contexto_iniciar_lexico(ctx, entrada) != 0) {
+        contexto_liberar_fuente(ctx);
+        return 1;
+    }
+    int error = ctx->lexear ? ctx->lexear(ctx, &tokens) : tokens_lexear(ctx, &tokens);
+    if (!error) error = ctx->parser == PARSER_MANO ? analizador_parsear(ctx, &tokens, raiz)
+                                                   : contexto_parsear_tokens(ctx, &tokens, raiz);
+    contexto_terminar_lexico(ctx);
+    tokens_liberar(&tokens);
+    return error;
+}
+
+/* ------------------ Análisis incremental ------------------ */
+
+/* Estado del análisis de un fuente que llega por partes */
+struct Incremental {
+    CompilerContext *ctx;
+    yypstate *ps;                   /* Parser push de Bison */
+    size_t cap;                     /* Capacidad de ctx->fuente */
+    int estado;                     /* YYPUSH_MORE, 0 (aceptado) o error */
+    int cerrado;                    /* Ya se redujo el '}' de main */
+    Nodo *raiz;
+};
+
+/**
+ * Crea un análisis incremental sobre el contexto. En ctx->fuente queda sólo
+ * lo recibido que el lexer todavía no consumió: cada parte nueva descarta lo
+ * ya analizado, y los ID que pasan al parser llevan su propia copia del
+ * nombre. El lexer es siempre el escrito a mano, que puede detenerse en
+ * cualquier byte y retomar.
+ * @param ctx Contexto de compilación.
+ * @return Estado del análisis, o NULL si no hubo memoria (con ctx->error).
+ */
+Incremental *incremental_crear(CompilerContext *ctx) {
+    contexto_liberar_fuente(ctx);
+    Incremental *inc = calloc(1, sizeof(Incremental));
+    if (inc) inc->ps = yypstate_new();
+    if (inc && inc->ps) ctx->fuente = malloc(INCREMENTAL_INICIAL);
+    if (!inc || !inc->ps || !ctx->fuente) {
+        if (inc && inc->ps) yypstate_delete(inc->ps);
+        free(inc);
+        contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para el análisis incremental");
+        return NULL;
+    }
+    inc->ctx = ctx;
+    inc->estado = YYPUSH_MORE;
+    inc->cap = INCREMENTAL_INICIAL;
+
+    ctx->fuente[0] = ctx->fuente[1] = '\0';
+    ctx->largo_fuente = 0;
+    ctx->lexer = LEXER_SIMD;
+    ctx->cursor = 0;
+    ctx->linea = 1;
+    ctx->linea_ubicado = 0;
+    return inc;
+}
+
+/**
+ * Copia el nombre de un ID, que tiene que sobrevivir en la pila del parser
+ * a que se descarte la parte del fuente de la que salió.
+ * @param ctx Contexto de compilación.
+ * @param lex Lexema a copiar (queda apuntando a la copia).
+ * @return 0, o -1 si no hubo memoria (con ctx->error).
+ */
+static int copiar_lexema(CompilerContext *ctx, Lexema *lex) {
+    char *copia = malloc(lex->largo ? lex->largo : 1);
+    if (!copia) {
+        contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para el análisis incremental");
+        return -1;
+    }
+    memcpy(copia, lex->texto, lex->largo);
+    lex->texto = copia;
+    lex->propio = 1;
     return 0;
 }
+
+/**
+ * Indica si un token que termina justo al final de lo recibido podría seguir
+ * en la próxima parte: un identificador, una palabra reservada, un número o
+ * '=' antes de '='.
+ * @param token Token leído.
+ * @return 1 si hay que esperar más texto para estar seguro.
+ */
+static int puede_seguir(int token) {
+    switch (token) {
+        case ID: case NUMERO: case OP_ASIGN:
+        case INT: case BOOL: case VOID: case TRUE: case FALSE: case RETURN: case MAIN:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Tokeniza lo que haya completo en el buffer y se lo pasa al parser. Un token
+ * que podría seguir en la próxima parte se deja para después, salvo que sea
+ * el final de la entrada.
+ *
+ * El '}' sólo cierra main: apenas se lo pasa al parser, le sigue el fin de
+ * la entrada, sin leer nada más del buffer. Así el programa se acepta en la
+ * misma parte en que llega el '}', y lo que venga después se ignora siempre,
+ * sin importar cómo se haya partido la entrada.
+ * @param inc Estado del análisis.
+ * @param final 1 si ya no va a llegar más texto.
+ */
+static void incremental_avanzar(Incremental *inc, int final) {
+    CompilerContext *ctx = inc->ctx;
+    double t0 = stats_reloj();
+    while (inc->estado == YYPUSH_MORE) {
+        size_t cursor = ctx->cursor;
+        int linea = ctx->linea;
+        YYSTYPE lval;
+        YYLTYPE lloc;
+        int token = contexto_fallo(ctx) || inc->cerrado ? 0 : lexico_simd(&lval, ctx);
+        if (!final && !inc->cerrado && !contexto_fallo(ctx) &&
+            (token == 0 || (ctx->cursor == ctx->largo_fuente && puede_seguir(token)))) {
+            ctx->cursor = cursor;               /* Esperar más texto */
+            ctx->linea = linea;
+            break;
+        }
+        if (token == ID && copiar_lexema(ctx, &lval.lex) != 0) continue;   /* Corta */
+        ctx->stats.tokens++;
+        ubicar_token(ctx, token ? ctx->inicio_token : inc->cerrado ? ctx->cursor : ctx->largo_fuente, &lloc);
+        inc->estado = yypush_parse(inc->ps, token, &lval, &lloc, ctx, &inc->raiz);
+        if (token == 0) break;
+        if (token == LLAC) inc->cerrado = 1;
+    }
+    ctx->stats.tiempo[FASE_LEXICO] += stats_reloj() - t0;
+}
+
+/**
+ * Descarta del buffer lo que el lexer ya consumió; queda sólo el token que se
+ * dejó para la próxima parte. La ubicación avanza antes hasta el corte, para
+ * que las líneas y columnas sigan contando desde el principio del fuente.
+ * @param ctx Contexto de compilación.
+ */
+static void incremental_descartar(CompilerContext *ctx) {
+    size_t consumido = ctx->cursor;
+    if (consumido == 0) return;
+    int linea, columna;
+    contexto_ubicar(ctx, consumido, &linea, &columna);
+    ctx->largo_fuente -= consumido;
+    memmove(ctx->fuente, ctx->fuente + consumido, ctx->largo_fuente + 2);
+    ctx->cursor = 0;
+    ctx->ubicado = 0;
+}
+
+/**
+ * Agrega una parte del fuente y analiza todo lo que ya se pueda.
+ * @param inc Estado del análisis.
+ * @param datos Texto recibido.
+ * @param largo Largo del texto.
+ * @return 0 si el análisis sigue; distinto de 0 si ya terminó, porque se
+ *         aceptó el programa o hubo un error (lo dice incremental_terminar).
+ */
+int incremental_alimentar(Incremental *inc, const char *datos, size_t largo) {
+    CompilerContext *ctx = inc->ctx;
+    if (inc->estado != YYPUSH_MORE) return 1;
+
+    incremental_descartar(ctx);
+    if (ctx->largo_fuente + largo + 2 > inc->cap) {
+        size_t cap = inc->cap;
+        while (ctx->largo_fuente + largo + 2 > cap) cap *= 2;
+        char *fuente = realloc(ctx->fuente, cap);
+        if (!fuente) {
+            contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para el análisis incremental");
+            incremental_avanzar(inc, 1);            /* Corta y libera la pila del parser */
+            return 1;
+        }
+        ctx->fuente = fuente;
+        inc->cap = cap;
+    }
+    memcpy(ctx->fuente + ctx->largo_fuente, datos, largo);
+    ctx->largo_fuente += largo;
+    ctx->fuente[ctx->largo_fuente] = ctx->fuente[ctx->largo_fuente + 1] = '\0';
+
+    incremental_avanzar(inc, 0);
+    return inc->estado != YYPUSH_MORE;
+}
+
+/**
+ * Indica el fin de la entrada, termina el análisis y libera su estado. Si el
+ * programa ya se aceptó, lo que haya llegado después no se analiza.
+ * @param inc Estado del análisis.
+ * @param raiz Devuelve la raíz del AST (NULL si está vacío o hubo un error).
+ * @return 0 si el análisis fue correcto, distinto de 0 si hubo errores.
+ */
+int incremental_terminar(Incremental *inc, Nodo **raiz) {
+    CompilerContext *ctx = inc->ctx;
+    incremental_avanzar(inc, 1);
+    int error = inc->estado;
+    if (!error && contexto_fallo(ctx)) {
+        nodo_libre(ctx, inc->raiz);
+        error = 1;
+    }
+    *raiz = error ? NULL : inc->raiz;
+
+    yypstate_delete(inc->ps);
+    free(inc);
+    contexto_liberar_fuente(ctx);     /* El AST tiene sus propias copias de los nombres */
+    return error;
+}
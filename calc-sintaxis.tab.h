@@ -49,7 +49,28 @@ extern int yydebug;
 
     #include "ast.h"
 
-#line 53 "calc-sintaxis.tab.h"
+    /* Tipo opaco del lexer reentrante (lo define también lex.yy.c) */
+    #ifndef YY_TYPEDEF_YY_SCANNER_T
+    #define YY_TYPEDEF_YY_SCANNER_T
+    typedef void *yyscan_t;
+    #endif
+
+    /* Identificador: porción del fuente (ctx->fuente), sin copiar. El análisis
+       incremental descarta el fuente ya leído, así que le da a cada ID que
+       pasa al parser una copia propia, que se libera al reducirlo */
+    typedef struct {
+        const char *texto;
+        uint32_t largo;
+        uint32_t propio;            /* 1 = copia en memoria dinámica */
+    } Lexema;
+
+    /* Lista de sentencias en construcción: CODIGO agrega al final */
+    typedef struct {
+        Nodo *primero;
+        Nodo *ultimo;               /* Último NODO_SEQ de la lista */
+    } ListaNodos;
+
+#line 74 "calc-sintaxis.tab.h"
 
 /* Token kinds.  */
 #ifndef YYTOKENTYPE
@@ -95,13 +116,14 @@ extern int yydebug;
 #if ! defined YYSTYPE && ! defined YYSTYPE_IS_DECLARED
 union YYSTYPE
 {
-#line 16 "calc-sintaxis.y"
+#line 50 "calc-sintaxis.y"
 
     Nodo *nodo;
-    char *str;
+    Lexema lex;
+    ListaNodos lista;
     int num;
 
-#line 105 "calc-sintaxis.tab.h"
+#line 127 "calc-sintaxis.tab.h"
 
 };
 typedef union YYSTYPE YYSTYPE;
@@ -109,11 +131,37 @@ typedef union YYSTYPE YYSTYPE;
 # define YYSTYPE_IS_DECLARED 1
 #endif
 
+/* Location type.  */
+#if ! defined YYLTYPE && ! defined YYLTYPE_IS_DECLARED
+typedef struct YYLTYPE YYLTYPE;
+struct YYLTYPE
+{
+  int first_line;
+  int first_column;
+  int last_line;
+  int last_column;
+};
+# define YYLTYPE_IS_DECLARED 1
+# define YYLTYPE_IS_TRIVIAL 1
+#endif
+
+
+
+
+#ifndef YYPUSH_MORE_DEFINED
+# define YYPUSH_MORE_DEFINED
+enum { YYPUSH_MORE = 4 };
+#endif
 
-extern YYSTYPE yylval;
+typedef struct yypstate yypstate;
 
 
-int yyparse (void);
+int yyparse (CompilerContext *ctx, Nodo **raiz);
+int yypush_parse (yypstate *ps,
+                  int pushed_char, YYSTYPE const *pushed_val, YYLTYPE *pushed_loc, CompilerContext *ctx, Nodo **raiz);
+int yypull_parse (yypstate *ps, CompilerContext *ctx, Nodo **raiz);
+yypstate *yypstate_new (void);
+void yypstate_delete (yypstate *ps);
 
 
 #endif /* !YY_YY_CALC_SINTAXIS_TAB_H_INCLUDED  */
@@ -1,33 +1,148 @@
 /* Importamos las definiciones de las funciones y estructuras */
 %code requires {
     #include "ast.h"
+
+    /* Tipo opaco del lexer reentrante (lo define también lex.yy.c) */
+    #ifndef YY_TYPEDEF_YY_SCANNER_T
+    #define YY_TYPEDEF_YY_SCANNER_T
+    typedef void *yyscan_t;
+    #endif
+
+    /* Identificador: porción del fuente (ctx->fuente), sin copiar. El análisis
+       incremental descarta el fuente ya leído, así que le da a cada ID que
+       pasa al parser una copia propia, que se libera al reducirlo */
+    typedef struct {
+        const char *texto;
+        uint32_t largo;
+        uint32_t propio;            /* 1 = copia en memoria dinámica */
+    } Lexema;
+
+    /* Lista de sentencias en construcción: CODIGO agrega al final */
+    typedef struct {
+        Nodo *primero;
+        Nodo *ultimo;               /* Último NODO_SEQ de la lista */
+    } ListaNodos;
 }
 
 /* Incluimos bibliotecas de C y declaramos funciones*/
 %{
 #include <stdio.h>
 #include <stdlib.h>
-
-extern int yylex(void);
-extern void yyerror(const char *s);
+#include <string.h>
+#include "ast.h"
+#include "contexto.h"
 %}
 
+/* Parser puro: todo su estado está en la pila de yyparse y en el contexto */
+%define api.pure full
+
+/* Además de yyparse, genera yypush_parse para recibir los tokens de a uno */
+%define api.push-pull both
+
+/* Cada token trae su línea y columna; las acciones se las anotan a los nodos */
+%locations
+
+/* El parser sólo construye el AST y lo devuelve al driver (calc.c) */
+%lex-param { CompilerContext *ctx }
+%parse-param { CompilerContext *ctx } { Nodo **raiz }
+
 /* Definición de la union */
 %union {
     Nodo *nodo;
-    char *str;
+    Lexema lex;
+    ListaNodos lista;
     int num;
 }
 
+/* El parser lee los tokens del arreglo que arma tokens_lexear */
+%code {
+#include "tokens.h"
+#include "analizador.h"
+#include "lexico.h"
+
+/* Tamaño inicial del buffer del análisis incremental */
+#define INCREMENTAL_INICIAL 65536
+
+/* Interfaz del lexer reentrante (calc-lexico.l, con bison-bridge) */
+int yylex_init_extra(CompilerContext *extra, yyscan_t *scanner);
+int yylex_destroy(yyscan_t yyscanner);
+struct yy_buffer_state *yy_scan_buffer(char *base, size_t size, yyscan_t yyscanner);
+void yyset_lineno(int linea, yyscan_t yyscanner);
+int yyget_lineno(yyscan_t yyscanner);
+void yyerror(CompilerContext *ctx, Nodo **raiz, const char *s);
+
+/* Con %locations Bison le pasa también la ubicación del error; yyerror ya
+   la calcula (contexto_linea y contexto_columna), así que no se usa */
+#define yyerror(lloc, ctx, raiz, s) ((void)(lloc), yyerror(ctx, raiz, s))
+
+/**
+ * Completa la ubicación de un token a partir de su desplazamiento en el fuente.
+ * @param ctx Contexto de compilación.
+ * @param desplazamiento Inicio del token en ctx->fuente.
+ * @param lloc Ubicación a completar.
+ */
+static void ubicar_token(CompilerContext *ctx, size_t desplazamiento, YYLTYPE *lloc) {
+    contexto_ubicar(ctx, desplazamiento, &lloc->first_line, &lloc->first_column);
+    lloc->last_line = lloc->first_line;
+    lloc->last_column = lloc->first_column;
+}
+
+static int yylex_tokens(YYSTYPE *lval, YYLTYPE *lloc, CompilerContext *ctx) {
+    const Tokens *t = ctx->tokens;
+    if (contexto_fallo(ctx)) return 0;     /* Cortar: lo apilado se destruye */
+    size_t i = ctx->token_actual < t->n ? ctx->token_actual++ : t->n - 1;
+    ubicar_token(ctx, t->desplazamiento[i], lloc);
+    return tokens_leer(t, ctx->fuente, i, lval);
+}
+#define yylex yylex_tokens
+
+/* Anota en un nodo recién construido la posición de un símbolo de la regla */
+#define UBICAR(nodo, l) nodo_ubicar((nodo), (l).first_line, (l).first_column)
+
+/* Texto y largo de un identificador, para los constructores del AST */
+#define LEXEMA(l) (l).texto, (l).largo
+
+/* Libera la copia de un identificador, si tiene (el constructor ya copió el nombre) */
+#define SOLTAR(l) do { if ((l).propio) free((char *)(l).texto); } while (0)
+
+/**
+ * Agrega una declaración o sentencia de nivel superior al final de CODIGO, o
+ * se la entrega al sumidero del contexto si hay uno (--stream).
+ * @param ctx Contexto de compilación.
+ * @param lista Lista armada hasta ahora.
+ * @param sentencia Sentencia recién reducida.
+ * @return La lista con la sentencia agregada.
+ */
+static ListaNodos agregar_sentencia(CompilerContext *ctx, ListaNodos lista, Nodo *sentencia) {
+    if (!sentencia) return lista;                       /* Falló su construcción */
+    if (ctx->sumidero) {
+        ctx->sumidero(ctx, sentencia, ctx->arg_sumidero);
+        return lista;
+    }
+    Nodo *seq = nodo_seq(ctx, sentencia, NULL);
+    if (!seq) return lista;                             /* nodo_seq ya liberó la sentencia */
+    if (lista.ultimo) lista.ultimo->opBinaria.der = seq;
+    else lista.primero = seq;
+    lista.ultimo = seq;
+    return lista;
+}
+}
+
 /* Definición de los tokens */
-%token <str> ID
+%token <lex> ID
 %token <num> NUMERO
 %token INT BOOL VOID TRUE FALSE RETURN MAIN
 %token PARA PARC LLAA LLAC CORA CORC PYC COMA
 %token OP_RESTA OP_SUMA OP_MAYOR OP_MENOR OP_AND OP_OR OP_DIV OP_MULT OP_IGUAL OP_ASIGN
 
 /* Asociamos los tipos de los nodos con las producciones */
-%type <nodo> prog CODIGO SENTENCIA E EB DECLARACION VAR VARS
+%type <lista> CODIGO
+%type <nodo> prog SENTENCIA E EB DECLARACION VAR VARS
+
+/* Ante un error, Bison descarta la pila: lo ya construido se libera ahí */
+%destructor { nodo_libre(ctx, $$); } <nodo>
+%destructor { nodo_libre(ctx, $$.primero); } <lista>
+%destructor { SOLTAR($$); } <lex>
 
 /* Definimos precedencia de operadores */
 %left OP_OR
@@ -39,34 +154,8 @@ extern void yyerror(const char *s);
 %%
 prog:
     TIPOM MAIN PARA PARC LLAA CODIGO LLAC {
-        /* Exporta el AST a DOT y genera PNG */
-        exportar_dot($6, "ast_tree");
-
-        /* Genera seudo-assembly */
-        printf("\n----------------------------------------\n");
-        generar_asm($6, "programa.sasm");
-        printf("Seudo-assembly escrito en 'programa.sasm'\n");
-        printf("----------------------------------------\n");
-
-        /* Evalúa directamente el nodo raíz */
-        int resultado_directo = eval_nodo($6);
-        printf("Resultado (eval_nodo): %d\n", resultado_directo);
-
-        /* Interpreta el programa completo */
-        int resultado_completo = interpretar_programa($6);
-
-        /* Libera memoria del AST */
-        nodo_libre($6);
-
-        /* Libera tabla de símbolos */
-        ast_liberar_recursos();
-
-        /* Imprime resultado final */
-        printf("┌───────────────────────────────┐\n");
-        printf("│ Resultado del Programa        │\n");
-        printf("└───────────────────────────────┘\n");
-        printf("     %d\n", resultado_completo);
-        printf("     ✔ No hay errores\n\n");
+        *raiz = $6.primero;
+        $$ = NULL;                  /* El AST es de *raiz, no del destructor */
     }
 ;
 
@@ -76,14 +165,12 @@ TIPOM:
   | VOID
 ;
 
+/* Recursiva a izquierda: cada sentencia se reduce apenas termina y la pila
+   del parser no crece con la cantidad de sentencias */
 CODIGO:
-    %empty              { $$ = NULL; }
-  | DECLARACION CODIGO  {
-        $$ = nodo_seq($1, $2);
-    }
-  | SENTENCIA CODIGO    {
-        $$ = nodo_seq($1, $2);
-    }
+    %empty              { $$.primero = $$.ultimo = NULL; }
+  | CODIGO DECLARACION  { $$ = agregar_sentencia(ctx, $1, $2); }
+  | CODIGO SENTENCIA    { $$ = agregar_sentencia(ctx, $1, $2); }
 ;
 
 DECLARACION:
@@ -92,13 +179,13 @@ DECLARACION:
 
 VARS:
     VAR             { $$ = $1; }
-  | VAR COMA VARS   { $$ = nodo_seq($1, $3); }
+  | VAR COMA VARS   { $$ = nodo_seq(ctx, $1, $3); }
 ;
 
 VAR:
-    ID                    { $$ = nodo_decl($1, NULL); free($1); }
-  | ID OP_ASIGN E        { $$ = nodo_decl($1, $3); free($1); }
-  | ID OP_ASIGN EB       { $$ = nodo_decl($1, $3); free($1); }
+    ID                    { $$ = UBICAR(nodo_decl(ctx, LEXEMA($1), NULL), @1); SOLTAR($1); }
+  | ID OP_ASIGN E        { $$ = UBICAR(nodo_decl(ctx, LEXEMA($1), $3), @1); SOLTAR($1); }
+  | ID OP_ASIGN EB       { $$ = UBICAR(nodo_decl(ctx, LEXEMA($1), $3), @1); SOLTAR($1); }
 ;
 
 TIPO:
@@ -107,43 +194,400 @@ TIPO:
 ;
 
 SENTENCIA:
-    ID OP_ASIGN E PYC     { $$ = nodo_assign($1, $3); free($1); }
-  | ID OP_ASIGN EB PYC    { $$ = nodo_assign($1, $3); free($1); }
-  | RETURN PYC            { $$ = nodo_return(NULL); }
-  | RETURN E PYC          { $$ = nodo_return($2); }
-  | RETURN EB PYC         { $$ = nodo_return($2); }
+    ID OP_ASIGN E PYC     { $$ = UBICAR(nodo_assign(ctx, LEXEMA($1), $3), @1); SOLTAR($1); }
+  | ID OP_ASIGN EB PYC    { $$ = UBICAR(nodo_assign(ctx, LEXEMA($1), $3), @1); SOLTAR($1); }
+  | RETURN PYC            { $$ = UBICAR(nodo_return(ctx, NULL), @1); }
+  | RETURN E PYC          { $$ = UBICAR(nodo_return(ctx, $2), @1); }
+  | RETURN EB PYC         { $$ = UBICAR(nodo_return(ctx, $2), @1); }
 ;
 
+/* Una operación se ubica en su operador: en a + b * c cada una tiene el suyo */
 E:
-    E OP_SUMA E     { $$ = nodo_opBin(TOP_SUMA, $1, $3); }
-  | E OP_RESTA E    { $$ = nodo_opBin(TOP_RESTA, $1, $3); }
-  | E OP_MULT E     { $$ = nodo_opBin(TOP_MULT, $1, $3); }
-  | E OP_DIV E      { $$ = nodo_opBin(TOP_DIV, $1, $3); }
+    E OP_SUMA E     { $$ = UBICAR(nodo_opBin(ctx, TOP_SUMA, $1, $3), @2); }
+  | E OP_RESTA E    { $$ = UBICAR(nodo_opBin(ctx, TOP_RESTA, $1, $3), @2); }
+  | E OP_MULT E     { $$ = UBICAR(nodo_opBin(ctx, TOP_MULT, $1, $3), @2); }
+  | E OP_DIV E      { $$ = UBICAR(nodo_opBin(ctx, TOP_DIV, $1, $3), @2); }
   | PARA E PARC     { $$ = $2; }
-  | ID              { $$ = nodo_ID($1); free($1); }
-  | NUMERO          { $$ = nodo_int($1); }
+  | ID              { $$ = UBICAR(nodo_ID(ctx, LEXEMA($1)), @1); SOLTAR($1); }
+  | NUMERO          { $$ = UBICAR(nodo_int(ctx, $1), @1); }
 ;
 
 EB:
-    EB OP_OR EB     { $$ = nodo_opBin(TOP_OR, $1, $3); }
-  | EB OP_AND EB    { $$ = nodo_opBin(TOP_AND, $1, $3); }
-  | E OP_IGUAL E    { $$ = nodo_opBin(TOP_IGUAL, $1, $3); }
-  | E OP_MAYOR E    { $$ = nodo_opBin(TOP_MAYOR, $1, $3); }
-  | E OP_MENOR E    { $$ = nodo_opBin(TOP_MENOR, $1, $3); }
+    EB OP_OR EB     { $$ = UBICAR(nodo_opBin(ctx, TOP_OR, $1, $3), @2); }
+  | EB OP_AND EB    { $$ = UBICAR(nodo_opBin(ctx, TOP_AND, $1, $3), @2); }
+  | E OP_IGUAL E    { $$ = UBICAR(nodo_opBin(ctx, TOP_IGUAL, $1, $3), @2); }
+  | E OP_MAYOR E    { $$ = UBICAR(nodo_opBin(ctx, TOP_MAYOR, $1, $3), @2); }
+  | E OP_MENOR E    { $$ = UBICAR(nodo_opBin(ctx, TOP_MENOR, $1, $3), @2); }
   | PARA EB PARC    { $$ = $2; }
-  | TRUE            { $$ = nodo_bool(1); }
-  | FALSE           { $$ = nodo_bool(0); }
+  | TRUE            { $$ = UBICAR(nodo_bool(ctx, 1), @1); }
+  | FALSE           { $$ = UBICAR(nodo_bool(ctx, 0), @1); }
 ;
 
 %%
 
-int main(int argc, char *argv[]) {
-    extern FILE *yyin;
-    ++argv, --argc;
+/**
+ * Deja listo el lexer elegido al principio de ctx->fuente: el de flex lo
+ * recorre en el lugar con yy_scan_buffer (necesita los dos NUL finales) y el
+ * escrito a mano avanza ctx->cursor hasta ctx->largo_fuente.
+ * @param ctx Contexto con el fuente ya cargado.
+ * @return 0, o -1 si flex no pudo reservar su estado (con ctx->error).
+ */
+int contexto_preparar_lexico(CompilerContext *ctx) {
+    ctx->cursor = 0;
+    ctx->linea = 1;
+    ctx->linea_ubicado = 0;
+    if (ctx->lexer != LEXER_FLEX) return 0;
+
+    yyscan_t scanner;
+    if (yylex_init_extra(ctx, &scanner) != 0) {
+        contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para el lexer");
+        return -1;
+    }
+    if (!yy_scan_buffer(ctx->fuente, ctx->largo_fuente + 2, scanner)) {
+        yylex_destroy(scanner);
+        contexto_error(ctx, ERROR_MEMORIA, 0, 0, "yy_scan_buffer rechazó la entrada");
+        return -1;
+    }
+    yyset_lineno(1, scanner);         /* yy_scan_buffer no inicializa la línea */
+    ctx->scanner = scanner;
+    return 0;
+}
+
+/**
+ * Carga la entrada en ctx->fuente, si no se cargó antes, y prepara el lexer
+ * elegido (ctx->lexer).
+ * @param ctx Contexto de compilación.
+ * @param entrada Archivo con el código fuente.
+ * @return 0, o -1 si no hubo memoria (con ctx->error).
+ */
+int contexto_iniciar_lexico(CompilerContext *ctx, FILE *entrada) {
+    if (!ctx->fuente && contexto_cargar_fuente(ctx, entrada) != 0) return -1;
+    return contexto_preparar_lexico(ctx);
+}
 
-    if (argc > 0) yyin = fopen(argv[0], "r");
-    else yyin = stdin;
+/**
+ * Libera el lexer de flex y el texto fuente.
+ * @param ctx Contexto de compilación.
+ */
+void contexto_terminar_lexico(CompilerContext *ctx) {
+    if (ctx->scanner) yylex_destroy(ctx->scanner);
+    ctx->scanner = NULL;
+    contexto_liberar_fuente(ctx);     /* El AST tiene sus propias copias de los nombres */
+}
 
-    yyparse();
+/**
+ * Devuelve la línea por la que va el análisis (para yyerror). Si el parser
+ * lee de un arreglo de tokens, es la línea del último token leído, contando
+ * los saltos del fuente hasta su desplazamiento; si no, la del lexer en uso.
+ * @param ctx Contexto de compilación.
+ * @return Número de línea, empezando en 1.
+ */
+int contexto_linea(const CompilerContext *ctx) {
+    if (ctx->tokens) {
+        size_t i = ctx->token_actual ? ctx->token_actual - 1 : 0;
+        const char *p = ctx->fuente;
+        const char *fin = p + ctx->tokens->desplazamiento[i];
+        int linea = 1;
+        while ((p = memchr(p, '\n', fin - p)) != NULL) {
+            linea++;
+            p++;
+        }
+        return linea;
+    }
+    return ctx->lexer == LEXER_SIMD ? ctx->linea : yyget_lineno(ctx->scanner);
+}
+
+/**
+ * Devuelve la columna del token por el que va el análisis, contando desde 1.
+ * Con el lexer de flex (sin arreglo de tokens) no se conoce.
+ * @param ctx Contexto de compilación.
+ * @return Columna, o 0 si no se sabe.
+ */
+int contexto_columna(const CompilerContext *ctx) {
+    size_t inicio;
+    if (ctx->tokens) {
+        size_t i = ctx->token_actual ? ctx->token_actual - 1 : 0;
+        inicio = ctx->tokens->desplazamiento[i];
+    } else if (ctx->lexer == LEXER_SIMD) {
+        /* El análisis incremental ya ubicó el token y puede haber descartado
+           el principio de su línea */
+        if (ctx->linea_ubicado && ctx->ubicado == ctx->inicio_token) return ctx->columna_ubicado;
+        inicio = ctx->inicio_token;
+    } else {
+        return 0;
+    }
+    size_t p = inicio;
+    while (p > 0 && ctx->fuente[p - 1] != '\n') p--;
+    return (int)(inicio - p) + 1;
+}
+
+/**
+ * Devuelve la línea y la columna de una posición del fuente. Avanza desde la
+ * última posición pedida contando saltos de línea; sólo si se pide una
+ * anterior vuelve a contar desde el principio. Como no vuelve a mirar el texto
+ * anterior a la última posición, el análisis incremental puede descartarlo.
+ * @param ctx Contexto con el fuente cargado.
+ * @param desplazamiento Posición en ctx->fuente.
+ * @param linea Devuelve la línea, desde 1.
+ * @param columna Devuelve la columna en bytes, desde 1.
+ */
+void contexto_ubicar(CompilerContext *ctx, size_t desplazamiento, int *linea, int *columna) {
+    size_t p = ctx->ubicado;
+    int l = ctx->linea_ubicado, c = ctx->columna_ubicado;
+    if (l == 0 || desplazamiento < p) {
+        p = 0;
+        l = c = 1;
+    }
+    const char *q = ctx->fuente + p;
+    const char *fin = ctx->fuente + desplazamiento;
+    const char *salto;
+    while (q < fin && (salto = memchr(q, '\n', fin - q)) != NULL) {
+        l++;
+        c = 1;
+        q = salto + 1;
+    }
+    c += (int)(fin - q);
+    ctx->ubicado = desplazamiento;
+    ctx->linea_ubicado = l;
+    ctx->columna_ubicado = c;
+    *linea = l;
+    *columna = c;
+}
+
+/**
+ * Analiza un arreglo de tokens ya armado. El fuente del que salió tiene que
+ * seguir en ctx->fuente, porque los ID son porciones de ese texto.
+ * @param ctx Contexto de compilación.
+ * @param tokens Arreglo terminado en el token de fin.
+ * @param raiz Devuelve la raíz del AST (NULL si el programa está vacío).
+ * @return 0 si el análisis fue correcto, distinto de 0 si hubo errores.
+ */
+int contexto_parsear_tokens(CompilerContext *ctx, const Tokens *tokens, Nodo **raiz) {
+    ctx->tokens = tokens;
+    ctx->token_actual = 0;
+    *raiz = NULL;
+    int error = yyparse(ctx, raiz);
+    ctx->tokens = NULL;
+    if (contexto_fallo(ctx)) {
+        nodo_libre(ctx, *raiz);         /* Se aceptó, pero falló la construcción de algo */
+        *raiz = NULL;
+        error = 1;
+    }
+    return error;
+}
+
+/**
+ * Analiza un programa completo con un lexer propio del contexto. La entrada
+ * se carga entera (mapeada si es un archivo), se tokeniza completa a un
+ * arreglo y el parser elegido (ctx->parser) lee de ese arreglo.
+ * @param ctx Contexto de compilación.
+ * @param entrada Archivo con el código fuente.
+ * @param raiz Devuelve la raíz del AST (NULL si el programa está vacío).
+ * @return 0 si el análisis fue correcto, distinto de 0 si hubo errores.
+ */
+int contexto_parsear(CompilerContext *ctx, FILE *entrada, Nodo **raiz) {
+    Tokens tokens;
+    tokens_iniciar(&tokens);
+    *raiz = NULL;
+    if (contexto_iniciar_lexico(ctx, entrada) != 0) {
+        contexto_liberar_fuente(ctx);
+        return 1;
+    }
+    int error = ctx->lexear ? ctx->lexear(ctx, &tokens) : tokens_lexear(ctx, &tokens);
+    if (!error) error = ctx->parser == PARSER_MANO ? analizador_parsear(ctx, &tokens, raiz)
+                                                   : contexto_parsear_tokens(ctx, &tokens, raiz);
+    contexto_terminar_lexico(ctx);
+    tokens_liberar(&tokens);
+    return error;
+}
+
+/* ------------------ Análisis incremental ------------------ */
+
+/* Estado del análisis de un fuente que llega por partes */
+struct Incremental {
+    CompilerContext *ctx;
+    yypstate *ps;                   /* Parser push de Bison */
+    size_t cap;                     /* Capacidad de ctx->fuente */
+    int estado;                     /* YYPUSH_MORE, 0 (aceptado) o error */
+    int cerrado;                    /* Ya se redujo el '}' de main */
+    Nodo *raiz;
+};
+
+/**
+ * Crea un análisis incremental sobre el contexto. En ctx->fuente queda sólo
+ * lo recibido que el lexer todavía no consumió: cada parte nueva descarta lo
+ * ya analizado, y los ID que pasan al parser llevan su propia copia del
+ * nombre. El lexer es siempre el escrito a mano, que puede detenerse en
+ * cualquier byte y retomar.
+ * @param ctx Contexto de compilación.
+ * @return Estado del análisis, o NULL si no hubo memoria (con ctx->error).
+ */
+Incremental *incremental_crear(CompilerContext *ctx) {
+    contexto_liberar_fuente(ctx);
+    Incremental *inc = calloc(1, sizeof(Incremental));
+    if (inc) inc->ps = yypstate_new();
+    if (inc && inc->ps) ctx->fuente = malloc(INCREMENTAL_INICIAL);
+    if (!inc || !inc->ps || !ctx->fuente) {
+        if (inc && inc->ps) yypstate_delete(inc->ps);
+        free(inc);
+        contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para el análisis incremental");
+        return NULL;
+    }
+    inc->ctx = ctx;
+    inc->estado = YYPUSH_MORE;
+    inc->cap = INCREMENTAL_INICIAL;
+
+    ctx->fuente[0] = ctx->fuente[1] = '\0';
+    ctx->largo_fuente = 0;
+    ctx->lexer = LEXER_SIMD;
+    ctx->cursor = 0;
+    ctx->linea = 1;
+    ctx->linea_ubicado = 0;
+    return inc;
+}
+
+/**
+ * Copia el nombre de un ID, que tiene que sobrevivir en la pila del parser
+ * a que se descarte la parte del fuente de la que salió.
+ * @param ctx Contexto de compilación.
+ * @param lex Lexema a copiar (queda apuntando a la copia).
+ * @return 0, o -1 si no hubo memoria (con ctx->error).
+ */
+static int copiar_lexema(CompilerContext *ctx, Lexema *lex) {
+    char *copia = malloc(lex->largo ? lex->largo : 1);
+    if (!copia) {
+        contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para el análisis incremental");
+        return -1;
+    }
+    memcpy(copia, lex->texto, lex->largo);
+    lex->texto = copia;
+    lex->propio = 1;
     return 0;
-}
\ No newline at end of file
+}
+
+/**
+ * Indica si un token que termina justo al final de lo recibido podría seguir
+ * en la próxima parte: un identificador, una palabra reservada, un número o
+ * '=' antes de '='.
+ * @param token Token leído.
+ * @return 1 si hay que esperar más texto para estar seguro.
+ */
+static int puede_seguir(int token) {
+    switch (token) {
+        case ID: case NUMERO: case OP_ASIGN:
+        case INT: case BOOL: case VOID: case TRUE: case FALSE: case RETURN: case MAIN:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Tokeniza lo que haya completo en el buffer y se lo pasa al parser. Un token
+ * que podría seguir en la próxima parte se deja para después, salvo que sea
+ * el final de la entrada.
+ *
+ * El '}' sólo cierra main: apenas se lo pasa al parser, le sigue el fin de
+ * la entrada, sin leer nada más del buffer. Así el programa se acepta en la
+ * misma parte en que llega el '}', y lo que venga después se ignora siempre,
+ * sin importar cómo se haya partido la entrada.
+ * @param inc Estado del análisis.
+ * @param final 1 si ya no va a llegar más texto.
+ */
+static void incremental_avanzar(Incremental *inc, int final) {
+    CompilerContext *ctx = inc->ctx;
+    double t0 = stats_reloj();
+    while (inc->estado == YYPUSH_MORE) {
+        size_t cursor = ctx->cursor;
+        int linea = ctx->linea;
+        YYSTYPE lval;
+        YYLTYPE lloc;
+        int token = contexto_fallo(ctx) || inc->cerrado ? 0 : lexico_simd(&lval, ctx);
+        if (!final && !inc->cerrado && !contexto_fallo(ctx) &&
+            (token == 0 || (ctx->cursor == ctx->largo_fuente && puede_seguir(token)))) {
+            ctx->cursor = cursor;               /* Esperar más texto */
+            ctx->linea = linea;
+            break;
+        }
+        if (token == ID && copiar_lexema(ctx, &lval.lex) != 0) continue;   /* Corta */
+        ctx->stats.tokens++;
+        ubicar_token(ctx, token ? ctx->inicio_token : inc->cerrado ? ctx->cursor : ctx->largo_fuente, &lloc);
+        inc->estado = yypush_parse(inc->ps, token, &lval, &lloc, ctx, &inc->raiz);
+        if (token == 0) break;
+        if (token == LLAC) inc->cerrado = 1;
+    }
+    ctx->stats.tiempo[FASE_LEXICO] += stats_reloj() - t0;
+}
+
+/**
+ * Descarta del buffer lo que el lexer ya consumió; queda sólo el token que se
+ * dejó para la próxima parte. La ubicación avanza antes hasta el corte, para
+ * que las líneas y columnas sigan contando desde el principio del fuente.
+ * @param ctx Contexto de compilación.
+ */
+static void incremental_descartar(CompilerContext *ctx) {
+    size_t consumido = ctx->cursor;
+    if (consumido == 0) return;
+    int linea, columna;
+    contexto_ubicar(ctx, consumido, &linea, &columna);
+    ctx->largo_fuente -= consumido;
+    memmove(ctx->fuente, ctx->fuente + consumido, ctx->largo_fuente + 2);
+    ctx->cursor = 0;
+    ctx->ubicado = 0;
+}
+
+/**
+ * Agrega una parte del fuente y analiza todo lo que ya se pueda.
+ * @param inc Estado del análisis.
+ * @param datos Texto recibido.
+ * @param largo Largo del texto.
+ * @return 0 si el análisis sigue; distinto de 0 si ya terminó, porque se
+ *         aceptó el programa o hubo un error (lo dice incremental_terminar).
+ */
+int incremental_alimentar(Incremental *inc, const char *datos, size_t largo) {
+    CompilerContext *ctx = inc->ctx;
+    if (inc->estado != YYPUSH_MORE) return 1;
+
+    incremental_descartar(ctx);
+    if (ctx->largo_fuente + largo + 2 > inc->cap) {
+        size_t cap = inc->cap;
+        while (ctx->largo_fuente + largo + 2 > cap) cap *= 2;
+        char *fuente = realloc(ctx->fuente, cap);
+        if (!fuente) {
+            contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para el análisis incremental");
+            incremental_avanzar(inc, 1);            /* Corta y libera la pila del parser */
+            return 1;
+        }
+        ctx->fuente = fuente;
+        inc->cap = cap;
+    }
+    memcpy(ctx->fuente + ctx->largo_fuente, datos, largo);
+    ctx->largo_fuente += largo;
+    ctx->fuente[ctx->largo_fuente] = ctx->fuente[ctx->largo_fuente + 1] = '\0';
+
+    incremental_avanzar(inc, 0);
+    return inc->estado != YYPUSH_MORE;
+}
+
+/**
+ * Indica el fin de la entrada, termina el análisis y libera su estado. Si el
+ * programa ya se aceptó, lo que haya llegado después no se analiza.
+ * @param inc Estado del análisis.
+ * @param raiz Devuelve la raíz del AST (NULL si está vacío o hubo un error).
+ * @return 0 si el análisis fue correcto, distinto de 0 si hubo errores.
+ */
+int incremental_terminar(Incremental *inc, Nodo **raiz) {
+    CompilerContext *ctx = inc->ctx;
+    incremental_avanzar(inc, 1);
+    int error = inc->estado;
+    if (!error && contexto_fallo(ctx)) {
+        nodo_libre(ctx, inc->raiz);
+        error = 1;
+    }
+    *raiz = error ? NULL : inc->raiz;
+
+    yypstate_delete(inc->ps);
+    free(inc);
+    contexto_liberar_fuente(ctx);     /* El AST tiene sus propias copias de los nombres */
+    return error;
+}
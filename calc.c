@@ -0,0 +1,1024 @@
+/*
+ * Driver del compilador.
+ *
+ * Uso: ./calc [opciones] [archivo]
+ *      ./calc [opciones] --batch dir [-j hilos]
+ *      ./calc [opciones] --serve socket
+ *
+ * El parser sólo construye el AST; cada fase (DOT, seudo-assembly,
+ * evaluación, impresión) se ejecuta una única vez y sólo si se la pide.
+ */
+
+/* Definiciones necesarias para compatibilidad POSIX */
+#define _POSIX_C_SOURCE 200809L
+
+/* Inclusiones de bibliotecas estándar */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <getopt.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ast.h"
+#include "contexto.h"
+#include "tokens.h"
+#include "planificador.h"
+#include "serializacion.h"
+#include "cache.h"
+#include "servidor.h"
+#include "perfil.h"
+
+/* Archivo de seudo-assembly por defecto */
+#define ASM_POR_DEFECTO "programa.sasm"
+
+/* Nombre base de la exportación DOT */
+#define DOT_POR_DEFECTO "ast_tree"
+
+/* Pilas plegadas de --profile */
+#define PERFIL_POR_DEFECTO "perfil.folded"
+
+/* Tamaño de cada parte leída por --incremental */
+#define PARTE_POR_DEFECTO 4096
+
+/* Fases seleccionadas por línea de comandos */
+typedef struct {
+    int emit_asm;
+    int emit_dot;
+    OpcionesGrafo grafo;    /* Formato y límites de --emit-dot */
+    int eval;
+    int especializado;      /* --eval=especializado: eval_especializado en vez de eval_nodo */
+    int print_ast;
+    int print_symbols;
+    int stats;              /* 0 = no, 1 = texto, 2 = JSON */
+    const char *salida_asm;
+    const char *entrada;
+    const char *batch;      /* Directorio a compilar con --batch */
+    int hilos;              /* -j */
+    TipoLexer lexer;        /* --lexer */
+    TipoParser parser;      /* --parser */
+    size_t incremental;     /* --incremental: bytes por parte (0 = no) */
+    int stream;             /* --stream */
+    const char *cache;      /* --cache: directorio de la caché de compilaciones */
+    unsigned long cache_max;    /* --cache-max: tamaño máximo de la caché en MB */
+    OcupacionCache *ocupacion;  /* Tamaño estimado de la caché (NULL sin --cache) */
+    const char *serve;      /* --serve: socket en el que atender pedidos */
+    const char *perfil;     /* --profile: archivo de las pilas (NULL = no se mide) */
+} Opciones;
+
+/* Estado de --stream: qué se hace con cada sentencia apenas se reduce */
+typedef struct {
+    const Opciones *op;
+    FILE *asm_f;            /* Seudo-assembly en curso (NULL si no se pidió) */
+    Emisor *emisor;
+    int resultado;          /* Valor de la última sentencia evaluada */
+    int terminado;          /* Ya se ejecutó un return */
+} Flujo;
+
+/* Una compilación de --batch: su archivo y lo que produjo */
+typedef struct {
+    char *ruta;
+    char *salida;           /* Texto de ctx->salida */
+    size_t largo_salida;
+    char *errores;          /* Texto de ctx->errores */
+    size_t largo_errores;
+    int error;
+    int sin_memoria;        /* No se pudo ni juntar la salida: no se compiló */
+    Estadisticas stats;
+} Trabajo;
+
+/* Argumento compartido por las tareas de --batch */
+typedef struct {
+    const Opciones *op;
+    Trabajo *trabajos;
+} Lote;
+
+/* Estado de --serve: un único contexto que se reinicia en cada pedido */
+typedef struct {
+    const Opciones *op;
+    CompilerContext *ctx;
+} Servicio;
+
+/**
+ * Imprime la ayuda de la línea de comandos.
+ * @param prog Nombre del ejecutable.
+ */
+static void uso(const char *prog) {
+    fprintf(stderr,
+            "Uso: %s [opciones] [archivo]\n"
+            "  --emit-asm        genera el seudo-assembly (ver -o)\n"
+            "  --emit-dot[=png|dot|json|aristas]  exporta el AST a " DOT_POR_DEFECTO ".dot;\n"
+            "                    con png (por defecto) además lanza Graphviz en segundo\n"
+            "                    plano para generar " DOT_POR_DEFECTO ".png; json escribe un\n"
+            "                    nodo por línea en .jsonl y aristas 'padre hijo' en .tsv\n"
+            "  --dot-max-nodos=n, --dot-max-profundidad=n  pasados esos límites, cada\n"
+            "                    subárbol se exporta como un nodo resumen\n"
+            "  --eval[=arbol|especializado]  evalúa el programa e imprime el resultado;\n"
+            "                    especializado reescribe cada operación en una variante\n"
+            "                    para su forma la primera vez que la ejecuta\n"
+            "  --print-ast       imprime el AST\n"
+            "  --print-symbols   imprime la tabla de símbolos (implica evaluar)\n"
+            "  -o archivo        salida del seudo-assembly (por defecto " ASM_POR_DEFECTO
+            ", '-' para stdout)\n"
+            "  --stats[=json]    informa tiempos por fase y contadores en stderr\n"
+            "  --batch dir       compila cada archivo .txt de dir (el .sasm y el .dot\n"
+            "                    quedan junto a cada fuente)\n"
+            "  -j hilos          hilos para --batch, o para tokenizar un único archivo\n"
+            "                    (por defecto 1)\n"
+            "  --lexer=flex|simd lexer generado por flex o escrito a mano con SIMD\n"
+            "  --parser=bison|mano  parser generado por Bison o escrito a mano\n"
+            "  --incremental[=bytes]  lee la entrada por partes y la analiza a medida\n"
+            "                    que llega (por defecto partes de %d bytes; sólo con\n"
+            "                    --parser=bison)\n"
+            "  --stream          evalúa y genera cada sentencia apenas se analiza y la\n"
+            "                    libera, sin armar el AST (no admite --print-ast ni\n"
+            "                    --emit-dot)\n"
+            "  --cache=dir       guarda en dir el resultado (seudo-assembly, valor, tabla\n"
+            "                    de símbolos) y el AST de cada compilación y, si el\n"
+            "                    fuente no cambió, los usa sin volver a compilar\n"
+            "  --cache-max=MB    tamaño máximo de la caché; se borran las entradas\n"
+            "                    usadas hace más tiempo (por defecto %d)\n"
+            "  --serve=socket    queda escuchando en un socket Unix y compila los\n"
+            "                    programas que recibe (ver servidor.h; no admite\n"
+            "                    --emit-dot)\n"
+            "  --profile[=archivo]  evalúa midiendo cada nodo: informa en stderr las\n"
+            "                    sentencias y los nodos más costosos, con su línea y\n"
+            "                    columna, y escribe en archivo (por defecto\n"
+            "                    " PERFIL_POR_DEFECTO ", '-' para stdout) las pilas para\n"
+            "                    flamegraph.pl (implica --eval; no admite --stream,\n"
+            "                    --batch, --serve ni --eval=especializado)\n"
+            "  -h, --help        muestra esta ayuda\n"
+            "Sin opciones de fase se asume --eval. Sin archivo se lee stdin.\n",
+            prog, PARTE_POR_DEFECTO, CACHE_MAX_POR_DEFECTO);
+}
+
+/**
+ * Interpreta los argumentos de la línea de comandos.
+ * @param argc Cantidad de argumentos.
+ * @param argv Argumentos.
+ * @param op Opciones a completar.
+ * @return 0 si son válidos, -1 si hay que mostrar la ayuda.
+ */
+static int leer_opciones(int argc, char *argv[], Opciones *op) {
+    enum { OPT_EMIT_ASM = 256, OPT_EMIT_DOT, OPT_EVAL, OPT_PRINT_AST, OPT_PRINT_SYMBOLS,
+           OPT_STATS, OPT_BATCH, OPT_LEXER, OPT_PARSER, OPT_INCREMENTAL,
+           OPT_STREAM, OPT_DOT_MAX_NODOS, OPT_DOT_MAX_PROFUNDIDAD, OPT_CACHE, OPT_CACHE_MAX, OPT_SERVE,
+           OPT_PROFILE };
+    static const struct option largas[] = {
+        { "emit-asm",      no_argument, NULL, OPT_EMIT_ASM },
+        { "emit-dot",      optional_argument, NULL, OPT_EMIT_DOT },
+        { "eval",          optional_argument, NULL, OPT_EVAL },
+        { "print-ast",     no_argument, NULL, OPT_PRINT_AST },
+        { "print-symbols", no_argument, NULL, OPT_PRINT_SYMBOLS },
+        { "stats",         optional_argument, NULL, OPT_STATS },
+        { "batch",         required_argument, NULL, OPT_BATCH },
+        { "lexer",         required_argument, NULL, OPT_LEXER },
+        { "parser",        required_argument, NULL, OPT_PARSER },
+        { "incremental",   optional_argument, NULL, OPT_INCREMENTAL },
+        { "stream",        no_argument, NULL, OPT_STREAM },
+        { "dot-max-nodos", required_argument, NULL, OPT_DOT_MAX_NODOS },
+        { "dot-max-profundidad", required_argument, NULL, OPT_DOT_MAX_PROFUNDIDAD },
+        { "cache",         required_argument, NULL, OPT_CACHE },
+        { "cache-max",     required_argument, NULL, OPT_CACHE_MAX },
+        { "serve",         required_argument, NULL, OPT_SERVE },
+        { "profile",       optional_argument, NULL, OPT_PROFILE },
+        { "help",          no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    memset(op, 0, sizeof(*op));
+    op->salida_asm = ASM_POR_DEFECTO;
+    op->hilos = 1;
+    op->lexer = LEXER_POR_DEFECTO;
+    op->cache_max = CACHE_MAX_POR_DEFECTO;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "o:j:h", largas, NULL)) != -1) {
+        switch (c) {
+            case OPT_EMIT_ASM:      op->emit_asm = 1; break;
+            case OPT_EMIT_DOT:
+                op->emit_dot = 1;
+                op->grafo.formato = GRAFO_DOT;
+                op->grafo.png = !optarg || strcmp(optarg, "png") == 0;
+                if (!optarg || strcmp(optarg, "png") == 0 || strcmp(optarg, "dot") == 0) break;
+                if (strcmp(optarg, "json") == 0) op->grafo.formato = GRAFO_JSON;
+                else if (strcmp(optarg, "aristas") == 0) op->grafo.formato = GRAFO_ARISTAS;
+                else return -1;
+                break;
+            case OPT_DOT_MAX_NODOS:
+                op->grafo.max_nodos = atol(optarg);
+                if (op->grafo.max_nodos < 1) return -1;
+                break;
+            case OPT_DOT_MAX_PROFUNDIDAD:
+                op->grafo.max_profundidad = atoi(optarg);
+                if (op->grafo.max_profundidad < 1) return -1;
+                break;
+            case OPT_EVAL:
+                op->eval = 1;
+                if (!optarg || strcmp(optarg, "arbol") == 0) break;
+                if (strcmp(optarg, "especializado") == 0) op->especializado = 1;
+                else return -1;
+                break;
+            case OPT_PRINT_AST:     op->print_ast = 1; break;
+            case OPT_PRINT_SYMBOLS: op->print_symbols = 1; break;
+            case OPT_STATS:
+                if (!optarg || strcmp(optarg, "text") == 0) op->stats = 1;
+                else if (strcmp(optarg, "json") == 0) op->stats = 2;
+                else return -1;
+                break;
+            case OPT_BATCH:         op->batch = optarg; break;
+            case OPT_LEXER:
+                if (strcmp(optarg, "flex") == 0) op->lexer = LEXER_FLEX;
+                else if (strcmp(optarg, "simd") == 0) op->lexer = LEXER_SIMD;
+                else return -1;
+                break;
+            case OPT_PARSER:
+                if (strcmp(optarg, "bison") == 0) op->parser = PARSER_BISON;
+                else if (strcmp(optarg, "mano") == 0) op->parser = PARSER_MANO;
+                else return -1;
+                break;
+            case OPT_INCREMENTAL:
+            {
+                long bytes = optarg ? atol(optarg) : PARTE_POR_DEFECTO;
+                if (bytes < 1) return -1;
+                op->incremental = (size_t)bytes;
+                break;
+            }
+            case OPT_STREAM:        op->stream = 1; break;
+            case OPT_CACHE:         op->cache = optarg; break;
+            case OPT_CACHE_MAX:
+                if (atol(optarg) < 1) return -1;
+                op->cache_max = (unsigned long)atol(optarg);
+                break;
+            case OPT_SERVE:         op->serve = optarg; break;
+            case OPT_PROFILE:
+                op->perfil = optarg ? optarg : PERFIL_POR_DEFECTO;
+                op->eval = 1;
+                break;
+            case 'o':               op->salida_asm = optarg; break;
+            case 'j':
+                op->hilos = atoi(optarg);
+                if (op->hilos < 1) return -1;
+                break;
+            default:                return -1;
+        }
+    }
+    if (optind < argc) op->entrada = argv[optind++];
+    if (optind < argc) return -1;
+    if (op->batch && op->entrada) return -1;
+    if (op->batch && op->incremental) return -1;
+    if (op->incremental && op->parser == PARSER_MANO) return -1;
+    if (op->stream && (op->print_ast || op->emit_dot)) return -1;
+    if (op->cache && (op->stream || op->incremental)) return -1;
+    if (op->serve && (op->batch || op->entrada || op->stream || op->incremental || op->cache ||
+                      op->emit_dot))
+        return -1;
+    if (op->perfil && (op->stream || op->batch || op->serve || op->especializado)) return -1;
+
+    if (!op->emit_asm && !op->emit_dot && !op->eval && !op->print_ast && !op->print_symbols)
+        op->eval = 1;
+    return 0;
+}
+
+/**
+ * Analiza la entrada leyéndola de a partes de tamaño fijo y pasándoselas al
+ * análisis incremental, sin esperar a tener el fuente completo.
+ * @param ctx Contexto de compilación.
+ * @param entrada Archivo fuente ya abierto.
+ * @param parte Bytes por lectura.
+ * @param raiz Devuelve la raíz del AST.
+ * @return 0 si el análisis fue correcto, distinto de 0 si hubo errores.
+ */
+static int parsear_incremental(CompilerContext *ctx, FILE *entrada, size_t parte,
+                               Nodo **raiz) {
+    char *buffer = malloc(parte);
+    if (!buffer) {
+        contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para el análisis incremental");
+        return 1;
+    }
+    Incremental *inc = incremental_crear(ctx);
+    if (!inc) {
+        free(buffer);
+        return 1;
+    }
+    /* read y no fread: con un pipe, fread esperaría a llenar la parte y el
+       programa recién se aceptaría al cerrarse la entrada */
+    int fd = fileno(entrada);
+    ssize_t n;
+    while ((n = read(fd, buffer, parte)) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("read");
+            break;
+        }
+        if (incremental_alimentar(inc, buffer, (size_t)n) != 0) break;
+    }
+    free(buffer);
+    return incremental_terminar(inc, raiz);
+}
+
+/**
+ * Analiza la entrada con la lectura que pidan las opciones.
+ * @param op Opciones.
+ * @param ctx Contexto de compilación.
+ * @param entrada Archivo fuente ya abierto.
+ * @param raiz Devuelve la raíz del AST.
+ * @return 0 si el análisis fue correcto, distinto de 0 si hubo errores.
+ */
+static int parsear(const Opciones *op, CompilerContext *ctx, FILE *entrada, Nodo **raiz) {
+    if (op->incremental) return parsear_incremental(ctx, entrada, op->incremental, raiz);
+    return contexto_parsear(ctx, entrada, raiz);
+}
+
+/**
+ * Anota en la ocupación de la caché una entrada recién guardada, que puede
+ * podar el directorio.
+ * @param op Opciones.
+ * @param ctx Contexto de compilación (sus estadísticas cuentan los desalojos).
+ * @param ruta Entrada guardada.
+ */
+static void anotar_en_cache(const Opciones *op, CompilerContext *ctx, const char *ruta) {
+    int borradas = cache_anotar(op->ocupacion, ruta);
+    if (borradas < 0)
+        fprintf(ctx->errores, "Aviso: no hubo memoria para podar la caché '%s'\n", op->cache);
+    else
+        ctx->stats.cache_desalojos += borradas;
+}
+
+/**
+ * Analiza la entrada pasando por el AST plano de la caché: si ya hay uno de
+ * este mismo fuente se mapea y no se tokeniza ni se analiza nada; si no, se
+ * analiza y el AST se guarda para la próxima vez.
+ * @param op Opciones (op->cache es el directorio).
+ * @param ctx Contexto de compilación, con el fuente ya cargado.
+ * @param entrada Archivo fuente.
+ * @param hash plano_hash del fuente.
+ * @param plano Devuelve el AST plano si estaba en la caché.
+ * @param en_cache Devuelve 1 si estaba en la caché (y *raiz queda en NULL).
+ * @param raiz Devuelve la raíz del AST si hubo que analizar.
+ * @return 0 si el análisis fue correcto, distinto de 0 si hubo errores.
+ */
+static int parsear_con_cache(const Opciones *op, CompilerContext *ctx, FILE *entrada, uint64_t hash,
+                             AstPlano *plano, int *en_cache, Nodo **raiz) {
+    char ruta[PATH_MAX];
+    uint64_t largo = ctx->largo_fuente;
+    cache_ruta(ruta, sizeof(ruta), op->cache, hash, ".ast");
+
+    *raiz = NULL;
+    *en_cache = plano_abrir(plano, ruta, hash, largo) == 0;
+    if (*en_cache) {
+        ctx->stats.cache_aciertos++;
+        cache_tocar(ruta);
+        contexto_liberar_fuente(ctx);
+        return 0;
+    }
+    ctx->stats.cache_fallos++;
+    int error = contexto_parsear(ctx, entrada, raiz);
+    if (error) return error;
+    if (plano_escribir(*raiz, hash, largo, ruta) != 0)
+        fprintf(ctx->errores, "Aviso: no se pudo escribir '%s' en la caché\n", ruta);
+    else
+        anotar_en_cache(op, ctx, ruta);
+    return 0;
+}
+
+/**
+ * Escribe el seudo-assembly ya generado en su destino.
+ * @param ctx Contexto de compilación.
+ * @param salida_asm Archivo de seudo-assembly ("-" para ctx->salida).
+ * @param texto Seudo-assembly.
+ * @param largo Bytes de texto.
+ * @return 0, o -1 si no se pudo escribir (con ctx->error).
+ */
+static int escribir_asm(CompilerContext *ctx, const char *salida_asm, const char *texto, size_t largo) {
+    if (strcmp(salida_asm, "-") == 0) {
+        /* generar_asm escribe directo al descriptor: igual que ella, que no
+           quede en el buffer detrás de un error posterior en stderr */
+        if (fwrite(texto, 1, largo, ctx->salida) < largo || fflush(ctx->salida) != 0) {
+            contexto_error(ctx, ERROR_ESCRITURA, 0, 0, "no se pudo escribir el seudo-assembly: %s",
+                           strerror(errno));
+            return -1;
+        }
+        return 0;
+    }
+    FILE *f = fopen(salida_asm, "w");
+    if (!f) {
+        contexto_error(ctx, ERROR_ESCRITURA, 0, 0, "no se pudo crear '%s': %s", salida_asm, strerror(errno));
+        return -1;
+    }
+    int escritos = fwrite(texto, 1, largo, f) == largo;
+    if (fclose(f) != 0 || !escritos) {
+        contexto_error(ctx, ERROR_ESCRITURA, 0, 0, "no se pudo escribir '%s': %s", salida_asm, strerror(errno));
+        return -1;
+    }
+    fprintf(ctx->salida, "Seudo-assembly escrito en '%s'\n", salida_asm);
+    return 0;
+}
+
+/**
+ * Busca en la caché el resultado de esta compilación y, si está, imprime lo
+ * mismo que imprimirían las fases sin ejecutar ninguna.
+ * @param op Fases pedidas.
+ * @param ctx Contexto de compilación.
+ * @param clave cache_clave de la compilación.
+ * @param salida_asm Archivo de seudo-assembly ("-" para ctx->salida).
+ * @return 0 si estaba, -1 si no.
+ */
+static int usar_resultado(const Opciones *op, CompilerContext *ctx, uint64_t clave,
+                          const char *salida_asm) {
+    ResultadoCache r;
+    /* Sin fallo todavía: si tampoco está el .ast lo cuenta parsear_con_cache */
+    if (cache_buscar(op->cache, clave, ctx->largo_fuente, &r) != 0) return -1;
+    ctx->stats.cache_aciertos++;
+    if (op->emit_asm) escribir_asm(ctx, salida_asm, r.asm_texto, r.largo_asm);
+    if (op->print_symbols) fwrite(r.simbolos, 1, r.largo_simbolos, ctx->salida);
+    if (op->eval) fprintf(ctx->salida, "Resultado: %d\n", r.resultado);
+    cache_cerrar(&r);
+    return 0;
+}
+
+/**
+ * Abre un FILE que junta en memoria lo que se escribe, para guardarlo en la caché.
+ * @param ctx Contexto de compilación (para informar errores).
+ * @param texto Devuelve el texto (válido después de fclose).
+ * @param largo Devuelve su largo.
+ * @return El FILE, o NULL si no hubo memoria (queda en ctx->error).
+ */
+static FILE *abrir_memoria(CompilerContext *ctx, char **texto, size_t *largo) {
+    FILE *f = open_memstream(texto, largo);
+    if (!f) contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para guardar en la caché");
+    return f;
+}
+
+/**
+ * Evalúa un árbol con el motor que pidan las opciones.
+ * @param op Opciones (op->especializado elige eval_especializado).
+ * @param ctx Contexto de compilación.
+ * @param n Árbol a evaluar.
+ * @return Valor resultante de la evaluación.
+ */
+static int evaluar(const Opciones *op, CompilerContext *ctx, Nodo *n) {
+    return op->especializado ? eval_especializado(ctx, n) : eval_nodo(ctx, n);
+}
+
+/**
+ * Sumidero de --stream: genera y evalúa una sentencia de nivel superior y la
+ * libera. Después de un return se sigue generando código pero ya no se
+ * evalúa, igual que eval_nodo con el programa completo.
+ * @param ctx Contexto de compilación.
+ * @param sentencia Sentencia recién reducida por el parser.
+ * @param arg El Flujo en curso.
+ */
+static void consumir_sentencia(CompilerContext *ctx, Nodo *sentencia, void *arg) {
+    Flujo *fl = arg;
+    Estadisticas *st = &ctx->stats;
+    double t0;
+
+    if (fl->emisor) {
+        t0 = stats_reloj();
+        generar_asm_sentencia(fl->emisor, sentencia);
+        st->tiempo[FASE_ASM] += stats_reloj() - t0;
+    }
+    if ((fl->op->eval || fl->op->print_symbols) && !fl->terminado) {
+        t0 = stats_reloj();
+        fl->resultado = evaluar(fl->op, ctx, sentencia);
+        fl->terminado = sentencia->tipo == NODO_RETURN;
+        st->tiempo[FASE_EVAL] += stats_reloj() - t0;
+    }
+    nodo_libre(ctx, sentencia);
+}
+
+/**
+ * Compila una entrada con --stream: el parser le entrega cada sentencia a
+ * consumir_sentencia en cuanto la reduce, así que en memoria nunca hay más
+ * que la sentencia en curso. Si aparece un error sintáctico, lo ya evaluado
+ * queda hecho y el seudo-assembly a medio escribir se borra.
+ * @param op Fases a ejecutar.
+ * @param ctx Contexto de esta compilación.
+ * @param entrada Archivo fuente ya abierto.
+ * @param salida_asm Archivo de seudo-assembly ("-" para ctx->salida).
+ * @return 0 si compiló, 1 si hubo un error (uno de ejecución corta el análisis).
+ */
+static int compilar_en_flujo(const Opciones *op, CompilerContext *ctx, FILE *entrada,
+                             const char *salida_asm) {
+    Estadisticas *st = &ctx->stats;
+    Flujo fl = { op, NULL, NULL, 0, 0 };
+    int a_salida = op->emit_asm && strcmp(salida_asm, "-") == 0;
+
+    if (op->emit_asm) {
+        fl.asm_f = a_salida ? ctx->salida : fopen(salida_asm, "w");
+        if (!fl.asm_f) {
+            contexto_error(ctx, ERROR_ESCRITURA, 0, 0, "no se pudo crear '%s': %s", salida_asm, strerror(errno));
+            return 1;
+        }
+        fl.emisor = generar_asm_inicio(ctx, fl.asm_f);
+    }
+
+    Nodo *ast = NULL;
+    ctx->sumidero = consumir_sentencia;
+    ctx->arg_sumidero = &fl;
+    double t0 = stats_reloj();
+    int error = parsear(op, ctx, entrada, &ast);
+    st->tiempo[FASE_SINTAXIS] = stats_reloj() - t0 - st->tiempo[FASE_LEXICO]
+                                - st->tiempo[FASE_ASM] - st->tiempo[FASE_EVAL];
+    ctx->sumidero = NULL;
+
+    if (fl.asm_f) {
+        generar_asm_fin(fl.emisor);
+        if (!a_salida) {
+            if (fclose(fl.asm_f) != 0)
+                contexto_error(ctx, ERROR_ESCRITURA, 0, 0, "no se pudo escribir '%s': %s", salida_asm,
+                               strerror(errno));
+            if (error) remove(salida_asm);
+            else if (!contexto_fallo(ctx)) fprintf(ctx->salida, "Seudo-assembly escrito en '%s'\n", salida_asm);
+        }
+        error |= contexto_fallo(ctx);
+    }
+    if (error) return 1;
+
+    if (op->print_symbols) {
+        t0 = stats_reloj();
+        imprimir_tabla_simbolos(ctx);
+        st->tiempo[FASE_IMPRESION] += stats_reloj() - t0;
+    }
+    if (op->eval) fprintf(ctx->salida, "Resultado: %d\n", fl.resultado);
+    return 0;
+}
+
+/**
+ * Termina --profile: informa en stderr lo más costoso y escribe las pilas.
+ * Tiene que llamarse con el AST evaluado todavía vivo; libera el perfil.
+ * @param op Opciones (op->perfil es el archivo de las pilas, '-' = ctx->salida).
+ * @param ctx Contexto con el perfil de la evaluación.
+ */
+static void informar_perfil(const Opciones *op, CompilerContext *ctx) {
+    perfil_informe(ctx->perfil, stderr);
+    int a_salida = strcmp(op->perfil, "-") == 0;
+    FILE *f = a_salida ? ctx->salida : fopen(op->perfil, "w");
+    if (!f) {
+        perror(op->perfil);
+    } else {
+        int error = perfil_escribir_pilas(ctx->perfil, f);
+        if (!a_salida && fclose(f) != 0) error = -1;
+        if (error) fprintf(stderr, "Error: no se pudieron escribir las pilas en '%s'\n", op->perfil);
+        else if (!a_salida) fprintf(stderr, "Pilas del perfil escritas en '%s'\n", op->perfil);
+    }
+    perfil_destruir(ctx->perfil);
+    ctx->perfil = NULL;
+}
+
+/**
+ * Compila una entrada ejecutando las fases pedidas sobre el contexto dado.
+ * Todo lo que se imprime va a ctx->salida y ctx->errores. Con --cache, si
+ * sólo se pidieron fases cuyo resultado se guarda (seudo-assembly, resultado
+ * y tabla de símbolos) y ya están en la caché, no se ejecuta ninguna.
+ * @param op Fases a ejecutar.
+ * @param ctx Contexto de esta compilación.
+ * @param entrada Archivo fuente ya abierto.
+ * @param salida_asm Archivo de seudo-assembly ("-" para ctx->salida).
+ * @param base_dot Nombre base de la exportación DOT.
+ * @return 0 si compiló, 1 si hubo un error (ya informado; queda en ctx->error).
+ */
+static int compilar(const Opciones *op, CompilerContext *ctx, FILE *entrada,
+                    const char *salida_asm, const char *base_dot) {
+    Estadisticas *st = &ctx->stats;
+    if (op->stream) return compilar_en_flujo(op, ctx, entrada, salida_asm);
+
+    /* Con --cache: primero el resultado entero, después el AST */
+    uint64_t hash = 0, clave = 0, largo_fuente = 0;
+    int guardar = 0;
+    ResultadoCache res;
+    char *texto_asm = NULL, *texto_simbolos = NULL;
+    memset(&res, 0, sizeof(res));
+    double t0 = stats_reloj();
+    if (op->cache) {
+        if (contexto_cargar_fuente(ctx, entrada) != 0) return 1;
+        hash = plano_hash(ctx->fuente, ctx->largo_fuente);
+        largo_fuente = ctx->largo_fuente;
+        if (!op->print_ast && !op->emit_dot && !op->perfil && !op->especializado) {
+            char opciones[64];
+            snprintf(opciones, sizeof(opciones), "asm=%d eval=%d simbolos=%d",
+                     op->emit_asm, op->eval, op->print_symbols);
+            clave = cache_clave(hash, opciones);
+            if (usar_resultado(op, ctx, clave, salida_asm) == 0) {
+                contexto_liberar_fuente(ctx);
+                st->tiempo[FASE_SINTAXIS] = stats_reloj() - t0;
+                return contexto_fallo(ctx);
+            }
+            guardar = 1;
+        }
+    }
+
+    /* Análisis léxico y sintáctico: sólo construye el AST */
+    Nodo *ast = NULL;
+    AstPlano plano;
+    int en_cache = 0;
+    int error = op->cache ? parsear_con_cache(op, ctx, entrada, hash, &plano, &en_cache, &ast)
+                          : parsear(op, ctx, entrada, &ast);
+    st->tiempo[FASE_SINTAXIS] = stats_reloj() - t0 - st->tiempo[FASE_LEXICO];
+    if (error) return 1;
+
+    /* Evaluar alcanza con el AST plano; las demás fases, y el perfil, recorren los Nodo */
+    if (en_cache && (op->print_ast || op->emit_dot || op->emit_asm || op->perfil || op->especializado)) {
+        ast = plano_a_ast(ctx, &plano);
+        plano_cerrar(&plano);
+        en_cache = 0;
+        if (contexto_fallo(ctx)) return 1;
+    }
+
+    if (op->print_ast) {
+        t0 = stats_reloj();
+        fprintf(ctx->salida, "Árbol Sintáctico Abstracto (AST):\n");
+        fprintf(ctx->salida, "----------------------------------------\n");
+        if (ast) imprimir_nodo(ctx, ast, 0);
+        else fprintf(ctx->salida, "(AST vacío)\n");
+        fprintf(ctx->salida, "\n");
+        st->tiempo[FASE_IMPRESION] += stats_reloj() - t0;
+    }
+
+    if (op->emit_dot) {
+        t0 = stats_reloj();
+        exportar_dot(ctx, ast, base_dot, &op->grafo);
+        st->tiempo[FASE_DOT] = stats_reloj() - t0;
+    }
+
+    if (op->emit_asm && guardar) {
+        /* Se genera en memoria para poder guardarlo además de escribirlo */
+        t0 = stats_reloj();
+        FILE *mem = abrir_memoria(ctx, &texto_asm, &res.largo_asm);
+        if (mem) {
+            Emisor *e = generar_asm_inicio(ctx, mem);
+            if (ast) generar_asm_sentencia(e, ast);
+            generar_asm_fin(e);
+            fclose(mem);
+            escribir_asm(ctx, salida_asm, texto_asm, res.largo_asm);
+        }
+        st->tiempo[FASE_ASM] = stats_reloj() - t0;
+    } else if (op->emit_asm) {
+        int a_salida = strcmp(salida_asm, "-") == 0;
+        t0 = stats_reloj();
+        generar_asm(ctx, ast, a_salida ? NULL : salida_asm);
+        st->tiempo[FASE_ASM] = stats_reloj() - t0;
+        if (!a_salida && !contexto_fallo(ctx)) fprintf(ctx->salida, "Seudo-assembly escrito en '%s'\n", salida_asm);
+    }
+
+    if (op->eval || op->print_symbols) {
+        if (op->perfil && !(ctx->perfil = perfil_crear()))
+            contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para el perfil");
+        t0 = stats_reloj();
+        if (!contexto_fallo(ctx)) res.resultado = en_cache ? eval_plano(ctx, &plano) : evaluar(op, ctx, ast);
+        st->tiempo[FASE_EVAL] = stats_reloj() - t0;
+        if (op->print_symbols && !contexto_fallo(ctx)) {
+            t0 = stats_reloj();
+            FILE *mem;
+            if (guardar && (mem = abrir_memoria(ctx, &texto_simbolos, &res.largo_simbolos))) {
+                FILE *salida = ctx->salida;
+                ctx->salida = mem;
+                imprimir_tabla_simbolos(ctx);
+                fclose(mem);
+                ctx->salida = salida;
+                fwrite(texto_simbolos, 1, res.largo_simbolos, ctx->salida);
+            } else if (!guardar) {
+                imprimir_tabla_simbolos(ctx);
+            }
+            st->tiempo[FASE_IMPRESION] += stats_reloj() - t0;
+        }
+        if (op->eval && !contexto_fallo(ctx)) fprintf(ctx->salida, "Resultado: %d\n", res.resultado);
+        if (ctx->perfil) informar_perfil(op, ctx);
+    }
+
+    if (guardar && !contexto_fallo(ctx)) {
+        char ruta[PATH_MAX];
+        res.asm_texto = texto_asm;
+        res.simbolos = texto_simbolos;
+        cache_ruta(ruta, sizeof(ruta), op->cache, clave, ".res");
+        if (cache_guardar(op->cache, clave, largo_fuente, &res) != 0)
+            fprintf(ctx->errores, "Aviso: no se pudo escribir '%s' en la caché\n", ruta);
+        else
+            anotar_en_cache(op, ctx, ruta);
+    }
+    free(texto_asm);
+    free(texto_simbolos);
+
+    if (en_cache) plano_cerrar(&plano);
+    nodo_libre(ctx, ast);
+    return contexto_fallo(ctx);
+}
+
+/**
+ * Compara dos rutas para qsort.
+ * @param a Puntero a la primera ruta.
+ * @param b Puntero a la segunda ruta.
+ * @return Resultado de strcmp.
+ */
+static int comparar_rutas(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/**
+ * Lista los archivos .txt de un directorio, ordenados por nombre para que la
+ * salida de --batch no dependa del orden de readdir.
+ * @param dir Directorio.
+ * @param n Cantidad de archivos encontrados.
+ * @return Arreglo de rutas (dir/nombre), o NULL si no se pudo abrir o no hubo
+ *         memoria (errno dice cuál).
+ */
+static char **listar_fuentes(const char *dir, int *n) {
+    DIR *d = opendir(dir);
+    if (!d) return NULL;
+
+    int cap = 16;
+    char **rutas = malloc(cap * sizeof(char *));
+    *n = 0;
+    if (!rutas) {
+        closedir(d);
+        return NULL;
+    }
+
+    struct dirent *e;
+    while ((e = readdir(d)) != NULL) {
+        size_t largo = strlen(e->d_name);
+        if (largo <= 4 || strcmp(e->d_name + largo - 4, ".txt") != 0) continue;
+
+        char *ruta = malloc(strlen(dir) + largo + 2);
+        if (!ruta) break;
+        sprintf(ruta, "%s/%s", dir, e->d_name);
+        struct stat sb;
+        if (stat(ruta, &sb) != 0 || !S_ISREG(sb.st_mode)) {
+            free(ruta);
+            continue;
+        }
+        if (*n == cap) {
+            char **mas = realloc(rutas, cap * 2 * sizeof(char *));
+            if (!mas) {
+                free(ruta);
+                break;
+            }
+            rutas = mas;
+            cap *= 2;
+        }
+        rutas[(*n)++] = ruta;
+    }
+    closedir(d);
+    if (e) {
+        /* Se cortó por falta de memoria: un lote a medias no sirve */
+        for (int i = 0; i < *n; ++i) free(rutas[i]);
+        free(rutas);
+        errno = ENOMEM;
+        return NULL;
+    }
+    qsort(rutas, *n, sizeof(char *), comparar_rutas);
+    return rutas;
+}
+
+/**
+ * Tarea de --batch: compila un archivo con su propio contexto. La salida y
+ * los errores se juntan en memoria y se imprimen después, en orden de entrada.
+ * @param tarea Índice del archivo.
+ * @param hilo Hilo que la ejecuta (no se usa).
+ * @param arg Lote.
+ */
+static void compilar_archivo(int tarea, int hilo, void *arg) {
+    (void)hilo;
+    Lote *lote = arg;
+    Trabajo *t = &lote->trabajos[tarea];
+
+    FILE *salida = open_memstream(&t->salida, &t->largo_salida);
+    FILE *errores = open_memstream(&t->errores, &t->largo_errores);
+
+    /* El .sasm y el .dot quedan junto a la fuente: dir/x.txt -> dir/x.sasm */
+    size_t largo = strlen(t->ruta) - 4;
+    char *base = malloc(largo + sizeof(".sasm"));
+    char *salida_asm = NULL;
+    if (base) {
+        memcpy(base, t->ruta, largo);
+        strcpy(base + largo, ".sasm");
+        salida_asm = strdup(base);
+        base[largo] = '\0';
+    }
+
+    FILE *entrada = NULL;
+    CompilerContext *ctx;
+    if (!salida || !errores || !salida_asm) {
+        /* No hay dónde juntar los mensajes: compilar_lote informa el error */
+        t->sin_memoria = 1;
+        t->error = 1;
+    } else if (!(entrada = fopen(t->ruta, "r"))) {
+        fprintf(errores, "%s: no se pudo abrir\n", t->ruta);
+        t->error = 1;
+    } else if (!(ctx = contexto_crear(salida))) {
+        fprintf(errores, "%s: sin memoria para el contexto\n", t->ruta);
+        t->error = 1;
+        fclose(entrada);
+    } else {
+        ctx->errores = errores;
+        ctx->lexer = lote->op->lexer;
+        ctx->parser = lote->op->parser;
+        t->error = compilar(lote->op, ctx, entrada, salida_asm, base);
+        t->stats = ctx->stats;
+        contexto_destruir(ctx);
+        fclose(entrada);
+    }
+
+    if (salida) fclose(salida);
+    if (errores) fclose(errores);
+    free(salida_asm);
+    free(base);
+}
+
+/**
+ * Modo --batch: compila todos los archivos de un directorio en un grupo de
+ * hilos con robo de trabajo. Cada archivo tiene su propio CompilerContext.
+ * @param op Opciones (op->batch es el directorio, op->hilos los hilos).
+ * @return EXIT_SUCCESS si compilaron todos.
+ */
+static int compilar_lote(const Opciones *op) {
+    int n;
+    char **rutas = listar_fuentes(op->batch, &n);
+    if (!rutas) {
+        perror(op->batch);
+        return EXIT_FAILURE;
+    }
+
+    Trabajo *trabajos = calloc(n + 1, sizeof(Trabajo));
+    ResumenHilo *resumen = calloc(op->hilos, sizeof(ResumenHilo));
+    if (!trabajos || !resumen) {
+        perror("calloc");
+        for (int i = 0; i < n; ++i) free(rutas[i]);
+        free(rutas);
+        free(trabajos);
+        free(resumen);
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < n; ++i) trabajos[i].ruta = rutas[i];
+
+    Lote lote = { op, trabajos };
+    double t0 = stats_reloj();
+    planificador_ejecutar(n, op->hilos, compilar_archivo, &lote, resumen);
+    double total = stats_reloj() - t0;
+
+    /* Resultados en el orden de entrada, sin importar qué hilo terminó antes */
+    int fallidos = 0;
+    Estadisticas acumuladas;
+    memset(&acumuladas, 0, sizeof(acumuladas));
+    for (int i = 0; i < n; ++i) {
+        Trabajo *t = &trabajos[i];
+        printf("== %s ==\n", t->ruta);
+        fwrite(t->salida, 1, t->largo_salida, stdout);
+        fflush(stdout);
+        fwrite(t->errores, 1, t->largo_errores, stderr);
+        if (t->sin_memoria) fprintf(stderr, "%s: sin memoria para compilarlo\n", t->ruta);
+        fallidos += t->error;
+        stats_acumular(&acumuladas, &t->stats);
+        free(t->salida);
+        free(t->errores);
+        free(t->ruta);
+    }
+
+    fprintf(stderr, "batch: %d archivos, %d con errores, %d hilos, %.3f ms\n",
+            n, fallidos, op->hilos, total * 1e3);
+    if (op->stats) {
+        for (int h = 0; h < op->hilos; ++h) {
+            fprintf(stderr, "  hilo %-3d %6d tareas %6d robadas %12.3f ms ocupado\n",
+                    h, resumen[h].tareas, resumen[h].robos, resumen[h].ocupado * 1e3);
+        }
+        if (op->stats == 1) stats_imprimir(&acumuladas, stderr);
+        else stats_imprimir_json(&acumuladas, stderr);
+    }
+
+    free(resumen);
+    free(trabajos);
+    free(rutas);
+    return fallidos ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+ * Toma las fases de un pedido de --serve: una lista separada por comas de
+ * eval, asm, simbolos y ast. Las demás fases y el perfil nunca corren en
+ * un pedido: escribirían archivos y lanzarían procesos en el servidor.
+ * @param fases Texto del pedido.
+ * @param op Opciones donde marcarlas.
+ * @return 0 si todas eran conocidas, -1 si no.
+ */
+static int leer_fases(const char *fases, Opciones *op) {
+    op->eval = op->emit_asm = op->print_symbols = op->print_ast = 0;
+    op->emit_dot = 0;
+    op->perfil = NULL;
+    const char *p = fases;
+    while (*p) {
+        size_t largo = strcspn(p, ",");
+        if (largo == 4 && strncmp(p, "eval", 4) == 0) op->eval = 1;
+        else if (largo == 3 && strncmp(p, "asm", 3) == 0) op->emit_asm = 1;
+        else if (largo == 8 && strncmp(p, "simbolos", 8) == 0) op->print_symbols = 1;
+        else if (largo == 3 && strncmp(p, "ast", 3) == 0) op->print_ast = 1;
+        else return -1;
+        p += largo;
+        if (*p == ',') p++;
+    }
+    return 0;
+}
+
+/**
+ * Atiende un pedido de --serve con el contexto del servicio: las fases
+ * escriben en la salida del pedido (el seudo-assembly también) y un error
+ * sintáctico o de ejecución se devuelve como respuesta, sin terminar el
+ * proceso. Al final el contexto queda reiniciado para el próximo pedido.
+ * @param fases Fases pedidas.
+ * @param fuente Texto del programa, seguido de dos NUL.
+ * @param largo Largo del fuente.
+ * @param salida Cuerpo de la respuesta.
+ * @param errores Diagnósticos.
+ * @param arg El Servicio.
+ * @return 0 si compiló, 1 si hubo un error.
+ */
+static int servir_pedido(const char *fases, char *fuente, size_t largo,
+                         FILE *salida, FILE *errores, void *arg) {
+    Servicio *sv = arg;
+    CompilerContext *ctx = sv->ctx;
+    Opciones op = *sv->op;
+    if (leer_fases(fases, &op) != 0) {
+        fprintf(errores, "Error: fases desconocidas '%s'\n", fases);
+        return 1;
+    }
+
+    ctx->salida = salida;
+    ctx->errores = errores;
+    contexto_prestar_fuente(ctx, fuente, largo);
+    int error = compilar(&op, ctx, NULL, "-", DOT_POR_DEFECTO);
+    contexto_reiniciar(ctx);
+    return error;
+}
+
+/**
+ * Atiende --serve hasta recibir SIGINT o SIGTERM.
+ * @param op Opciones (lexer y parser de todos los pedidos).
+ * @return Código de salida del proceso.
+ */
+static int servir(const Opciones *op) {
+    Servicio sv = { op, contexto_crear(NULL) };
+    if (!sv.ctx) {
+        fprintf(stderr, "Error: sin memoria para el contexto\n");
+        return EXIT_FAILURE;
+    }
+    sv.ctx->lexer = op->lexer;
+    sv.ctx->parser = op->parser;
+    int error = servidor_ejecutar(op->serve, servir_pedido, &sv);
+    contexto_destruir(sv.ctx);
+    return error ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+    Opciones op;
+
+    if (leer_opciones(argc, argv, &op) != 0) {
+        uso(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    OcupacionCache ocupacion;
+    if (op.cache) {
+        if (mkdir(op.cache, 0777) != 0 && errno != EEXIST) {
+            perror(op.cache);
+            return EXIT_FAILURE;
+        }
+        cache_ocupacion_iniciar(&ocupacion, op.cache, (uint64_t)op.cache_max << 20);
+        op.ocupacion = &ocupacion;
+    }
+
+    if (op.batch) {
+        int estado = compilar_lote(&op);
+        if (op.cache) cache_ocupacion_destruir(&ocupacion);
+        return estado;
+    }
+    if (op.serve) return servir(&op);
+
+    FILE *entrada = stdin;
+    if (op.entrada) {
+        entrada = fopen(op.entrada, "r");
+        if (!entrada) {
+            perror(op.entrada);
+            return EXIT_FAILURE;
+        }
+    }
+
+    CompilerContext *ctx = contexto_crear(stdout);
+    if (!ctx) {
+        fprintf(stderr, "Error: sin memoria para el contexto\n");
+        if (op.entrada) fclose(entrada);
+        return EXIT_FAILURE;
+    }
+    ctx->lexer = op.lexer;
+    ctx->hilos_lexico = op.hilos;
+    if (op.hilos > 1) ctx->lexear = tokens_lexear_paralelo;
+    ctx->parser = op.parser;
+    int error = compilar(&op, ctx, entrada, op.salida_asm, DOT_POR_DEFECTO);
+    if (op.entrada) fclose(entrada);
+
+    if (!error && op.stats == 1) stats_imprimir(&ctx->stats, stderr);
+    else if (!error && op.stats == 2) stats_imprimir_json(&ctx->stats, stderr);
+    contexto_destruir(ctx);
+    if (op.cache) cache_ocupacion_destruir(&ocupacion);
+    return error ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,402 @@
+/* Compilación del AST a cierres especializados y su ejecución */
+
+/* Definiciones necesarias para compatibilidad POSIX */
+#define _POSIX_C_SOURCE 200809L
+
+/* Inclusiones de bibliotecas estándar */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cierres.h"
+
+/* ------------------ Funciones especializadas ------------------ */
+
+/* Formas que puede tener un operando */
+enum { FORMA_SLOT, FORMA_CONST, FORMA_EXPR, NUM_FORMAS };
+
+/* Lectura de un operando según su forma (campo: a/b, sub: izq/der) */
+#define OPERANDO_slot(c, m, campo, sub)  ((m)[(c)->campo])
+#define OPERANDO_const(c, m, campo, sub) ((c)->campo)
+#define OPERANDO_expr(c, m, campo, sub)  ((c)->sub->fn((c)->sub, (m)))
+
+/**
+ * División entera con el mismo control que eval_nodo.
+ */
+static inline int dividir(int x, int y) {
+    if (y == 0) {
+        fprintf(stderr, "Error: división por cero\n");
+        exit(EXIT_FAILURE);
+    }
+    if (y == -1) return (int)(0u - (unsigned)x);   /* INT_MIN / -1 da INT_MIN */
+    return x / y;
+}
+
+/* Operaciones binarias; como en eval_nodo, && y || evalúan ambos lados */
+#define APLICAR_add(x, y) ((x) + (y))
+#define APLICAR_sub(x, y) ((x) - (y))
+#define APLICAR_mul(x, y) ((x) * (y))
+#define APLICAR_div(x, y) dividir((x), (y))
+#define APLICAR_eq(x, y)  ((x) == (y))
+#define APLICAR_or(x, y)  (((x) != 0) || ((y) != 0))
+#define APLICAR_and(x, y) (((x) != 0) && ((y) != 0))
+#define APLICAR_gt(x, y)  ((x) > (y))
+#define APLICAR_lt(x, y)  ((x) < (y))
+
+/* Define una función por operación y forma de operandos, p. ej. add_slot_const */
+#define DEF_OP(op, fa, fb)                                                  \
+    static int op##_##fa##_##fb(const Cierre *c, int *m) {                 \
+        int x = OPERANDO_##fa(c, m, a, izq);                               \
+        int y = OPERANDO_##fb(c, m, b, der);                               \
+        (void)m;                                                           \
+        return APLICAR_##op(x, y);                                         \
+    }
+
+#define DEF_OP_FORMAS(op)                                                   \
+    DEF_OP(op, slot, slot)  DEF_OP(op, slot, const)  DEF_OP(op, slot, expr)  \
+    DEF_OP(op, const, slot) DEF_OP(op, const, const) DEF_OP(op, const, expr) \
+    DEF_OP(op, expr, slot)  DEF_OP(op, expr, const)  DEF_OP(op, expr, expr)
+
+DEF_OP_FORMAS(add)
+DEF_OP_FORMAS(sub)
+DEF_OP_FORMAS(mul)
+DEF_OP_FORMAS(div)
+DEF_OP_FORMAS(eq)
+DEF_OP_FORMAS(or)
+DEF_OP_FORMAS(and)
+DEF_OP_FORMAS(gt)
+DEF_OP_FORMAS(lt)
+
+/* Tabla [forma izq][forma der] de las funciones de una operación */
+#define FORMAS(op) {                                                        \
+    { op##_slot_slot,  op##_slot_const,  op##_slot_expr  },                 \
+    { op##_const_slot, op##_const_const, op##_const_expr },                 \
+    { op##_expr_slot,  op##_expr_const,  op##_expr_expr  } }
+
+static const FnCierre fn_op[][NUM_FORMAS][NUM_FORMAS] = {
+    [TOP_SUMA]  = FORMAS(add),
+    [TOP_RESTA] = FORMAS(sub),
+    [TOP_MULT]  = FORMAS(mul),
+    [TOP_DIV]   = FORMAS(div),
+    [TOP_IGUAL] = FORMAS(eq),
+    [TOP_OR]    = FORMAS(or),
+    [TOP_AND]   = FORMAS(and),
+    [TOP_MAYOR] = FORMAS(gt),
+    [TOP_MENOR] = FORMAS(lt),
+};
+
+/* Hojas */
+static int cte(const Cierre *c, int *m) { (void)m; return c->a; }
+static int var(const Cierre *c, int *m) { return m[c->a]; }
+
+/* Secuencia: ejecuta la sentencia y devuelve el valor del resto */
+static int seq(const Cierre *c, int *m) {
+    c->izq->fn(c->izq, m);
+    return c->der->fn(c->der, m);
+}
+
+/* Declaración sin valor inicial */
+static int decl_slot(const Cierre *c, int *m) {
+    m[c->a] = 0;
+    return 0;
+}
+
+/* Declaraciones y asignaciones según la forma del valor */
+#define DEF_DECL(fb)                                                        \
+    static int decl_slot_##fb(const Cierre *c, int *m) {                   \
+        m[c->a] = OPERANDO_##fb(c, m, b, der);                             \
+        return 0;                                                          \
+    }
+#define DEF_ASSIGN(fb)                                                      \
+    static int assign_slot_##fb(const Cierre *c, int *m) {                 \
+        return m[c->a] = OPERANDO_##fb(c, m, b, der);                      \
+    }
+
+DEF_DECL(slot)   DEF_DECL(const)   DEF_DECL(expr)
+DEF_ASSIGN(slot) DEF_ASSIGN(const) DEF_ASSIGN(expr)
+
+static const FnCierre fn_decl[NUM_FORMAS] = { decl_slot_slot, decl_slot_const, decl_slot_expr };
+static const FnCierre fn_assign[NUM_FORMAS] = { assign_slot_slot, assign_slot_const, assign_slot_expr };
+
+/* ------------------ Compilación ------------------ */
+
+/* Estado de la compilación: tabla de símbolos resuelta a slots */
+typedef struct {
+    ProgramaCierres *p;
+    unsigned char *inicializada;    /* Por slot: ya tiene valor en este punto */
+    int cap_vars;
+} Compilador;
+
+/**
+ * Cuenta los nodos del AST; es una cota del número de cierres.
+ * @param n Nodo raíz.
+ * @return Cantidad de nodos.
+ */
+static int contar_nodos(Nodo *n) {
+    if (!n) return 0;
+    switch (n->tipo) {
+        case NODO_SEQ:
+        case NODO_OP:
+        case NODO_OP_RAPIDO:
+            return 1 + contar_nodos(n->opBinaria.izq) + contar_nodos(n->opBinaria.der);
+        case NODO_ASSIGN:
+        case NODO_DECL:
+            return 1 + contar_nodos(n->assign.expr);
+        case NODO_RETURN:
+            return 1 + contar_nodos(n->ret_expr);
+        default:
+            return 1;
+    }
+}
+
+/**
+ * Reserva un cierre nuevo dentro del bloque del programa.
+ * @param k Compilador.
+ * @param fn Función especializada.
+ * @return Puntero al cierre.
+ */
+static Cierre *nuevo_cierre(Compilador *k, FnCierre fn) {
+    Cierre *c = &k->p->cierres[k->p->n++];
+    c->fn = fn;
+    c->izq = c->der = NULL;
+    c->a = c->b = 0;
+    return c;
+}
+
+/**
+ * Busca el slot de una variable en tiempo de compilación.
+ * @param k Compilador.
+ * @param id Nombre.
+ * @return Slot o -1 si no fue declarada.
+ */
+static int buscar_slot(Compilador *k, const char *id) {
+    for (int i = 0; i < k->p->n_vars; ++i) {
+        if (strcmp(k->p->vars[i], id) == 0) return i;
+    }
+    return -1;
+}
+
+/**
+ * Declara una variable y le asigna un slot nuevo.
+ * @param k Compilador.
+ * @param id Nombre.
+ * @return Slot asignado.
+ */
+static int declarar_slot(Compilador *k, const char *id) {
+    if (buscar_slot(k, id) >= 0) {
+        fprintf(stderr, "Error: variable '%s' ya declarada\n", id);
+        exit(EXIT_FAILURE);
+    }
+    ProgramaCierres *p = k->p;
+    if (p->n_vars == k->cap_vars) {
+        k->cap_vars = k->cap_vars ? k->cap_vars * 2 : 16;
+        p->vars = realloc(p->vars, k->cap_vars * sizeof(char *));
+        k->inicializada = realloc(k->inicializada, k->cap_vars);
+        if (!p->vars || !k->inicializada) {
+            perror("realloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+    p->vars[p->n_vars] = strdup(id);
+    k->inicializada[p->n_vars] = 0;
+    return p->n_vars++;
+}
+
+/**
+ * Resuelve el uso de una variable. Como el lenguaje no tiene saltos, los
+ * controles que eval_nodo hace en cada ejecución se hacen aquí una sola vez.
+ * @param k Compilador.
+ * @param id Nombre.
+ * @return Slot de la variable.
+ */
+static int usar_slot(Compilador *k, const char *id) {
+    int s = buscar_slot(k, id);
+    if (s < 0) {
+        fprintf(stderr, "Error: variable '%s' no declarada\n", id);
+        exit(EXIT_FAILURE);
+    }
+    if (!k->inicializada[s]) {
+        fprintf(stderr, "Error: variable '%s' usada sin inicializar\n", id);
+        exit(EXIT_FAILURE);
+    }
+    return s;
+}
+
+static const Cierre *compilar_stmt(Compilador *k, Nodo *n);
+static const Cierre *compilar_expr(Compilador *k, Nodo *n);
+
+/**
+ * Clasifica un operando: constante, variable o subexpresión compilada.
+ * @param k Compilador.
+ * @param n Nodo del operando.
+ * @param valor Constante o slot, según la forma.
+ * @param sub Cierre de la subexpresión si la forma es FORMA_EXPR.
+ * @return Forma del operando.
+ */
+static int compilar_operando(Compilador *k, Nodo *n, int *valor, const Cierre **sub) {
+    *sub = NULL;
+    if (!n) {
+        *valor = 0;
+        return FORMA_CONST;
+    }
+    switch (n->tipo) {
+        case NODO_INT:
+            *valor = n->val_int;
+            return FORMA_CONST;
+        case NODO_BOOL:
+            *valor = n->val_bool ? 1 : 0;
+            return FORMA_CONST;
+        case NODO_ID:
+            *valor = usar_slot(k, n->nombre);
+            return FORMA_SLOT;
+        default:
+            *sub = compilar_expr(k, n);
+            return FORMA_EXPR;
+    }
+}
+
+/**
+ * Compila una expresión a un cierre.
+ * @param k Compilador.
+ * @param n Nodo de la expresión.
+ * @return Cierre que devuelve su valor.
+ */
+static const Cierre *compilar_expr(Compilador *k, Nodo *n) {
+    if (n && (n->tipo == NODO_OP || n->tipo == NODO_OP_RAPIDO)) {
+        if (n->opBinaria.op == TOP_ASSIGN || n->opBinaria.op > TOP_MENOR) {
+            fprintf(stderr, "Error: operación binaria desconocida %d\n", n->opBinaria.op);
+            exit(EXIT_FAILURE);
+        }
+        int a, b;
+        const Cierre *izq, *der;
+        int fa = compilar_operando(k, n->opBinaria.izq, &a, &izq);
+        int fb = compilar_operando(k, n->opBinaria.der, &b, &der);
+        Cierre *c = nuevo_cierre(k, fn_op[n->opBinaria.op][fa][fb]);
+        c->a = a;
+        c->b = b;
+        c->izq = izq;
+        c->der = der;
+        return c;
+    }
+
+    int valor;
+    const Cierre *sub;
+    switch (compilar_operando(k, n, &valor, &sub)) {
+        case FORMA_CONST: {
+            Cierre *c = nuevo_cierre(k, cte);
+            c->a = valor;
+            return c;
+        }
+        case FORMA_SLOT: {
+            Cierre *c = nuevo_cierre(k, var);
+            c->a = valor;
+            return c;
+        }
+        default:
+            return compilar_stmt(k, n);
+    }
+}
+
+/**
+ * Compila una sentencia o secuencia a un cierre.
+ * @param k Compilador.
+ * @param n Nodo de la sentencia.
+ * @return Cierre, o NULL si no hay nada que ejecutar.
+ */
+static const Cierre *compilar_stmt(Compilador *k, Nodo *n) {
+    if (!n) return NULL;
+
+    switch (n->tipo) {
+        case NODO_SEQ: {
+            const Cierre *izq = compilar_stmt(k, n->opBinaria.izq);
+            /* Lo que sigue a un return nunca se ejecuta */
+            if (n->opBinaria.izq && n->opBinaria.izq->tipo == NODO_RETURN) return izq;
+            const Cierre *der = compilar_stmt(k, n->opBinaria.der);
+            if (!izq || !der) return izq ? izq : der;
+            Cierre *c = nuevo_cierre(k, seq);
+            c->izq = izq;
+            c->der = der;
+            return c;
+        }
+        case NODO_DECL: {
+            int b = 0, forma = -1;
+            const Cierre *der = NULL;
+            if (n->assign.expr) forma = compilar_operando(k, n->assign.expr, &b, &der);
+            int slot = declarar_slot(k, n->assign.id);
+            Cierre *c = nuevo_cierre(k, forma < 0 ? decl_slot : fn_decl[forma]);
+            k->inicializada[slot] = forma >= 0;
+            c->a = slot;
+            c->b = b;
+            c->der = der;
+            return c;
+        }
+        case NODO_ASSIGN: {
+            int b;
+            const Cierre *der;
+            int forma = compilar_operando(k, n->assign.expr, &b, &der);
+            int slot = buscar_slot(k, n->assign.id);
+            if (slot < 0) {
+                fprintf(stderr, "Error: asignación a variable no declarada '%s'\n", n->assign.id);
+                exit(EXIT_FAILURE);
+            }
+            k->inicializada[slot] = 1;
+            Cierre *c = nuevo_cierre(k, fn_assign[forma]);
+            c->a = slot;
+            c->b = b;
+            c->der = der;
+            return c;
+        }
+        case NODO_RETURN:
+            /* El corte de la secuencia se resolvió al compilar */
+            return compilar_expr(k, n->ret_expr);
+        case NODO_OP:
+        case NODO_OP_RAPIDO:
+        case NODO_INT:
+        case NODO_BOOL:
+        case NODO_ID:
+            return compilar_expr(k, n);
+        default:
+            fprintf(stderr, "Error: cierres_compilar no soporta tipo de nodo %d\n", n->tipo);
+            exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * Traduce el AST de un programa a un árbol de cierres. Los errores de
+ * variables (no declaradas, sin inicializar, redeclaradas) se detectan aquí.
+ * @param programa Raíz del AST.
+ * @param p Programa compilado (se sobrescribe).
+ */
+void cierres_compilar(Nodo *programa, ProgramaCierres *p) {
+    memset(p, 0, sizeof(*p));
+    p->cierres = malloc((contar_nodos(programa) + 1) * sizeof(Cierre));
+    if (!p->cierres) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    Compilador k = { p, NULL, 0 };
+    p->raiz = compilar_stmt(&k, programa);
+    free(k.inicializada);
+}
+
+/**
+ * Ejecuta un programa compilado.
+ * @param p Programa.
+ * @param marco Arreglo de al menos p->n_vars enteros provisto por el llamador.
+ * @return Resultado del programa, igual al de eval_nodo.
+ */
+int cierres_ejecutar(const ProgramaCierres *p, int *marco) {
+    if (!p->raiz) return 0;
+    return p->raiz->fn(p->raiz, marco);
+}
+
+/**
+ * Libera la memoria de un programa compilado.
+ * @param p Programa.
+ */
+void cierres_liberar(ProgramaCierres *p) {
+    free(p->cierres);
+    for (int i = 0; i < p->n_vars; ++i) free(p->vars[i]);
+    free(p->vars);
+    memset(p, 0, sizeof(*p));
+}
@@ -0,0 +1,45 @@
+#ifndef CIERRES_H
+#define CIERRES_H
+
+#include "ast.h"
+
+/* ------------------ Motor de ejecución por cierres ------------------ */
+
+/*
+ * El AST se traduce una sola vez a un árbol de cierres: cada nodo guarda un
+ * puntero a una función especializada para su operación y la forma de sus
+ * operandos (slot de variable, constante o subexpresión), con las variables ya
+ * resueltas a índices del marco. Ejecutar es encadenar llamadas indirectas,
+ * sin volver a despachar sobre n->tipo ni n->opBinaria.op.
+ */
+
+typedef struct Cierre Cierre;
+
+/* Función que ejecuta un cierre sobre el marco de variables */
+typedef int (*FnCierre)(const Cierre *c, int *marco);
+
+/* Cierre: función especializada más sus operandos ya resueltos */
+struct Cierre {
+    FnCierre fn;
+    const Cierre *izq;              /* Subexpresión izquierda (o sentencia) */
+    const Cierre *der;              /* Subexpresión derecha (o resto) */
+    int a;                          /* Slot o constante del primer operando */
+    int b;                          /* Slot o constante del segundo operando */
+};
+
+/* Programa compilado a cierres */
+typedef struct {
+    Cierre *cierres;                /* Todos los cierres en un único bloque */
+    int n;                          /* Cierres usados */
+    const Cierre *raiz;             /* Punto de entrada (NULL si está vacío) */
+    char **vars;                    /* Nombre de cada slot del marco */
+    int n_vars;                     /* Tamaño del marco */
+} ProgramaCierres;
+
+/* ------------------ Prototipos de funciones ------------------ */
+
+void cierres_compilar(Nodo *programa, ProgramaCierres *p);
+int cierres_ejecutar(const ProgramaCierres *p, int *marco); /* marco de n_vars ints */
+void cierres_liberar(ProgramaCierres *p);
+
+#endif /* CIERRES_H */
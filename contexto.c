@@ -0,0 +1,232 @@
+/* Creación y destrucción del contexto de compilación */
+
+/* Definiciones necesarias para compatibilidad POSIX */
+#define _DEFAULT_SOURCE
+
+/* Inclusiones de bibliotecas estándar */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "contexto.h"
+
+/* Tamaño inicial del buffer cuando la entrada no se puede mapear */
+#define FUENTE_INICIAL 65536
+
+/**
+ * Deja un contexto recién reservado con los valores por defecto.
+ * @param ctx Contexto en cero (calloc).
+ * @param salida Archivo para las impresiones del compilador (NULL = stdout).
+ */
+void contexto_inicializar(CompilerContext *ctx, FILE *salida) {
+    ctx->salida = salida ? salida : stdout;
+    ctx->errores = stderr;
+    ctx->lexer = LEXER_POR_DEFECTO;
+    ctx->hilos_lexico = 1;
+}
+
+/**
+ * Crea un contexto vacío: tabla de símbolos, contadores y estadísticas en cero.
+ * @param salida Archivo para las impresiones del compilador (NULL = stdout).
+ * @return Contexto nuevo, o NULL si no hubo memoria.
+ */
+CompilerContext *contexto_crear(FILE *salida) {
+    CompilerContext *ctx = calloc(1, sizeof(CompilerContext));
+    if (!ctx) return NULL;
+    contexto_inicializar(ctx, salida);
+    return ctx;
+}
+
+/**
+ * Libera el contexto y los símbolos que todavía tenga.
+ * @param ctx Contexto a destruir.
+ */
+void contexto_destruir(CompilerContext *ctx) {
+    if (!ctx) return;
+    contexto_liberar_fuente(ctx);
+    ast_liberar_recursos(ctx);
+    free(ctx);
+}
+
+/**
+ * Vacía la tabla de símbolos, los contadores y las estadísticas para reusar el
+ * contexto en otra compilación. Se conservan la salida, los errores y el
+ * lexer y parser elegidos.
+ * @param ctx Contexto a reiniciar.
+ */
+void contexto_reiniciar(CompilerContext *ctx) {
+    contexto_liberar_fuente(ctx);
+    ast_liberar_recursos(ctx);
+    ctx->contador_nodos = 0;
+    ctx->gen_label_counter = 0;
+    memset(&ctx->error, 0, sizeof(ctx->error));
+    memset(&ctx->stats, 0, sizeof(ctx->stats));
+}
+
+/**
+ * Registra un error de la compilación. Sólo se guarda el primero: los que
+ * siguen suelen ser consecuencia de él. Si ctx->errores no es NULL también se
+ * informa ahí, en el momento, con el formato de siempre ("-> ERROR Sintactico
+ * en la linea N: ..." o "Error: ..."). Quien detecta el error deja de
+ * trabajar y vuelve; el driver decide qué hacer con ctx->error.
+ * @param ctx Contexto de compilación.
+ * @param codigo Clase del error.
+ * @param linea Línea del fuente (0 si no se sabe).
+ * @param columna Columna del fuente (0 si no se sabe).
+ * @param formato Mensaje, como en printf.
+ * @return 0, para usarlo como valor de la operación que falló.
+ */
+int contexto_error(CompilerContext *ctx, CodigoError codigo, int linea, int columna,
+                   const char *formato, ...) {
+    ErrorCompilacion *e = &ctx->error;
+    if (e->codigo != ERROR_NINGUNO) return 0;
+    va_list args;
+    va_start(args, formato);
+    vsnprintf(e->mensaje, sizeof(e->mensaje), formato, args);
+    va_end(args);
+    e->codigo = codigo;
+    e->linea = linea;
+    e->columna = columna;
+
+    if (!ctx->errores) return 0;
+    if (codigo == ERROR_SINTAXIS)
+        fprintf(ctx->errores, "-> ERROR Sintactico en la linea %d: %s\n", linea, e->mensaje);
+    else
+        fprintf(ctx->errores, "Error: %s\n", e->mensaje);
+    return 0;
+}
+
+/**
+ * Nombre corto de una clase de error, para salidas que lee otro programa.
+ * @param codigo Clase del error.
+ * @return Nombre en minúsculas.
+ */
+const char *error_nombre(CodigoError codigo) {
+    switch (codigo) {
+        case ERROR_NINGUNO:          return "ninguno";
+        case ERROR_MEMORIA:          return "memoria";
+        case ERROR_SINTAXIS:         return "sintaxis";
+        case ERROR_NO_DECLARADA:     return "no_declarada";
+        case ERROR_REDECLARADA:      return "redeclarada";
+        case ERROR_SIN_INICIALIZAR:  return "sin_inicializar";
+        case ERROR_DIVISION_CERO:    return "division_cero";
+        case ERROR_TABLA_LLENA:      return "tabla_llena";
+        case ERROR_NODO_DESCONOCIDO: return "nodo_desconocido";
+        case ERROR_ESCRITURA:        return "escritura";
+        default:                     return "interno";
+    }
+}
+
+/**
+ * Mapea un archivo regular con dos bytes en cero después del final. La
+ * reserva anónima, redondeada a páginas, garantiza esos bytes aunque el
+ * archivo termine justo en un borde de página; el archivo se mapea encima.
+ * El mapeo es privado y escribible porque flex pone temporalmente un NUL
+ * después de cada lexema: las páginas tocadas se copian al escribirlas y el
+ * archivo nunca se modifica.
+ * @param ctx Contexto de compilación.
+ * @param fd Descriptor del archivo.
+ * @param largo Tamaño del archivo.
+ * @return 0 si se pudo mapear, -1 si no.
+ */
+static int mapear_fuente(CompilerContext *ctx, int fd, size_t largo) {
+    size_t pagina = (size_t)sysconf(_SC_PAGESIZE);
+    size_t reserva = (largo + 2 + pagina - 1) / pagina * pagina;
+
+    char *base = mmap(NULL, reserva, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) return -1;
+    if (largo > 0 &&
+        mmap(base, largo, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, reserva);
+        return -1;
+    }
+    madvise(base, reserva, MADV_SEQUENTIAL);
+
+    ctx->fuente = base;
+    ctx->largo_fuente = largo;
+    ctx->largo_reserva = reserva;
+    return 0;
+}
+
+/**
+ * Lee toda la entrada a memoria dinámica (stdin, tuberías, o archivos que no
+ * se pudieron mapear).
+ * @param ctx Contexto de compilación.
+ * @param entrada Archivo abierto.
+ * @return 0, o -1 si no hubo memoria.
+ */
+static int leer_fuente(CompilerContext *ctx, FILE *entrada) {
+    size_t cap = FUENTE_INICIAL, largo = 0, leidos;
+    char *buf = malloc(cap);
+    if (!buf) {
+        contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para el fuente");
+        return -1;
+    }
+    while ((leidos = fread(buf + largo, 1, cap - largo - 2, entrada)) > 0) {
+        largo += leidos;
+        if (cap - largo - 2 == 0) {
+            char *mayor = realloc(buf, cap * 2);
+            if (!mayor) {
+                free(buf);
+                contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para el fuente");
+                return -1;
+            }
+            buf = mayor;
+            cap *= 2;
+        }
+    }
+    buf[largo] = buf[largo + 1] = '\0';
+
+    ctx->fuente = buf;
+    ctx->largo_fuente = largo;
+    ctx->largo_reserva = 0;
+    return 0;
+}
+
+/**
+ * Deja la entrada completa en ctx->fuente, terminada en dos NUL, para que el
+ * lexer la recorra en el lugar sin copiarla a su propio buffer.
+ * @param ctx Contexto de compilación.
+ * @param entrada Archivo abierto (se lee desde la posición actual si no es regular).
+ * @return 0, o -1 si no hubo memoria (con ctx->error).
+ */
+int contexto_cargar_fuente(CompilerContext *ctx, FILE *entrada) {
+    struct stat sb;
+    int fd = fileno(entrada);
+    if (fd >= 0 && fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode) && ftell(entrada) == 0 &&
+        mapear_fuente(ctx, fd, (size_t)sb.st_size) == 0)
+        return 0;
+    return leer_fuente(ctx, entrada);
+}
+
+/**
+ * Libera el texto fuente (desmapea o hace free según cómo se cargó).
+ * @param ctx Contexto de compilación.
+ */
+void contexto_liberar_fuente(CompilerContext *ctx) {
+    if (!ctx->fuente) return;
+    if (ctx->fuente_prestada) ctx->fuente_prestada = 0;
+    else if (ctx->largo_reserva) munmap(ctx->fuente, ctx->largo_reserva);
+    else free(ctx->fuente);
+    ctx->fuente = NULL;
+    ctx->largo_fuente = ctx->largo_reserva = 0;
+}
+
+/**
+ * Usa un texto del llamador como fuente, sin copiarlo (--serve reusa el mismo
+ * buffer en cada pedido).
+ * @param ctx Contexto de compilación.
+ * @param texto Fuente seguido de dos NUL; el lexer puede escribir en él.
+ * @param largo Largo del fuente sin los NUL.
+ */
+void contexto_prestar_fuente(CompilerContext *ctx, char *texto, size_t largo) {
+    contexto_liberar_fuente(ctx);
+    ctx->fuente = texto;
+    ctx->largo_fuente = largo;
+    ctx->largo_reserva = 0;
+    ctx->fuente_prestada = 1;
+}
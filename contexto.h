@@ -0,0 +1,168 @@
+#ifndef CONTEXTO_H
+#define CONTEXTO_H
+
+#include <stdio.h>
+#include "ast.h"
+#include "stats.h"
+
+/* ------------------ Contexto de compilación ------------------ */
+
+/*
+ * Todo el estado que antes era global (tabla de símbolos, contadores del DOT y
+ * de etiquetas, estadísticas, estado del lexer) vive en un CompilerContext.
+ * Dos compilaciones con contextos distintos no comparten nada, así que pueden
+ * ejecutarse a la vez en hilos separados.
+ */
+
+/* Tamaño máximo de la tabla de símbolos */
+#define MAX_SIMBOLOS 1024
+
+/* Lexer a usar: el generado por flex o el escrito a mano (lexico.c) */
+typedef enum {
+    LEXER_FLEX,
+    LEXER_SIMD
+} TipoLexer;
+
+/* Lexer por defecto; se cambia al compilar con -DLEXER_POR_DEFECTO=LEXER_SIMD */
+#ifndef LEXER_POR_DEFECTO
+#define LEXER_POR_DEFECTO LEXER_FLEX
+#endif
+
+/* Parser a usar: el generado por Bison o el escrito a mano (analizador.c) */
+typedef enum {
+    PARSER_BISON,
+    PARSER_MANO
+} TipoParser;
+
+/* Largo máximo del mensaje de un error, con el NUL */
+#define ERROR_MAX_MENSAJE 256
+
+/* Clase de un error de compilación o de ejecución */
+typedef enum {
+    ERROR_NINGUNO,
+    ERROR_MEMORIA,              /* Falló una reserva de memoria */
+    ERROR_SINTAXIS,
+    ERROR_NO_DECLARADA,         /* Uso o asignación de una variable sin declarar */
+    ERROR_REDECLARADA,
+    ERROR_SIN_INICIALIZAR,
+    ERROR_DIVISION_CERO,
+    ERROR_TABLA_LLENA,          /* Más de MAX_SIMBOLOS variables */
+    ERROR_NODO_DESCONOCIDO,     /* Tipo de nodo u operación que la fase no conoce */
+    ERROR_INTERNO,              /* Un constructor recibió un argumento inválido */
+    ERROR_ESCRITURA             /* No se pudo escribir una salida (seudo-assembly, grafo) */
+} CodigoError;
+
+/* Primer error de una compilación y dónde ocurrió (0 = posición desconocida) */
+typedef struct {
+    CodigoError codigo;
+    int linea;
+    int columna;
+    char mensaje[ERROR_MAX_MENSAJE];
+} ErrorCompilacion;
+
+/* Recibe cada declaración o sentencia de nivel superior apenas el parser la
+   reduce, en lugar de encadenarla al AST; el sumidero pasa a ser su dueño */
+typedef void (*FnSumidero)(CompilerContext *ctx, Nodo *sentencia, void *arg);
+
+/* Tokeniza todo el fuente, como tokens_lexear; devuelve 0 o -1 con ctx->error */
+struct Tokens;
+typedef int (*FnLexear)(CompilerContext *ctx, struct Tokens *t);
+
+/**
+ * Estructura para un símbolo en la tabla.
+ */
+typedef struct {
+    char *id;           /* Nombre del símbolo */
+    int valor;          /* Valor (entero o booleano 0/1) */
+    int es_bool;        /* 0 = int, 1 = bool */
+    int inicializado;   /* 0 = no inicializado, 1 = inicializado */
+} Simbolo;
+
+struct CompilerContext {
+    Simbolo tabla[MAX_SIMBOLOS];    /* Tabla de símbolos */
+    int tabla_size;
+    int contador_nodos;             /* IDs únicos de nodo en la exportación DOT */
+    int gen_label_counter;          /* Etiquetas únicas del seudo-assembly */
+    FILE *salida;                   /* Destino de AST, tabla y resultados */
+    FILE *errores;                  /* Donde se informan los errores (NULL = no
+                                       se informan, sólo quedan en error) */
+    void *scanner;                  /* yyscan_t mientras dura el análisis */
+    char *fuente;                   /* Texto fuente mientras dura el análisis */
+    size_t largo_fuente;            /* Sin contar los dos NUL finales */
+    size_t largo_reserva;           /* Bytes mapeados, o 0 si fuente es de malloc */
+    int fuente_prestada;            /* fuente es del llamador: no se libera */
+    TipoLexer lexer;                /* Lexer que usa contexto_parsear */
+    int hilos_lexico;               /* Hilos para tokenizar (1 = secuencial) */
+    FnLexear lexear;                /* Tokenizador de contexto_parsear (NULL = tokens_lexear) */
+    TipoParser parser;              /* Parser que usa contexto_parsear */
+    size_t cursor;                  /* Posición del lexer a mano en fuente */
+    size_t inicio_token;            /* Inicio del último token del lexer a mano */
+    int linea;                      /* Línea actual del lexer a mano */
+    const struct Tokens *tokens;    /* Arreglo que lee el parser (tokens.h) */
+    size_t token_actual;            /* Próximo token a leer del arreglo */
+    size_t ubicado;                 /* Último desplazamiento que pasó por contexto_ubicar */
+    int linea_ubicado;              /* Su línea (0 = volver a contar desde el principio) */
+    int columna_ubicado;            /* Y su columna */
+    FnSumidero sumidero;            /* NULL = armar el AST completo */
+    void *arg_sumidero;
+    struct Perfil *perfil;          /* --profile: lo que mide eval_nodo (NULL = nada) */
+    ErrorCompilacion error;         /* Primer error; después de él cada fase corta */
+    Estadisticas stats;             /* Contadores de --stats */
+};
+
+/* ------------------ Prototipos de funciones ------------------ */
+
+CompilerContext *contexto_crear(FILE *salida);  /* salida NULL = stdout; NULL sin memoria */
+void contexto_inicializar(CompilerContext *ctx, FILE *salida); /* Sobre memoria en cero;
+                                                                  contexto_destruir la libera */
+void contexto_destruir(CompilerContext *ctx);
+void contexto_reiniciar(CompilerContext *ctx);  /* Deja el contexto listo para otra compilación */
+
+/* Registra un error en ctx->error si es el primero y lo informa en
+   ctx->errores; devuelve 0, para usarlo como valor de lo que falló */
+int contexto_error(CompilerContext *ctx, CodigoError codigo, int linea, int columna,
+                   const char *formato, ...);
+const char *error_nombre(CodigoError codigo);   /* "memoria", "sintaxis", ... */
+
+/* 1 si la compilación ya tiene un error */
+static inline int contexto_fallo(const CompilerContext *ctx) {
+    return ctx->error.codigo != ERROR_NINGUNO;
+}
+
+/* Carga la entrada en ctx->fuente seguida de dos NUL, como pide yy_scan_buffer.
+   Los archivos regulares se mapean; stdin y tuberías se leen a memoria.
+   Devuelve 0, o -1 si no hubo memoria (con ctx->error). */
+int contexto_cargar_fuente(CompilerContext *ctx, FILE *entrada);
+void contexto_liberar_fuente(CompilerContext *ctx);
+
+/* Usa como fuente un texto del llamador, que debe seguir de dos NUL y poder
+   modificarse mientras dura el análisis; no se copia ni se libera */
+void contexto_prestar_fuente(CompilerContext *ctx, char *texto, size_t largo);
+
+/* Análisis léxico y sintáctico (calc-sintaxis.y); devuelve el valor de yyparse.
+   Si ctx->fuente ya está cargado (contexto_cargar_fuente) no se vuelve a leer. */
+int contexto_parsear(CompilerContext *ctx, FILE *entrada, Nodo **raiz);
+
+/* Análisis sintáctico de un arreglo de tokens ya armado sobre ctx->fuente */
+int contexto_parsear_tokens(CompilerContext *ctx, const struct Tokens *tokens, Nodo **raiz);
+
+/* Prepara el lexer elegido sobre la entrada y lo libera (calc-sintaxis.y);
+   preparar devuelve 0, o -1 con ctx->error */
+int contexto_iniciar_lexico(CompilerContext *ctx, FILE *entrada);
+int contexto_preparar_lexico(CompilerContext *ctx);  /* Con ctx->fuente ya cargado */
+void contexto_terminar_lexico(CompilerContext *ctx);
+int contexto_linea(const CompilerContext *ctx);     /* Línea actual del lexer en uso */
+int contexto_columna(const CompilerContext *ctx);   /* Columna del último token (0 = no se sabe) */
+
+/* Línea y columna (desde 1) de un desplazamiento de ctx->fuente, para ubicar
+   los nodos. Avanza desde el último pedido, así que consultar en orden cuesta
+   una sola pasada por el fuente; contexto_preparar_lexico la reinicia. */
+void contexto_ubicar(CompilerContext *ctx, size_t desplazamiento, int *linea, int *columna);
+
+/* Análisis incremental: el fuente llega por partes (calc-sintaxis.y) */
+typedef struct Incremental Incremental;
+Incremental *incremental_crear(CompilerContext *ctx);     /* NULL con ctx->error */
+int incremental_alimentar(Incremental *inc, const char *datos, size_t largo); /* 0 = sigue, 1 = terminó */
+int incremental_terminar(Incremental *inc, Nodo **raiz);   /* Libera inc */
+
+#endif /* CONTEXTO_H */
@@ -0,0 +1,153 @@
+/*
+ * Generador de superinstrucciones.
+ *
+ * Cuenta las frecuencias de n-gramas de instrucciones en un corpus de
+ * archivos .sasm y escribe en la salida estándar la lista de secuencias a
+ * fusionar en formato superinstr.def. La selección es determinística: a igual
+ * corpus, igual archivo.
+ *
+ * Uso: ./gen-superinstr [-k N] corpus/aritmetica.sasm ... > superinstr.def
+ */
+
+/* Definiciones necesarias para compatibilidad POSIX */
+#define _POSIX_C_SOURCE 200809L
+
+/* Inclusiones de bibliotecas estándar */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sasm.h"
+
+/* Cantidad de superinstrucciones a seleccionar por defecto */
+#define K_POR_DEFECTO 8
+
+/* Candidato a superinstrucción */
+typedef struct {
+    int n;                          /* Longitud (2 o 3) */
+    int base[SASM_MAX_FUSION];      /* Secuencia de instrucciones base */
+    unsigned long frecuencia;       /* Apariciones en el corpus */
+    unsigned long ahorro;           /* Despachos que se evitan: frecuencia * (n-1) */
+} Candidato;
+
+/**
+ * Construye el nombre de una superinstrucción uniendo sus componentes.
+ * @param c Candidato.
+ * @param buf Buffer de salida.
+ * @param tam Tamaño del buffer.
+ */
+static void nombre_candidato(const Candidato *c, char *buf, size_t tam) {
+    buf[0] = '\0';
+    for (int k = 0; k < c->n; ++k) {
+        if (k > 0) strncat(buf, "_", tam - strlen(buf) - 1);
+        strncat(buf, sasm_nombre_op(c->base[k]), tam - strlen(buf) - 1);
+    }
+}
+
+/**
+ * Orden de selección: mayor ahorro, luego más largo, luego por nombre.
+ */
+static int comparar_candidatos(const void *a, const void *b) {
+    const Candidato *x = a, *y = b;
+    if (x->ahorro != y->ahorro) return x->ahorro > y->ahorro ? -1 : 1;
+    if (x->n != y->n) return y->n - x->n;
+    char nx[64], ny[64];
+    nombre_candidato(x, nx, sizeof(nx));
+    nombre_candidato(y, ny, sizeof(ny));
+    return strcmp(nx, ny);
+}
+
+/**
+ * Elige el mejor bigrama o trigrama de una tabla de frecuencias.
+ * @param t Frecuencias contadas sobre las instrucciones aún no fusionadas.
+ * @param mejor Candidato elegido.
+ * @return 1 si hubo algún candidato.
+ */
+static int mejor_candidato(const SasmNgramas *t, Candidato *mejor) {
+    int hay = 0;
+    for (int a = 0; a < SASM_NUM_BASE; ++a) {
+        for (int b = 0; b < SASM_NUM_BASE; ++b) {
+            Candidato c2 = { 2, { a, b, SASM_NOP }, t->dos[a][b], t->dos[a][b] };
+            if (c2.frecuencia && (!hay || comparar_candidatos(&c2, mejor) < 0)) {
+                *mejor = c2;
+                hay = 1;
+            }
+            for (int c = 0; c < SASM_NUM_BASE; ++c) {
+                Candidato c3 = { 3, { a, b, c }, t->tres[a][b][c], 2 * t->tres[a][b][c] };
+                if (c3.frecuencia && (!hay || comparar_candidatos(&c3, mejor) < 0)) {
+                    *mejor = c3;
+                    hay = 1;
+                }
+            }
+        }
+    }
+    return hay;
+}
+
+int main(int argc, char *argv[]) {
+    int k = K_POR_DEFECTO;
+    int primero = 1;
+
+    if (argc > 2 && strcmp(argv[1], "-k") == 0) {
+        k = atoi(argv[2]);
+        primero = 3;
+    }
+    if (primero >= argc || k <= 0) {
+        fprintf(stderr, "Uso: %s [-k N] archivo.sasm...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int n_progs = argc - primero;
+    SasmPrograma *progs = calloc(n_progs, sizeof(SasmPrograma));
+    Candidato *elegidos = calloc(k, sizeof(Candidato));
+    if (!progs || !elegidos) {
+        perror("calloc");
+        return EXIT_FAILURE;
+    }
+    unsigned long total = 0;
+    for (int i = 0; i < n_progs; ++i) {
+        if (sasm_cargar(argv[primero + i], &progs[i]) != 0) return EXIT_FAILURE;
+        total += progs[i].n;
+    }
+
+    /*
+     * Selección voraz: en cada ronda se cuentan los n-gramas sobre las
+     * instrucciones que siguen sin fusionar, se elige el de mayor ahorro y se
+     * aplica al corpus, igual que lo hará sasm_fusionar con la lista final.
+     * Así los patrones solapados no se cuentan dos veces.
+     */
+    int n_elegidos = 0;
+    while (n_elegidos < k) {
+        static SasmNgramas t;
+        memset(&t, 0, sizeof(t));
+        for (int i = 0; i < n_progs; ++i) sasm_contar_ngramas(&progs[i], &t);
+        if (!mejor_candidato(&t, &elegidos[n_elegidos])) break;
+
+        Candidato *c = &elegidos[n_elegidos];
+        SasmSuper s = { SASM_NUM_OPS + n_elegidos, c->n,
+                        { c->base[0], c->base[1], c->base[2] } };
+        for (int i = 0; i < n_progs; ++i) sasm_fusionar_con(&progs[i], &s, 1);
+        n_elegidos++;
+    }
+
+    printf("/*\n");
+    printf(" * Superinstrucciones del seudo-assembly. Archivo generado por gen-superinstr\n");
+    printf(" * a partir del corpus en corpus/ (%lu instrucciones); no editar a mano.\n", total);
+    printf(" *\n");
+    printf(" * SUPER(nombre, n, op1, op2, op3): fusiona n instrucciones base (relleno NOP).\n");
+    printf(" * El orden es la prioridad con la que sasm_fusionar prueba cada patrón.\n");
+    printf(" */\n\n");
+    for (int i = 0; i < n_elegidos; ++i) {
+        char nombre[64];
+        nombre_candidato(&elegidos[i], nombre, sizeof(nombre));
+        printf("/* frecuencia %lu */\n", elegidos[i].frecuencia);
+        printf("SUPER(%s, %d, %s, %s, %s)\n", nombre, elegidos[i].n,
+               sasm_nombre_op(elegidos[i].base[0]),
+               sasm_nombre_op(elegidos[i].base[1]),
+               sasm_nombre_op(elegidos[i].base[2]));
+    }
+
+    for (int i = 0; i < n_progs; ++i) sasm_liberar(&progs[i]);
+    free(progs);
+    free(elegidos);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,321 @@
+/* Generador de programas sintéticos para medir el compilador */
+
+/* Definiciones necesarias para compatibilidad POSIX */
+#define _POSIX_C_SOURCE 200809L
+
+/* Inclusiones de bibliotecas estándar */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "generador.h"
+#include "contexto.h"
+
+/* Ningún resultado parcial de una expresión pasa de esto en valor absoluto,
+   así que la suma o resta de dos de ellos todavía entra en un int */
+#define LIMITE_PARCIAL 1073741823LL
+
+/* Posición de signo del primer grupo de una expresión, que no tiene */
+#define SIN_SIGNO ((size_t)-1)
+
+/* Estado de una generación */
+typedef struct {
+    FILE *f;
+    const OpcionesGenerador *og;
+    unsigned long semilla;
+    unsigned char *declarada;       /* Por variable: 0 = no, 1 = int, 2 = bool */
+    int *orden;                     /* Variables declaradas, en orden */
+    int n_declaradas;
+    int *valor;                     /* Valor de cada variable declarada */
+    char *texto;                    /* Sentencia en curso, que todavía se puede retocar */
+    size_t largo, cap;
+    int sin_memoria;
+} Generador;
+
+/**
+ * Número pseudoaleatorio (el mismo LCG que bench-motores).
+ * @param g Generador.
+ * @param n Cota.
+ * @return Entero en [0, n).
+ */
+static int azar(Generador *g, int n) {
+    g->semilla = g->semilla * 1103515245UL + 12345UL;
+    return (int)((g->semilla >> 16) % (unsigned long)n);
+}
+
+/**
+ * Inserta texto en la sentencia en curso.
+ * @param g Generador.
+ * @param pos Posición donde insertar (g->largo para agregar al final).
+ * @param fmt Formato de printf.
+ */
+static void insertar(Generador *g, size_t pos, const char *fmt, ...) {
+    char aux[32];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(aux, sizeof(aux), fmt, ap);
+    va_end(ap);
+    if (g->sin_memoria) return;
+    if (g->largo + (size_t)n + 1 > g->cap) {
+        size_t cap = g->cap ? g->cap : 256;
+        while (cap < g->largo + (size_t)n + 1) cap *= 2;
+        char *texto = realloc(g->texto, cap);
+        if (!texto) {
+            g->sin_memoria = 1;
+            return;
+        }
+        g->texto = texto;
+        g->cap = cap;
+    }
+    memmove(g->texto + pos + n, g->texto + pos, g->largo - pos);
+    memcpy(g->texto + pos, aux, (size_t)n);
+    g->largo += (size_t)n;
+}
+
+#define agregar(g, ...) insertar((g), (g)->largo, __VA_ARGS__)
+
+/**
+ * Escribe un término de nivel 1: una variable ya declarada o una constante.
+ * @param g Generador.
+ * @return Su valor.
+ */
+static long long hoja(Generador *g) {
+    if (g->n_declaradas > 0 && azar(g, 4) != 0) {
+        int v = g->orden[azar(g, g->n_declaradas)];
+        agregar(g, "v%d", v);
+        return g->valor[v];
+    }
+    int k = azar(g, 100);
+    agregar(g, "%d", k);
+    return k;
+}
+
+/**
+ * Cierra un grupo de productos sumándolo (o restándolo) a lo anterior. Si el
+ * resultado se pasaría de LIMITE_PARCIAL se invierte el signo del grupo,
+ * que con los dos en el límite siempre alcanza.
+ * @param g Generador.
+ * @param total Suma de los grupos anteriores.
+ * @param grupo Valor del grupo.
+ * @param signo Posición de su '+' o '-' en el texto, o SIN_SIGNO.
+ * @return La nueva suma.
+ */
+static long long cerrar_grupo(Generador *g, long long total, long long grupo, size_t signo) {
+    if (signo == SIN_SIGNO || g->sin_memoria) return grupo;
+    long long r = g->texto[signo] == '-' ? total - grupo : total + grupo;
+    if (llabs(r) > LIMITE_PARCIAL) {
+        g->texto[signo] = g->texto[signo] == '-' ? '+' : '-';
+        r = 2 * total - r;
+    }
+    return r;
+}
+
+/**
+ * Escribe una expresión aritmética y calcula su valor como lo hará el
+ * evaluador. El divisor de una división es siempre una constante positiva,
+ * así que nunca divide por cero; un producto que se pasaría de
+ * LIMITE_PARCIAL se cambia por una suma, así que ningún resultado parcial
+ * desborda un int.
+ * @param g Generador.
+ * @param profundidad Niveles de paréntesis que quedan.
+ * @return Su valor.
+ */
+static long long expresion(Generador *g, int profundidad) {
+    static const char operadores[] = "+-*/";
+    long long total = 0, grupo = 0;
+    size_t signo = SIN_SIGNO;
+    for (int i = 0; i < g->og->ancho; ++i) {
+        int op = azar(g, 4);
+        size_t pos = g->largo + 1;
+        if (i > 0) agregar(g, " %c ", operadores[op]);
+        if (i > 0 && op == 3) {
+            int k = 1 + azar(g, 9);
+            agregar(g, "%d", k);
+            grupo /= k;
+            continue;
+        }
+        long long x;
+        if (profundidad > 1 && (i == 0 || azar(g, 2))) {
+            agregar(g, "(");
+            x = expresion(g, profundidad - 1);
+            agregar(g, ")");
+        } else {
+            x = hoja(g);
+        }
+        if (g->sin_memoria) return 0;
+        if (i == 0) {
+            grupo = x;
+        } else if (op == 2 && llabs(grupo * x) <= LIMITE_PARCIAL) {
+            grupo *= x;
+        } else {
+            if (op == 2) g->texto[pos] = '+';
+            total = cerrar_grupo(g, total, grupo, signo);
+            signo = pos;
+            grupo = x;
+        }
+    }
+    return cerrar_grupo(g, total, grupo, signo);
+}
+
+/**
+ * Escribe una expresión lógica: comparaciones de expresiones de nivel 1
+ * encadenadas con && y ||, con subexpresiones lógicas entre paréntesis.
+ * @param g Generador.
+ * @param profundidad Niveles de paréntesis que quedan.
+ * @return Su valor (0 o 1).
+ */
+static int expresion_logica(Generador *g, int profundidad) {
+    static const char *const comparaciones[] = { " < ", " > ", " == " };
+    int o = 0, y = 1;               /* && agrupa antes que || */
+    for (int i = 0; i < g->og->ancho; ++i) {
+        int conjuncion = 1;
+        if (i > 0) {
+            conjuncion = azar(g, 2);
+            agregar(g, conjuncion ? " && " : " || ");
+        }
+        int x;
+        if (profundidad > 1 && (i == 0 || azar(g, 2))) {
+            agregar(g, "(");
+            x = expresion_logica(g, profundidad - 1);
+            agregar(g, ")");
+        } else if (azar(g, 8) == 0) {
+            x = azar(g, 2);
+            agregar(g, x ? "true" : "false");
+        } else {
+            long long a = expresion(g, 1);
+            int comparacion = azar(g, 3);
+            agregar(g, "%s", comparaciones[comparacion]);
+            long long b = expresion(g, 1);
+            x = comparacion == 0 ? a < b : comparacion == 1 ? a > b : a == b;
+        }
+        if (conjuncion) {
+            y = y && x;
+        } else {
+            o = o || y;
+            y = x;
+        }
+    }
+    return o || y;
+}
+
+/**
+ * Escribe una sentencia: declara una variable todavía libre o asigna a una
+ * ya declarada, con una expresión del tipo de la variable. Si el valor de una
+ * entera pasaría de GENERADOR_MAX_VALOR, la expresión se divide por una
+ * constante que lo deja dentro.
+ * @param g Generador.
+ */
+static void sentencia(Generador *g) {
+    const OpcionesGenerador *og = g->og;
+    int declarar = g->n_declaradas == 0 ||
+                   (g->n_declaradas < og->variables && azar(g, 100) < og->porc_declaraciones);
+    int logica = azar(g, 100) < og->porc_logicas;
+    int v;
+    g->largo = 0;
+    if (declarar) {
+        /* Las variables se declaran en un orden mezclado */
+        do v = azar(g, og->variables); while (g->declarada[v]);
+        agregar(g, "    %s v%d = ", logica ? "bool" : "int", v);
+    } else {
+        v = g->orden[azar(g, g->n_declaradas)];
+        logica = g->declarada[v] == 2;
+        agregar(g, "    v%d = ", v);
+    }
+    size_t inicio = g->largo;
+    long long x;
+    if (logica) {
+        x = expresion_logica(g, og->profundidad);
+    } else {
+        x = expresion(g, og->profundidad);
+        if (llabs(x) > GENERADOR_MAX_VALOR) {
+            long long k = llabs(x) / GENERADOR_MAX_VALOR + 1;
+            insertar(g, inicio, "(");
+            agregar(g, ") / %lld", k);
+            x /= k;
+        }
+    }
+    agregar(g, ";\n");
+    if (g->sin_memoria) return;
+    fwrite(g->texto, 1, g->largo, g->f);
+    g->valor[v] = (int)x;
+    if (declarar) {
+        g->declarada[v] = logica ? 2 : 1;
+        g->orden[g->n_declaradas++] = v;
+    }
+}
+
+/**
+ * Deja las opciones en sus valores por defecto.
+ * @param og Opciones.
+ */
+void generador_opciones(OpcionesGenerador *og) {
+    og->sentencias = 1000;
+    og->variables = 64;
+    og->profundidad = 2;
+    og->ancho = 3;
+    og->porc_logicas = 20;
+    og->porc_declaraciones = 10;
+    og->semilla = 12345UL;
+}
+
+/**
+ * Valida las opciones.
+ * @param og Opciones.
+ * @return NULL si sirven, o el motivo.
+ */
+const char *generador_validar(const OpcionesGenerador *og) {
+    if (og->sentencias < 0) return "la cantidad de sentencias no puede ser negativa";
+    if (og->variables < 1 || og->variables > MAX_SIMBOLOS) return "las variables deben estar entre 1 y MAX_SIMBOLOS";
+    if (og->profundidad < 1 || og->profundidad > GENERADOR_MAX_PROFUNDIDAD)
+        return "la profundidad debe estar entre 1 y GENERADOR_MAX_PROFUNDIDAD";
+    if (og->ancho < 1) return "el ancho debe ser al menos 1";
+    if (og->porc_logicas < 0 || og->porc_logicas > 100) return "el porcentaje de lógicas debe estar entre 0 y 100";
+    if (og->porc_declaraciones < 0 || og->porc_declaraciones > 100)
+        return "el porcentaje de declaraciones debe estar entre 0 y 100";
+    return NULL;
+}
+
+/**
+ * Escribe un programa sintético.
+ * @param f Destino.
+ * @param og Opciones (ya validadas).
+ * @return 0, o -1 si falló la escritura o no hubo memoria.
+ */
+int generador_escribir(FILE *f, const OpcionesGenerador *og) {
+    Generador g;
+    memset(&g, 0, sizeof(g));
+    g.f = f;
+    g.og = og;
+    g.semilla = og->semilla;
+    g.declarada = calloc(og->variables, 1);
+    g.orden = malloc(og->variables * sizeof(int));
+    g.valor = malloc(og->variables * sizeof(int));
+    if (!g.declarada || !g.orden || !g.valor) {
+        free(g.declarada);
+        free(g.orden);
+        free(g.valor);
+        return -1;
+    }
+
+    fputs("int main () {\n", f);
+    for (long i = 0; i < og->sentencias && !g.sin_memoria; ++i) sentencia(&g);
+    fputs("    return ", f);
+    if (g.n_declaradas > 0) {
+        /* Sólo variables enteras, para que el resultado dependa del programa */
+        int escritos = 0;
+        for (int i = 0; i < g.n_declaradas && escritos < 4; ++i) {
+            if (g.declarada[g.orden[i]] != 1) continue;
+            fprintf(f, "%sv%d", escritos++ ? " + " : "", g.orden[i]);
+        }
+        if (!escritos) fputc('0', f);
+    } else {
+        fputc('0', f);
+    }
+    fputs(";\n}\n", f);
+
+    free(g.declarada);
+    free(g.orden);
+    free(g.valor);
+    free(g.texto);
+    return ferror(f) || g.sin_memoria ? -1 : 0;
+}
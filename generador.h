@@ -0,0 +1,54 @@
+#ifndef GENERADOR_H
+#define GENERADOR_H
+
+#include <stdio.h>
+
+/* ------------------ Generador de programas sintéticos ------------------ */
+
+/*
+ * Escribe programas válidos en la gramática de calc-sintaxis.y, que además
+ * se evalúan sin errores: cada variable se declara con valor inicial antes de
+ * usarse, nunca se redeclara y el divisor de una división es siempre una
+ * constante distinta de cero. Tampoco desbordan un int: el generador calcula
+ * el valor de cada expresión mientras la escribe, cambia por una suma el
+ * producto que se pasaría de la mitad de INT_MAX (o invierte el signo de la
+ * suma que lo haría) y divide por una constante la expresión de una sentencia
+ * cuyo valor pasaría de GENERADOR_MAX_VALOR. Con la misma semilla y las
+ * mismas opciones el texto es el mismo byte a byte.
+ *
+ * Cada sentencia es una declaración (int o bool) o una asignación, y el
+ * programa termina con un return. Una expresión de profundidad p es una
+ * cadena de `ancho` términos unidos por operadores; el primer término es una
+ * subexpresión de profundidad p-1 entre paréntesis y los demás lo son con
+ * probabilidad 1/2. En el nivel 1 los términos son variables o constantes.
+ * Las expresiones lógicas encadenan comparaciones con && y ||.
+ */
+
+/* Profundidad máxima de las expresiones (el generador es recursivo) */
+#define GENERADOR_MAX_PROFUNDIDAD 1000
+
+/* Valor absoluto máximo de una variable entera del programa generado */
+#define GENERADOR_MAX_VALOR 10000
+
+/* Opciones del generador; generador_opciones las deja en sus valores por defecto */
+typedef struct {
+    long sentencias;            /* Declaraciones y asignaciones, sin el return */
+    int variables;              /* Variables distintas, como máximo MAX_SIMBOLOS */
+    int profundidad;            /* Niveles de paréntesis de cada expresión (>= 1) */
+    int ancho;                  /* Términos por nivel (>= 1) */
+    int porc_logicas;           /* % de sentencias con expresión lógica (bool) */
+    int porc_declaraciones;     /* % de sentencias que declaran mientras queden variables */
+    unsigned long semilla;
+} OpcionesGenerador;
+
+/* ------------------ Prototipos de funciones ------------------ */
+
+void generador_opciones(OpcionesGenerador *og);    /* Valores por defecto */
+
+/* Valida las opciones; devuelve NULL o el motivo por el que no sirven */
+const char *generador_validar(const OpcionesGenerador *og);
+
+/* Escribe el programa en f; devuelve 0, o -1 si falló la escritura */
+int generador_escribir(FILE *f, const OpcionesGenerador *og);
+
+#endif /* GENERADOR_H */
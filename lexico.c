@@ -0,0 +1,217 @@
+/* Lexer escrito a mano: mismos tokens que calc-lexico.l, recorridos con SIMD */
+
+/* Inclusiones de bibliotecas estándar */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "lexico.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define ANCHO 32
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define ANCHO 16
+#endif
+
+/* Clases de caracteres de calc-lexico.l ([ \t\r\n], {letra}, {digito}) */
+#define ES_ESPACIO(c) ((c) == ' ' || (c) == '\t' || (c) == '\r' || (c) == '\n')
+#define ES_DIGITO(c)  ((c) >= '0' && (c) <= '9')
+#define ES_LETRA(c)   ((((c) | 0x20) >= 'a') && (((c) | 0x20) <= 'z'))
+
+#ifdef ANCHO
+/*
+ * Operaciones vectoriales de a ANCHO bytes. Cada una devuelve una máscara con
+ * un bit por byte; las cargas no alineadas sólo se hacen si quedan ANCHO bytes
+ * dentro del fuente (contando los dos NUL finales), así que nunca se lee fuera.
+ */
+#if ANCHO == 32
+typedef __m256i Vector;
+#define CARGAR(p)        _mm256_loadu_si256((const __m256i *)(p))
+#define REPETIR(c)       _mm256_set1_epi8((char)(c))
+#define IGUAL(a, b)      _mm256_cmpeq_epi8(a, b)
+#define MAYOR(a, b)      _mm256_cmpgt_epi8(a, b)
+#define O(a, b)          _mm256_or_si256(a, b)
+#define Y(a, b)          _mm256_and_si256(a, b)
+#define MASCARA(v)       ((unsigned)_mm256_movemask_epi8(v))
+#else
+typedef __m128i Vector;
+#define CARGAR(p)        _mm_loadu_si128((const __m128i *)(p))
+#define REPETIR(c)       _mm_set1_epi8((char)(c))
+#define IGUAL(a, b)      _mm_cmpeq_epi8(a, b)
+#define MAYOR(a, b)      _mm_cmpgt_epi8(a, b)
+#define O(a, b)          _mm_or_si128(a, b)
+#define Y(a, b)          _mm_and_si128(a, b)
+#define MASCARA(v)       ((unsigned)_mm_movemask_epi8(v))
+#endif
+
+/* Bits válidos de una máscara de ANCHO bytes */
+#define TODOS ((unsigned)((1ULL << ANCHO) - 1))
+
+/**
+ * Bytes en el rango [lo, hi] (con signo: los bytes >= 0x80 nunca entran).
+ * @param v Bytes.
+ * @param lo Menor valor aceptado.
+ * @param hi Mayor valor aceptado.
+ * @return Máscara de los bytes en el rango.
+ */
+static inline Vector en_rango(Vector v, char lo, char hi) {
+    return Y(MAYOR(v, REPETIR(lo - 1)), MAYOR(REPETIR(hi + 1), v));
+}
+#endif
+
+/**
+ * Avanza sobre espacios en blanco contando los saltos de línea.
+ * @param ctx Contexto (usa y actualiza ctx->cursor y ctx->linea).
+ * @param p Posición actual.
+ * @param fin Fin del fuente.
+ * @return Primera posición que no es espacio.
+ */
+static const char *saltar_espacios(CompilerContext *ctx, const char *p, const char *fin) {
+#ifdef ANCHO
+    const Vector blanco = REPETIR(' '), tab = REPETIR('\t'), cr = REPETIR('\r'), lf = REPETIR('\n');
+    while (p + ANCHO <= fin + 2) {
+        Vector v = CARGAR(p);
+        Vector nl = IGUAL(v, lf);
+        unsigned espacios = MASCARA(O(O(IGUAL(v, blanco), IGUAL(v, tab)), O(IGUAL(v, cr), nl)));
+        unsigned saltos = MASCARA(nl);
+        if (espacios != TODOS) {
+            int n = __builtin_ctz(~espacios);
+            ctx->linea += __builtin_popcount(saltos & ((1u << n) - 1));
+            return p + n;
+        }
+        ctx->linea += __builtin_popcount(saltos);
+        p += ANCHO;
+    }
+#endif
+    while (p < fin && ES_ESPACIO(*p)) {
+        if (*p == '\n') ctx->linea++;
+        p++;
+    }
+    return p;
+}
+
+/**
+ * Avanza sobre el resto de un identificador ({letra}|{digito})*.
+ * @param p Posición actual.
+ * @param fin Fin del fuente.
+ * @return Primera posición que no es letra ni dígito.
+ */
+static const char *saltar_alfanumericos(const char *p, const char *fin) {
+#ifdef ANCHO
+    while (p + ANCHO <= fin + 2) {
+        Vector v = CARGAR(p);
+        Vector minuscula = O(v, REPETIR(0x20));
+        unsigned alnum = MASCARA(O(en_rango(minuscula, 'a', 'z'), en_rango(v, '0', '9')));
+        if (alnum != TODOS) return p + __builtin_ctz(~alnum);
+        p += ANCHO;
+    }
+#endif
+    while (p < fin && (ES_LETRA(*p) || ES_DIGITO(*p))) p++;
+    return p;
+}
+
+/**
+ * Clasifica un identificador como palabra reservada o ID.
+ * @param s Texto.
+ * @param n Largo.
+ * @return Token correspondiente.
+ */
+static int palabra_reservada(const char *s, size_t n) {
+    switch (n) {
+        case 3: if (memcmp(s, "int", 3) == 0) return INT; break;
+        case 4:
+            if (memcmp(s, "bool", 4) == 0) return BOOL;
+            if (memcmp(s, "void", 4) == 0) return VOID;
+            if (memcmp(s, "main", 4) == 0) return MAIN;
+            if (memcmp(s, "true", 4) == 0) return TRUE;
+            break;
+        case 5: if (memcmp(s, "false", 5) == 0) return FALSE; break;
+        case 6: if (memcmp(s, "return", 6) == 0) return RETURN; break;
+    }
+    return ID;
+}
+
+/**
+ * Convierte una secuencia de dígitos como lo hace atoi en glibc (strtol
+ * saturado a LONG_MAX y truncado a int), para dar el mismo valor que flex.
+ * @param s Dígitos.
+ * @param n Cantidad de dígitos.
+ * @return Valor del número.
+ */
+static int valor_numero(const char *s, size_t n) {
+    unsigned long v = 0;
+    for (size_t i = 0; i < n; ++i) {
+        unsigned d = (unsigned)(s[i] - '0');
+        if (v > ((unsigned long)LONG_MAX - d) / 10) return (int)LONG_MAX;
+        v = v * 10 + d;
+    }
+    return (int)v;
+}
+
+/**
+ * Devuelve el siguiente token de ctx->fuente, como yylex.
+ * @param lval Valor semántico del token.
+ * @param ctx Contexto (ctx->cursor y ctx->linea avanzan).
+ * @return Token, o 0 al final de la entrada.
+ */
+int lexico_simd(YYSTYPE *lval, CompilerContext *ctx) {
+    const char *inicio = ctx->fuente;
+    const char *fin = inicio + ctx->largo_fuente;
+    const char *p = inicio + ctx->cursor;
+
+    for (;;) {
+        p = saltar_espacios(ctx, p, fin);
+        if (p >= fin) {
+            ctx->cursor = ctx->largo_fuente;
+            return 0;
+        }
+
+        const char *lexema = p;
+        char c = *p++;
+        int token = -1;
+        if (ES_LETRA(c)) {
+            p = saltar_alfanumericos(p, fin);
+            token = palabra_reservada(lexema, p - lexema);
+            if (token == ID) {
+                lval->lex.texto = lexema;
+                lval->lex.largo = p - lexema;
+                lval->lex.propio = 0;
+            }
+        } else if (ES_DIGITO(c)) {
+            while (p < fin && ES_DIGITO(*p)) p++;
+            lval->num = valor_numero(lexema, p - lexema);
+            token = NUMERO;
+        } else {
+            switch (c) {
+                case '&': if (p < fin && *p == '&') { p++; token = OP_AND; } break;
+                case '|': if (p < fin && *p == '|') { p++; token = OP_OR; } break;
+                case '=':
+                    if (p < fin && *p == '=') { p++; token = OP_IGUAL; }
+                    else token = OP_ASIGN;
+                    break;
+                case '-': token = OP_RESTA; break;
+                case '+': token = OP_SUMA; break;
+                case '(': token = PARA; break;
+                case ')': token = PARC; break;
+                case '{': token = LLAA; break;
+                case '}': token = LLAC; break;
+                case '[': token = CORA; break;
+                case ']': token = CORC; break;
+                case '*': token = OP_MULT; break;
+                case '/': token = OP_DIV; break;
+                case ';': token = PYC; break;
+                case ',': token = COMA; break;
+                case '>': token = OP_MAYOR; break;
+                case '<': token = OP_MENOR; break;
+            }
+        }
+        if (token >= 0) {
+            ctx->inicio_token = lexema - inicio;
+            ctx->cursor = p - inicio;
+            return token;
+        }
+        /* Carácter no reconocido: se ignora, como la regla '.' de flex */
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef LEXICO_H
+#define LEXICO_H
+
+#include "contexto.h"
+#include "calc-sintaxis.tab.h"
+
+/* ------------------ Lexer escrito a mano con SIMD ------------------ */
+
+/*
+ * Alternativa al lexer de flex con la misma interfaz que yylex: recorre
+ * ctx->fuente desde ctx->cursor y devuelve los mismos tokens con los mismos
+ * valores (NUMERO con el valor de atoi, ID como porción del fuente). Los
+ * espacios y los identificadores se recorren de a 16 bytes con SSE2, o de a
+ * 32 con AVX2 si se compila con -mavx2; sin SSE2 se usa un bucle escalar.
+ */
+
+/* Variante compilada, para los mensajes del benchmark */
+#if defined(__AVX2__)
+#define LEXICO_SIMD_NOMBRE "avx2"
+#elif defined(__SSE2__)
+#define LEXICO_SIMD_NOMBRE "sse2"
+#else
+#define LEXICO_SIMD_NOMBRE "escalar"
+#endif
+
+/* ------------------ Prototipos de funciones ------------------ */
+
+int lexico_simd(YYSTYPE *lval, CompilerContext *ctx);
+
+#endif /* LEXICO_H */
@@ -0,0 +1,426 @@
+/* Biblioteca embebible: compilación a una máquina de pila y su ejecución */
+
+/* Definiciones necesarias para compatibilidad POSIX */
+#define _POSIX_C_SOURCE 200809L
+
+/* Inclusiones de bibliotecas estándar */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libcalc.h"
+#include "ast.h"
+#include "contexto.h"
+#include "recorrido.h"
+
+/* Los códigos públicos son los del contexto, más CALC_ERR_MARCO */
+_Static_assert((int)CALC_ERR_MEMORIA == ERROR_MEMORIA && (int)CALC_ERR_SINTAXIS == ERROR_SINTAXIS &&
+               (int)CALC_ERR_DIVISION_CERO == ERROR_DIVISION_CERO && (int)CALC_ERR_ESCRITURA == ERROR_ESCRITURA,
+               "calc_status_t y CodigoError deben coincidir");
+_Static_assert(CALC_MAX_MENSAJE == ERROR_MAX_MENSAJE, "largo de los mensajes de error");
+
+/* Instrucciones; las binarias toman los dos valores del tope y dejan uno */
+typedef enum {
+    INS_SUMA,
+    INS_RESTA,
+    INS_MULT,
+    INS_DIV,
+    INS_IGUAL,
+    INS_OR,
+    INS_AND,
+    INS_MAYOR,
+    INS_MENOR,
+    INS_CONST,          /* Apila a */
+    INS_CARGAR,         /* Apila la variable a */
+    INS_DECLARAR,       /* Desapila el valor inicial de a y apila 0 */
+    INS_DECLARAR_CERO,  /* Pone a en 0 y apila 0 */
+    INS_ASIGNAR,        /* Copia el tope en a, sin desapilar */
+    INS_DESCARTAR,      /* Desapila el valor de una sentencia */
+    INS_FIN             /* El tope es el resultado */
+} CodigoInstruccion;
+
+/* Una instrucción y su operando */
+typedef struct {
+    int op;
+    int a;
+} Instruccion;
+
+struct calc_prog {
+    Instruccion *codigo;
+    int n_codigo;
+    char **vars;                    /* Nombre de cada slot */
+    int n_vars;
+    int profundidad;                /* Máximo de la pila de valores */
+};
+
+/* Estado de la compilación */
+typedef struct {
+    CompilerContext *ctx;           /* Para registrar los errores */
+    calc_prog_t *p;
+    int cap_codigo;
+    unsigned char inicializada[MAX_SIMBOLOS];   /* Por slot, en este punto */
+    int tope;                       /* Valores en la pila en este punto */
+} Compilador;
+
+/* ------------------ Compilación ------------------ */
+
+/**
+ * Agrega una instrucción al programa y lleva la cuenta de la pila.
+ * @param k Compilador.
+ * @param op Instrucción.
+ * @param a Operando.
+ * @param efecto Valores que apila (negativo si desapila).
+ * @return 0, o -1 sin memoria (con el error en el contexto).
+ */
+static int emitir(Compilador *k, int op, int a, int efecto) {
+    calc_prog_t *p = k->p;
+    if (p->n_codigo == k->cap_codigo) {
+        int cap = k->cap_codigo ? k->cap_codigo * 2 : 64;
+        Instruccion *c = realloc(p->codigo, cap * sizeof(Instruccion));
+        if (!c) {
+            contexto_error(k->ctx, ERROR_MEMORIA, 0, 0, "sin memoria para compilar");
+            return -1;
+        }
+        p->codigo = c;
+        k->cap_codigo = cap;
+    }
+    p->codigo[p->n_codigo++] = (Instruccion){ op, a };
+    k->tope += efecto;
+    if (k->tope > p->profundidad) p->profundidad = k->tope;
+    return 0;
+}
+
+/**
+ * Busca el slot de una variable ya declarada.
+ * @param p Programa.
+ * @param id Nombre.
+ * @return Slot o -1.
+ */
+static int buscar_slot(const calc_prog_t *p, const char *id) {
+    for (int i = 0; i < p->n_vars; ++i) {
+        if (strcmp(p->vars[i], id) == 0) return i;
+    }
+    return -1;
+}
+
+/**
+ * Declara una variable, con los mismos controles que eval_nodo.
+ * @param k Compilador.
+ * @param n Nodo NODO_DECL (nombre y posición para los errores).
+ * @return Slot nuevo, o -1 con el error en el contexto.
+ */
+static int declarar_slot(Compilador *k, const Nodo *n) {
+    calc_prog_t *p = k->p;
+    const char *id = n->assign.id;
+    if (buscar_slot(p, id) >= 0) {
+        contexto_error(k->ctx, ERROR_REDECLARADA, n->linea, n->columna, "variable '%s' ya declarada", id);
+        return -1;
+    }
+    if (p->n_vars >= MAX_SIMBOLOS) {
+        contexto_error(k->ctx, ERROR_TABLA_LLENA, n->linea, n->columna, "tabla de símbolos llena");
+        return -1;
+    }
+    if (p->n_vars % 64 == 0) {
+        char **vars = realloc(p->vars, (p->n_vars + 64) * sizeof(char *));
+        if (!vars) {
+            contexto_error(k->ctx, ERROR_MEMORIA, 0, 0, "sin memoria para compilar");
+            return -1;
+        }
+        p->vars = vars;
+    }
+    if (!(p->vars[p->n_vars] = strdup(id))) {
+        contexto_error(k->ctx, ERROR_MEMORIA, 0, 0, "sin memoria para compilar");
+        return -1;
+    }
+    k->inicializada[p->n_vars] = 0;
+    return p->n_vars++;
+}
+
+/**
+ * Paso de la compilación: emite el código de cada nodo en postorden, en el
+ * mismo orden en que eval_nodo lo evalúa. Como el lenguaje no tiene saltos,
+ * lo que sigue a un return no se emite y el estado de cada variable en cada
+ * punto se conoce al compilar.
+ * @param r Recorrido.
+ * @param m Marco del nodo.
+ * @param arg Compilador.
+ * @return Qué sigue.
+ */
+static int paso_compilar(Recorrido *r, Marco *m, void *arg) {
+    Compilador *k = arg;
+    Nodo *n = m->nodo;
+    int slot, ins;
+    if (!n) return emitir(k, INS_CONST, 0, 1) ? RECORRIDO_ABORTAR : RECORRIDO_FIN;
+
+    switch (n->tipo) {
+        case NODO_INT:
+            return emitir(k, INS_CONST, n->val_int, 1) ? RECORRIDO_ABORTAR : RECORRIDO_FIN;
+        case NODO_BOOL:
+            return emitir(k, INS_CONST, n->val_bool ? 1 : 0, 1) ? RECORRIDO_ABORTAR : RECORRIDO_FIN;
+        case NODO_ID:
+            slot = buscar_slot(k->p, n->nombre);
+            if (slot < 0) {
+                contexto_error(k->ctx, ERROR_NO_DECLARADA, n->linea, n->columna, "variable '%s' no declarada",
+                               n->nombre);
+                return RECORRIDO_ABORTAR;
+            }
+            if (!k->inicializada[slot]) {
+                contexto_error(k->ctx, ERROR_SIN_INICIALIZAR, n->linea, n->columna,
+                               "variable '%s' usada sin inicializar", n->nombre);
+                return RECORRIDO_ABORTAR;
+            }
+            return emitir(k, INS_CARGAR, slot, 1) ? RECORRIDO_ABORTAR : RECORRIDO_FIN;
+        case NODO_DECL:
+            if (m->paso == 0 && n->assign.expr) {
+                m->paso = 1;
+                return recorrido_bajar(r, n->assign.expr, 0);
+            }
+            if ((slot = declarar_slot(k, n)) < 0) return RECORRIDO_ABORTAR;
+            k->inicializada[slot] = m->paso;
+            if (m->paso) return emitir(k, INS_DECLARAR, slot, 0) ? RECORRIDO_ABORTAR : RECORRIDO_FIN;
+            return emitir(k, INS_DECLARAR_CERO, slot, 1) ? RECORRIDO_ABORTAR : RECORRIDO_FIN;
+        case NODO_ASSIGN:
+            if (m->paso == 0) {
+                m->paso = 1;
+                return recorrido_bajar(r, n->assign.expr, 0);
+            }
+            if ((slot = buscar_slot(k->p, n->assign.id)) < 0) {
+                contexto_error(k->ctx, ERROR_NO_DECLARADA, n->linea, n->columna,
+                               "asignación a variable no declarada '%s'", n->assign.id);
+                return RECORRIDO_ABORTAR;
+            }
+            k->inicializada[slot] = 1;
+            return emitir(k, INS_ASIGNAR, slot, 0) ? RECORRIDO_ABORTAR : RECORRIDO_FIN;
+        case NODO_OP:
+        case NODO_OP_RAPIDO:
+            switch (m->paso) {
+                case 0:
+                    m->paso = 1;
+                    return recorrido_bajar(r, n->opBinaria.izq, 0);
+                case 1:
+                    m->paso = 2;
+                    return recorrido_bajar(r, n->opBinaria.der, 0);
+            }
+            switch (n->opBinaria.op) {
+                case TOP_SUMA:  ins = INS_SUMA;  break;
+                case TOP_RESTA: ins = INS_RESTA; break;
+                case TOP_MULT:  ins = INS_MULT;  break;
+                case TOP_DIV:   ins = INS_DIV;   break;
+                case TOP_IGUAL: ins = INS_IGUAL; break;
+                case TOP_OR:    ins = INS_OR;    break;
+                case TOP_AND:   ins = INS_AND;   break;
+                case TOP_MAYOR: ins = INS_MAYOR; break;
+                case TOP_MENOR: ins = INS_MENOR; break;
+                default:
+                    contexto_error(k->ctx, ERROR_NODO_DESCONOCIDO, n->linea, n->columna,
+                                   "operación binaria desconocida %d", n->opBinaria.op);
+                    return RECORRIDO_ABORTAR;
+            }
+            return emitir(k, ins, 0, -1) ? RECORRIDO_ABORTAR : RECORRIDO_FIN;
+        case NODO_SEQ:
+            if (m->paso == 0) {
+                m->paso = 1;
+                if (n->opBinaria.izq) return recorrido_bajar(r, n->opBinaria.izq, 0);
+                if (emitir(k, INS_CONST, 0, 1)) return RECORRIDO_ABORTAR;
+            }
+            /* El valor de la secuencia es el de su última sentencia */
+            if (n->opBinaria.izq && n->opBinaria.izq->tipo == NODO_RETURN) return RECORRIDO_FIN;
+            if (!n->opBinaria.der) return RECORRIDO_FIN;
+            if (emitir(k, INS_DESCARTAR, 0, -1)) return RECORRIDO_ABORTAR;
+            return recorrido_seguir(r, n->opBinaria.der, 0);
+        case NODO_RETURN:
+            return recorrido_seguir(r, n->ret_expr, 0);
+        default:
+            contexto_error(k->ctx, ERROR_NODO_DESCONOCIDO, n->linea, n->columna,
+                           "calc_compile no soporta tipo de nodo %d", n->tipo);
+            return RECORRIDO_ABORTAR;
+    }
+}
+
+/**
+ * Traduce el AST a un programa.
+ * @param ctx Contexto de la compilación (errores).
+ * @param raiz Raíz del AST (puede ser NULL).
+ * @return Programa, o NULL con el error en el contexto.
+ */
+static calc_prog_t *compilar_programa(CompilerContext *ctx, Nodo *raiz) {
+    Compilador *k = calloc(1, sizeof(Compilador));
+    calc_prog_t *p = calloc(1, sizeof(calc_prog_t));
+    if (!k || !p) {
+        free(k);
+        free(p);
+        contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para compilar");
+        return NULL;
+    }
+    k->ctx = ctx;
+    k->p = p;
+
+    Recorrido r;
+    recorrido_ejecutar(&r, raiz, 0, paso_compilar, k);
+    if (r.sin_memoria) contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para compilar");
+    if (!contexto_fallo(ctx)) emitir(k, INS_FIN, 0, 0);
+    free(k);
+    if (contexto_fallo(ctx)) {
+        calc_free(p);
+        return NULL;
+    }
+    return p;
+}
+
+/**
+ * Compila un programa.
+ * @param src Fuente (no necesita NUL final).
+ * @param largo Largo del fuente.
+ * @param opts Lexer y parser (NULL = los de siempre).
+ * @param error Donde dejar el error (puede ser NULL).
+ * @return Programa, o NULL si hubo un error.
+ */
+calc_prog_t *calc_compile(const char *src, size_t largo, const calc_opts_t *opts, calc_error_t *error) {
+    if (error) memset(error, 0, sizeof(*error));
+
+    /* El lexer necesita el texto seguido de dos NUL y poder escribirlo */
+    CompilerContext *ctx = calloc(1, sizeof(CompilerContext));
+    char *texto = malloc(largo + 2);
+    if (!ctx || !texto) {
+        free(ctx);
+        free(texto);
+        if (error) {
+            error->codigo = CALC_ERR_MEMORIA;
+            snprintf(error->mensaje, sizeof(error->mensaje), "sin memoria para compilar");
+        }
+        return NULL;
+    }
+    contexto_inicializar(ctx, NULL);
+    ctx->errores = NULL;
+    if (opts && opts->lexer != CALC_LEXER_DEFECTO) ctx->lexer = opts->lexer == CALC_LEXER_SIMD ? LEXER_SIMD : LEXER_FLEX;
+    if (opts && opts->parser == CALC_PARSER_MANO) ctx->parser = PARSER_MANO;
+    memcpy(texto, src, largo);
+    texto[largo] = texto[largo + 1] = '\0';
+    contexto_prestar_fuente(ctx, texto, largo);
+
+    Nodo *raiz = NULL;
+    calc_prog_t *p = NULL;
+    if (contexto_parsear(ctx, NULL, &raiz) == 0 && !contexto_fallo(ctx)) p = compilar_programa(ctx, raiz);
+
+    if (error && contexto_fallo(ctx)) {
+        error->codigo = (calc_status_t)ctx->error.codigo;
+        error->linea = ctx->error.linea;
+        error->columna = ctx->error.columna;
+        memcpy(error->mensaje, ctx->error.mensaje, sizeof(error->mensaje));
+    }
+    nodo_libre(ctx, raiz);
+    contexto_destruir(ctx);
+    free(texto);
+    return p;
+}
+
+/* ------------------ Ejecución ------------------ */
+
+/**
+ * Ejecuta un programa compilado. No reserva memoria: las variables y la pila
+ * de valores están en el marco del llamador.
+ * @param prog Programa.
+ * @param frame Marco con al menos calc_frame_slots(prog) enteros.
+ * @return CALC_OK (el valor queda en frame->resultado), CALC_ERR_DIVISION_CERO
+ *         o CALC_ERR_MARCO. Tras un error los slots no tienen un valor definido.
+ */
+calc_status_t calc_run(const calc_prog_t *prog, calc_frame_t *frame) {
+    if (!frame->slots || frame->n_slots < calc_frame_slots(prog)) return CALC_ERR_MARCO;
+    int *vars = frame->slots;
+    int *tope = frame->slots + prog->n_vars;     /* Primer lugar libre de la pila */
+
+    for (const Instruccion *i = prog->codigo;; ++i) {
+        switch (i->op) {
+            case INS_SUMA:  tope[-2] = tope[-2] + tope[-1]; --tope; break;
+            case INS_RESTA: tope[-2] = tope[-2] - tope[-1]; --tope; break;
+            case INS_MULT:  tope[-2] = tope[-2] * tope[-1]; --tope; break;
+            case INS_DIV:
+                if (tope[-1] == 0) return CALC_ERR_DIVISION_CERO;
+                /* Como aplicar_op: dividir por -1 es negar, INT_MIN / -1 da INT_MIN */
+                tope[-2] = tope[-1] == -1 ? (int)(0u - (unsigned)tope[-2]) : tope[-2] / tope[-1];
+                --tope;
+                break;
+            case INS_IGUAL: tope[-2] = tope[-2] == tope[-1]; --tope; break;
+            case INS_OR:    tope[-2] = (tope[-2] != 0) || (tope[-1] != 0); --tope; break;
+            case INS_AND:   tope[-2] = (tope[-2] != 0) && (tope[-1] != 0); --tope; break;
+            case INS_MAYOR: tope[-2] = tope[-2] > tope[-1]; --tope; break;
+            case INS_MENOR: tope[-2] = tope[-2] < tope[-1]; --tope; break;
+            case INS_CONST:  *tope++ = i->a; break;
+            case INS_CARGAR: *tope++ = vars[i->a]; break;
+            case INS_DECLARAR:
+                vars[i->a] = tope[-1];
+                tope[-1] = 0;
+                break;
+            case INS_DECLARAR_CERO:
+                vars[i->a] = 0;
+                *tope++ = 0;
+                break;
+            case INS_ASIGNAR:   vars[i->a] = tope[-1]; break;
+            case INS_DESCARTAR: --tope; break;
+            default:    /* INS_FIN */
+                frame->resultado = tope[-1];
+                return CALC_OK;
+        }
+    }
+}
+
+/**
+ * Libera un programa compilado.
+ * @param prog Programa (puede ser NULL).
+ */
+void calc_free(calc_prog_t *prog) {
+    if (!prog) return;
+    for (int i = 0; i < prog->n_vars; ++i) free(prog->vars[i]);
+    free(prog->vars);
+    free(prog->codigo);
+    free(prog);
+}
+
+/* ------------------ Consultas ------------------ */
+
+/**
+ * Tamaño mínimo del marco de un programa.
+ * @param prog Programa.
+ * @return Enteros: las variables más la pila de valores.
+ */
+size_t calc_frame_slots(const calc_prog_t *prog) {
+    return (size_t)prog->n_vars + (size_t)prog->profundidad;
+}
+
+/**
+ * Cantidad de variables (ocupan los primeros slots del marco).
+ * @param prog Programa.
+ * @return Cantidad de variables.
+ */
+int calc_var_count(const calc_prog_t *prog) {
+    return prog->n_vars;
+}
+
+/**
+ * Nombre de la variable de un slot.
+ * @param prog Programa.
+ * @param slot Slot.
+ * @return Nombre, o NULL si el slot no es de una variable.
+ */
+const char *calc_var_name(const calc_prog_t *prog, int slot) {
+    return slot >= 0 && slot < prog->n_vars ? prog->vars[slot] : NULL;
+}
+
+/**
+ * Slot de una variable.
+ * @param prog Programa.
+ * @param nombre Nombre.
+ * @return Slot, o -1 si el programa no la declara.
+ */
+int calc_var_slot(const calc_prog_t *prog, const char *nombre) {
+    return buscar_slot(prog, nombre);
+}
+
+/**
+ * Nombre corto de un código de resultado.
+ * @param codigo Código.
+ * @return "memoria", "sintaxis", ..., "marco".
+ */
+const char *calc_status_name(calc_status_t codigo) {
+    if (codigo == CALC_ERR_MARCO) return "marco";
+    return error_nombre((CodigoError)codigo);
+}
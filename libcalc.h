@@ -0,0 +1,110 @@
+#ifndef LIBCALC_H
+#define LIBCALC_H
+
+#include <stddef.h>
+
+/* ------------------ Biblioteca embebible (libcalc.a / libcalc.so) ------------------ */
+
+/*
+ * Compilar una vez, ejecutar muchas. calc_compile analiza el fuente y lo
+ * traduce a un programa inmutable: una secuencia de instrucciones de una
+ * máquina de pila con las variables ya resueltas a slots. Los errores de
+ * variables (no declaradas, sin inicializar, redeclaradas) se detectan al
+ * compilar; en ejecución sólo puede fallar una división por cero.
+ *
+ * calc_run no reserva memoria ni toca nada global: todo lo que escribe está
+ * en el marco que le pasa el llamador. Un mismo programa puede ejecutarse a
+ * la vez desde varios hilos, cada uno con su marco.
+ *
+ *     calc_error_t err;
+ *     calc_prog_t *p = calc_compile(src, strlen(src), NULL, &err);
+ *     int slots[256];
+ *     calc_frame_t f = { slots, 256, 0 };
+ *     if (p && calc_frame_slots(p) <= 256 && calc_run(p, &f) == CALC_OK)
+ *         printf("%d\n", f.resultado);
+ *     calc_free(p);
+ *
+ * Este encabezado es todo lo público: no depende de ast.h ni de contexto.h.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Símbolos que exporta libcalc.so (se compila con -fvisibility=hidden) */
+#if defined(__GNUC__)
+#define CALC_API __attribute__((visibility("default")))
+#else
+#define CALC_API
+#endif
+
+/* Largo máximo del mensaje de un error, con el NUL */
+#define CALC_MAX_MENSAJE 256
+
+/* Resultado de calc_compile y calc_run; mismos valores que CodigoError */
+typedef enum {
+    CALC_OK,
+    CALC_ERR_MEMORIA,
+    CALC_ERR_SINTAXIS,
+    CALC_ERR_NO_DECLARADA,
+    CALC_ERR_REDECLARADA,
+    CALC_ERR_SIN_INICIALIZAR,
+    CALC_ERR_DIVISION_CERO,
+    CALC_ERR_TABLA_LLENA,
+    CALC_ERR_NODO_DESCONOCIDO,
+    CALC_ERR_INTERNO,
+    CALC_ERR_ESCRITURA,         /* Sólo del driver: la biblioteca no escribe archivos */
+    CALC_ERR_MARCO              /* El marco tiene menos de calc_frame_slots */
+} calc_status_t;
+
+/* Error de compilación y dónde ocurrió (0 = posición desconocida) */
+typedef struct {
+    calc_status_t codigo;
+    int linea;
+    int columna;
+    char mensaje[CALC_MAX_MENSAJE];
+} calc_error_t;
+
+/* Lexer y parser de calc_compile; un struct en cero usa los de siempre */
+typedef enum { CALC_LEXER_DEFECTO, CALC_LEXER_FLEX, CALC_LEXER_SIMD } calc_lexer_t;
+typedef enum { CALC_PARSER_DEFECTO, CALC_PARSER_BISON, CALC_PARSER_MANO } calc_parser_t;
+
+typedef struct {
+    calc_lexer_t lexer;
+    calc_parser_t parser;
+} calc_opts_t;
+
+/* Programa compilado (opaco e inmutable) */
+typedef struct calc_prog calc_prog_t;
+
+/* Marco de una ejecución, en memoria del llamador. Los primeros
+   calc_var_count enteros son las variables; el resto, la pila de valores. */
+typedef struct {
+    int *slots;
+    size_t n_slots;             /* Enteros disponibles en slots */
+    int resultado;              /* Valor del programa si calc_run dio CALC_OK */
+} calc_frame_t;
+
+/* ------------------ Prototipos de funciones ------------------ */
+
+/* Compila src (largo bytes, no hace falta el NUL). opts y error pueden ser
+   NULL. Devuelve NULL si hubo un error, que queda en *error. */
+CALC_API calc_prog_t *calc_compile(const char *src, size_t largo,
+                                   const calc_opts_t *opts, calc_error_t *error);
+
+/* Ejecuta el programa sobre el marco; CALC_OK o el error de ejecución */
+CALC_API calc_status_t calc_run(const calc_prog_t *prog, calc_frame_t *frame);
+
+CALC_API void calc_free(calc_prog_t *prog);
+
+CALC_API size_t calc_frame_slots(const calc_prog_t *prog);     /* Tamaño mínimo del marco */
+CALC_API int calc_var_count(const calc_prog_t *prog);
+CALC_API const char *calc_var_name(const calc_prog_t *prog, int slot);
+CALC_API int calc_var_slot(const calc_prog_t *prog, const char *nombre); /* -1 si no está */
+CALC_API const char *calc_status_name(calc_status_t codigo);   /* "memoria", "sintaxis", ... */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBCALC_H */
@@ -0,0 +1,157 @@
+/* Tokenización en paralelo: el fuente en trozos, cada uno en el planificador */
+
+/* Inclusiones de bibliotecas estándar */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "tokens.h"
+#include "lexico.h"
+#include "planificador.h"
+
+/* Tamaño mínimo de un trozo */
+#define TROZO_MINIMO (256 * 1024)
+
+/* Trozos por hilo, para que el robo de trabajo equilibre la carga */
+#define TROZOS_POR_HILO 4
+
+/* Un trozo del fuente tokenizado por separado */
+typedef struct {
+    const CompilerContext *padre;
+    size_t inicio;                  /* Desplazamiento del trozo en el fuente */
+    size_t fin;
+    Tokens tokens;                  /* Desplazamientos relativos al trozo */
+    int fallo;                      /* No hubo memoria para tokenizarlo */
+} Trozo;
+
+/**
+ * Busca el primer corte válido a partir de una posición: justo después de un
+ * ';' seguido de un espacio. Como ';' es siempre un token de un carácter y el
+ * espacio no forma parte de ningún lexema, ningún token queda partido.
+ * @param fuente Texto.
+ * @param desde Posición donde empezar a buscar.
+ * @param largo Largo del texto.
+ * @return Posición del corte, o largo si no hay ninguno.
+ */
+static size_t buscar_corte(const char *fuente, size_t desde, size_t largo) {
+    const char *p = fuente + desde;
+    const char *fin = fuente + largo;
+    while ((p = memchr(p, ';', fin - p)) != NULL) {
+        p++;
+        if (p < fin && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+            return (size_t)(p - fuente);
+    }
+    return largo;
+}
+
+/**
+ * Tarea de tokens_lexear_paralelo: tokeniza un trozo con un contexto propio.
+ * El lexer a mano lo recorre en el lugar; flex necesita dos NUL al final, así
+ * que recibe una copia del trozo. Si no hay memoria marca el trozo, sin
+ * informar nada: el error lo registra tokens_lexear_paralelo en el contexto
+ * de la compilación.
+ * @param i Índice del trozo.
+ * @param hilo Hilo que la ejecuta (no se usa).
+ * @param arg Arreglo de trozos.
+ */
+static void lexear_trozo(int i, int hilo, void *arg) {
+    (void)hilo;
+    Trozo *tr = &((Trozo *)arg)[i];
+    size_t largo = tr->fin - tr->inicio;
+
+    CompilerContext *c = contexto_crear(NULL);
+    if (!c) {
+        tr->fallo = 1;
+        return;
+    }
+    c->errores = NULL;
+    c->lexer = tr->padre->lexer;
+    if (c->lexer == LEXER_FLEX) {
+        c->fuente = malloc(largo + 2);
+        if (!c->fuente) {
+            tr->fallo = 1;
+            contexto_destruir(c);
+            return;
+        }
+        memcpy(c->fuente, tr->padre->fuente + tr->inicio, largo);
+        c->fuente[largo] = c->fuente[largo + 1] = '\0';
+    } else {
+        c->fuente = tr->padre->fuente + tr->inicio;
+    }
+    c->largo_fuente = largo;
+
+    if (contexto_preparar_lexico(c) != 0 || tokens_lexear(c, &tr->tokens) != 0) tr->fallo = 1;
+    if (c->lexer != LEXER_FLEX) c->fuente = NULL;     /* No es nuestro */
+    contexto_terminar_lexico(c);
+    contexto_destruir(c);
+}
+
+/**
+ * Tokeniza ctx->fuente en paralelo: lo parte en trozos después de ';' seguido
+ * de espacio, tokeniza cada trozo en el grupo de hilos y concatena los
+ * arreglos en orden, corrigiendo los desplazamientos. Como las líneas se
+ * calculan a partir del desplazamiento, los errores informan la misma línea
+ * que con la tokenización secuencial.
+ * @param ctx Contexto con el fuente ya cargado (ctx->hilos_lexico hilos).
+ * @param t Arreglo (vacío) a completar.
+ * @return 0, o -1 como tokens_lexear.
+ */
+int tokens_lexear_paralelo(CompilerContext *ctx, Tokens *t) {
+    int hilos = ctx->hilos_lexico;
+    size_t largo = ctx->largo_fuente;
+    int n = hilos * TROZOS_POR_HILO;
+    if ((size_t)n > largo / TROZO_MINIMO) n = (int)(largo / TROZO_MINIMO);
+    if (n < 2) return tokens_lexear(ctx, t);
+    if (tokens_comprobar_largo(ctx) != 0) return -1;
+
+    double t0 = stats_reloj();
+    Trozo *trozos = calloc(n, sizeof(Trozo));
+    if (!trozos) {
+        contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para los tokens");
+        return -1;
+    }
+    int usados = 0;
+    size_t inicio = 0;
+    for (int i = 1; i <= n && inicio < largo; ++i) {
+        size_t fin = i == n ? largo : buscar_corte(ctx->fuente, largo / n * i, largo);
+        if (fin <= inicio) continue;
+        trozos[usados].padre = ctx;
+        trozos[usados].inicio = inicio;
+        trozos[usados].fin = fin;
+        tokens_iniciar(&trozos[usados].tokens);
+        usados++;
+        inicio = fin;
+    }
+
+    planificador_ejecutar(usados, hilos, lexear_trozo, trozos, NULL);
+
+    /* Concatenar sin los fines de entrada intermedios */
+    size_t total = 1;
+    int fallo = 0;
+    for (int i = 0; i < usados; ++i) {
+        total += trozos[i].tokens.n - 1;
+        fallo |= trozos[i].fallo;
+    }
+    if (fallo || tokens_reservar(t, total) != 0) {
+        for (int i = 0; i < usados; ++i) tokens_liberar(&trozos[i].tokens);
+        free(trozos);
+        contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para los tokens");
+        return -1;
+    }
+    for (int i = 0; i < usados; ++i) {
+        Tokens *p = &trozos[i].tokens;
+        size_t m = p->n - 1;
+        memcpy(t->tipo + t->n, p->tipo, m * sizeof(uint8_t));
+        memcpy(t->valor + t->n, p->valor, m * sizeof(int32_t));
+        for (size_t k = 0; k < m; ++k)
+            t->desplazamiento[t->n + k] = (uint32_t)(trozos[i].inicio + p->desplazamiento[k]);
+        t->n += m;
+        tokens_liberar(p);
+    }
+    tokens_agregar(t, 0, 0, largo);     /* Entra: se reservó total */
+    free(trozos);
+
+    ctx->stats.tiempo[FASE_LEXICO] += stats_reloj() - t0;
+    ctx->stats.tokens += t->n;
+    return 0;
+}
@@ -0,0 +1,282 @@
+/* Perfil de ejecución de eval_nodo: registros por nodo, informe y pilas plegadas */
+
+/* Definiciones necesarias para compatibilidad POSIX */
+#define _POSIX_C_SOURCE 200809L
+
+/* Inclusiones de bibliotecas estándar */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "perfil.h"
+#include "stats.h"
+
+/* Registros que entran antes de crecer (la tabla tiene el doble de lugares) */
+#define PERFIL_INICIAL 1024
+
+/* Una fila de las tablas del informe */
+typedef struct {
+    uint64_t ciclos;
+    int registro;
+} Fila;
+
+/**
+ * Crea un perfil vacío.
+ * @return El perfil, o NULL si no hubo memoria.
+ */
+Perfil *perfil_crear(void) {
+    Perfil *p = calloc(1, sizeof(Perfil));
+    if (!p) return NULL;
+    p->registros = malloc(PERFIL_INICIAL * sizeof(RegistroPerfil));
+    p->tabla = malloc(2 * PERFIL_INICIAL * sizeof(int));
+    if (!p->registros || !p->tabla) {
+        perfil_destruir(p);
+        return NULL;
+    }
+    p->cap = PERFIL_INICIAL;
+    p->cap_tabla = 2 * PERFIL_INICIAL;
+    memset(p->tabla, 0xff, p->cap_tabla * sizeof(int));
+    return p;
+}
+
+/**
+ * Libera un perfil.
+ * @param p Perfil (puede ser NULL).
+ */
+void perfil_destruir(Perfil *p) {
+    if (!p) return;
+    free(p->registros);
+    free(p->tabla);
+    free(p);
+}
+
+/**
+ * Posición inicial de un nodo en la tabla de dispersión.
+ * @param n Nodo.
+ * @param cap Lugares de la tabla (potencia de 2).
+ * @return Índice en la tabla.
+ */
+static size_t dispersar(const Nodo *n, size_t cap) {
+    uint64_t h = (uint64_t)(uintptr_t)n * 0x9E3779B97F4A7C15ULL;
+    return (size_t)(h >> 32) & (cap - 1);
+}
+
+/**
+ * Hace lugar para un registro más: agranda el arreglo si está lleno y la
+ * tabla si quedaría ocupada en más de la mitad.
+ * @param p Perfil.
+ * @return 0, o -1 si no hubo memoria (el perfil queda como estaba).
+ */
+static int crecer(Perfil *p) {
+    if (p->n == p->cap) {
+        RegistroPerfil *registros = realloc(p->registros, 2 * p->cap * sizeof(RegistroPerfil));
+        if (!registros) return -1;
+        p->registros = registros;
+        p->cap *= 2;
+    }
+    if (2 * ((size_t)p->n + 1) <= p->cap_tabla) return 0;
+
+    size_t cap = 2 * p->cap_tabla;
+    int *tabla = malloc(cap * sizeof(int));
+    if (!tabla) return -1;
+    memset(tabla, 0xff, cap * sizeof(int));
+    for (int i = 0; i < p->n; ++i) {
+        size_t j = dispersar(p->registros[i].nodo, cap);
+        while (tabla[j] >= 0) j = (j + 1) & (cap - 1);
+        tabla[j] = i;
+    }
+    free(p->tabla);
+    p->tabla = tabla;
+    p->cap_tabla = cap;
+    return 0;
+}
+
+/**
+ * Cuenta una ejecución de un nodo. La primera crea su registro, colgado del
+ * padre que se indica.
+ * @param p Perfil.
+ * @param n Nodo en el que se entra.
+ * @param padre Registro del padre (-1 = nivel superior).
+ * @return Registro del nodo, o -1 si no hubo memoria.
+ */
+int perfil_entrar(Perfil *p, const Nodo *n, int padre) {
+    size_t mascara = p->cap_tabla - 1;
+    size_t j = dispersar(n, p->cap_tabla);
+    for (; p->tabla[j] >= 0; j = (j + 1) & mascara) {
+        RegistroPerfil *r = &p->registros[p->tabla[j]];
+        if (r->nodo == n) {
+            r->ejecuciones++;
+            return p->tabla[j];
+        }
+    }
+
+    if (crecer(p) != 0) return -1;
+    mascara = p->cap_tabla - 1;
+    for (j = dispersar(n, p->cap_tabla); p->tabla[j] >= 0; j = (j + 1) & mascara) continue;
+    p->tabla[j] = p->n;
+    p->registros[p->n] = (RegistroPerfil){ n, padre, 1, 0 };
+    return p->n++;
+}
+
+/**
+ * Escribe el tipo de un nodo y lo que lo distingue ("ASSIGN x", "OP +", "INT 4").
+ * @param f Destino.
+ * @param n Nodo.
+ */
+static void escribir_nodo(FILE *f, const Nodo *n) {
+    fputs(stats_nombre_nodo(n->tipo), f);
+    switch (n->tipo) {
+        case NODO_ID:
+            fprintf(f, " %s", n->nombre);
+            break;
+        case NODO_DECL:
+        case NODO_ASSIGN:
+            fprintf(f, " %s", n->assign.id);
+            break;
+        case NODO_OP:
+        case NODO_OP_RAPIDO:
+            fprintf(f, " %s", texto_op(n->opBinaria.op));
+            break;
+        case NODO_INT:
+            fprintf(f, " %d", n->val_int);
+            break;
+        case NODO_BOOL:
+            fputs(n->val_bool ? " true" : " false", f);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Compara dos filas para qsort: más ciclos primero y, a igual costo, en el
+ * orden de ejecución.
+ * @param a Primera fila.
+ * @param b Segunda fila.
+ * @return Negativo si a va antes.
+ */
+static int comparar_filas(const void *a, const void *b) {
+    const Fila *x = a, *y = b;
+    if (x->ciclos != y->ciclos) return x->ciclos > y->ciclos ? -1 : 1;
+    return x->registro - y->registro;
+}
+
+/**
+ * Imprime las filas más costosas de una tabla del informe.
+ * @param p Perfil.
+ * @param f Destino.
+ * @param titulo Encabezado de la tabla.
+ * @param filas Filas, ya ordenadas.
+ * @param n Cantidad de filas.
+ * @param total Ciclos de todo el programa, para el porcentaje.
+ */
+static void imprimir_filas(const Perfil *p, FILE *f, const char *titulo, const Fila *filas,
+                           int n, uint64_t total) {
+    fprintf(f, "%s\n", titulo);
+    fprintf(f, "  %-11s %11s %15s %7s  %s\n", "linea:col", "ejecuciones", PERFIL_UNIDAD, "%", "nodo");
+    for (int i = 0; i < n && i < PERFIL_FILAS; ++i) {
+        const RegistroPerfil *r = &p->registros[filas[i].registro];
+        char posicion[32];
+        snprintf(posicion, sizeof(posicion), "%d:%d", r->nodo->linea, r->nodo->columna);
+        fprintf(f, "  %-11s %11lu %15llu %6.2f%%  ", posicion, r->ejecuciones,
+                (unsigned long long)filas[i].ciclos, total ? 100.0 * filas[i].ciclos / total : 0.0);
+        escribir_nodo(f, r->nodo);
+        fputc('\n', f);
+    }
+}
+
+/**
+ * Informa las declaraciones y sentencias de nivel superior más costosas,
+ * contando los ciclos de sus expresiones, y los nodos con más ciclos propios.
+ * @param p Perfil, con los nodos medidos todavía vivos.
+ * @param f Destino.
+ */
+void perfil_informe(const Perfil *p, FILE *f) {
+    uint64_t *con_hijos = malloc(((size_t)p->n + 1) * sizeof(uint64_t));
+    Fila *sentencias = malloc(((size_t)p->n + 1) * sizeof(Fila));
+    Fila *nodos = malloc(((size_t)p->n + 1) * sizeof(Fila));
+    if (!con_hijos || !sentencias || !nodos) {
+        fprintf(f, "Error: sin memoria para el informe del perfil\n");
+        free(con_hijos);
+        free(sentencias);
+        free(nodos);
+        return;
+    }
+
+    /* Cada registro está después de su padre: de atrás para adelante, cada
+       uno ya sumó a todos sus descendientes cuando se lo suma al padre */
+    uint64_t total = 0;
+    unsigned long ejecuciones = 0;
+    for (int i = 0; i < p->n; ++i) {
+        con_hijos[i] = p->registros[i].propio;
+        total += p->registros[i].propio;
+        ejecuciones += p->registros[i].ejecuciones;
+    }
+    for (int i = p->n - 1; i >= 0; --i) {
+        if (p->registros[i].padre >= 0) con_hijos[p->registros[i].padre] += con_hijos[i];
+    }
+
+    int n_sentencias = 0;
+    for (int i = 0; i < p->n; ++i) {
+        const RegistroPerfil *r = &p->registros[i];
+        nodos[i] = (Fila){ r->propio, i };
+        if (r->padre < 0 && r->nodo->tipo != NODO_SEQ)
+            sentencias[n_sentencias++] = (Fila){ con_hijos[i], i };
+    }
+    qsort(sentencias, n_sentencias, sizeof(Fila), comparar_filas);
+    qsort(nodos, p->n, sizeof(Fila), comparar_filas);
+
+    fprintf(f, "Perfil de eval_nodo: %d nodos, %lu ejecuciones, %llu %s\n",
+            p->n, ejecuciones, (unsigned long long)total, PERFIL_UNIDAD);
+    imprimir_filas(p, f, "Sentencias más costosas (con sus expresiones):", sentencias, n_sentencias, total);
+    imprimir_filas(p, f, "Nodos más costosos (sólo su propio trabajo):", nodos, p->n, total);
+
+    free(con_hijos);
+    free(sentencias);
+    free(nodos);
+}
+
+/**
+ * Escribe una línea por nodo con la pila que lleva hasta él y sus ciclos
+ * propios, en el formato plegado de flamegraph.pl. Las secuencias no son un
+ * marco: su costo (recorrer la cadena) se suma al del marco del que cuelgan,
+ * que para las de nivel superior es "main".
+ * @param p Perfil, con los nodos medidos todavía vivos.
+ * @param f Destino.
+ * @return 0, o -1 si no hubo memoria o falló la escritura.
+ */
+int perfil_escribir_pilas(const Perfil *p, FILE *f) {
+    uint64_t *secuencias = calloc((size_t)p->n + 1, sizeof(uint64_t));
+    int *camino = malloc(((size_t)p->n + 1) * sizeof(int));
+    if (!secuencias || !camino) {
+        free(secuencias);
+        free(camino);
+        return -1;
+    }
+
+    /* secuencias[padre + 1]: lo de las secuencias que cuelgan de ese registro */
+    for (int i = 0; i < p->n; ++i) {
+        const RegistroPerfil *r = &p->registros[i];
+        if (r->nodo->tipo == NODO_SEQ) secuencias[r->padre + 1] += r->propio;
+    }
+    if (secuencias[0]) fprintf(f, "main %llu\n", (unsigned long long)secuencias[0]);
+
+    for (int i = 0; i < p->n; ++i) {
+        const RegistroPerfil *r = &p->registros[i];
+        uint64_t ciclos = r->propio + secuencias[i + 1];
+        if (r->nodo->tipo == NODO_SEQ || ciclos == 0) continue;
+        int k = 0;
+        for (int j = i; j >= 0; j = p->registros[j].padre) camino[k++] = j;
+        fputs("main", f);
+        while (k > 0) {
+            const Nodo *n = p->registros[camino[--k]].nodo;
+            fputc(';', f);
+            escribir_nodo(f, n);
+            fprintf(f, " (%d:%d)", n->linea, n->columna);
+        }
+        fprintf(f, " %llu\n", (unsigned long long)ciclos);
+    }
+
+    free(secuencias);
+    free(camino);
+    return ferror(f) ? -1 : 0;
+}
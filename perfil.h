@@ -0,0 +1,81 @@
+#ifndef PERFIL_H
+#define PERFIL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "ast.h"
+
+/* ------------------ Perfil de ejecución de eval_nodo (--profile) ------------------ */
+
+/*
+ * Con ctx->perfil puesto, eval_nodo mide cada llamada a su función de paso y
+ * se la carga al nodo del marco: son los ciclos propios del nodo, sin los de
+ * sus hijos, que se miden en sus propias llamadas. Cada nodo tiene un
+ * registro, creado la primera vez que se entra en él, con cuántas veces se
+ * ejecutó, sus ciclos propios y el registro de su padre.
+ *
+ * Las secuencias son transparentes: los hijos de un NODO_SEQ cuelgan del
+ * padre de la secuencia, así que las declaraciones y sentencias de nivel
+ * superior no tienen padre y una cadena larga de NODO_SEQ no se convierte
+ * en una pila igual de profunda.
+ *
+ * Con el AST todavía vivo, perfil_informe lista las sentencias y los nodos
+ * más costosos con su línea y columna, y perfil_escribir_pilas escribe las
+ * pilas en el formato plegado de flamegraph.pl:
+ *
+ *     main;ASSIGN x (3:5);OP + (3:11);ID y (3:9) 812
+ */
+
+/* Reloj del perfil: el contador de ciclos donde lo hay, si no nanosegundos */
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PERFIL_UNIDAD "ciclos"
+static inline uint64_t perfil_ciclos(void) {
+    return __rdtsc();
+}
+#else
+#include <time.h>
+#define PERFIL_UNIDAD "ns"
+static inline uint64_t perfil_ciclos(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+#endif
+
+/* Filas de cada tabla de perfil_informe */
+#define PERFIL_FILAS 20
+
+/* Lo medido de un nodo */
+typedef struct {
+    const Nodo *nodo;
+    int padre;                  /* Registro del padre (-1 = nivel superior) */
+    unsigned long ejecuciones;
+    uint64_t propio;            /* Ciclos de sus pasos, sin los de sus hijos */
+} RegistroPerfil;
+
+typedef struct Perfil {
+    RegistroPerfil *registros;  /* En orden de primera ejecución: el padre antes */
+    int n;
+    int cap;
+    int *tabla;                 /* Nodo -> registro (dispersión abierta, -1 = libre) */
+    size_t cap_tabla;           /* Potencia de 2 */
+} Perfil;
+
+/* ------------------ Prototipos de funciones ------------------ */
+
+Perfil *perfil_crear(void);                     /* NULL si no hubo memoria */
+void perfil_destruir(Perfil *p);
+
+/* Cuenta una ejecución de n, creando su registro si es la primera.
+   Devuelve el registro, o -1 si no hubo memoria. */
+int perfil_entrar(Perfil *p, const Nodo *n, int padre);
+
+/* Informe de las sentencias (ciclos con sus hijos) y los nodos (ciclos
+   propios) más costosos; los nodos tienen que seguir vivos */
+void perfil_informe(const Perfil *p, FILE *f);
+
+/* Pilas plegadas para flamegraph.pl; devuelve 0, o -1 si falló la escritura */
+int perfil_escribir_pilas(const Perfil *p, FILE *f);
+
+#endif /* PERFIL_H */
@@ -0,0 +1,199 @@
+/* Grupo de hilos con deques de robo de trabajo (Chase-Lev) */
+
+/* Definiciones necesarias para compatibilidad POSIX */
+#define _POSIX_C_SOURCE 200809L
+
+/* Inclusiones de bibliotecas estándar */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "planificador.h"
+#include "stats.h"
+
+/* Resultados de sacar una tarea de una deque */
+#define DEQUE_VACIA   -1
+#define DEQUE_CARRERA -2            /* Otro hilo ganó la tarea: reintentar */
+
+/*
+ * Deque de Chase-Lev de capacidad fija. El dueño apila y desapila por
+ * 'abajo'; los ladrones sólo avanzan 'arriba' con una comparación atómica.
+ * Todas las tareas se cargan antes de lanzar los hilos, así que no hace falta
+ * crecer el arreglo.
+ */
+typedef struct {
+    atomic_long arriba;
+    atomic_long abajo;
+    int *tareas;
+} Deque;
+
+/* Estado de cada hilo trabajador */
+typedef struct {
+    Deque deque;
+    int id;
+    struct Grupo *grupo;
+    ResumenHilo resumen;
+} Trabajador;
+
+/* Estado compartido del grupo de hilos */
+typedef struct Grupo {
+    Trabajador *trabajadores;
+    int hilos;
+    atomic_int pendientes;          /* Tareas todavía sin terminar */
+    FnTarea fn;
+    void *arg;
+} Grupo;
+
+/**
+ * Agrega una tarea por abajo. Sólo la usa el dueño de la deque.
+ * @param d Deque.
+ * @param tarea Índice de la tarea.
+ */
+static void deque_apilar(Deque *d, int tarea) {
+    long b = atomic_load(&d->abajo);
+    d->tareas[b] = tarea;
+    atomic_store(&d->abajo, b + 1);
+}
+
+/**
+ * Saca la última tarea apilada. Sólo la usa el dueño de la deque.
+ * @param d Deque.
+ * @return Índice de la tarea o DEQUE_VACIA.
+ */
+static int deque_desapilar(Deque *d) {
+    long b = atomic_load(&d->abajo) - 1;
+    atomic_store(&d->abajo, b);
+    long a = atomic_load(&d->arriba);
+    if (a > b) {                    /* Estaba vacía */
+        atomic_store(&d->abajo, b + 1);
+        return DEQUE_VACIA;
+    }
+    int tarea = d->tareas[b];
+    if (a == b) {                   /* Última tarea: competimos con los ladrones */
+        if (!atomic_compare_exchange_strong(&d->arriba, &a, a + 1)) tarea = DEQUE_VACIA;
+        atomic_store(&d->abajo, b + 1);
+    }
+    return tarea;
+}
+
+/**
+ * Roba la tarea más antigua de una deque ajena.
+ * @param d Deque de otro hilo.
+ * @return Índice de la tarea, DEQUE_VACIA o DEQUE_CARRERA.
+ */
+static int deque_robar(Deque *d) {
+    long a = atomic_load(&d->arriba);
+    long b = atomic_load(&d->abajo);
+    if (a >= b) return DEQUE_VACIA;
+    int tarea = d->tareas[a];
+    if (!atomic_compare_exchange_strong(&d->arriba, &a, a + 1)) return DEQUE_CARRERA;
+    return tarea;
+}
+
+/**
+ * Busca una tarea para robar recorriendo las deques de los demás hilos.
+ * @param t Trabajador que roba.
+ * @return Índice de la tarea o DEQUE_VACIA si no quedó ninguna.
+ */
+static int robar(Trabajador *t) {
+    Grupo *g = t->grupo;
+    for (;;) {
+        int carrera = 0;
+        for (int k = 1; k < g->hilos; ++k) {
+            Trabajador *victima = &g->trabajadores[(t->id + k) % g->hilos];
+            int tarea = deque_robar(&victima->deque);
+            if (tarea >= 0) return tarea;
+            if (tarea == DEQUE_CARRERA) carrera = 1;
+        }
+        if (!carrera) return DEQUE_VACIA;
+    }
+}
+
+/**
+ * Bucle de cada hilo: vacía su deque y después roba hasta que no quede nada.
+ * @param p Trabajador.
+ * @return NULL.
+ */
+static void *trabajar(void *p) {
+    Trabajador *t = p;
+    Grupo *g = t->grupo;
+    while (atomic_load(&g->pendientes) > 0) {
+        int robada = 0;
+        int tarea = deque_desapilar(&t->deque);
+        if (tarea < 0) {
+            tarea = robar(t);
+            robada = 1;
+        }
+        if (tarea < 0) break;       /* Nada para robar: lo que falta ya está en curso */
+
+        double t0 = stats_reloj();
+        g->fn(tarea, t->id, g->arg);
+        t->resumen.ocupado += stats_reloj() - t0;
+        t->resumen.tareas++;
+        t->resumen.robos += robada;
+        atomic_fetch_sub(&g->pendientes, 1);
+    }
+    return NULL;
+}
+
+/**
+ * Ejecuta las tareas 0..n_tareas-1 repartidas entre 'hilos' hilos.
+ * Vuelve cuando terminaron todas.
+ * @param n_tareas Cantidad de tareas.
+ * @param hilos Cantidad de hilos (al menos 1).
+ * @param fn Función que ejecuta una tarea.
+ * @param arg Argumento para fn.
+ * @param resumen Tareas y robos de cada hilo (puede ser NULL).
+ */
+void planificador_ejecutar(int n_tareas, int hilos, FnTarea fn, void *arg,
+                           ResumenHilo *resumen) {
+    if (hilos < 1) hilos = 1;
+
+    Grupo g;
+    g.hilos = hilos;
+    g.fn = fn;
+    g.arg = arg;
+    atomic_init(&g.pendientes, n_tareas);
+    g.trabajadores = calloc(hilos, sizeof(Trabajador));
+    int *tareas = malloc((n_tareas + 1) * sizeof(int));
+    if (!g.trabajadores || !tareas) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Cada hilo recibe un bloque contiguo; se apila al revés para que el
+       dueño lo recorra en orden */
+    for (int h = 0; h < hilos; ++h) {
+        Trabajador *t = &g.trabajadores[h];
+        int desde = (int)((long)n_tareas * h / hilos);
+        int hasta = (int)((long)n_tareas * (h + 1) / hilos);
+        t->id = h;
+        t->grupo = &g;
+        t->deque.tareas = tareas + desde;
+        atomic_init(&t->deque.arriba, 0);
+        atomic_init(&t->deque.abajo, 0);
+        for (int i = hasta - 1; i >= desde; --i) deque_apilar(&t->deque, i);
+    }
+
+    /* El hilo actual hace de trabajador 0 */
+    pthread_t *ids = malloc(hilos * sizeof(pthread_t));
+    if (!ids) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    for (int h = 1; h < hilos; ++h) {
+        if (pthread_create(&ids[h], NULL, trabajar, &g.trabajadores[h]) != 0) {
+            perror("pthread_create");
+            exit(EXIT_FAILURE);
+        }
+    }
+    trabajar(&g.trabajadores[0]);
+    for (int h = 1; h < hilos; ++h) pthread_join(ids[h], NULL);
+
+    if (resumen) {
+        for (int h = 0; h < hilos; ++h) resumen[h] = g.trabajadores[h].resumen;
+    }
+    free(ids);
+    free(tareas);
+    free(g.trabajadores);
+}
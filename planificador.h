@@ -0,0 +1,29 @@
+#ifndef PLANIFICADOR_H
+#define PLANIFICADOR_H
+
+/* ------------------ Planificador con robo de trabajo ------------------ */
+
+/*
+ * Ejecuta n tareas independientes (identificadas por su índice) en un grupo
+ * de hilos. Cada hilo tiene su propia deque de tareas: toma trabajo por abajo
+ * de la suya y, cuando se vacía, roba por arriba de la de otro hilo. Así unas
+ * pocas tareas muy largas no dejan a los demás núcleos ociosos.
+ */
+
+/* Función que ejecuta la tarea número 'tarea' en el hilo 'hilo' */
+typedef void (*FnTarea)(int tarea, int hilo, void *arg);
+
+/* Lo que hizo cada hilo, para el resumen de --batch */
+typedef struct {
+    int tareas;                     /* Tareas ejecutadas */
+    int robos;                      /* De ellas, cuántas robó a otro hilo */
+    double ocupado;                 /* Segundos ejecutando tareas */
+} ResumenHilo;
+
+/* ------------------ Prototipos de funciones ------------------ */
+
+/* resumen puede ser NULL; si no, debe tener lugar para 'hilos' entradas */
+void planificador_ejecutar(int n_tareas, int hilos, FnTarea fn, void *arg,
+                           ResumenHilo *resumen);
+
+#endif /* PLANIFICADOR_H */
@@ -0,0 +1,75 @@
+/* Motor de recorrido iterativo del AST con pila explícita */
+
+/* Definiciones necesarias para compatibilidad POSIX */
+#define _POSIX_C_SOURCE 200809L
+
+/* Inclusiones de bibliotecas estándar */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "recorrido.h"
+
+/* Visitas de recorrido_profundo */
+typedef struct {
+    FnVisita pre;
+    FnVisita post;
+    void *arg;
+} Profundo;
+
+/**
+ * Duplica la capacidad de la pila. La primera vez copia los marcos locales a
+ * memoria del heap.
+ * @param r Recorrido con la pila llena.
+ * @return 0, o -1 si no hubo memoria (la pila queda como estaba).
+ */
+int recorrido_crecer(Recorrido *r) {
+    size_t cap = (size_t)r->cap * 2;
+    Marco *marcos;
+    if (r->marcos == r->locales) {
+        marcos = malloc(cap * sizeof(Marco));
+        if (marcos) memcpy(marcos, r->locales, sizeof(r->locales));
+    } else {
+        marcos = realloc(r->marcos, cap * sizeof(Marco));
+    }
+    if (!marcos) return -1;
+    r->marcos = marcos;
+    r->cap = (int)cap;
+    return 0;
+}
+
+/**
+ * Paso de recorrido_profundo: visita en preorden al entrar, baja a cada hijo
+ * que exista y visita en postorden al salir.
+ * @param r Recorrido.
+ * @param m Marco del nodo.
+ * @param arg Las visitas (Profundo).
+ * @return Qué sigue.
+ */
+static int paso_profundo(Recorrido *r, Marco *m, void *arg) {
+    Profundo *p = arg;
+    if (m->paso == 0 && p->pre) p->pre(m->nodo, r->n - 1, p->arg);
+    while (m->paso < 2) {
+        Nodo *hijo = recorrido_hijo(m->nodo, m->paso++);
+        if (hijo) return recorrido_bajar(r, hijo, 0);
+    }
+    if (p->post) p->post(m->nodo, r->n - 1, p->arg);
+    return RECORRIDO_FIN;
+}
+
+/**
+ * Recorre el árbol en profundidad, de izquierda a derecha, saltando los hijos
+ * NULL. post se llama después de haber visitado todos los hijos, así que
+ * puede liberar el nodo.
+ * @param raiz Raíz (puede ser NULL).
+ * @param pre Visita al entrar a cada nodo (o NULL).
+ * @param post Visita al salir de cada nodo (o NULL).
+ * @param arg Argumento de las visitas.
+ * @return 0, o -1 si la pila no pudo crecer y quedaron nodos sin visitar.
+ */
+int recorrido_profundo(Nodo *raiz, FnVisita pre, FnVisita post, void *arg) {
+    if (!raiz) return 0;
+    Profundo p = { pre, post, arg };
+    Recorrido r;
+    recorrido_ejecutar(&r, raiz, 0, paso_profundo, &p);
+    return r.sin_memoria ? -1 : 0;
+}
@@ -0,0 +1,159 @@
+#ifndef RECORRIDO_H
+#define RECORRIDO_H
+
+#include <stdlib.h>
+#include "ast.h"
+
+/* ------------------ Recorrido iterativo del AST ------------------ */
+
+/*
+ * Las pasadas sobre el AST no recursan en la pila de C: cada una es una
+ * función de paso que el motor llama con el marco del tope de una pila
+ * explícita. El paso mira en qué punto del nodo va (m->paso), hace su trabajo
+ * y devuelve qué sigue: bajar a un hijo, seguir con otro nodo en el mismo
+ * marco (llamada de cola, para que una cadena de NODO_SEQ no haga crecer la
+ * pila) o terminar el nodo. El resultado de un nodo se deja en r->valor,
+ * donde lo lee el padre cuando el motor vuelve a llamarlo.
+ *
+ * Los primeros marcos viven dentro del Recorrido; pasado ese tope la pila se
+ * mueve al heap, así que la profundidad del árbol sólo la limita la memoria.
+ * recorrido_ejecutar es inline para que el compilador pueda integrar la
+ * función de paso en el bucle.
+ */
+
+/* Marcos que entran sin reservar memoria */
+#define RECORRIDO_MARCOS_LOCALES 64
+
+/* Un nodo en curso */
+typedef struct {
+    Nodo *nodo;             /* Puede ser NULL: el paso decide qué significa */
+    int paso;               /* Punto del nodo en que va la pasada (0 = recién entrado) */
+    int valor;              /* Resultado parcial (p. ej. el operando izquierdo) */
+    int dato;               /* Dato de la pasada, lo fija quien apila el marco */
+} Marco;
+
+/* Pila del recorrido */
+typedef struct {
+    Marco *marcos;          /* locales o memoria del heap */
+    int n;
+    int cap;
+    int valor;              /* Resultado del último nodo terminado */
+    Nodo *hijo;             /* Nodo a apilar (recorrido_bajar/recorrido_seguir) */
+    int dato_hijo;
+    int sin_memoria;        /* La pila no pudo crecer y la pasada se cortó */
+    Marco locales[RECORRIDO_MARCOS_LOCALES];
+} Recorrido;
+
+/* Lo que devuelve una función de paso */
+enum {
+    RECORRIDO_FIN,          /* El nodo terminó: desapilar */
+    RECORRIDO_BAJAR,        /* Apilar r->hijo y volver a este marco al terminar */
+    RECORRIDO_SEGUIR,       /* Reemplazar este marco por r->hijo */
+    RECORRIDO_ABORTAR       /* Cortar la pasada entera (p. ej. por un error) */
+};
+
+/* Un paso de una pasada sobre el marco del tope */
+typedef int (*FnPaso)(Recorrido *r, Marco *m, void *arg);
+
+/* Visita de recorrido_profundo */
+typedef void (*FnVisita)(Nodo *n, int profundidad, void *arg);
+
+/* ------------------ Prototipos de funciones ------------------ */
+
+int recorrido_crecer(Recorrido *r);     /* Duplica la pila (la pasa al heap); -1 sin memoria */
+int recorrido_profundo(Nodo *raiz, FnVisita pre, FnVisita post, void *arg);   /* -1 sin memoria */
+
+/**
+ * Devuelve el i-ésimo hijo de un nodo, en el orden en que lo visitan las
+ * pasadas (izquierdo y derecho, o la expresión).
+ * @param n Nodo.
+ * @param i Índice del hijo (0 o 1).
+ * @return El hijo, o NULL si no existe.
+ */
+static inline Nodo *recorrido_hijo(const Nodo *n, int i) {
+    switch (n->tipo) {
+        case NODO_SEQ:
+        case NODO_OP:
+        case NODO_OP_RAPIDO:
+            return i == 0 ? n->opBinaria.izq : i == 1 ? n->opBinaria.der : NULL;
+        case NODO_DECL:
+        case NODO_ASSIGN:
+            return i == 0 ? n->assign.expr : NULL;
+        case NODO_RETURN:
+            return i == 0 ? n->ret_expr : NULL;
+        default:
+            return NULL;
+    }
+}
+
+/**
+ * Pide bajar a un hijo; el marco actual se retoma cuando el hijo termina.
+ * @param r Recorrido.
+ * @param hijo Nodo a visitar (puede ser NULL).
+ * @param dato Dato del marco del hijo.
+ * @return RECORRIDO_BAJAR, para devolver desde el paso.
+ */
+static inline int recorrido_bajar(Recorrido *r, Nodo *hijo, int dato) {
+    r->hijo = hijo;
+    r->dato_hijo = dato;
+    return RECORRIDO_BAJAR;
+}
+
+/**
+ * Pide continuar con otro nodo en lugar del actual, cuando el resultado del
+ * actual es el de ese nodo y no queda nada por hacer después.
+ * @param r Recorrido.
+ * @param hijo Nodo que reemplaza al actual (puede ser NULL).
+ * @param dato Dato del nuevo marco.
+ * @return RECORRIDO_SEGUIR, para devolver desde el paso.
+ */
+static inline int recorrido_seguir(Recorrido *r, Nodo *hijo, int dato) {
+    r->hijo = hijo;
+    r->dato_hijo = dato;
+    return RECORRIDO_SEGUIR;
+}
+
+/**
+ * Ejecuta una pasada desde la raíz hasta vaciar la pila.
+ * @param r Recorrido (sin inicializar; la pila se libera al terminar).
+ * @param raiz Nodo inicial (puede ser NULL).
+ * @param dato Dato del marco inicial.
+ * @param paso Función de paso de la pasada.
+ * @param arg Argumento de la función de paso.
+ * @return El resultado de la raíz (r->valor).
+ */
+static inline int recorrido_ejecutar(Recorrido *r, Nodo *raiz, int dato, FnPaso paso, void *arg) {
+    r->marcos = r->locales;
+    r->cap = RECORRIDO_MARCOS_LOCALES;
+    r->valor = 0;
+    r->sin_memoria = 0;
+    r->marcos[0] = (Marco){ raiz, 0, 0, dato };
+    r->n = 1;
+
+    while (r->n > 0) {
+        Marco *m = &r->marcos[r->n - 1];
+        switch (paso(r, m, arg)) {
+            case RECORRIDO_FIN:
+                r->n--;
+                break;
+            case RECORRIDO_SEGUIR:
+                *m = (Marco){ r->hijo, 0, 0, r->dato_hijo };
+                break;
+            case RECORRIDO_ABORTAR:
+                r->n = 0;
+                break;
+            default:
+                if (r->n == r->cap && recorrido_crecer(r) != 0) {
+                    r->sin_memoria = 1;
+                    r->n = 0;
+                    break;
+                }
+                r->marcos[r->n++] = (Marco){ r->hijo, 0, 0, r->dato_hijo };
+                break;
+        }
+    }
+    if (r->marcos != r->locales) free(r->marcos);
+    return r->valor;
+}
+
+#endif /* RECORRIDO_H */
@@ -0,0 +1,63 @@
+/*
+ * Intérprete de línea de comandos para el seudo-assembly.
+ *
+ * Uso: ./sasm-vm [--sin-fusion] [-r N] programa.sasm
+ *
+ * Carga el archivo, lo reescribe con las superinstrucciones de superinstr.def
+ * (salvo con --sin-fusion) y lo ejecuta N veces, informando el resultado y el
+ * tiempo promedio por ejecución.
+ */
+
+/* Definiciones necesarias para compatibilidad POSIX */
+#define _POSIX_C_SOURCE 200809L
+
+/* Inclusiones de bibliotecas estándar */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sasm.h"
+
+/**
+ * Devuelve el tiempo monótono actual en segundos.
+ */
+static double ahora(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    int fusionar = 1;
+    long repeticiones = 1;
+    const char *archivo = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--sin-fusion") == 0) fusionar = 0;
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) repeticiones = atol(argv[++i]);
+        else archivo = argv[i];
+    }
+    if (!archivo || repeticiones <= 0) {
+        fprintf(stderr, "Uso: %s [--sin-fusion] [-r N] programa.sasm\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    SasmPrograma p;
+    if (sasm_cargar(archivo, &p) != 0) return EXIT_FAILURE;
+
+    int base = p.n;
+    int fusiones = fusionar ? sasm_fusionar(&p) : 0;
+    printf("Instrucciones: %d (%d tras fusionar %d superinstrucciones)\n",
+           base, p.n, fusiones);
+
+    int resultado = 0;
+    double t0 = ahora();
+    for (long r = 0; r < repeticiones; ++r) resultado = sasm_ejecutar(&p);
+    double t = ahora() - t0;
+
+    printf("Resultado (sasm): %d\n", resultado);
+    printf("Tiempo por ejecución: %.3f us\n", t * 1e6 / repeticiones);
+
+    sasm_liberar(&p);
+    return EXIT_SUCCESS;
+}
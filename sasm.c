@@ -0,0 +1,503 @@
+/* Carga, fusión en superinstrucciones e intérprete del seudo-assembly */
+
+/* Definiciones necesarias para compatibilidad POSIX */
+#define _POSIX_C_SOURCE 200809L
+
+/* Inclusiones de bibliotecas estándar */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "sasm.h"
+
+/* ------------------ Tablas de instrucciones ------------------ */
+
+/* Nombres de todas las instrucciones, base y fusionadas */
+static const char *nombres_op[SASM_NUM_OPS] = {
+#define SASM_NOMBRE_BASE(nombre) [SASM_##nombre] = #nombre,
+    SASM_OPS_BASE(SASM_NOMBRE_BASE)
+#undef SASM_NOMBRE_BASE
+#define SUPER(nombre, n, o1, o2, o3) [SASM_SI_##nombre] = #nombre,
+#include "superinstr.def"
+#undef SUPER
+};
+
+/* Superinstrucciones disponibles, en orden de prioridad para la fusión */
+static const SasmSuper supers[] = {
+#define SUPER(nombre, n, o1, o2, o3) \
+    { SASM_SI_##nombre, n, { SASM_##o1, SASM_##o2, SASM_##o3 } },
+#include "superinstr.def"
+#undef SUPER
+    { -1, 0, { 0 } }                /* Centinela */
+};
+
+/* Cantidad de superinstrucciones (sin el centinela) */
+#define N_SUPERS ((int)(sizeof(supers) / sizeof(supers[0])) - 1)
+
+/**
+ * Devuelve el nombre de una instrucción.
+ * @param op Código de operación.
+ * @return Nombre legible o "??" si el código no existe.
+ */
+const char *sasm_nombre_op(int op) {
+    if (op < 0 || op >= SASM_NUM_OPS || !nombres_op[op]) return "??";
+    return nombres_op[op];
+}
+
+/**
+ * Busca una instrucción base por su mnemónico.
+ * @param nombre Mnemónico tal como aparece en el .sasm.
+ * @return Código de operación o -1 si no es una instrucción base.
+ */
+int sasm_op_desde_nombre(const char *nombre) {
+    for (int op = 0; op < SASM_NUM_BASE; ++op) {
+        if (strcmp(nombres_op[op], nombre) == 0) return op;
+    }
+    return -1;
+}
+
+/**
+ * Indica si una instrucción base transfiere el control. Estas instrucciones
+ * sólo pueden aparecer al final de una superinstrucción.
+ * @param op Código de operación base.
+ * @return 1 si es un salto, RET o HALT.
+ */
+int sasm_es_salto(int op) {
+    return op == SASM_JZ || op == SASM_JNZ || op == SASM_JMP ||
+           op == SASM_RET || op == SASM_HALT;
+}
+
+/**
+ * Devuelve la k-ésima instrucción base contenida en una instrucción.
+ * @param op Código de operación (base o fusionado).
+ * @param k Posición dentro de la superinstrucción.
+ * @param lista Superinstrucciones que pueden aparecer en el programa.
+ * @param n_lista Cantidad de elementos de lista.
+ * @return Código base o SASM_NOP si no hay componente en esa posición.
+ */
+static int componente(int op, int k, const SasmSuper *lista, int n_lista) {
+    if (op < SASM_NUM_BASE) return k == 0 ? op : SASM_NOP;
+    for (int i = 0; i < n_lista; ++i) {
+        if (lista[i].op == op) return k < lista[i].n ? lista[i].base[k] : SASM_NOP;
+    }
+    return SASM_NOP;
+}
+
+/* ------------------ Carga del seudo-assembly ------------------ */
+
+/**
+ * Agrega una instrucción base al programa, ampliando el arreglo si hace falta.
+ * @param p Programa.
+ * @param op Código de operación.
+ * @param arg Argumento.
+ * @param destino 1 si una etiqueta apunta a esta instrucción.
+ */
+static void agregar_instr(SasmPrograma *p, int op, int arg, int destino) {
+    if (p->n == p->cap) {
+        p->cap = p->cap ? p->cap * 2 : 64;
+        p->codigo = realloc(p->codigo, p->cap * sizeof(SasmInstr));
+        p->destino = realloc(p->destino, p->cap);
+        if (!p->codigo || !p->destino) {
+            perror("realloc");
+            exit(EXIT_FAILURE);
+        }
+    }
+    p->codigo[p->n].op = op;
+    p->codigo[p->n].arg[0] = arg;
+    for (int k = 1; k < SASM_MAX_FUSION; ++k) p->codigo[p->n].arg[k] = 0;
+    p->destino[p->n] = (unsigned char)destino;
+    p->n++;
+}
+
+/**
+ * Obtiene el slot de una variable, creándolo si es la primera aparición.
+ * @param p Programa.
+ * @param nombre Nombre de la variable.
+ * @return Índice del slot.
+ */
+static int slot_variable(SasmPrograma *p, const char *nombre) {
+    for (int i = 0; i < p->n_vars; ++i) {
+        if (strcmp(p->vars[i], nombre) == 0) return i;
+    }
+    char **vars = realloc(p->vars, (p->n_vars + 1) * sizeof(char *));
+    if (!vars) {
+        perror("realloc");
+        exit(EXIT_FAILURE);
+    }
+    p->vars = vars;
+    p->vars[p->n_vars] = strdup(nombre);
+    return p->n_vars++;
+}
+
+/**
+ * Lee el número de una etiqueta con forma "L<n>".
+ * @param s Texto del operando.
+ * @return Número de etiqueta o -1 si el formato es inválido.
+ */
+static int numero_etiqueta(const char *s) {
+    if (s[0] != 'L' || !isdigit((unsigned char)s[1])) return -1;
+    return atoi(s + 1);
+}
+
+/**
+ * Carga un archivo .sasm generado por generar_asm. Las etiquetas se resuelven
+ * a índices de instrucción y las variables a slots.
+ * @param filename Archivo de entrada.
+ * @param p Programa a completar (se sobrescribe).
+ * @return 0 si tuvo éxito, -1 si hubo un error.
+ */
+int sasm_cargar(const char *filename, SasmPrograma *p) {
+    memset(p, 0, sizeof(*p));
+
+    FILE *f = fopen(filename, "r");
+    if (!f) {
+        perror("fopen sasm_cargar");
+        return -1;
+    }
+
+    int *etiquetas = NULL;          /* Número de etiqueta -> instrucción */
+    int n_etiquetas = 0;
+    int destino_pendiente = 0;
+    char linea[512];
+    int nro_linea = 0;
+    int error = 0;
+
+    while (!error && fgets(linea, sizeof(linea), f)) {
+        char mnem[64], operando[448];
+        nro_linea++;
+        if (linea[0] == ';') continue;
+        int campos = sscanf(linea, "%63s %447s", mnem, operando);
+        if (campos < 1 || strcmp(mnem, "BEGIN") == 0) continue;
+
+        if (strcmp(mnem, "LABEL") == 0) {
+            int e = campos == 2 ? numero_etiqueta(operando) : -1;
+            if (e < 0) {
+                error = 1;
+                break;
+            }
+            if (e >= n_etiquetas) {
+                int nuevo = e + 16;
+                etiquetas = realloc(etiquetas, nuevo * sizeof(int));
+                if (!etiquetas) {
+                    perror("realloc");
+                    exit(EXIT_FAILURE);
+                }
+                for (int i = n_etiquetas; i < nuevo; ++i) etiquetas[i] = -1;
+                n_etiquetas = nuevo;
+            }
+            etiquetas[e] = p->n;
+            destino_pendiente = 1;
+            continue;
+        }
+
+        int op = sasm_op_desde_nombre(mnem);
+        int arg = 0;
+        switch (op) {
+            case SASM_DECL:
+            case SASM_LOAD:
+            case SASM_STORE:
+                if (campos < 2) error = 1;
+                else arg = slot_variable(p, operando);
+                break;
+            case SASM_PUSH:
+                if (campos < 2) error = 1;
+                else arg = atoi(operando);
+                break;
+            case SASM_JZ:
+            case SASM_JNZ:
+            case SASM_JMP:
+                arg = campos == 2 ? numero_etiqueta(operando) : -1;
+                if (arg < 0) error = 1;
+                break;
+            case -1:
+                error = 1;
+                break;
+            default:
+                break;
+        }
+        if (!error) {
+            agregar_instr(p, op, arg, destino_pendiente);
+            destino_pendiente = 0;
+        }
+    }
+    fclose(f);
+
+    if (error) {
+        fprintf(stderr, "Error: %s:%d: instrucción inválida\n", filename, nro_linea);
+    }
+
+    /* Resuelve los saltos; el lenguaje no tiene ciclos, así que sólo se aceptan
+       saltos hacia adelante (esto acota la profundidad de la pila) */
+    for (int i = 0; !error && i < p->n; ++i) {
+        int op = p->codigo[i].op;
+        if (op != SASM_JZ && op != SASM_JNZ && op != SASM_JMP) continue;
+        int e = p->codigo[i].arg[0];
+        if (e >= n_etiquetas || etiquetas[e] < 0 || etiquetas[e] <= i) {
+            fprintf(stderr, "Error: %s: salto inválido a L%d\n", filename, e);
+            error = 1;
+        } else {
+            p->codigo[i].arg[0] = etiquetas[e];
+        }
+    }
+    free(etiquetas);
+
+    /* Garantiza que la ejecución termine aunque falte el HALT final */
+    if (!error && (p->n == 0 || p->codigo[p->n - 1].op != SASM_HALT)) {
+        agregar_instr(p, SASM_HALT, 0, destino_pendiente);
+    }
+
+    if (error) {
+        sasm_liberar(p);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Libera la memoria de un programa cargado.
+ * @param p Programa.
+ */
+void sasm_liberar(SasmPrograma *p) {
+    free(p->codigo);
+    free(p->destino);
+    for (int i = 0; i < p->n_vars; ++i) free(p->vars[i]);
+    free(p->vars);
+    memset(p, 0, sizeof(*p));
+}
+
+/* ------------------ Fusión en superinstrucciones ------------------ */
+
+/**
+ * Indica si la superinstrucción puede reemplazar las instrucciones que
+ * empiezan en i. No se fusiona a través de un destino de salto, sobre
+ * instrucciones ya tomadas por otra superinstrucción, ni más allá de un salto.
+ * @param p Programa.
+ * @param tomada Marcas de instrucciones ya fusionadas.
+ * @param i Posición inicial.
+ * @param s Superinstrucción candidata.
+ * @return 1 si aplica.
+ */
+static int aplica_super(const SasmPrograma *p, const unsigned char *tomada,
+                        int i, const SasmSuper *s) {
+    if (i + s->n > p->n) return 0;
+    for (int k = 0; k < s->n; ++k) {
+        if (tomada[i + k] || p->codigo[i + k].op != s->base[k]) return 0;
+        if (k > 0 && p->destino[i + k]) return 0;
+        if (k < s->n - 1 && sasm_es_salto(s->base[k])) return 0;
+    }
+    return 1;
+}
+
+/**
+ * Reescribe el programa reemplazando secuencias de instrucciones base por las
+ * superinstrucciones dadas y reubica los saltos. Cada patrón se aplica de
+ * izquierda a derecha sobre lo que dejaron libre los de mayor prioridad.
+ * @param p Programa cargado.
+ * @param lista Superinstrucciones en orden de prioridad.
+ * @param n_lista Cantidad de elementos de lista.
+ * @return Cantidad de superinstrucciones introducidas.
+ */
+int sasm_fusionar_con(SasmPrograma *p, const SasmSuper *lista, int n_lista) {
+    int *inicio = malloc((p->n + 1) * sizeof(int));   /* Patrón que empieza en i */
+    int *mapa = malloc((p->n + 1) * sizeof(int));     /* Índice viejo -> nuevo */
+    unsigned char *tomada = calloc(p->n + 1, 1);
+    if (!inicio || !mapa || !tomada) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < p->n; ++i) inicio[i] = -1;
+
+    int fusiones = 0;
+    for (int s = 0; s < n_lista; ++s) {
+        for (int i = 0; i < p->n; ++i) {
+            if (!aplica_super(p, tomada, i, &lista[s])) continue;
+            inicio[i] = s;
+            memset(tomada + i, 1, lista[s].n);
+            fusiones++;
+            i += lista[s].n - 1;
+        }
+    }
+
+    int j = 0;
+    for (int i = 0; i < p->n; ) {
+        int s = inicio[i];
+        int n = s >= 0 ? lista[s].n : 1;
+        SasmInstr nueva = p->codigo[i];
+        if (s >= 0) {
+            nueva.op = lista[s].op;
+            for (int k = 0; k < SASM_MAX_FUSION; ++k)
+                nueva.arg[k] = k < n ? p->codigo[i + k].arg[0] : 0;
+        }
+        unsigned char destino = p->destino[i];
+        for (int k = 0; k < n; ++k) mapa[i + k] = j;
+        p->codigo[j] = nueva;
+        p->destino[j] = destino;
+        j++;
+        i += n;
+    }
+    mapa[p->n] = j;
+
+    /* Los saltos apuntan siempre al inicio de una instrucción fusionada */
+    for (int i = 0; i < j; ++i) {
+        for (int k = 0; k < SASM_MAX_FUSION; ++k) {
+            int op = componente(p->codigo[i].op, k, lista, n_lista);
+            if (op == SASM_JZ || op == SASM_JNZ || op == SASM_JMP)
+                p->codigo[i].arg[k] = mapa[p->codigo[i].arg[k]];
+        }
+    }
+    p->n = j;
+    free(inicio);
+    free(mapa);
+    free(tomada);
+    return fusiones;
+}
+
+/**
+ * Aplica las superinstrucciones de superinstr.def.
+ * @param p Programa cargado sin fusionar.
+ * @return Cantidad de superinstrucciones introducidas.
+ */
+int sasm_fusionar(SasmPrograma *p) {
+    return sasm_fusionar_con(p, supers, N_SUPERS);
+}
+
+/* ------------------ Perfilado de n-gramas ------------------ */
+
+/**
+ * Cuenta las secuencias de 1 a SASM_MAX_FUSION instrucciones base que podrían
+ * fusionarse: ninguna posición salvo la primera es destino de salto y sólo la
+ * última puede transferir el control.
+ * @param p Programa cargado sin fusionar.
+ * @param t Tabla de frecuencias a incrementar.
+ */
+void sasm_contar_ngramas(const SasmPrograma *p, SasmNgramas *t) {
+    for (int i = 0; i < p->n; ++i) {
+        const SasmInstr *c = &p->codigo[i];
+        if (c[0].op >= SASM_NUM_BASE) continue;
+        t->uno[c[0].op]++;
+        if (sasm_es_salto(c[0].op) || i + 1 >= p->n || p->destino[i + 1]) continue;
+        if (c[1].op >= SASM_NUM_BASE) continue;
+        t->dos[c[0].op][c[1].op]++;
+        if (sasm_es_salto(c[1].op) || i + 2 >= p->n || p->destino[i + 2]) continue;
+        if (c[2].op >= SASM_NUM_BASE) continue;
+        t->tres[c[0].op][c[1].op][c[2].op]++;
+    }
+}
+
+/* ------------------ Intérprete ------------------ */
+
+/* Estado de cada slot durante la ejecución */
+enum { VAR_LIBRE, VAR_DECLARADA, VAR_INICIALIZADA };
+
+/**
+ * Informa un error de ejecución sobre una variable y termina.
+ * @param fmt Formato del mensaje (recibe el nombre de la variable).
+ * @param nombre Nombre de la variable.
+ */
+static void error_variable(const char *fmt, const char *nombre) {
+    fprintf(stderr, fmt, nombre);
+    exit(EXIT_FAILURE);
+}
+
+/*
+ * Cuerpo de una instrucción base. OP es siempre una constante, por lo que el
+ * compilador reduce el switch al único caso que corresponde; así cada
+ * superinstrucción se arma concatenando los cuerpos de sus componentes.
+ */
+#define EJECUTAR_BASE(OP, A) do {                                              \
+    switch (OP) {                                                              \
+        case SASM_NOP: break;                                                  \
+        case SASM_HALT: goto fin;                                              \
+        case SASM_DECL:                                                        \
+            if (estado[A] != VAR_LIBRE)                                        \
+                error_variable("Error: variable '%s' ya declarada\n",          \
+                               p->vars[A]);                                    \
+            estado[A] = VAR_DECLARADA;                                         \
+            break;                                                             \
+        case SASM_PUSH: *++sp = (A); break;                                    \
+        case SASM_LOAD:                                                        \
+            if (estado[A] != VAR_INICIALIZADA)                                 \
+                error_variable(estado[A] == VAR_LIBRE                          \
+                               ? "Error: variable '%s' no declarada\n"         \
+                               : "Error: variable '%s' usada sin inicializar\n",\
+                               p->vars[A]);                                    \
+            *++sp = valor[A];                                                  \
+            break;                                                             \
+        case SASM_STORE:                                                       \
+            if (estado[A] == VAR_LIBRE)                                        \
+                error_variable("Error: asignación a variable no declarada '%s'\n",\
+                               p->vars[A]);                                    \
+            valor[A] = *sp--;                                                  \
+            estado[A] = VAR_INICIALIZADA;                                      \
+            break;                                                             \
+        case SASM_ADD:   sp[-1] = sp[-1] + sp[0]; sp--; break;                 \
+        case SASM_SUB:   sp[-1] = sp[-1] - sp[0]; sp--; break;                 \
+        case SASM_MUL:   sp[-1] = sp[-1] * sp[0]; sp--; break;                 \
+        case SASM_DIV:                                                         \
+            if (sp[0] == 0) {                                                  \
+                fprintf(stderr, "Error: división por cero\n");                 \
+                exit(EXIT_FAILURE);                                            \
+            }                                                                  \
+            /* Como en eval_nodo, INT_MIN / -1 da INT_MIN */                   \
+            sp[-1] = sp[0] == -1 ? (int)(0u - (unsigned)sp[-1])                \
+                                 : sp[-1] / sp[0];                             \
+            sp--;                                                              \
+            break;                                                             \
+        case SASM_CMPEQ: sp[-1] = sp[-1] == sp[0]; sp--; break;                \
+        case SASM_CMPGT: sp[-1] = sp[-1] > sp[0]; sp--; break;                 \
+        case SASM_CMPLT: sp[-1] = sp[-1] < sp[0]; sp--; break;                 \
+        case SASM_JZ:  if (*sp-- == 0) pc = (A); break;                        \
+        case SASM_JNZ: if (*sp-- != 0) pc = (A); break;                        \
+        case SASM_JMP: pc = (A); break;                                        \
+        case SASM_RET: resultado = *sp; goto fin;                              \
+        default: break;                                                        \
+    }                                                                          \
+} while (0)
+
+/**
+ * Ejecuta un programa cargado, fusionado o no.
+ * @param p Programa.
+ * @return Valor devuelto por RET, o 0 si termina en HALT.
+ */
+int sasm_ejecutar(const SasmPrograma *p) {
+    /* Sin saltos hacia atrás cada instrucción se ejecuta a lo sumo una vez,
+       así que la pila nunca supera la cantidad de instrucciones base */
+    int *pila = malloc((p->n * SASM_MAX_FUSION + 1) * sizeof(int));
+    int *valor = calloc(p->n_vars + 1, sizeof(int));
+    unsigned char *estado = calloc(p->n_vars + 1, 1);
+    if (!pila || !valor || !estado) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    int *sp = pila;                 /* sp apunta al tope; pila[0] no se usa */
+    int pc = 0;
+    int resultado = 0;
+
+    for (;;) {
+        const SasmInstr *in = &p->codigo[pc++];
+        switch (in->op) {
+#define SASM_CASO_BASE(nombre) \
+            case SASM_##nombre: EJECUTAR_BASE(SASM_##nombre, in->arg[0]); break;
+            SASM_OPS_BASE(SASM_CASO_BASE)
+#undef SASM_CASO_BASE
+#define SUPER(nombre, n, o1, o2, o3)                \
+            case SASM_SI_##nombre:                  \
+                EJECUTAR_BASE(SASM_##o1, in->arg[0]); \
+                EJECUTAR_BASE(SASM_##o2, in->arg[1]); \
+                EJECUTAR_BASE(SASM_##o3, in->arg[2]); \
+                break;
+#include "superinstr.def"
+#undef SUPER
+            default:
+                fprintf(stderr, "Error: instrucción desconocida %d\n", in->op);
+                exit(EXIT_FAILURE);
+        }
+    }
+
+fin:
+    free(pila);
+    free(valor);
+    free(estado);
+    return resultado;
+}
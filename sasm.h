@@ -0,0 +1,93 @@
+#ifndef SASM_H
+#define SASM_H
+
+/* ------------------ Máquina virtual para el seudo-assembly ------------------ */
+
+/*
+ * El texto generado por generar_asm se carga como un arreglo de instrucciones
+ * (bytecode): las etiquetas se resuelven a índices y las variables a slots.
+ * Sobre ese arreglo se pueden fusionar secuencias frecuentes en
+ * superinstrucciones, listadas en superinstr.def, para reducir el número de
+ * despachos del intérprete.
+ */
+
+/* Instrucciones base del seudo-assembly (LABEL y BEGIN se eliminan al cargar) */
+#define SASM_OPS_BASE(X) \
+    X(NOP)   \
+    X(HALT)  \
+    X(DECL)  \
+    X(PUSH)  \
+    X(LOAD)  \
+    X(STORE) \
+    X(ADD)   \
+    X(SUB)   \
+    X(MUL)   \
+    X(DIV)   \
+    X(CMPEQ) \
+    X(CMPGT) \
+    X(CMPLT) \
+    X(JZ)    \
+    X(JNZ)   \
+    X(JMP)   \
+    X(RET)
+
+/* Máximo de instrucciones base que se fusionan en una superinstrucción */
+#define SASM_MAX_FUSION 3
+
+/* Códigos de operación: primero las instrucciones base, luego las fusionadas */
+typedef enum {
+#define SASM_ENUM_BASE(nombre) SASM_##nombre,
+    SASM_OPS_BASE(SASM_ENUM_BASE)
+#undef SASM_ENUM_BASE
+    SASM_NUM_BASE,
+    SASM_SUPER_INICIO = SASM_NUM_BASE - 1,
+#define SUPER(nombre, n, o1, o2, o3) SASM_SI_##nombre,
+#include "superinstr.def"
+#undef SUPER
+    SASM_NUM_OPS
+} SasmOp;
+
+/* Instrucción cargada: un argumento por cada instrucción base que contiene */
+typedef struct {
+    int op;                         /* SasmOp */
+    int arg[SASM_MAX_FUSION];       /* Constante, slot de variable o destino */
+} SasmInstr;
+
+/* Programa cargado en memoria */
+typedef struct {
+    SasmInstr *codigo;              /* Instrucciones */
+    unsigned char *destino;         /* 1 si la instrucción es destino de salto */
+    int n;                          /* Cantidad de instrucciones */
+    int cap;                        /* Capacidad reservada */
+    char **vars;                    /* Nombre de cada slot de variable */
+    int n_vars;                     /* Cantidad de slots */
+} SasmPrograma;
+
+/* Superinstrucción: secuencia de instrucciones base que reemplaza */
+typedef struct {
+    int op;                         /* Código fusionado */
+    int n;                          /* Cantidad de instrucciones base */
+    int base[SASM_MAX_FUSION];      /* Secuencia reemplazada (relleno NOP) */
+} SasmSuper;
+
+/* Frecuencias de n-gramas de instrucciones base (n = 1..SASM_MAX_FUSION) */
+typedef struct {
+    unsigned long uno[SASM_NUM_BASE];
+    unsigned long dos[SASM_NUM_BASE][SASM_NUM_BASE];
+    unsigned long tres[SASM_NUM_BASE][SASM_NUM_BASE][SASM_NUM_BASE];
+} SasmNgramas;
+
+/* ------------------ Prototipos de funciones ------------------ */
+
+int sasm_cargar(const char *filename, SasmPrograma *p);   /* 0 si tuvo éxito */
+void sasm_liberar(SasmPrograma *p);
+int sasm_fusionar(SasmPrograma *p);           /* Devuelve cuántas fusiones aplicó */
+int sasm_fusionar_con(SasmPrograma *p, const SasmSuper *lista, int n_lista);
+int sasm_ejecutar(const SasmPrograma *p);     /* Devuelve el valor de RET (0 en HALT) */
+
+const char *sasm_nombre_op(int op);
+int sasm_op_desde_nombre(const char *nombre); /* -1 si no es una instrucción base */
+int sasm_es_salto(int op);                    /* JZ, JNZ, JMP, RET o HALT */
+void sasm_contar_ngramas(const SasmPrograma *p, SasmNgramas *t);
+
+#endif /* SASM_H */
@@ -0,0 +1,429 @@
+/* Serialización del AST a un formato binario plano que se usa mapeado */
+
+/* Definiciones necesarias para compatibilidad POSIX */
+#define _DEFAULT_SOURCE
+
+/* Inclusiones de bibliotecas estándar */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "serializacion.h"
+#include "contexto.h"
+#include "recorrido.h"
+#include "cache.h"
+
+/* Capacidades iniciales del serializador */
+#define SERIAL_NODOS_INICIAL 1024
+#define SERIAL_TEXTO_INICIAL 4096
+#define SERIAL_TABLA_INICIAL 256    /* Potencia de 2 */
+
+/* Estado de plano_escribir */
+typedef struct {
+    NodoPlano *nodos;
+    int32_t *pila;                  /* Índices de los subárboles ya escritos */
+    uint32_t n, n_pila, cap;
+    uint32_t *cadenas;
+    uint32_t n_cadenas, cap_cadenas;
+    char *texto;
+    uint32_t largo_texto, cap_texto;
+    int32_t *tabla;                 /* Hash abierto: número de cadena o PLANO_NINGUNO */
+    uint32_t cap_tabla;
+    int invalido;                   /* Apareció un nodo que el formato no admite */
+    int sin_memoria;                /* Falló un realloc: no se escribe nada */
+} Serializador;
+
+/**
+ * Sigue un hash FNV-1a de 64 bits con más bytes.
+ * @param h Hash de lo anterior (o el de plano_hash de nada).
+ * @param datos Bytes.
+ * @param largo Cantidad de bytes.
+ * @return Hash.
+ */
+uint64_t plano_hash_seguir(uint64_t h, const char *datos, size_t largo) {
+    for (size_t i = 0; i < largo; ++i) {
+        h ^= (unsigned char)datos[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/**
+ * Calcula el hash FNV-1a de 64 bits de un bloque de bytes.
+ * @param datos Bytes.
+ * @param largo Cantidad de bytes.
+ * @return Hash.
+ */
+uint64_t plano_hash(const char *datos, size_t largo) {
+    return plano_hash_seguir(14695981039346656037ULL, datos, largo);
+}
+
+/**
+ * realloc que, si no hay memoria, deja el bloque como estaba y marca al
+ * serializador para que plano_escribir no publique nada.
+ * @param s Serializador.
+ * @param p Bloque actual (o NULL).
+ * @param tam Tamaño nuevo.
+ * @return Bloque nuevo, o NULL si no hubo memoria.
+ */
+static void *serial_realloc(Serializador *s, void *p, size_t tam) {
+    void *nuevo = realloc(p, tam);
+    if (!nuevo) s->sin_memoria = 1;
+    return nuevo;
+}
+
+/**
+ * Duplica la tabla de cadenas y vuelve a ubicar las que ya tiene.
+ * @param s Serializador.
+ * @return 0, o -1 si no hubo memoria.
+ */
+static int agrandar_tabla(Serializador *s) {
+    uint32_t cap = s->cap_tabla ? s->cap_tabla * 2 : SERIAL_TABLA_INICIAL;
+    int32_t *tabla = serial_realloc(s, NULL, cap * sizeof(int32_t));
+    if (!tabla) return -1;
+    free(s->tabla);
+    s->tabla = tabla;
+    s->cap_tabla = cap;
+    for (uint32_t i = 0; i < s->cap_tabla; ++i) s->tabla[i] = PLANO_NINGUNO;
+    for (uint32_t c = 0; c < s->n_cadenas; ++c) {
+        const char *t = s->texto + s->cadenas[c];
+        uint32_t j = (uint32_t)plano_hash(t, strlen(t)) & (s->cap_tabla - 1);
+        while (s->tabla[j] != PLANO_NINGUNO) j = (j + 1) & (s->cap_tabla - 1);
+        s->tabla[j] = (int32_t)c;
+    }
+    return 0;
+}
+
+/**
+ * Devuelve el número de una cadena, agregándola al texto si es la primera vez.
+ * @param s Serializador.
+ * @param cadena Cadena terminada en NUL.
+ * @return Número de cadena, o PLANO_NINGUNO si no hubo memoria.
+ */
+static int32_t internar(Serializador *s, const char *cadena) {
+    size_t largo = strlen(cadena);
+    if (2 * (s->n_cadenas + 1) > s->cap_tabla && agrandar_tabla(s) != 0) return PLANO_NINGUNO;
+
+    uint32_t j = (uint32_t)plano_hash(cadena, largo) & (s->cap_tabla - 1);
+    while (s->tabla[j] != PLANO_NINGUNO) {
+        if (strcmp(s->texto + s->cadenas[s->tabla[j]], cadena) == 0) return s->tabla[j];
+        j = (j + 1) & (s->cap_tabla - 1);
+    }
+
+    if (s->n_cadenas == s->cap_cadenas) {
+        uint32_t cap = s->cap_cadenas ? s->cap_cadenas * 2 : SERIAL_TABLA_INICIAL;
+        uint32_t *cadenas = serial_realloc(s, s->cadenas, cap * sizeof(uint32_t));
+        if (!cadenas) return PLANO_NINGUNO;
+        s->cadenas = cadenas;
+        s->cap_cadenas = cap;
+    }
+    while (s->largo_texto + largo + 1 > s->cap_texto) {
+        uint32_t cap = s->cap_texto ? s->cap_texto * 2 : SERIAL_TEXTO_INICIAL;
+        char *texto = serial_realloc(s, s->texto, cap);
+        if (!texto) return PLANO_NINGUNO;
+        s->texto = texto;
+        s->cap_texto = cap;
+    }
+    memcpy(s->texto + s->largo_texto, cadena, largo + 1);
+    s->cadenas[s->n_cadenas] = s->largo_texto;
+    s->largo_texto += (uint32_t)largo + 1;
+    s->tabla[j] = (int32_t)s->n_cadenas;
+    return (int32_t)s->n_cadenas++;
+}
+
+/**
+ * Visita de plano_escribir: agrega un nodo cuyos hijos ya se escribieron
+ * (sus índices están en el tope de la pila) y deja el suyo en la pila.
+ * @param n Nodo.
+ * @param profundidad No se usa.
+ * @param arg El Serializador.
+ */
+static void serializar_visita(Nodo *n, int profundidad, void *arg) {
+    Serializador *s = arg;
+    int32_t hijos[2] = { PLANO_NINGUNO, PLANO_NINGUNO };
+    (void)profundidad;
+    if (s->sin_memoria) return;     /* El resto del recorrido no se escribe */
+
+    for (int i = 1; i >= 0; --i) {
+        if (recorrido_hijo(n, i)) hijos[i] = s->pila[--s->n_pila];
+    }
+    if (s->n == s->cap) {
+        uint32_t cap = s->cap ? s->cap * 2 : SERIAL_NODOS_INICIAL;
+        NodoPlano *nodos = serial_realloc(s, s->nodos, cap * sizeof(NodoPlano));
+        if (!nodos) return;
+        s->nodos = nodos;
+        int32_t *pila = serial_realloc(s, s->pila, cap * sizeof(int32_t));
+        if (!pila) return;
+        s->pila = pila;
+        s->cap = cap;
+    }
+
+    NodoPlano *np = &s->nodos[s->n];
+    np->tipo = (uint8_t)n->tipo;
+    np->op = 0;
+    np->reservado = 0;
+    np->a = hijos[0];
+    np->b = hijos[1];
+    np->linea = n->linea;
+    np->columna = n->columna;
+    switch (n->tipo) {
+        case NODO_INT:
+            np->a = n->val_int;
+            break;
+        case NODO_BOOL:
+            np->a = n->val_bool;
+            break;
+        case NODO_ID:
+            np->a = internar(s, n->nombre);
+            break;
+        case NODO_OP:
+        case NODO_OP_RAPIDO:
+            np->tipo = NODO_OP;
+            np->op = (uint8_t)n->opBinaria.op;
+            break;
+        case NODO_SEQ:
+            /* Un return como primer elemento corta la secuencia */
+            if (hijos[0] != PLANO_NINGUNO && s->nodos[hijos[0]].tipo == NODO_RETURN)
+                s->nodos[hijos[0]].b = (int32_t)s->n;
+            break;
+        case NODO_DECL:
+        case NODO_ASSIGN:
+            np->b = hijos[0];
+            np->a = internar(s, n->assign.id);
+            break;
+        case NODO_RETURN:
+            break;
+        default:
+            s->invalido = 1;
+            break;
+    }
+    s->pila[s->n_pila++] = (int32_t)s->n++;
+}
+
+/**
+ * Serializa un AST y lo publica en ruta con cache_publicar, así que quien
+ * abra ruta ve el archivo completo o no lo ve (varios hilos de --batch pueden
+ * escribir la misma entrada).
+ * @param raiz Raíz del AST (NULL para el programa vacío).
+ * @param hash_fuente plano_hash del fuente.
+ * @param largo_fuente Bytes del fuente.
+ * @param ruta Archivo a escribir.
+ * @return 0 si se escribió, -1 si no (un nodo que el formato no admite, falta
+ *         de memoria o un error al publicar).
+ */
+int plano_escribir(Nodo *raiz, uint64_t hash_fuente, uint64_t largo_fuente, const char *ruta) {
+    Serializador s;
+    memset(&s, 0, sizeof(s));
+    recorrido_profundo(raiz, NULL, serializar_visita, &s);
+
+    CabeceraPlano cab;
+    memset(&cab, 0, sizeof(cab));
+    memcpy(cab.magia, PLANO_MAGIA, sizeof(PLANO_MAGIA));
+    cab.version = PLANO_VERSION;
+    cab.n_nodos = s.n;
+    cab.hash_fuente = hash_fuente;
+    cab.largo_fuente = largo_fuente;
+    cab.n_cadenas = s.n_cadenas;
+    cab.largo_texto = s.largo_texto;
+    cab.raiz = s.n ? (int32_t)s.n - 1 : PLANO_NINGUNO;
+
+    const void *const partes[] = { &cab, s.nodos, s.cadenas, s.texto };
+    const size_t largos[] = { sizeof(cab), s.n * sizeof(NodoPlano),
+                              s.n_cadenas * sizeof(uint32_t), s.largo_texto };
+    int resultado = s.invalido || s.sin_memoria ? -1 : cache_publicar(ruta, partes, largos, 4);
+
+    free(s.nodos);
+    free(s.pila);
+    free(s.cadenas);
+    free(s.texto);
+    free(s.tabla);
+    return resultado;
+}
+
+/**
+ * Verifica que los nodos formen un único árbol en postorden bien armado:
+ * cada nodo toma como hijos exactamente los subárboles que lo preceden, las
+ * referencias a cadenas existen y cada return apunta a su secuencia. Con eso
+ * eval_plano no puede leer fuera del mapeo aunque el archivo esté corrupto.
+ * @param p AST plano recién mapeado.
+ * @return 0 si es válido, -1 si no.
+ */
+static int validar_nodos(const AstPlano *p) {
+    const CabeceraPlano *cab = p->cabecera;
+    int32_t n = (int32_t)cab->n_nodos;
+    int32_t *pila = malloc((n + 1) * sizeof(int32_t));
+    int32_t n_pila = 0;
+    int valido = pila != NULL;
+
+    for (int32_t i = 0; i < n && valido; ++i) {
+        const NodoPlano *np = &p->nodos[i];
+        int32_t hijos[2] = { PLANO_NINGUNO, PLANO_NINGUNO };
+        int cadena = 0;
+        switch (np->tipo) {
+            case NODO_INT:
+            case NODO_BOOL:
+                break;
+            case NODO_ID:
+                cadena = 1;
+                break;
+            case NODO_OP:
+                valido = np->op <= TOP_MENOR;
+                /* fallthrough */
+            case NODO_SEQ:
+                hijos[0] = np->a;
+                hijos[1] = np->b;
+                break;
+            case NODO_ASSIGN:
+                valido = np->b != PLANO_NINGUNO;
+                /* fallthrough */
+            case NODO_DECL:
+                cadena = 1;
+                hijos[0] = np->b;
+                break;
+            case NODO_RETURN:
+                hijos[0] = np->a;
+                if (np->b != PLANO_NINGUNO)
+                    valido = np->b > i && np->b < n && p->nodos[np->b].tipo == NODO_SEQ &&
+                             p->nodos[np->b].a == i;
+                break;
+            default:
+                valido = 0;
+        }
+        if (cadena && (np->a < 0 || (uint32_t)np->a >= cab->n_cadenas)) valido = 0;
+        for (int k = 1; k >= 0 && valido; --k) {
+            if (hijos[k] == PLANO_NINGUNO) continue;
+            valido = n_pila > 0 && pila[--n_pila] == hijos[k];
+        }
+        pila[n_pila++] = i;
+    }
+    valido = valido && (n == 0 ? cab->raiz == PLANO_NINGUNO : n_pila == 1 && cab->raiz == n - 1);
+    free(pila);
+    return valido ? 0 : -1;
+}
+
+/**
+ * Mapea un AST plano y verifica que sea del fuente dado y que esté bien
+ * formado. Los datos se usan en el lugar, sin copiarlos ni ajustar punteros.
+ * @param p Dónde dejar el AST abierto.
+ * @param ruta Archivo.
+ * @param hash_fuente plano_hash del fuente.
+ * @param largo_fuente Bytes del fuente.
+ * @return 0 si se abrió, -1 si no existe o no sirve.
+ */
+int plano_abrir(AstPlano *p, const char *ruta, uint64_t hash_fuente, uint64_t largo_fuente) {
+    memset(p, 0, sizeof(*p));
+    int fd = open(ruta, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || (size_t)sb.st_size < sizeof(CabeceraPlano)) {
+        close(fd);
+        return -1;
+    }
+    void *base = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return -1;
+
+    const CabeceraPlano *cab = base;
+    p->base = base;
+    p->largo = (size_t)sb.st_size;
+    p->cabecera = cab;
+    if (memcmp(cab->magia, PLANO_MAGIA, sizeof(PLANO_MAGIA)) != 0 || cab->version != PLANO_VERSION ||
+        cab->hash_fuente != hash_fuente || cab->largo_fuente != largo_fuente ||
+        sizeof(CabeceraPlano) + (uint64_t)cab->n_nodos * sizeof(NodoPlano) +
+        (uint64_t)cab->n_cadenas * sizeof(uint32_t) + cab->largo_texto != p->largo) {
+        plano_cerrar(p);
+        return -1;
+    }
+    p->nodos = (const NodoPlano *)(cab + 1);
+    p->cadenas = (const uint32_t *)(p->nodos + cab->n_nodos);
+    p->texto = (const char *)(p->cadenas + cab->n_cadenas);
+
+    int valido = cab->n_cadenas == 0 || p->texto[cab->largo_texto - 1] == '\0';
+    for (uint32_t i = 0; i < cab->n_cadenas && valido; ++i) valido = p->cadenas[i] < cab->largo_texto;
+    if (!valido || validar_nodos(p) != 0) {
+        plano_cerrar(p);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Desmapea un AST plano.
+ * @param p AST plano abierto con plano_abrir.
+ */
+void plano_cerrar(AstPlano *p) {
+    if (p->base) munmap(p->base, p->largo);
+    memset(p, 0, sizeof(*p));
+}
+
+/**
+ * Reconstruye los Nodo de un AST plano con los constructores de siempre
+ * (cuentan en las estadísticas como si los hubiera creado el parser).
+ * @param ctx Contexto de compilación.
+ * @param p AST plano abierto.
+ * @return Raíz del AST (NULL para el programa vacío, o si no hubo memoria,
+ *         con ctx->error).
+ */
+Nodo *plano_a_ast(CompilerContext *ctx, const AstPlano *p) {
+    uint32_t n = p->cabecera->n_nodos;
+    if (n == 0) return NULL;
+    Nodo **hechos = malloc(n * sizeof(Nodo *));
+    if (!hechos) {
+        contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para reconstruir el AST");
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < n; ++i) {
+        const NodoPlano *np = &p->nodos[i];
+        /* a y b sólo son hijos en OP y SEQ, y b en DECL y ASSIGN; en RETURN,
+           a es el hijo y b apunta hacia adelante, a un nodo que aún no existe */
+        int hijos = np->tipo == NODO_OP || np->tipo == NODO_SEQ || np->tipo == NODO_RETURN;
+        int hijo_b = np->tipo == NODO_OP || np->tipo == NODO_SEQ ||
+                     np->tipo == NODO_DECL || np->tipo == NODO_ASSIGN;
+        Nodo *a = hijos && np->a != PLANO_NINGUNO ? hechos[np->a] : NULL;
+        Nodo *b = hijo_b && np->b != PLANO_NINGUNO ? hechos[np->b] : NULL;
+        const char *nombre;
+        switch (np->tipo) {
+            case NODO_INT:
+                hechos[i] = nodo_int(ctx, np->a);
+                break;
+            case NODO_BOOL:
+                hechos[i] = nodo_bool(ctx, np->a);
+                break;
+            case NODO_ID:
+                nombre = plano_cadena(p, np->a);
+                hechos[i] = nodo_ID(ctx, nombre, strlen(nombre));
+                break;
+            case NODO_OP:
+                hechos[i] = nodo_opBin(ctx, (TipoOP)np->op, a, b);
+                break;
+            case NODO_SEQ:
+                hechos[i] = nodo_seq(ctx, a, b);
+                break;
+            case NODO_DECL:
+                nombre = plano_cadena(p, np->a);
+                hechos[i] = nodo_decl(ctx, nombre, strlen(nombre), b);
+                break;
+            case NODO_ASSIGN:
+                nombre = plano_cadena(p, np->a);
+                hechos[i] = nodo_assign(ctx, nombre, strlen(nombre), b);
+                break;
+            default:    /* NODO_RETURN; plano_abrir ya descartó el resto */
+                hechos[i] = nodo_return(ctx, a);
+                break;
+        }
+        nodo_ubicar(hechos[i], np->linea, np->columna);
+    }
+
+    /* Cada constructor que falla libera sus hijos: lo construido cuelga de la raíz */
+    Nodo *raiz = hechos[n - 1];
+    free(hechos);
+    if (contexto_fallo(ctx)) {
+        nodo_libre(ctx, raiz);
+        return NULL;
+    }
+    return raiz;
+}
@@ -0,0 +1,104 @@
+#ifndef SERIALIZACION_H
+#define SERIALIZACION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ast.h"
+
+/* ------------------ AST en formato binario plano ------------------ */
+
+/*
+ * Un AST ya analizado se guarda en un archivo sin punteros, pensado para
+ * mapearse con mmap y usarse tal cual:
+ *
+ *   CabeceraPlano
+ *   NodoPlano[n_nodos]          en postorden: los hijos antes que el padre,
+ *                               la raíz al final
+ *   uint32_t[n_cadenas]         desplazamiento de cada cadena en el texto
+ *   char[largo_texto]           cadenas terminadas en NUL, sin repetir
+ *
+ * Los hijos se indican por índice (-1 si no hay) y los identificadores por
+ * número de cadena. Los enteros están en el orden de bytes de la máquina que
+ * escribió el archivo: es un formato de caché local, no de intercambio.
+ * eval_plano evalúa directamente sobre los datos mapeados; plano_a_ast
+ * reconstruye los Nodo para las pasadas que los necesitan.
+ */
+
+/* Identificación del formato; cambiar PLANO_VERSION si cambian el AST o la gramática */
+#define PLANO_MAGIA "CALCAST"
+#define PLANO_VERSION 2
+
+/* Ningún nodo (hijo ausente, programa vacío) */
+#define PLANO_NINGUNO (-1)
+
+/* Encabezado del archivo */
+typedef struct {
+    char magia[8];              /* PLANO_MAGIA con su NUL */
+    uint32_t version;
+    uint32_t n_nodos;
+    uint64_t hash_fuente;       /* plano_hash del fuente del que sale el AST */
+    uint64_t largo_fuente;
+    uint32_t n_cadenas;
+    uint32_t largo_texto;
+    int32_t raiz;               /* Índice de la raíz (el último) o PLANO_NINGUNO */
+    uint32_t reservado;
+} CabeceraPlano;
+
+/*
+ * Un nodo. Según el tipo:
+ *   NODO_INT, NODO_BOOL    a = valor
+ *   NODO_ID                a = cadena del nombre
+ *   NODO_OP                op, a = izquierdo, b = derecho
+ *   NODO_SEQ               a = primero, b = resto
+ *   NODO_DECL, NODO_ASSIGN a = cadena del nombre, b = expresión
+ *   NODO_RETURN            a = expresión; b = la NODO_SEQ de la que es el
+ *                          primer elemento (donde sigue la evaluación), o
+ *                          PLANO_NINGUNO
+ * y en todos la posición en el fuente (Nodo.linea, Nodo.columna).
+ */
+typedef struct {
+    uint8_t tipo;               /* TipoNodo */
+    uint8_t op;                 /* TipoOP */
+    uint16_t reservado;
+    int32_t a;
+    int32_t b;
+    int32_t linea;
+    int32_t columna;
+} NodoPlano;
+
+/* Un AST plano abierto (mapeado) */
+typedef struct AstPlano {
+    const CabeceraPlano *cabecera;
+    const NodoPlano *nodos;
+    const uint32_t *cadenas;
+    const char *texto;
+    void *base;                 /* Mapeo completo */
+    size_t largo;
+} AstPlano;
+
+/* ------------------ Prototipos de funciones ------------------ */
+
+uint64_t plano_hash(const char *datos, size_t largo);      /* FNV-1a de 64 bits */
+uint64_t plano_hash_seguir(uint64_t h, const char *datos, size_t largo);
+
+/* Serializa el AST y lo publica en ruta con un rename atómico; 0 si se pudo */
+int plano_escribir(Nodo *raiz, uint64_t hash_fuente, uint64_t largo_fuente, const char *ruta);
+
+/* Mapea y valida un archivo; 0 si es un AST plano de ese fuente */
+int plano_abrir(AstPlano *p, const char *ruta, uint64_t hash_fuente, uint64_t largo_fuente);
+void plano_cerrar(AstPlano *p);
+
+Nodo *plano_a_ast(CompilerContext *ctx, const AstPlano *p);  /* Reconstruye los Nodo */
+int eval_plano(CompilerContext *ctx, const AstPlano *p);     /* Como eval_nodo (ast.c) */
+
+/**
+ * Devuelve una cadena del texto del AST plano.
+ * @param p AST plano.
+ * @param i Número de cadena.
+ * @return La cadena, dentro del mapeo.
+ */
+static inline const char *plano_cadena(const AstPlano *p, int32_t i) {
+    return p->texto + p->cadenas[i];
+}
+
+#endif /* SERIALIZACION_H */
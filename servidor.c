@@ -0,0 +1,500 @@
+/* Servidor de compilación sobre un socket Unix con un bucle de epoll */
+
+/* Definiciones necesarias para accept4 */
+#define _GNU_SOURCE
+
+/* Inclusiones de bibliotecas estándar */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <malloc.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "servidor.h"
+
+/* Eventos que se piden a epoll_wait por vuelta */
+#define SERVIDOR_EVENTOS 64
+
+/* Bytes que se intentan leer por vez de una conexión */
+#define SERVIDOR_LECTURA 65536
+
+/* Un buffer vacío más grande que esto se libera en vez de conservarse para el
+   próximo pedido; también es lo máximo que se acumula sin enviar antes de
+   dejar de leer pedidos de esa conexión */
+#define SERVIDOR_RETENIDO (1u << 20)
+
+/* Buffer que crece y se reusa entre pedidos */
+typedef struct {
+    char *datos;
+    size_t n;
+    size_t cap;
+} Buffer;
+
+/* Un cliente conectado */
+typedef struct Conexion {
+    int fd;
+    Buffer entrada;             /* Recibido y todavía no procesado */
+    Buffer salida;              /* Respuestas todavía no enviadas */
+    size_t enviado;             /* Bytes de salida ya enviados */
+    int cerrar;                 /* Cerrar apenas se envíe lo pendiente */
+    uint32_t eventos;           /* Eventos registrados en epoll */
+    struct Conexion *ant, *sig; /* Lista de conexiones abiertas */
+} Conexion;
+
+/* Estado del servidor */
+typedef struct {
+    int epoll;
+    int escucha;
+    int senales;
+    FnPedido fn;
+    void *arg;
+    FILE *salida;               /* Memoria reusada por todos los pedidos */
+    FILE *errores;
+    char *texto_salida;
+    char *texto_errores;
+    size_t largo_salida;
+    size_t largo_errores;
+    Buffer fuente;              /* Fuente del pedido en curso, con dos NUL */
+    Conexion *conexiones;
+} Servidor;
+
+/**
+ * Asegura lugar para 'extra' bytes más en el buffer.
+ * @param b Buffer.
+ * @param extra Bytes a agregar.
+ * @return 0, o -1 si no hubo memoria (el buffer queda como estaba).
+ */
+static int buffer_reservar(Buffer *b, size_t extra) {
+    if (b->n + extra <= b->cap) return 0;
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->n + extra) cap *= 2;
+    char *datos = realloc(b->datos, cap);
+    if (!datos) return -1;
+    b->datos = datos;
+    b->cap = cap;
+    return 0;
+}
+
+/**
+ * Agrega bytes al final del buffer.
+ * @param b Buffer.
+ * @param datos Bytes.
+ * @param largo Cantidad.
+ * @return 0, o -1 si no hubo memoria (el buffer queda como estaba).
+ */
+static int buffer_agregar(Buffer *b, const void *datos, size_t largo) {
+    if (buffer_reservar(b, largo) != 0) return -1;
+    memcpy(b->datos + b->n, datos, largo);
+    b->n += largo;
+    return 0;
+}
+
+/**
+ * Descarta los primeros bytes del buffer. Si queda vacío y había crecido
+ * mucho, lo libera.
+ * @param b Buffer.
+ * @param largo Bytes a descartar.
+ */
+static void buffer_consumir(Buffer *b, size_t largo) {
+    b->n -= largo;
+    if (b->n > 0) memmove(b->datos, b->datos + largo, b->n);
+    else if (b->cap > SERVIDOR_RETENIDO) {
+        free(b->datos);
+        b->datos = NULL;
+        b->cap = 0;
+    }
+}
+
+/**
+ * Cierra una conexión y libera sus buffers.
+ * @param s Servidor.
+ * @param c Conexión.
+ */
+static void conexion_cerrar(Servidor *s, Conexion *c) {
+    epoll_ctl(s->epoll, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    if (c->ant) c->ant->sig = c->sig;
+    else s->conexiones = c->sig;
+    if (c->sig) c->sig->ant = c->ant;
+    free(c->entrada.datos);
+    free(c->salida.datos);
+    free(c);
+}
+
+/**
+ * Acepta todas las conexiones pendientes.
+ * @param s Servidor.
+ */
+static void aceptar(Servidor *s) {
+    int fd;
+    while ((fd = accept4(s->escucha, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        Conexion *c = calloc(1, sizeof(Conexion));
+        if (!c) {
+            /* Sin memoria se rechaza esta conexión; las otras siguen */
+            perror("calloc");
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->eventos = EPOLLIN;
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = c };
+        if (epoll_ctl(s->epoll, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            perror("epoll_ctl");
+            close(fd);
+            free(c);
+            continue;
+        }
+        c->sig = s->conexiones;
+        if (c->sig) c->sig->ant = c;
+        s->conexiones = c;
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) perror("accept4");
+}
+
+/**
+ * Agrega una respuesta a lo pendiente de enviar. Si no hay memoria para
+ * ella, se envían las anteriores y la conexión se cierra sin leer más.
+ * @param c Conexión.
+ * @param error 0 para "ok", distinto de 0 para "error".
+ * @param cuerpo Cuerpo de la respuesta.
+ * @param largo Largo del cuerpo.
+ * @return 0, o -1 si no hubo memoria.
+ */
+static int responder(Conexion *c, int error, const char *cuerpo, size_t largo) {
+    char encabezado[64];
+    int n = snprintf(encabezado, sizeof(encabezado), "%s %zu\n", error ? "error" : "ok", largo);
+    size_t antes = c->salida.n;
+    if (buffer_agregar(&c->salida, encabezado, (size_t)n) != 0 ||
+        buffer_agregar(&c->salida, cuerpo, largo) != 0) {
+        c->salida.n = antes;
+        c->entrada.n = 0;
+        c->cerrar = 1;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Responde a un pedido mal formado y marca la conexión para cerrarla: lo que
+ * siga en la entrada ya no se puede separar en pedidos.
+ * @param c Conexión.
+ * @param mensaje Diagnóstico.
+ */
+static void rechazar(Conexion *c, const char *mensaje) {
+    responder(c, 1, mensaje, strlen(mensaje));
+    c->entrada.n = 0;
+    c->cerrar = 1;
+}
+
+/**
+ * Abre (o reabre) los archivos en memoria donde escriben los pedidos.
+ * @param s Servidor.
+ * @return 0, o -1 si no hubo memoria (quedan cerrados, y el próximo pedido
+ *         vuelve a intentarlo).
+ */
+static int abrir_memoria(Servidor *s) {
+    if (s->salida) fclose(s->salida);
+    if (s->errores) fclose(s->errores);
+    free(s->texto_salida);
+    free(s->texto_errores);
+    s->texto_salida = s->texto_errores = NULL;
+    s->salida = open_memstream(&s->texto_salida, &s->largo_salida);
+    s->errores = open_memstream(&s->texto_errores, &s->largo_errores);
+    if (s->salida && s->errores) return 0;
+    if (s->salida) fclose(s->salida);
+    if (s->errores) fclose(s->errores);
+    free(s->texto_salida);
+    free(s->texto_errores);
+    s->salida = s->errores = NULL;
+    s->texto_salida = s->texto_errores = NULL;
+    return -1;
+}
+
+/**
+ * Después de un pedido grande, devuelve al sistema la memoria que sólo él
+ * necesitó: el fuente, la salida en memoria y lo que quede libre en malloc
+ * (el AST y la tabla ya se liberaron). Los pedidos chicos reusan todo.
+ * @param s Servidor.
+ */
+static void reciclar_memoria(Servidor *s) {
+    if (s->fuente.cap <= SERVIDOR_RETENIDO && s->largo_salida <= SERVIDOR_RETENIDO &&
+        s->largo_errores <= SERVIDOR_RETENIDO) return;
+    free(s->fuente.datos);
+    s->fuente = (Buffer){ NULL, 0, 0 };
+    abrir_memoria(s);
+    malloc_trim(0);
+}
+
+/**
+ * Ejecuta un pedido con el manejador y encola su respuesta. La salida y los
+ * errores se escriben en los mismos buffers de memoria en cada pedido.
+ * @param s Servidor.
+ * @param c Conexión.
+ * @param fases Fases pedidas.
+ * @param texto Fuente (dentro del buffer de entrada).
+ * @param largo Largo del fuente.
+ * @return 0, o -1 si no hubo memoria y se rechazó la conexión.
+ */
+static int atender_pedido(Servidor *s, Conexion *c, const char *fases,
+                          const char *texto, size_t largo) {
+    s->fuente.n = 0;
+    if ((!s->salida && abrir_memoria(s) != 0) || buffer_reservar(&s->fuente, largo + 2) != 0) {
+        rechazar(c, "Error: sin memoria para el pedido\n");
+        return -1;
+    }
+    buffer_agregar(&s->fuente, texto, largo);
+    buffer_agregar(&s->fuente, "\0\0", 2);
+    rewind(s->salida);
+    rewind(s->errores);
+
+    int error = s->fn(fases, s->fuente.datos, largo, s->salida, s->errores, s->arg);
+
+    FILE *f = error ? s->errores : s->salida;
+    fflush(f);
+    long n = ftell(f);
+    int rechazado = responder(c, error, error ? s->texto_errores : s->texto_salida, n > 0 ? (size_t)n : 0);
+    reciclar_memoria(s);
+    return rechazado;
+}
+
+/**
+ * Responde todos los pedidos completos que haya en la entrada de la conexión,
+ * mientras lo pendiente de enviar no pase de SERVIDOR_RETENIDO.
+ * @param s Servidor.
+ * @param c Conexión.
+ */
+static void procesar(Servidor *s, Conexion *c) {
+    while (c->entrada.n > 0 && c->salida.n - c->enviado < SERVIDOR_RETENIDO) {
+        size_t limite = c->entrada.n < SERVIDOR_MAX_ENCABEZADO ? c->entrada.n : SERVIDOR_MAX_ENCABEZADO;
+        char *fin = memchr(c->entrada.datos, '\n', limite);
+        if (!fin) {
+            if (limite == SERVIDOR_MAX_ENCABEZADO) rechazar(c, "Error: encabezado demasiado largo\n");
+            return;
+        }
+
+        /* "<fases> <largo>" */
+        char encabezado[SERVIDOR_MAX_ENCABEZADO];
+        size_t largo_encabezado = (size_t)(fin - c->entrada.datos);
+        memcpy(encabezado, c->entrada.datos, largo_encabezado);
+        encabezado[largo_encabezado] = '\0';
+        char *espacio = strchr(encabezado, ' ');
+        char *resto;
+        errno = 0;
+        unsigned long long largo = espacio ? strtoull(espacio + 1, &resto, 10) : 0;
+        if (!espacio || espacio == encabezado || espacio[1] < '0' || espacio[1] > '9' ||
+            *resto != '\0' || errno != 0) {
+            rechazar(c, "Error: pedido mal formado (se espera '<fases> <largo>')\n");
+            return;
+        }
+        if (largo > SERVIDOR_MAX_PEDIDO) {
+            rechazar(c, "Error: fuente demasiado largo\n");
+            return;
+        }
+        *espacio = '\0';
+
+        size_t total = largo_encabezado + 1 + (size_t)largo;
+        if (c->entrada.n < total) return;     /* Falta parte del fuente */
+        if (atender_pedido(s, c, encabezado, fin + 1, (size_t)largo) != 0) return;
+        buffer_consumir(&c->entrada, total);
+    }
+}
+
+/**
+ * Lee todo lo disponible en la conexión.
+ * @param c Conexión.
+ * @return 0 si la conexión sigue, -1 si hubo un error (o no hubo memoria).
+ */
+static int leer(Conexion *c) {
+    for (;;) {
+        if (buffer_reservar(&c->entrada, SERVIDOR_LECTURA) != 0) return -1;
+        ssize_t n = read(c->fd, c->entrada.datos + c->entrada.n, c->entrada.cap - c->entrada.n);
+        if (n > 0) {
+            c->entrada.n += (size_t)n;
+            if (c->entrada.n > SERVIDOR_MAX_ENCABEZADO + SERVIDOR_MAX_PEDIDO) return 0;
+            continue;
+        }
+        if (n == 0) {
+            c->cerrar = 1;          /* El cliente no manda más: responder lo que haya */
+            return 0;
+        }
+        if (errno == EINTR) continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+}
+
+/**
+ * Envía lo pendiente sin bloquearse.
+ * @param c Conexión.
+ * @return 0 si la conexión sigue, -1 si hubo un error.
+ */
+static int enviar(Conexion *c) {
+    while (c->enviado < c->salida.n) {
+        ssize_t n = send(c->fd, c->salida.datos + c->enviado, c->salida.n - c->enviado, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        }
+        c->enviado += (size_t)n;
+    }
+    buffer_consumir(&c->salida, c->enviado);
+    c->enviado = 0;
+    return 0;
+}
+
+/**
+ * Atiende los eventos de una conexión: lee, responde lo que esté completo,
+ * envía, y ajusta qué eventos esperar. Mientras haya mucho sin enviar deja de
+ * leer, para que un cliente que no lee sus respuestas no haga crecer la
+ * memoria del servidor. Si el cliente cerró su lado, la conexión se cierra
+ * recién cuando se respondieron todos sus pedidos completos y se envió todo.
+ * @param s Servidor.
+ * @param c Conexión.
+ * @param eventos Eventos de epoll.
+ */
+static void atender_conexion(Servidor *s, Conexion *c, uint32_t eventos) {
+    if ((eventos & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !c->cerrar && leer(c) != 0) {
+        conexion_cerrar(s, c);
+        return;
+    }
+    /* procesar se detiene con mucho sin enviar: mientras enviar vacíe la
+       salida y queden pedidos completos, hay que volver a procesar, también
+       después de que el cliente cerró su lado */
+    size_t antes;
+    do {
+        antes = c->entrada.n;
+        procesar(s, c);
+        if (enviar(c) != 0) {
+            conexion_cerrar(s, c);
+            return;
+        }
+    } while (c->salida.n == 0 && c->entrada.n > 0 && c->entrada.n != antes);
+
+    /* Con la salida enviada, en la entrada sólo puede quedar un pedido a medias */
+    size_t pendiente = c->salida.n - c->enviado;
+    if (c->cerrar && pendiente == 0) {
+        conexion_cerrar(s, c);
+        return;
+    }
+    uint32_t quiero = 0;
+    if (!c->cerrar && pendiente < SERVIDOR_RETENIDO) quiero |= EPOLLIN;
+    if (pendiente > 0) quiero |= EPOLLOUT;
+    if (quiero != c->eventos) {
+        struct epoll_event ev = { .events = quiero, .data.ptr = c };
+        epoll_ctl(s->epoll, EPOLL_CTL_MOD, c->fd, &ev);
+        c->eventos = quiero;
+    }
+}
+
+/**
+ * Crea el socket de escucha en ruta. Si ya hay un socket con ese nombre (de
+ * un servidor anterior) se reemplaza.
+ * @param ruta Ruta del socket.
+ * @return Descriptor, o -1 si no se pudo.
+ */
+static int escuchar(const char *ruta) {
+    struct sockaddr_un dir;
+    if (strlen(ruta) >= sizeof(dir.sun_path)) {
+        fprintf(stderr, "Error: ruta de socket demasiado larga '%s'\n", ruta);
+        return -1;
+    }
+    memset(&dir, 0, sizeof(dir));
+    dir.sun_family = AF_UNIX;
+    strcpy(dir.sun_path, ruta);
+
+    struct stat sb;
+    if (lstat(ruta, &sb) == 0 && S_ISSOCK(sb.st_mode)) unlink(ruta);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr *)&dir, sizeof(dir)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        perror(ruta);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Atiende pedidos en el socket ruta hasta recibir SIGINT o SIGTERM. Cada
+ * pedido se pasa a fn con la salida y los errores en memoria; el mismo buffer
+ * de fuente y los mismos de salida se reusan en todos los pedidos.
+ * @param ruta Ruta del socket.
+ * @param fn Manejador de pedidos.
+ * @param arg Argumento del manejador.
+ * @return 0 si terminó por una señal, -1 si no se pudo iniciar.
+ */
+int servidor_ejecutar(const char *ruta, FnPedido fn, void *arg) {
+    Servidor s;
+    memset(&s, 0, sizeof(s));
+    s.fn = fn;
+    s.arg = arg;
+
+    /* Las señales de fin llegan como eventos, para cerrar en orden */
+    sigset_t fin, anterior;
+    sigemptyset(&fin);
+    sigaddset(&fin, SIGINT);
+    sigaddset(&fin, SIGTERM);
+    sigprocmask(SIG_BLOCK, &fin, &anterior);
+
+    s.escucha = escuchar(ruta);
+    if (s.escucha < 0) {
+        sigprocmask(SIG_SETMASK, &anterior, NULL);
+        return -1;
+    }
+    s.senales = signalfd(-1, &fin, SFD_NONBLOCK | SFD_CLOEXEC);
+    s.epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (s.senales < 0 || s.epoll < 0 || abrir_memoria(&s) != 0) {
+        perror("servidor");
+        if (s.senales >= 0) close(s.senales);
+        if (s.epoll >= 0) close(s.epoll);
+        close(s.escucha);
+        unlink(ruta);
+        sigprocmask(SIG_SETMASK, &anterior, NULL);
+        return -1;
+    }
+
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &s.escucha };
+    epoll_ctl(s.epoll, EPOLL_CTL_ADD, s.escucha, &ev);
+    ev.data.ptr = &s.senales;
+    epoll_ctl(s.epoll, EPOLL_CTL_ADD, s.senales, &ev);
+    fprintf(stderr, "Escuchando en '%s'\n", ruta);
+
+    struct epoll_event eventos[SERVIDOR_EVENTOS];
+    int seguir = 1;
+    while (seguir) {
+        int n = epoll_wait(s.epoll, eventos, SERVIDOR_EVENTOS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            void *p = eventos[i].data.ptr;
+            if (p == &s.escucha) aceptar(&s);
+            else if (p == &s.senales) seguir = 0;
+            else atender_conexion(&s, p, eventos[i].events);
+        }
+    }
+
+    while (s.conexiones) conexion_cerrar(&s, s.conexiones);
+    close(s.epoll);
+    close(s.senales);
+    close(s.escucha);
+    unlink(ruta);
+    if (s.salida) fclose(s.salida);
+    if (s.errores) fclose(s.errores);
+    free(s.texto_salida);
+    free(s.texto_errores);
+    free(s.fuente.datos);
+    sigprocmask(SIG_SETMASK, &anterior, NULL);
+    return 0;
+}
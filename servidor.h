@@ -0,0 +1,46 @@
+#ifndef SERVIDOR_H
+#define SERVIDOR_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* ------------------ Servidor de compilación (--serve) ------------------ */
+
+/*
+ * Un proceso que queda vivo escuchando en un socket Unix y compila los
+ * programas que le mandan, sin pagar en cada uno el arranque del proceso.
+ * Un único hilo atiende a todos los clientes con epoll: lee de cada conexión
+ * lo que haya, responde cada pedido completo y escribe sin bloquearse lo que
+ * el cliente todavía no leyó. Una conexión puede mandar varios pedidos
+ * seguidos; las respuestas salen en el mismo orden.
+ *
+ * Pedido:     <fases> <largo>\n<largo bytes de fuente>
+ * Respuesta:  ok <largo>\n<largo bytes de salida>
+ *             error <largo>\n<largo bytes de diagnósticos>
+ *
+ * <fases> es una lista separada por comas (ver calc.c); la interpreta el
+ * manejador. Un pedido mal formado recibe una respuesta de error y la
+ * conexión se cierra después de enviarla.
+ */
+
+/* Largo máximo de la línea de encabezado de un pedido */
+#define SERVIDOR_MAX_ENCABEZADO 256
+
+/* Largo máximo del fuente de un pedido */
+#define SERVIDOR_MAX_PEDIDO (64u << 20)
+
+/*
+ * Atiende un pedido. fuente está seguido de dos NUL y el manejador puede
+ * escribir en él mientras lo usa. Lo que escriba en salida es el cuerpo de la
+ * respuesta si devuelve 0; si devuelve distinto de 0, el cuerpo es lo que
+ * escribió en errores.
+ */
+typedef int (*FnPedido)(const char *fases, char *fuente, size_t largo,
+                        FILE *salida, FILE *errores, void *arg);
+
+/* ------------------ Prototipos de funciones ------------------ */
+
+/* Escucha en ruta hasta recibir SIGINT o SIGTERM; 0 si terminó bien */
+int servidor_ejecutar(const char *ruta, FnPedido fn, void *arg);
+
+#endif /* SERVIDOR_H */
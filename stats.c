@@ -0,0 +1,153 @@
+/* Estadísticas de compilación: tiempos por fase y contadores */
+
+/* Definiciones necesarias para compatibilidad POSIX */
+#define _POSIX_C_SOURCE 200809L
+
+/* Inclusiones de bibliotecas estándar */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+
+/* Nombres de las fases, en el orden de Fase */
+static const char *nombres_fase[NUM_FASES] = {
+    "lexico", "sintaxis", "dot", "asm", "eval", "interpretar", "impresion"
+};
+
+/* Nombres de los tipos de nodo, en el orden de TipoNodo */
+static const char *nombres_nodo[NODO_OP_RAPIDO + 1] = {
+    "PROG", "DECL", "SENT", "ASSIGN", "RETURN", "OP", "INT", "BOOL", "ID", "SEQ",
+    "OP_RAPIDO"
+};
+
+/**
+ * Devuelve el tiempo monótono actual.
+ * @return Segundos desde un origen arbitrario.
+ */
+double stats_reloj(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Devuelve el nombre de un tipo de nodo, como aparece en las estadísticas.
+ * @param tipo Tipo de nodo.
+ * @return Nombre ("OP", "INT"...).
+ */
+const char *stats_nombre_nodo(TipoNodo tipo) {
+    return tipo <= NODO_OP_RAPIDO ? nombres_nodo[tipo] : "?";
+}
+
+/**
+ * Suma instrucciones emitidas de un mnemónico. Los mnemónicos se listan en el
+ * orden en que aparecen por primera vez.
+ * @param e Estadísticas a actualizar.
+ * @param mnemonico Nombre de la instrucción.
+ * @param cantidad Cuántas se emitieron.
+ */
+void stats_contar_instrucciones(Estadisticas *e, const char *mnemonico, unsigned long cantidad) {
+    for (int i = 0; i < e->n_instr; ++i) {
+        if (strcmp(e->instr[i].nombre, mnemonico) == 0) {
+            e->instr[i].cantidad += cantidad;
+            return;
+        }
+    }
+    if (e->n_instr < STATS_MAX_MNEMONICOS) {
+        snprintf(e->instr[e->n_instr].nombre, sizeof(e->instr[0].nombre), "%s", mnemonico);
+        e->instr[e->n_instr].cantidad = cantidad;
+        e->n_instr++;
+    }
+}
+
+/**
+ * Suma las estadísticas de una compilación a un total (usado por --batch).
+ * @param total Acumulador.
+ * @param e Estadísticas a sumar.
+ */
+void stats_acumular(Estadisticas *total, const Estadisticas *e) {
+    for (int i = 0; i < NUM_FASES; ++i) total->tiempo[i] += e->tiempo[i];
+    for (int i = 0; i <= NODO_OP_RAPIDO; ++i) total->nodos[i] += e->nodos[i];
+    total->tokens += e->tokens;
+    total->bytes += e->bytes;
+    total->reservas += e->reservas;
+    total->busquedas += e->busquedas;
+    total->comparaciones += e->comparaciones;
+    total->cache_aciertos += e->cache_aciertos;
+    total->cache_fallos += e->cache_fallos;
+    total->cache_desalojos += e->cache_desalojos;
+
+    for (int i = 0; i < e->n_instr; ++i) {
+        int j = 0;
+        while (j < total->n_instr && strcmp(total->instr[j].nombre, e->instr[i].nombre) != 0) j++;
+        if (j == total->n_instr) {
+            if (j == STATS_MAX_MNEMONICOS) continue;
+            strcpy(total->instr[j].nombre, e->instr[i].nombre);
+            total->instr[j].cantidad = 0;
+            total->n_instr++;
+        }
+        total->instr[j].cantidad += e->instr[i].cantidad;
+    }
+}
+
+/**
+ * Imprime las estadísticas en formato legible.
+ * @param e Estadísticas a imprimir.
+ * @param f Archivo de salida.
+ */
+void stats_imprimir(const Estadisticas *e, FILE *f) {
+    double total = 0;
+    fprintf(f, "Estadísticas de compilación:\n");
+    fprintf(f, "----------------------------------------\n");
+    fprintf(f, "%-14s %12s\n", "Fase", "Tiempo (ms)");
+    for (int i = 0; i < NUM_FASES; ++i) {
+        fprintf(f, "%-14s %12.3f\n", nombres_fase[i], e->tiempo[i] * 1e3);
+        total += e->tiempo[i];
+    }
+    fprintf(f, "%-14s %12.3f\n", "total", total * 1e3);
+    fprintf(f, "----------------------------------------\n");
+    fprintf(f, "%-14s %12lu\n", "tokens", e->tokens);
+    fprintf(f, "%-14s %12lu\n", "bytes", e->bytes);
+    fprintf(f, "%-14s %12lu\n", "reservas", e->reservas);
+    fprintf(f, "%-14s %12lu\n", "busquedas", e->busquedas);
+    fprintf(f, "%-14s %12lu\n", "comparaciones", e->comparaciones);
+    if (e->cache_aciertos || e->cache_fallos) {
+        fprintf(f, "%-14s %12lu\n", "cache aciertos", e->cache_aciertos);
+        fprintf(f, "%-14s %12lu\n", "cache fallos", e->cache_fallos);
+        fprintf(f, "%-14s %12lu\n", "desalojos", e->cache_desalojos);
+    }
+    fprintf(f, "----------------------------------------\n");
+    fprintf(f, "Nodos por tipo:\n");
+    for (int i = 0; i <= NODO_OP_RAPIDO; ++i) {
+        if (e->nodos[i]) fprintf(f, "  %-12s %12lu\n", nombres_nodo[i], e->nodos[i]);
+    }
+    fprintf(f, "Instrucciones por mnemónico:\n");
+    for (int i = 0; i < e->n_instr; ++i) {
+        fprintf(f, "  %-12s %12lu\n", e->instr[i].nombre, e->instr[i].cantidad);
+    }
+}
+
+/**
+ * Imprime las estadísticas como un objeto JSON en una línea.
+ * @param e Estadísticas a imprimir.
+ * @param f Archivo de salida.
+ */
+void stats_imprimir_json(const Estadisticas *e, FILE *f) {
+    fprintf(f, "{\"tiempo_ms\":{");
+    for (int i = 0; i < NUM_FASES; ++i) {
+        fprintf(f, "%s\"%s\":%.6f", i ? "," : "", nombres_fase[i], e->tiempo[i] * 1e3);
+    }
+    fprintf(f, "},\"tokens\":%lu,\"bytes\":%lu,\"reservas\":%lu,"
+               "\"busquedas\":%lu,\"comparaciones\":%lu,\"cache\":{\"aciertos\":%lu,"
+               "\"fallos\":%lu,\"desalojos\":%lu},\"nodos\":{",
+            e->tokens, e->bytes, e->reservas, e->busquedas, e->comparaciones,
+            e->cache_aciertos, e->cache_fallos, e->cache_desalojos);
+    for (int i = 0; i <= NODO_OP_RAPIDO; ++i) {
+        fprintf(f, "%s\"%s\":%lu", i ? "," : "", nombres_nodo[i], e->nodos[i]);
+    }
+    fprintf(f, "},\"instrucciones\":{");
+    for (int i = 0; i < e->n_instr; ++i) {
+        fprintf(f, "%s\"%s\":%lu", i ? "," : "", e->instr[i].nombre, e->instr[i].cantidad);
+    }
+    fprintf(f, "}}\n");
+}
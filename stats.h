@@ -0,0 +1,52 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include "ast.h"
+
+/* ------------------ Estadísticas de compilación (--stats) ------------------ */
+
+/* Fases medidas */
+typedef enum {
+    FASE_LEXICO,        /* yylex */
+    FASE_SINTAXIS,      /* yyparse sin contar yylex */
+    FASE_DOT,           /* exportar_dot */
+    FASE_ASM,           /* generar_asm */
+    FASE_EVAL,          /* eval_nodo */
+    FASE_INTERPRETAR,   /* interpretar_programa */
+    FASE_IMPRESION,     /* --print-ast / --print-symbols */
+    NUM_FASES
+} Fase;
+
+/* Máximo de mnemónicos distintos que se cuentan */
+#define STATS_MAX_MNEMONICOS 32
+
+/* Contadores acumulados durante una compilación (uno por CompilerContext) */
+typedef struct {
+    double tiempo[NUM_FASES];               /* Segundos por fase */
+    unsigned long tokens;                   /* Tokens devueltos por yylex */
+    unsigned long nodos[NODO_OP_RAPIDO + 1];/* Nodos creados por TipoNodo */
+    unsigned long bytes;                    /* Bytes pedidos a malloc/strdup */
+    unsigned long reservas;                 /* Cantidad de reservas */
+    unsigned long busquedas;                /* Búsquedas en la tabla de símbolos */
+    unsigned long comparaciones;            /* strcmp hechos en esas búsquedas */
+    unsigned long cache_aciertos;           /* Compilaciones servidas por --cache (.res o .ast) */
+    unsigned long cache_fallos;             /* Compilaciones que no encontraron ninguno */
+    unsigned long cache_desalojos;          /* Entradas borradas por el tamaño máximo */
+    struct {
+        char nombre[16];
+        unsigned long cantidad;
+    } instr[STATS_MAX_MNEMONICOS];          /* Instrucciones emitidas por mnemónico */
+    int n_instr;
+} Estadisticas;
+
+/* ------------------ Prototipos de funciones ------------------ */
+
+double stats_reloj(void);                       /* CLOCK_MONOTONIC en segundos */
+const char *stats_nombre_nodo(TipoNodo tipo);   /* "OP", "INT"... */
+void stats_contar_instrucciones(Estadisticas *e, const char *mnemonico, unsigned long cantidad);
+void stats_acumular(Estadisticas *total, const Estadisticas *e);   /* total += e */
+void stats_imprimir(const Estadisticas *e, FILE *f);        /* Formato legible */
+void stats_imprimir_json(const Estadisticas *e, FILE *f);   /* Formato JSON */
+
+#endif /* STATS_H */
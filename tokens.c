@@ -0,0 +1,123 @@
+/* Tokenización completa del fuente a un arreglo compacto */
+
+/* Inclusiones de bibliotecas estándar */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "tokens.h"
+#include "lexico.h"
+
+/* Capacidad inicial del arreglo de tokens */
+#define TOKENS_INICIAL 1024
+
+/* Interfaz del lexer reentrante (calc-lexico.l) */
+int yylex(YYSTYPE *yylval_param, void *yyscanner);
+char *yyget_text(void *yyscanner);
+
+/**
+ * Deja un arreglo vacío.
+ * @param t Arreglo.
+ */
+void tokens_iniciar(Tokens *t) {
+    t->tipo = NULL;
+    t->valor = NULL;
+    t->desplazamiento = NULL;
+    t->n = t->cap = 0;
+}
+
+/**
+ * Asegura lugar para al menos 'cap' tokens.
+ * @param t Arreglo.
+ * @param cap Capacidad pedida.
+ * @return 0, o -1 si no hubo memoria (los tokens que tenía siguen ahí).
+ */
+int tokens_reservar(Tokens *t, size_t cap) {
+    if (cap <= t->cap) return 0;
+    uint8_t *tipo = realloc(t->tipo, cap * sizeof(uint8_t));
+    if (tipo) t->tipo = tipo;
+    int32_t *valor = realloc(t->valor, cap * sizeof(int32_t));
+    if (valor) t->valor = valor;
+    uint32_t *desplazamiento = realloc(t->desplazamiento, cap * sizeof(uint32_t));
+    if (desplazamiento) t->desplazamiento = desplazamiento;
+    if (!tipo || !valor || !desplazamiento) return -1;
+    t->cap = cap;
+    return 0;
+}
+
+/**
+ * Comprueba que los desplazamientos del fuente entren en el arreglo de tokens.
+ * @param ctx Contexto con el fuente.
+ * @return 0, o -1 si el fuente supera los 4 GiB (con ctx->error).
+ */
+int tokens_comprobar_largo(CompilerContext *ctx) {
+    if (ctx->largo_fuente <= UINT32_MAX) return 0;
+    contexto_error(ctx, ERROR_MEMORIA, 0, 0, "el fuente supera los 4 GiB que admite el arreglo de tokens");
+    return -1;
+}
+
+/**
+ * Agrega un token al final del arreglo.
+ * @param t Arreglo.
+ * @param token Token de Bison (0 para el fin de la entrada).
+ * @param valor Número de un NUMERO o largo de un ID.
+ * @param desplazamiento Inicio del lexema en el fuente (menos de 4 GiB).
+ * @return 0, o -1 si no hubo memoria.
+ */
+int tokens_agregar(Tokens *t, int token, int32_t valor, size_t desplazamiento) {
+    if (t->n == t->cap && tokens_reservar(t, t->cap ? t->cap * 2 : TOKENS_INICIAL) != 0)
+        return -1;
+    t->tipo[t->n] = (uint8_t)(token ? token - TOKEN_BASE : 0);
+    t->valor[t->n] = valor;
+    t->desplazamiento[t->n] = (uint32_t)desplazamiento;
+    t->n++;
+    return 0;
+}
+
+/**
+ * Libera los arreglos.
+ * @param t Arreglo.
+ */
+void tokens_liberar(Tokens *t) {
+    free(t->tipo);
+    free(t->valor);
+    free(t->desplazamiento);
+    tokens_iniciar(t);
+}
+
+/**
+ * Tokeniza todo el fuente del contexto con el lexer elegido. El arreglo
+ * termina con el token de fin, ubicado al final del fuente, salvo que falle.
+ * @param ctx Contexto con el lexer ya iniciado.
+ * @param t Arreglo (vacío) a completar.
+ * @return 0, o -1 si el fuente no entra en el arreglo o no hubo memoria
+ *         (con ctx->error; el arreglo queda a medias).
+ */
+int tokens_lexear(CompilerContext *ctx, Tokens *t) {
+    if (tokens_comprobar_largo(ctx) != 0) return -1;
+    YYSTYPE lval;
+    int token;
+    double t0 = stats_reloj();
+    do {
+        size_t inicio;
+        if (ctx->lexer == LEXER_SIMD) {
+            token = lexico_simd(&lval, ctx);
+            inicio = ctx->inicio_token;
+        } else {
+            token = yylex(&lval, ctx->scanner);
+            inicio = (size_t)(yyget_text(ctx->scanner) - ctx->fuente);
+        }
+        if (token == 0) inicio = ctx->largo_fuente;
+
+        int32_t valor = 0;
+        if (token == NUMERO) valor = lval.num;
+        else if (token == ID) valor = (int32_t)lval.lex.largo;
+        if (tokens_agregar(t, token, valor, inicio) != 0) {
+            contexto_error(ctx, ERROR_MEMORIA, 0, 0, "sin memoria para los tokens");
+            return -1;
+        }
+    } while (token != 0);
+    ctx->stats.tiempo[FASE_LEXICO] += stats_reloj() - t0;
+    ctx->stats.tokens += t->n;
+    return 0;
+}
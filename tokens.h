@@ -0,0 +1,69 @@
+#ifndef TOKENS_H
+#define TOKENS_H
+
+#include <stdint.h>
+#include "contexto.h"
+#include "calc-sintaxis.tab.h"
+
+/* ------------------ Arreglo de tokens ------------------ */
+
+/*
+ * El fuente se tokeniza completo antes de parsear y el parser lee de este
+ * arreglo en vez de llamar al lexer. Cada token ocupa 9 bytes repartidos en
+ * tres arreglos paralelos: el tipo en un byte, un valor de 32 bits (el número
+ * de un NUMERO o el largo de un ID) y el desplazamiento de 32 bits del lexema
+ * en el fuente. La línea no se guarda: sólo hace falta para los errores y se
+ * recalcula contando saltos hasta el desplazamiento.
+ *
+ * Un arreglo sirve mientras viva el fuente del que salió: se puede parsear
+ * más de una vez, guardar junto al fuente o armar por partes y concatenar.
+ */
+typedef struct Tokens {
+    uint8_t *tipo;                  /* Token - TOKEN_BASE; 0 es el fin de la entrada */
+    int32_t *valor;                 /* NUMERO: valor; ID: largo del lexema */
+    uint32_t *desplazamiento;       /* Inicio del lexema en el fuente */
+    size_t n;
+    size_t cap;
+} Tokens;
+
+/* Los tokens de Bison empiezan en 258; se guardan restando esta base */
+#define TOKEN_BASE 256
+
+/**
+ * Devuelve el token i del arreglo con su valor semántico, como yylex.
+ * @param t Arreglo de tokens.
+ * @param fuente Fuente del que salió el arreglo.
+ * @param i Índice del token.
+ * @param lval Valor semántico a completar.
+ * @return Token de Bison (0 al final).
+ */
+static inline int tokens_leer(const Tokens *t, const char *fuente, size_t i, YYSTYPE *lval) {
+    int token = t->tipo[i] ? t->tipo[i] + TOKEN_BASE : 0;
+    if (token == NUMERO) {
+        lval->num = t->valor[i];
+    } else if (token == ID) {
+        lval->lex.texto = fuente + t->desplazamiento[i];
+        lval->lex.largo = (uint32_t)t->valor[i];
+        lval->lex.propio = 0;
+    }
+    return token;
+}
+
+/* ------------------ Prototipos de funciones ------------------ */
+
+void tokens_iniciar(Tokens *t);
+int tokens_reservar(Tokens *t, size_t cap);     /* 0, o -1 si no hubo memoria */
+int tokens_agregar(Tokens *t, int token, int32_t valor, size_t desplazamiento);
+void tokens_liberar(Tokens *t);
+int tokens_comprobar_largo(CompilerContext *ctx);   /* -1 si el fuente supera los 4 GiB */
+
+/* Tokeniza todo ctx->fuente con ctx->lexer (después de contexto_iniciar_lexico).
+   Devuelve 0, o -1 si no hubo memoria (con ctx->error). */
+int tokens_lexear(CompilerContext *ctx, Tokens *t);
+
+/* Igual, pero partiendo el fuente en trozos que se tokenizan en paralelo con
+   ctx->hilos_lexico hilos. Está en paralelo.c, que usa el planificador y no
+   forma parte de libcalc: el driver la instala en ctx->lexear. */
+int tokens_lexear_paralelo(CompilerContext *ctx, Tokens *t);
+
+#endif /* TOKENS_H */